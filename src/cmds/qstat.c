@@ -2420,6 +2420,9 @@ tcl_stat(char *type, struct batch_status *bs, int f_opt)
 }
 #endif /* localmod 071 */
 
+/* the tcl script is given all the status at once */
+#define tcl_active() (interp != NULL)
+
 void
 #ifdef NAS /* localmod 071 */
 tcl_run(int tcl_opt)
@@ -2458,6 +2461,7 @@ tcl_run(int f_opt)
 #define tcl_stat(type, bs, f_opt) 1
 #define tcl_run(f_opt)
 #endif /* localmod 071 */
+#define tcl_active() 0
 #endif /* TCL_QSTAT */
 
 int
@@ -2503,6 +2507,7 @@ main(int argc, char **argv, char **envp) /* qstat */
 	       SERVERS } mode;
 	struct batch_status *p_status;
 	struct batch_status *p_server = NULL;
+	int more = 0; /* more parts of the job status to read */
 	struct attropl *p_atropl = 0;
 	struct attropl *new_atropl;
 #ifdef NAS /* localmod 071 */
@@ -3081,7 +3086,21 @@ qstat -B [-f] [-F format] [-D delim] [ server_name... ]\n";
 					}
 				}
 
+				more = 0;
 				if ((stat_single_job == 1) || (new_atropl == 0)) {
+#ifndef NAS /* localmod 071 */
+					/*
+					 * the default and full displays print each part as it
+					 * comes in, a JSON document is built whole
+					 */
+					if ((alt_opt & ~ALT_DISPLAY_w) == 0 &&
+					    (f_opt ? !tcl_active() && output_format != FORMAT_JSON : output_format == FORMAT_DEFAULT)) {
+						do {
+							p_status = pbs_statjob_iter(conn, (E_opt == 1) ? query_job_list : job_id_out,
+										    display_attribs, extend, &more);
+						} while (p_status == NULL && more);
+					} else
+#endif /* localmod 071 */
 					if (E_opt == 1)
 						p_status = pbs_statjob(conn, query_job_list, display_attribs, extend);
 					else
@@ -3167,6 +3186,18 @@ qstat -B [-f] [-F format] [-D delim] [ server_name... ]\n";
 					} else if (f_opt == 0 || tcl_stat("job", p_status, f_opt))
 						if (display_statjob(p_status, p_server, f_opt, how_opt, alt_opt, wide))
 							exit_qstat("out of memory");
+					while (more) {
+						pbs_statfree(p_status);
+						p_status = pbs_statjob_iter(conn, NULL, NULL, NULL, &more);
+						if (p_status == NULL && pbs_errno != PBSE_NONE) {
+							prt_job_err("qstat", conn, job_id_out);
+							any_failed = pbs_errno;
+							break;
+						}
+						/* the header went out with the first part */
+						if (p_status && display_statjob(p_status, NULL, f_opt, how_opt, alt_opt, wide))
+							exit_qstat("out of memory");
+					}
 #endif /* localmod 071 */
 					p_header = FALSE;
 					pbs_statfree(p_status);
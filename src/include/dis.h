@@ -204,6 +204,12 @@ extern void DIS_tcp_funcs();
 
 #define PBS_DIS_BUFSZ 8192
 
+/*
+ * Bit in the auxcode of the reply to a Connect request, set by a server
+ * that reads the compact encoding, see dis_set_compact()
+ */
+#define DIS_COMPACT_OFFER 0x1
+
 #define DIS_WRITE_BUF 0
 #define DIS_READ_BUF 1
 
@@ -212,6 +218,7 @@ typedef struct pbs_dis_buf {
 	size_t tdis_len;
 	char *tdis_pos;
 	char *tdis_data;
+	int tdis_compact; /* pkt in buffer uses the compact encoding */
 } pbs_dis_buf_t;
 
 typedef struct pbs_tcp_auth_data {
@@ -224,6 +231,7 @@ typedef struct pbs_tcp_chan {
 	pbs_dis_buf_t readbuf;
 	pbs_dis_buf_t writebuf;
 	int is_old_client; /* This is just for backward compatibility */
+	int is_compact;	   /* peer reads the compact encoding, see dis_set_compact() */
 	pbs_tcp_auth_data_t auths[2];
 } pbs_tcp_chan_t;
 
@@ -234,6 +242,10 @@ int dis_getc(int);
 int dis_gets(int, char *, size_t);
 int dis_puts(int, const char *, size_t);
 int dis_flush(int);
+int dis_take_pkt(int, void **, size_t *);
+void dis_set_compact(int, int);
+int dis_compact_wr(int);
+int dis_compact_rd(int);
 void dis_setup_chan(int, pbs_tcp_chan_t *(*) (int) );
 void dis_destroy_chan(int);
 
@@ -107,6 +107,7 @@ void __pbs_delstatfree(struct batch_deljob_status *);
 struct batch_status *__pbs_statrsc(int, const char *, struct attrl *, const char *);
 
 struct batch_status *__pbs_statjob(int, const char *, struct attrl *, const char *);
+struct batch_status *__pbs_statjob_iter(int, const char *, struct attrl *, const char *, int *);
 
 struct batch_status *__pbs_selstat(int, struct attropl *, struct attrl *, const char *);
 
@@ -1008,6 +1008,7 @@ extern int   site_check_user_map(job *, char *);
 #endif
 extern int site_check_user_map(void *, int, char *);
 extern int site_allow_u(char *user, char *host);
+extern int cmp_job_qrank(job *, long long, char *);
 extern void svr_dequejob(job *);
 extern int svr_enquejob(job *, char *);
 extern void svr_evaljobstate(job *, char *, int *, int);
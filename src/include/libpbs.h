@@ -333,6 +333,8 @@ int PBSD_mgr_put(int, int, int, int, const char *, struct attropl *, const char
 int PBSD_manager(int, int, int, int, const char *, struct attropl *, const char *);
 int PBSD_msg_put(int, const char *, int, const char *, const char *, int, char **);
 int PBSD_relnodes_put(int, const char *, const char *, const char *, int, char **);
+int PBSD_run_put(int, const char *, const char *, const char *, int);
+int PBSD_run_get(int);
 int PBSD_py_spawn_put(int, char *, char **, char **, int, char **);
 int PBSD_sig_put(int, const char *, const char *, const char *, int, char **);
 int PBSD_jobfile(int, int, char *, char *, enum job_file, int, char **);
@@ -340,15 +342,18 @@ int PBSD_status_put(int, int, const char *, struct attrl *, const char *, int, c
 int PBSD_select_put(int, int, struct attropl *, struct attrl *, const char *);
 char **PBSD_select_get(int);
 struct batch_reply *PBSD_rdrpy(int);
+struct batch_reply *PBSD_rdrpy_part(int);
 struct batch_reply *PBSD_rdrpy_sock(int, int *, int prot);
 void PBSD_FreeReply(struct batch_reply *);
 struct batch_status *PBSD_status(int, int, const char *, struct attrl *, const char *);
 struct batch_status *PBSD_status_get(int c);
+struct batch_status *PBSD_status_get_part(int c, int *more);
 char *PBSD_queuejob(int, char *, const char *, struct attropl *, const char *, int, char **, int *);
 int decode_DIS_svrattrl(int, pbs_list_head *);
 int decode_DIS_attrl(int, struct attrl **);
 int decode_DIS_JobId(int, char *);
 int decode_DIS_replyCmd(int, struct batch_reply *, int);
+int decode_DIS_replyCmd_part(int, struct batch_reply *, int);
 int encode_DIS_JobCred(int, int, const char *, int);
 int encode_DIS_UserCred(int, const char *, int, const char *, int);
 int encode_DIS_JobFile(int, int, const char *, int, const char *, int);
@@ -130,6 +130,8 @@ extern int set_msgdaemonname(const char *ch);
 void set_log_conf(char *leafname, char *nodename,
 		  unsigned int islocallog, unsigned int sl_fac, unsigned int sl_svr,
 		  unsigned int log_highres);
+extern void log_set_async(unsigned int mode);
+extern unsigned long log_async_dropped(void);
 
 extern struct log_net_info *get_if_info(char *msg);
 extern void free_if_info(struct log_net_info *ni);
@@ -185,6 +187,12 @@ extern void log_supported_auth_methods(char **supported_auth_methods);
 #define SVR_LOG_DFLT PBSEVENT_ERROR | PBSEVENT_SYSTEM | PBSEVENT_ADMIN | PBSEVENT_JOB | PBSEVENT_JOB_USAGE | PBSEVENT_SECURITY | PBSEVENT_SCHED | PBSEVENT_DEBUG | PBSEVENT_DEBUG2
 #define SCHED_LOG_DFLT PBSEVENT_ERROR | PBSEVENT_SYSTEM | PBSEVENT_ADMIN | PBSEVENT_JOB | PBSEVENT_JOB_USAGE | PBSEVENT_SECURITY | PBSEVENT_SCHED | PBSEVENT_DEBUG | PBSEVENT_RESV
 
+/* Asynchronous logging modes, see log_set_async() */
+
+#define LOG_ASYNC_OFF 0	       /* write each record on the caller's thread */
+#define LOG_ASYNC_BLOCK 1      /* writer thread, wait for room if the buffer is full */
+#define LOG_ASYNC_DROP_DEBUG 2 /* writer thread, drop debug records if the buffer is full */
+
 /* Event Object Classes, see array class_names[] in ../lib/Liblog/pbs_log.c */
 
 #define PBS_EVENTCLASS_SERVER 1	 /* The server itself */
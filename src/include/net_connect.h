@@ -68,6 +68,7 @@ typedef unsigned long pbs_net_t; /* for holding host addresses */
 #define PBS_NET_CONN_FROM_QSUB_DAEMON 0x08
 #define PBS_NET_CONN_FORCE_QSUB_UPDATE 0x10
 #define PBS_NET_CONN_PREVENT_IP_SPOOFING 0x20
+#define PBS_NET_CONN_PAUSED 0x40 /* not polled, see net_pause_conn() */
 
 #define QSUB_DAEMON "qsub-daemon"
 
@@ -115,6 +116,9 @@ typedef unsigned long pbs_net_t; /* for holding host addresses */
 #define IS_UPDATE_FROM_HOOK2 21		   /* request to update vnodes from a hook running on a parent mom host or an allowed non-parent mom host */
 #define IS_HELLOSVR 22			   /* hello send to server from mom to initiate a hello sequence */
 
+/* bits of the capabilities Mom may add to IS_HELLOSVR */
+#define IS_CAP_DIS_COMPACT 0x1 /* Mom reads the compact DIS encoding */
+
 /* return codes for client_to_svr() */
 
 #define PBS_NET_RC_FATAL -1
@@ -194,6 +198,9 @@ int init_network(unsigned int port);
 int init_network_add(int sock, int (*readyreadfunc)(conn_t *), void (*readfunc)(int));
 void net_close(int);
 int wait_request(float waittime, void *priority_context);
+void net_set_poll_hooks(void (*)(void), void (*)(void));
+int net_pause_conn(int sock);
+int net_resume_conn(int sock);
 extern void *priority_context;
 void net_add_close_func(int, void (*)(int));
 extern pbs_net_t get_addr_of_nodebyname(char *name, unsigned int *port);
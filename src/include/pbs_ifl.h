@@ -671,6 +671,7 @@ DECLDIR void pbs_statfree(struct batch_status *);
 DECLDIR struct batch_status *pbs_statrsc(int, char *, struct attrl *, char *);
 
 DECLDIR struct batch_status *pbs_statjob(int, char *, struct attrl *, char *);
+DECLDIR struct batch_status *pbs_statjob_iter(int, char *, struct attrl *, char *, int *);
 
 DECLDIR struct batch_status *pbs_selstat(int, struct attropl *, struct attrl *, char *);
 
@@ -775,6 +776,7 @@ extern void pbs_delstatfree(struct batch_deljob_status *);
 extern struct batch_status *pbs_statrsc(int, const char *, struct attrl *, const char *);
 
 extern struct batch_status *pbs_statjob(int, const char *, struct attrl *, const char *);
+extern struct batch_status *pbs_statjob_iter(int, const char *, struct attrl *, const char *, int *);
 
 extern struct batch_status *pbs_selstat(int, struct attropl *, struct attrl *, const char *);
 
@@ -249,7 +249,10 @@ struct pbs_config
 	unsigned int pbs_comm_threads;	/* number of threads for router, default 4 */
 	char *pbs_mom_node_name;	/* mom short name used for natural node, default NULL */
 	unsigned int pbs_log_highres_timestamp; /* high resolution logging */
+	unsigned int pbs_log_async;	/* asynchronous logging mode */
 	unsigned int pbs_sched_threads;	/* number of threads for scheduler */
+	unsigned int pbs_server_stat_threads;	/* server threads for status requests, default 0 */
+	unsigned int pbs_dis_compact;	/* offer the compact DIS encoding to peers, default 1 */
 	char *pbs_daemon_service_user; /* user the scheduler runs as */
 	char *pbs_daemon_service_auth_user; /* auth user the scheduler runs as */
 	char *pbs_privileged_auth_user; /* auth user with admin access */
@@ -322,7 +325,10 @@ extern struct pbs_config pbs_conf;
 #define PBS_CONF_SCHEDULER_MODIFY_EVENT	"PBS_SCHEDULER_MODIFY_EVENT"
 #define PBS_CONF_MOM_NODE_NAME	"PBS_MOM_NODE_NAME"
 #define PBS_CONF_LOG_HIGHRES_TIMESTAMP	"PBS_LOG_HIGHRES_TIMESTAMP"
+#define PBS_CONF_LOG_ASYNC	"PBS_LOG_ASYNC"
 #define PBS_CONF_SCHED_THREADS	"PBS_SCHED_THREADS"
+#define PBS_CONF_SERVER_STAT_THREADS	"PBS_SERVER_STAT_THREADS"
+#define PBS_CONF_DIS_COMPACT	"PBS_DIS_COMPACT"
 #define PBS_CONF_DAEMON_SERVICE_USER "PBS_DAEMON_SERVICE_USER"
 #define PBS_CONF_DAEMON_SERVICE_AUTH_USER "PBS_DAEMON_SERVICE_AUTH_USER"
 #define PBS_CONF_PRIVILEGED_AUTH_USER "PBS_PRIVILEGED_AUTH_USER" /* e.g.: used for gss/krb and krb host principal (host/<fqdn>@<REALM>) is expected */
@@ -589,6 +595,7 @@ extern void (*pfn_pbs_statfree)(struct batch_status *);
 extern void (*pfn_pbs_delstatfree)(struct batch_deljob_status *);
 extern struct batch_status *(*pfn_pbs_statrsc)(int, const char *, struct attrl *, const char *);
 extern struct batch_status *(*pfn_pbs_statjob)(int, const char *, struct attrl *, const char *);
+extern struct batch_status *(*pfn_pbs_statjob_iter)(int, const char *, struct attrl *, const char *, int *);
 extern struct batch_status *(*pfn_pbs_selstat)(int, struct attropl *, struct attrl *, const char *);
 extern struct batch_status *(*pfn_pbs_statque)(int, const char *, struct attrl *, const char *);
 extern struct batch_status *(*pfn_pbs_statserver)(int, struct attrl *, const char *);
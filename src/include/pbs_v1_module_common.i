@@ -124,7 +124,6 @@ pbs_list_head svr_execjob_preresume_hooks;
 
 pbs_list_head task_list_immed;
 pbs_list_head task_list_interleave;
-pbs_list_head task_list_timed;
 pbs_list_head task_list_event;
 
 char *path_hooks = NULL;
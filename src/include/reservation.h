@@ -154,7 +154,7 @@ struct resc_resv {
 							 */
 
 	int ri_futuredr; /* non-zero if future delete resv
-							 * task placed on "task_list_timed
+							 * task placed on the timed task heap
 							 */
 
 	job *ri_jbp;	      /* for a "reservation job" this
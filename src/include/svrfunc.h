@@ -136,6 +136,13 @@ extern int compare_obj_hash(void *, int, void *);
 extern void panic_stop_db();
 extern void free_db_attr_list(pbs_db_attr_list_t *);
 extern bool delete_pending_arrayjobs(struct batch_request *);
+extern int set_to_non_blocking(conn_t *);
+extern void clear_non_blocking(conn_t *);
+extern int stat_pool_init(int);
+extern int stat_pool_submit(conn_t *, struct batch_request *);
+extern int stat_pool_worker(void);
+extern int stat_pool_reply(int, struct batch_request *);
+extern int stat_pool_yield(void);
 
 #ifdef _PROVISION_H
 extern int find_prov_vnode_list(job *, exec_vnode_listtype *, char **);
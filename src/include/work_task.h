@@ -50,6 +50,10 @@ extern "C" {
  *
  * This information need not be preserved.
  *
+ * WORK_Timed tasks are kept in a heap ordered on wt_event, so wt_event of
+ * a timed task must not be changed once it is set; delete the task and
+ * set a new one instead.
+ *
  * Other Required Header Files
  *	"list_link.h"
  */
@@ -88,6 +92,10 @@ struct work_task {
 	void *wt_parm3;			     /* used to store reply for deferred cmds TPP */
 	int wt_aux;			     /* optional info: e.g. child status */
 	int wt_aux2;			     /* optional info 2: e.g. *real* child pid (windows), tpp msgid etc */
+	pbs_list_head *wt_list;		     /* event type work list the task was put on */
+	pbs_list_link wt_linkparm1;	     /* link to other tasks with the same wt_parm1 */
+	int wt_heapidx;			     /* position in the timed task heap, -1 if not on it */
+	unsigned long wt_seq;		     /* creation order, breaks ties between timed tasks */
 };
 
 extern struct work_task *set_task(enum work_type, long event, void (*func)(struct work_task *), void *param);
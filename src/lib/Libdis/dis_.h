@@ -66,6 +66,11 @@ disrsl_(int stream, int *negate, unsigned long *value,
 	unsigned long count, int recursv);
 int disrsll_(int stream, int *negate, u_Long *value, unsigned long count, int recursv);
 int diswui_(int stream, unsigned value);
+int disvw_(int stream, int negate, u_Long value);
+int disvr_(int stream, int *negate, u_Long *value);
+int disrsiv_(int stream, int *negate, unsigned *value);
+int disrslv_(int stream, int *negate, unsigned long *value);
+int disrsllv_(int stream, int *negate, u_Long *value);
 
 extern unsigned dis_dmx10;
 extern double *dis_dp10;
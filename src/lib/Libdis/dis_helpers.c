@@ -47,6 +47,7 @@
 #include "pbs_internal.h"
 
 #define PKT_MAGIC "PKTV1"
+#define PKT_MAGIC_COMPACT "PKTC1" /* pkt data uses the compact encoding */
 #define PKT_MAGIC_SZ sizeof(PKT_MAGIC)
 #define PKT_HDR_SZ (PKT_MAGIC_SZ + 1 + sizeof(int))
 
@@ -246,10 +247,9 @@ transport_chan_is_encrypted(int fd)
 
 /**
  * @brief
- * 	send pkt from given DIS buffer over network
- * 	after patching pkt header for data size and
+ * 	finish pkt in given DIS buffer for sending:
  * 	if not encrypted already and chan is encrypted
- * 	then encrypt data before send
+ * 	then encrypt data, then patch pkt header for data size
  *
  * @param[in] fd - file descriptor
  * @param[in] tp - pointer to DIS buffer
@@ -257,7 +257,7 @@ transport_chan_is_encrypted(int fd)
  *
  * @return int
  *
- * @retval >= 0  - success
+ * @retval 0  - success
  * @retval -1 - failure
  *
  * @par Side Effects:
@@ -267,7 +267,7 @@ transport_chan_is_encrypted(int fd)
  *
  */
 static int
-__send_pkt(int fd, pbs_dis_buf_t *tp, int encrypt_done)
+__finish_pkt(int fd, pbs_dis_buf_t *tp, int encrypt_done)
 {
 	int i;
 
@@ -291,6 +291,36 @@ __send_pkt(int fd, pbs_dis_buf_t *tp, int encrypt_done)
 
 	i = htonl(tp->tdis_len - PKT_HDR_SZ);
 	memcpy((void *) (tp->tdis_data + PKT_HDR_SZ - sizeof(int)), &i, sizeof(int));
+	return 0;
+}
+
+/**
+ * @brief
+ * 	send pkt from given DIS buffer over network
+ * 	after finishing it, see __finish_pkt()
+ *
+ * @param[in] fd - file descriptor
+ * @param[in] tp - pointer to DIS buffer
+ * @param[in] encrypt_done - is data already encrypted
+ *
+ * @return int
+ *
+ * @retval >= 0  - success
+ * @retval -1 - failure
+ *
+ * @par Side Effects:
+ *	None
+ *
+ * @par MT-safe: Yes
+ *
+ */
+static int
+__send_pkt(int fd, pbs_dis_buf_t *tp, int encrypt_done)
+{
+	int i;
+
+	if (__finish_pkt(fd, tp, encrypt_done) != 0)
+		return -1;
 
 	i = transport_send(fd, (void *) tp->tdis_data, tp->tdis_len);
 	if (i < 0)
@@ -395,7 +425,16 @@ __recv_pkt(int fd, int *type, pbs_dis_buf_t *tp)
 	i = transport_recv(fd, (void *) &pkthdr, PKT_HDR_SZ);
 	if (i != PKT_HDR_SZ)
 		return (i < 0 ? i : -1);
-	if (strncmp(pkthdr, PKT_MAGIC, PKT_MAGIC_SZ) != 0) {
+	if (strncmp(pkthdr, PKT_MAGIC, PKT_MAGIC_SZ) == 0)
+		tp->tdis_compact = 0;
+	else if (strncmp(pkthdr, PKT_MAGIC_COMPACT, PKT_MAGIC_SZ) == 0) {
+		pbs_tcp_chan_t *chan = transport_get_chan(fd);
+
+		/* a peer that sends the compact encoding also reads it */
+		if (chan != NULL)
+			chan->is_compact = 1;
+		tp->tdis_compact = 1;
+	} else {
 		/* no pkt magic match, reject data/connection */
 		return -1;
 	}
@@ -754,14 +793,17 @@ dis_gets(int fd, char *str, size_t ct)
 int
 dis_puts(int fd, const char *str, size_t ct)
 {
-	pbs_dis_buf_t *tp = dis_get_writebuf(fd);
+	pbs_tcp_chan_t *chan = transport_get_chan(fd);
+	pbs_dis_buf_t *tp;
 
-	if (tp == NULL)
+	if (chan == NULL)
 		return -1;
+	tp = &(chan->writebuf);
 	if (tp->tdis_len <= 0) {
 		if (dis_resize_buf(tp, ct + PKT_HDR_SZ) != 0)
 			return -1;
-		strcpy(tp->tdis_data, PKT_MAGIC);
+		tp->tdis_compact = chan->is_compact;
+		strcpy(tp->tdis_data, tp->tdis_compact ? PKT_MAGIC_COMPACT : PKT_MAGIC);
 		tp->tdis_pos = tp->tdis_data + PKT_HDR_SZ;
 		tp->tdis_len = PKT_HDR_SZ;
 	} else {
@@ -808,6 +850,153 @@ dis_flush(int fd)
 	return 0;
 }
 
+/**
+ * @brief
+ *	take the pending pkt out of the dis write buffer
+ *
+ *	Does what dis_flush() does, except that the finished (and, if the
+ *	channel is encrypted, encrypted) pkt is copied into a malloc'ed
+ *	buffer for the caller to send, instead of being sent on fd.
+ *	The caller must free *pkt.
+ *
+ * @param[in] fd - file descriptor
+ * @param[out] pkt - the pkt, NULL if nothing was pending
+ * @param[out] pktlen - length of the pkt
+ *
+ * @return int
+ *
+ * @retval  0 on success
+ * @retval -1 on error
+ *
+ * @par Side Effects:
+ *	None
+ *
+ * @par MT-safe: Yes
+ *
+ */
+int
+dis_take_pkt(int fd, void **pkt, size_t *pktlen)
+{
+	pbs_dis_buf_t *tp = dis_get_writebuf(fd);
+
+	*pkt = NULL;
+	*pktlen = 0;
+	if (tp == NULL)
+		return -1;
+	if (tp->tdis_len == 0)
+		return 0;
+	if (__finish_pkt(fd, tp, 0) != 0)
+		return -1;
+	if ((*pkt = malloc(tp->tdis_len)) == NULL)
+		return -1;
+	memcpy(*pkt, tp->tdis_data, tp->tdis_len);
+	*pktlen = tp->tdis_len;
+	dis_clear_buf(tp);
+	return 0;
+}
+
+/**
+ * @brief
+ * 	dis_set_compact - set whether the peer on fd reads the compact
+ * 	encoding of integers and strings, see disvr_()
+ *
+ * @par
+ *	Only set this once the peer has said that it does.  Pkts started
+ *	from here on are sent in the compact encoding and carry their own
+ *	pkt magic, so the peer tells them from DIS text pkts on its own.
+ *	A peer that is sent compact pkts answers in kind, see __recv_pkt().
+ *
+ * @param[in] fd - file descriptor
+ * @param[in] on - true to send compact pkts
+ *
+ * @return void
+ *
+ * @par Side Effects:
+ *	None
+ *
+ * @par MT-safe: Yes
+ *
+ */
+void
+dis_set_compact(int fd, int on)
+{
+	pbs_tcp_chan_t *chan = transport_get_chan(fd);
+
+	if (chan == NULL)
+		return;
+	chan->is_compact = on ? 1 : 0;
+}
+
+/**
+ * @brief
+ * 	dis_compact_wr - is data put on fd now in the compact encoding?
+ *
+ * @param[in] fd - file descriptor
+ *
+ * @return int
+ *
+ * @retval 1 - compact encoding
+ * @retval 0 - DIS text
+ *
+ * @par Side Effects:
+ *	None
+ *
+ * @par MT-safe: Yes
+ *
+ */
+int
+dis_compact_wr(int fd)
+{
+	pbs_tcp_chan_t *chan = transport_get_chan(fd);
+
+	if (chan == NULL)
+		return 0;
+	if (chan->writebuf.tdis_len > 0)
+		return chan->writebuf.tdis_compact;
+	return chan->is_compact;
+}
+
+/**
+ * @brief
+ * 	dis_compact_rd - is the data to be read next from fd in the compact
+ * 	encoding?  Reads the next pkt if none is buffered.
+ *
+ * @param[in] fd - file descriptor
+ *
+ * @return int
+ *
+ * @retval 1 	compact encoding
+ * @retval 0 	DIS text
+ * @retval -1 	if EOD or error
+ * @retval -2 	if EOF (stream closed)
+ *
+ * @par Side Effects:
+ *	None
+ *
+ * @par MT-safe: Yes
+ *
+ */
+int
+dis_compact_rd(int fd)
+{
+	pbs_dis_buf_t *tp = dis_get_readbuf(fd);
+
+	if (tp == NULL)
+		return -1;
+	if (tp->tdis_len <= 0) {
+		/* not enought data, try to get more */
+		int unused;
+		int c;
+
+		dis_clear_buf(tp);
+		if ((c = __recv_pkt(fd, &unused, tp)) <= 0) {
+			dis_clear_buf(tp);
+			return (c == -2 ? -2 : -1); /* Error or EOF */
+		}
+	}
+	return tp->tdis_compact;
+}
+
 /**
  * @brief
  * 	dis_destroy_chan - release structures associated with fd
@@ -100,7 +100,7 @@ disrl(int stream, int *retval)
 	ldval = 0.0L;
 	locret = disrl_(stream, &ldval, &ndigs, &nskips, LDBL_DIG, 1, 0);
 	if (locret == DIS_SUCCESS) {
-		locret = disrsi_(stream, &negate, &uexpon, 1, 0);
+		locret = disrsiv_(stream, &negate, &uexpon);
 		if (locret == DIS_SUCCESS) {
 			expon = negate ? nskips - uexpon : nskips + uexpon;
 			if (expon + (int) ndigs > LDBL_MAX_10_EXP) {
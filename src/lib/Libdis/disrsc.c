@@ -102,7 +102,7 @@ disrsc(int stream, int *retval)
 	assert(retval != NULL);
 
 	value = 0;
-	switch (locret = disrsi_(stream, &negate, &uvalue, 1, 0)) {
+	switch (locret = disrsiv_(stream, &negate, &uvalue)) {
 		case DIS_SUCCESS:
 			if (negate ? -uvalue >= SCHAR_MIN : uvalue <= SCHAR_MAX) {
 				value = negate ? -uvalue : uvalue;
@@ -97,7 +97,7 @@ disrsl(int stream, int *retval)
 	assert(retval != NULL);
 
 	value = 0;
-	switch (locret = disrsl_(stream, &negate, &uvalue, 1, 0)) {
+	switch (locret = disrslv_(stream, &negate, &uvalue)) {
 		case DIS_SUCCESS:
 			if (negate ? uvalue <= (unsigned long) -(LONG_MIN + 1) + 1 : uvalue <= LONG_MAX) {
 				value = negate ? -uvalue : uvalue;
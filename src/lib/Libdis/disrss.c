@@ -98,7 +98,7 @@ disrss(int stream, int *retval)
 	assert(retval != NULL);
 
 	value = 0;
-	switch (locret = disrsi_(stream, &negate, &uvalue, 1, 0)) {
+	switch (locret = disrsiv_(stream, &negate, &uvalue)) {
 		case DIS_SUCCESS:
 			if (negate ? -uvalue >= SHRT_MIN : uvalue <= SHRT_MAX) {
 				value = negate ? -uvalue : uvalue;
@@ -91,7 +91,7 @@ disrst(int stream, int *retval)
 
 	assert(retval != NULL);
 
-	locret = disrsi_(stream, &negate, &count, 1, 0);
+	locret = disrsiv_(stream, &negate, &count);
 	if (locret == DIS_SUCCESS) {
 		if (negate)
 			locret = DIS_BADSIGN;
@@ -94,7 +94,7 @@ disrui(int stream, int *retval)
 	int negate;
 	unsigned value;
 
-	locret = disrsi_(stream, &negate, &value, 1, 0);
+	locret = disrsiv_(stream, &negate, &value);
 	if (locret != DIS_SUCCESS) {
 		value = 0;
 	} else if (negate) {
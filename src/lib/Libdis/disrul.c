@@ -92,7 +92,7 @@ disrul(int stream, int *retval)
 	int negate;
 	unsigned long value;
 
-	locret = disrsl_(stream, &negate, &value, 1, 0);
+	locret = disrslv_(stream, &negate, &value);
 	if (locret != DIS_SUCCESS) {
 		value = 0;
 	} else if (negate) {
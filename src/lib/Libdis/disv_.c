@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+/**
+ * @file	disv_.c
+ *
+ * @par Synopsis:
+ *	The compact encoding of integers and strings.
+ *
+ *	A pkt that starts with the compact pkt magic (see dis_helpers.c)
+ *	carries integers as variable length binary numbers instead of
+ *	Data-is-Strings digits.  Like a DIS integer, a compact integer is a
+ *	sign and a magnitude, so values written as signed may be read as
+ *	unsigned and the other way round, same as with DIS:
+ *
+ *	1. The first byte holds the sign in bit 6 and the low 6 bits of the
+ *	   magnitude in bits 0-5.
+ *
+ *	2. Each following byte holds the next 7 bits of the magnitude in
+ *	   bits 0-6.
+ *
+ *	3. Bit 7 of a byte is set if another byte follows.
+ *
+ *	A string is its length as a compact integer followed by its
+ *	characters.  The coefficient of a floating point number stays in DIS
+ *	text, its exponent is an integer like any other.
+ *
+ *	The readers here fall back to the DIS text routines when the pkt
+ *	being read is a DIS text pkt, so a peer may switch encoding between
+ *	messages at will.
+ */
+
+#include <pbs_config.h> /* the master config generated by configure */
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "dis.h"
+#include "dis_.h"
+
+/* bytes needed for the largest magnitude: 6 bits, then 7 bits a byte */
+#define DISV_MAXBYTES (1 + (CHAR_BIT * sizeof(u_Long) - 6 + 6) / 7)
+
+#define DISV_MORE 0x80
+#define DISV_SIGN 0x40
+
+/**
+ * @brief
+ *	Converts <negate> and <value> into a compact integer and sends it
+ *	to <stream>.
+ *
+ * @param[in] stream - socket descriptor
+ * @param[in] negate - true if the value is negative
+ * @param[in] value - magnitude of the value
+ *
+ * @return	int
+ * @retval	DIS_SUCCESS	success
+ * @retval	DIS_PROTO	error
+ *
+ */
+int
+disvw_(int stream, int negate, u_Long value)
+{
+	unsigned char buf[DISV_MAXBYTES];
+	size_t ct = 0;
+
+	assert(stream >= 0);
+
+	buf[ct] = (unsigned char) (value & 0x3f);
+	if (negate)
+		buf[ct] |= DISV_SIGN;
+	value >>= 6;
+	while (value != 0) {
+		buf[ct++] |= DISV_MORE;
+		buf[ct] = (unsigned char) (value & 0x7f);
+		value >>= 7;
+	}
+	ct++;
+	return (dis_puts(stream, (char *) buf, ct) != ct ? DIS_PROTO : DIS_SUCCESS);
+}
+
+/**
+ * @brief
+ *	Gets a compact integer from <stream>.
+ *
+ * @param[in] stream - socket descriptor
+ * @param[out] negate - true if the value is negative
+ * @param[out] value - magnitude of the value
+ *
+ * @return	int
+ * @retval	DIS_success/error status
+ *
+ */
+int
+disvr_(int stream, int *negate, u_Long *value)
+{
+	unsigned char c;
+	unsigned char bits;
+	unsigned shift;
+	int nbytes;
+	int i;
+	u_Long locval;
+
+	assert(negate != NULL);
+	assert(value != NULL);
+
+	/* read byte-wise, dis_getc() cannot tell high bytes from errors */
+	if ((i = dis_gets(stream, (char *) &c, 1)) != 1)
+		return (i == -2 ? DIS_EOF : DIS_EOD);
+	*negate = (c & DISV_SIGN) != 0;
+	locval = c & 0x3f;
+	shift = 6;
+	for (nbytes = 1; c & DISV_MORE; nbytes++) {
+		if (nbytes >= DISV_MAXBYTES)
+			return (DIS_PROTO);
+		if ((i = dis_gets(stream, (char *) &c, 1)) != 1)
+			return (i == -2 ? DIS_EOF : DIS_EOD);
+		bits = c & 0x7f;
+		if (shift + 7 > CHAR_BIT * sizeof(u_Long) && (bits >> (CHAR_BIT * sizeof(u_Long) - shift)) != 0)
+			goto overflow;
+		locval |= (u_Long) bits << shift;
+		shift += 7;
+	}
+	*value = locval;
+	return (DIS_SUCCESS);
+
+overflow:
+	/* skip the rest of the integer so the stream stays in step */
+	while ((c & DISV_MORE) && ++nbytes <= DISV_MAXBYTES) {
+		if ((i = dis_gets(stream, (char *) &c, 1)) != 1)
+			return (i == -2 ? DIS_EOF : DIS_EOD);
+	}
+	*value = UlONG_MAX;
+	return (DIS_OVERFLOW);
+}
+
+/**
+ * @brief
+ *	Gets an integer from <stream>, in whichever encoding the pkt being
+ *	read uses, as a sign and an unsigned magnitude.
+ *
+ * @param[in] stream - socket descriptor
+ * @param[out] negate - true if the value is negative
+ * @param[out] value - magnitude of the value
+ *
+ * @return	int
+ * @retval	DIS_success/error status
+ *
+ */
+int
+disrsllv_(int stream, int *negate, u_Long *value)
+{
+	switch (dis_compact_rd(stream)) {
+		case 0:
+			return (disrsll_(stream, negate, value, 1, 0));
+		case 1:
+			return (disvr_(stream, negate, value));
+		case -2:
+			return (DIS_EOF);
+		default:
+			return (DIS_EOD);
+	}
+}
+
+/**
+ * @brief
+ *	As disrsllv_(), for a magnitude that fits an unsigned long.
+ *
+ * @param[in] stream - socket descriptor
+ * @param[out] negate - true if the value is negative
+ * @param[out] value - magnitude of the value
+ *
+ * @return	int
+ * @retval	DIS_success/error status
+ *
+ */
+int
+disrslv_(int stream, int *negate, unsigned long *value)
+{
+	int locret;
+	u_Long locval;
+
+	switch (dis_compact_rd(stream)) {
+		case 0:
+			return (disrsl_(stream, negate, value, 1, 0));
+		case 1:
+			break;
+		case -2:
+			return (DIS_EOF);
+		default:
+			return (DIS_EOD);
+	}
+	locret = disvr_(stream, negate, &locval);
+	if (locret == DIS_SUCCESS && locval > ULONG_MAX)
+		locret = DIS_OVERFLOW;
+	if (locret == DIS_OVERFLOW)
+		*value = ULONG_MAX;
+	else if (locret == DIS_SUCCESS)
+		*value = (unsigned long) locval;
+	return (locret);
+}
+
+/**
+ * @brief
+ *	As disrsllv_(), for a magnitude that fits an unsigned int.
+ *
+ * @param[in] stream - socket descriptor
+ * @param[out] negate - true if the value is negative
+ * @param[out] value - magnitude of the value
+ *
+ * @return	int
+ * @retval	DIS_success/error status
+ *
+ */
+int
+disrsiv_(int stream, int *negate, unsigned *value)
+{
+	int locret;
+	u_Long locval;
+
+	switch (dis_compact_rd(stream)) {
+		case 0:
+			return (disrsi_(stream, negate, value, 1, 0));
+		case 1:
+			break;
+		case -2:
+			return (DIS_EOF);
+		default:
+			return (DIS_EOD);
+	}
+	locret = disvr_(stream, negate, &locval);
+	if (locret == DIS_SUCCESS && locval > UINT_MAX)
+		locret = DIS_OVERFLOW;
+	if (locret == DIS_OVERFLOW)
+		*value = UINT_MAX;
+	else if (locret == DIS_SUCCESS)
+		*value = (unsigned) locval;
+	return (locret);
+}
@@ -94,7 +94,9 @@ diswf(int stream, double value)
 	/* Make zero a special case.  If we don't it will blow exponent		*/
 	/* calculation.								*/
 	if (value == 0.0) {
-		return (dis_puts(stream, "+0+0", 4) != 4 ? DIS_PROTO : DIS_SUCCESS);
+		if (dis_puts(stream, "+0", 2) != 2)
+			return (DIS_PROTO);
+		return (diswsi(stream, 0)); /* exponent */
 	}
 	/* Extract the sign from the coefficient.				*/
 	dval = (negate = value < 0.0) ? -value : value;
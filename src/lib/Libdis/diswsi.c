@@ -103,6 +103,8 @@ diswsi(int stream, int value)
 		uval = value;
 		c = '+';
 	}
+	if (dis_compact_wr(stream))
+		return (disvw_(stream, c == '-', (u_Long) uval));
 	cp = discui_(&dis_buffer[DIS_BUFSIZ], uval, &ndigs);
 	*--cp = c;
 	while (ndigs > 1)
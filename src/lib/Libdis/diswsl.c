@@ -103,6 +103,8 @@ diswsl(int stream, long value)
 		ulval = value;
 		c = '+';
 	}
+	if (dis_compact_wr(stream))
+		return (disvw_(stream, c == '-', (u_Long) ulval));
 	cp = discul_(&dis_buffer[DIS_BUFSIZ], ulval, &ndigs);
 	*--cp = c;
 	while (ndigs > 1)
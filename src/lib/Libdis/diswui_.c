@@ -68,6 +68,8 @@ diswui_(int stream, unsigned value)
 	char *cp;
 
 	assert(stream >= 0);
+	if (dis_compact_wr(stream))
+		return (disvw_(stream, FALSE, (u_Long) value));
 
 	cp = discui_(&dis_buffer[DIS_BUFSIZ], value, &ndigs);
 	*--cp = '+';
@@ -95,6 +95,8 @@ diswull(int stream, u_Long value)
 	char *cp;
 
 	assert(stream >= 0);
+	if (dis_compact_wr(stream))
+		return (disvw_(stream, FALSE, value));
 
 	cp = discull_(&dis_buffer[DIS_BUFSIZ], value, &ndigs);
 	*--cp = '+';
@@ -41,6 +41,7 @@
  * @file	dec_rcpy.c
  * @brief
  * 	decode_DIS_replyCmd() - decode a Batch Protocol Reply Structure for a Command
+ * 	decode_DIS_replyCmd_part() - decode one part of a status reply at a time
  *
  *	This routine decodes a batch reply into the form used by commands.
  *	The only difference between this and the server version is on status
@@ -273,6 +274,8 @@ cmp_sj_name(struct batch_status *a, struct batch_status *b)
  * @param[in] sock - socket descriptor
  * @param[in] reply - pointer to batch_reply structure
  * @param[in] prot - protocol type
+ * @param[in] all_parts - read a status reply sent in parts up to its last
+ *			  part, else only the next part
  *
  * @return	int
  * @retval	-1	error
@@ -280,8 +283,8 @@ cmp_sj_name(struct batch_status *a, struct batch_status *b)
  *
  */
 
-int
-decode_DIS_replyCmd(int sock, struct batch_reply *reply, int prot)
+static int
+decode_DIS_reply_parts(int sock, struct batch_reply *reply, int prot, int all_parts)
 {
 	int ct;
 	int i;
@@ -401,7 +404,7 @@ again:
 					}
 					pstcmd_ja = pstcmd;
 					continue;
-				} else if (reply->brp_type == MGR_OBJ_SUBJOB) {
+				} else if (reply->brp_type == MGR_OBJ_SUBJOB && pstcmd_ja != NULL) {
 					pstcmd->next = pstcmd_ja->next;
 					pstcmd_ja->next = pstcmd;
 					continue;
@@ -425,11 +428,13 @@ again:
 				*pstcx = pstcmd_ja;
 				pstcx = &pstcmd_last->next;
 				pstcmd = pstcmd_last;
+				/* a part ends on a whole job, its subjobs are all in */
+				pstcmd_ja = NULL;
 			}
 
 			if (reply->brp_un.brp_statc)
 				reply->last = pstcmd;
-			if (reply->brp_is_part)
+			if (reply->brp_is_part && all_parts)
 				goto again;
 			break;
 
@@ -541,3 +546,50 @@ again:
 
 	return rc;
 }
+
+/**
+ * @brief
+ *	decode a Batch Protocol Reply Structure for a Command
+ *
+ * @par	Functionality:
+ *		A status reply sent in parts is read up to its last part and
+ *		returned as one list, see decode_DIS_reply_parts().
+ *
+ * @param[in] sock - socket descriptor
+ * @param[in] reply - pointer to batch_reply structure
+ * @param[in] prot - protocol type
+ *
+ * @return	int
+ * @retval	-1	error
+ * @retval	0	Success
+ *
+ */
+int
+decode_DIS_replyCmd(int sock, struct batch_reply *reply, int prot)
+{
+	return (decode_DIS_reply_parts(sock, reply, prot, 1));
+}
+
+/**
+ * @brief
+ *	decode the next part of a Batch Protocol Reply for a Command
+ *
+ * @par	Functionality:
+ *		As decode_DIS_replyCmd() but a status reply sent in parts is read
+ *		one part at a time; brp_is_part is set in the reply when more
+ *		parts follow on the stream.
+ *
+ * @param[in] sock - socket descriptor
+ * @param[in] reply - pointer to batch_reply structure
+ * @param[in] prot - protocol type
+ *
+ * @return	int
+ * @retval	-1	error
+ * @retval	0	Success
+ *
+ */
+int
+decode_DIS_replyCmd_part(int sock, struct batch_reply *reply, int prot)
+{
+	return (decode_DIS_reply_parts(sock, reply, prot, 0));
+}
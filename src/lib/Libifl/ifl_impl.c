@@ -625,6 +625,27 @@ pbs_statjob(int c, const char *id, struct attrl *attrib, const char *extend)
 	return (*pfn_pbs_statjob)(c, id, attrib, extend);
 }
 
+/**
+ * @brief
+ *	-Pass-through call to get status of jobs one part at a time.
+ *
+ * @param[in] c - communication handle
+ * @param[in] id - job id
+ * @param[in] attrib - pointer to attribute list
+ * @param[in] extend - extend string for req
+ * @param[in,out] more - 0 to start, set to 1 when more parts follow
+ *
+ * @return	structure handle
+ * @retval	pointer to batch_status struct		success
+ * @retval	NULL					error, or empty part
+ *
+ */
+struct batch_status *
+pbs_statjob_iter(int c, const char *id, struct attrl *attrib, const char *extend, int *more)
+{
+	return (*pfn_pbs_statjob_iter)(c, id, attrib, extend, more);
+}
+
 /**
  * @brief
  *	-Pass-through call to SelectJob request
@@ -70,6 +70,7 @@ void (*pfn_pbs_statfree)(struct batch_status *) = __pbs_statfree;
 void (*pfn_pbs_delstatfree)(struct batch_deljob_status *) = __pbs_delstatfree;
 struct batch_status *(*pfn_pbs_statrsc)(int, const char *, struct attrl *, const char *) = __pbs_statrsc;
 struct batch_status *(*pfn_pbs_statjob)(int, const char *, struct attrl *, const char *) = __pbs_statjob;
+struct batch_status *(*pfn_pbs_statjob_iter)(int, const char *, struct attrl *, const char *, int *) = __pbs_statjob_iter;
 struct batch_status *(*pfn_pbs_selstat)(int, struct attropl *, struct attrl *, const char *) = __pbs_selstat;
 struct batch_status *(*pfn_pbs_statque)(int, const char *, struct attrl *, const char *) = __pbs_statque;
 struct batch_status *(*pfn_pbs_statserver)(int, struct attrl *, const char *) = __pbs_statserver;
@@ -65,14 +65,16 @@
  * @param[in] sock - The socket fd to read from
  * @param[out] rc  - Return DIS error code
  * @param[in] prot - protocol type
+ * @param[in] all_parts - read a status reply sent in parts up to its last
+ *			  part, else only the next part
  *
  * @return Batch reply structure
  * @retval  !NULL - Success
  * @retval   NULL - Failure
  *
  */
-struct batch_reply *
-PBSD_rdrpy_sock(int sock, int *rc, int prot)
+static struct batch_reply *
+rdrpy_sock(int sock, int *rc, int prot, int all_parts)
 {
 	struct batch_reply *reply;
 	time_t old_timeout;
@@ -92,7 +94,11 @@ PBSD_rdrpy_sock(int sock, int *rc, int prot)
 	} else
 		DIS_tpp_funcs();
 
-	if ((*rc = decode_DIS_replyCmd(sock, reply, prot)) != 0) {
+	if (all_parts)
+		*rc = decode_DIS_replyCmd(sock, reply, prot);
+	else
+		*rc = decode_DIS_replyCmd_part(sock, reply, prot);
+	if (*rc != 0) {
 		(void) free(reply);
 		pbs_errno = PBSE_PROTOCOL;
 		return NULL;
@@ -106,17 +112,37 @@ PBSD_rdrpy_sock(int sock, int *rc, int prot)
 	return reply;
 }
 
+/**
+ * @brief read a batch reply from the given socket
+ *
+ * @param[in] sock - The socket fd to read from
+ * @param[out] rc  - Return DIS error code
+ * @param[in] prot - protocol type
+ *
+ * @return Batch reply structure
+ * @retval  !NULL - Success
+ * @retval   NULL - Failure
+ *
+ */
+struct batch_reply *
+PBSD_rdrpy_sock(int sock, int *rc, int prot)
+{
+	return (rdrpy_sock(sock, rc, prot, 1));
+}
+
 /**
  * @brief read a batch reply from the given connection index
  *
  * @param[in] c - The connection index to read from
+ * @param[in] all_parts - read a status reply sent in parts up to its last
+ *			  part, else only the next part
  *
  * @return DIS error code
  * @retval   DIS_SUCCESS  - Success
  * @retval  !DIS_SUCCESS  - Failure
  */
-struct batch_reply *
-PBSD_rdrpy(int c)
+static struct batch_reply *
+rdrpy(int c, int all_parts)
 {
 	int rc;
 	struct batch_reply *reply;
@@ -128,7 +154,7 @@ PBSD_rdrpy(int c)
 		return NULL;
 	}
 	/* PBSD_rdrpy() only handles TCP, hence passing PROT_TCP as prot */
-	reply = PBSD_rdrpy_sock(c, &rc, PROT_TCP);
+	reply = rdrpy_sock(c, &rc, PROT_TCP, all_parts);
 	if (reply == NULL) {
 		if (set_conn_errno(c, PBSE_PROTOCOL) != 0) {
 			pbs_errno = PBSE_SYSTEM;
@@ -157,6 +183,40 @@ PBSD_rdrpy(int c)
 	return reply;
 }
 
+/**
+ * @brief read a batch reply from the given connection index
+ *
+ * @param[in] c - The connection index to read from
+ *
+ * @return DIS error code
+ * @retval   DIS_SUCCESS  - Success
+ * @retval  !DIS_SUCCESS  - Failure
+ */
+struct batch_reply *
+PBSD_rdrpy(int c)
+{
+	return (rdrpy(c, 1));
+}
+
+/**
+ * @brief read the next part of a status reply from the given connection index
+ *
+ * @par
+ *	brp_is_part is set in the returned reply when more parts follow,
+ *	they must be read before the connection is used for anything else.
+ *
+ * @param[in] c - The connection index to read from
+ *
+ * @return Batch reply structure
+ * @retval  !NULL - Success
+ * @retval   NULL - Failure
+ */
+struct batch_reply *
+PBSD_rdrpy_part(int c)
+{
+	return (rdrpy(c, 0));
+}
+
 /*
  * PBS_FreeReply - Free a batch_reply structure allocated in PBS_rdrpy()
  *
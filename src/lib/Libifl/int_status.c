@@ -128,3 +128,48 @@ end:
 	PBSD_FreeReply(reply);
 	return rbsp;
 }
+
+/**
+ * @brief
+ *	Returns pointer to the status records of the next part of a reply
+ *
+ * @param[in] c - connection socket
+ * @param[out] more - set to 1 when more parts follow, else 0
+ *
+ * @return returns a pointer to a batch_status structure
+ * @retval pointer to batch status on SUCCESS
+ * @retval NULL on failure, or on a part without status records with
+ *	   pbs_errno PBSE_NONE
+ */
+struct batch_status *
+PBSD_status_get_part(int c, int *more)
+{
+	struct batch_status *rbsp = NULL;
+	struct batch_reply *reply;
+
+	*more = 0;
+
+	/* read reply from stream into presentation element */
+
+	reply = PBSD_rdrpy_part(c);
+	if (reply == NULL) {
+		if (pbs_errno == PBSE_NONE)
+			pbs_errno = PBSE_PROTOCOL;
+		goto end;
+	} else if (reply->brp_choice != BATCH_REPLY_CHOICE_NULL &&
+		   reply->brp_choice != BATCH_REPLY_CHOICE_Text &&
+		   reply->brp_choice != BATCH_REPLY_CHOICE_Status) {
+		if (pbs_errno == PBSE_NONE)
+			pbs_errno = PBSE_PROTOCOL;
+		goto end;
+	} else if (get_conn_errno(c) == 0) {
+		rbsp = reply->brp_un.brp_statc;
+		reply->brp_un.brp_statc = NULL;
+		if (reply->brp_choice == BATCH_REPLY_CHOICE_Status)
+			*more = reply->brp_is_part ? 1 : 0;
+	}
+
+end:
+	PBSD_FreeReply(reply);
+	return rbsp;
+}
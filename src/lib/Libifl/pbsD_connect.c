@@ -345,6 +345,9 @@ tcp_connect(const char *hostname, int server_port, const char *extend_data)
 
 		pbs_errno = PBSE_NONE;
 		reply = PBSD_rdrpy(sd);
+		/* talk the compact encoding if the server offers it */
+		if (reply != NULL && pbs_conf.pbs_dis_compact && (reply->brp_auxcode & DIS_COMPACT_OFFER))
+			dis_set_compact(sd, 1);
 		PBSD_FreeReply(reply);
 		if (pbs_errno != PBSE_NONE) {
 			closesocket(sd);
@@ -50,7 +50,14 @@
 #include "pbs_ecl.h"
 
 /**
- * @brief	Inner function for __pbs_runjob, __pbs_asynrunjob and __pbs_asynrunjob_ack
+ * @brief
+ *	-send a run job batch request without waiting for the reply
+ *
+ * @par
+ *	The reply, if req_type asks for one, must be read with PBSD_run_get()
+ *	before any other request on the connection waits for its own reply.
+ *	Requests on a connection are answered in order, so several run requests
+ *	may be outstanding at a time.
  *
  * @param[in] c - connection handle
  * @param[in] jobid- job identifier
@@ -59,11 +66,11 @@
  * @param[in] req_type - one of PBS_BATCH_RunJob, PBS_BATCH_AsyrunJob or PBS_BATCH_AsyrunJob_ack
  *
  * @return      int
- * @retval      0       success
- * @retval      !0      error
+ * @retval      0               Success
+ * @retval      pbs_error(!0)   error
  */
-static int
-__runjob_inner(int c, const char *jobid, const char *location, const char *extend, int req_type)
+int
+PBSD_run_put(int c, const char *jobid, const char *location, const char *extend, int req_type)
 {
 	int rc = 0;
 	unsigned long resch = 0;
@@ -74,15 +81,6 @@ __runjob_inner(int c, const char *jobid, const char *location, const char *exten
 	if (location == NULL)
 		location = "";
 
-	/* initialize the thread context data, if not already initialized */
-	if (pbs_client_thread_init_thread_context() != 0)
-		return pbs_errno;
-
-	/* lock pthread mutex here for this connection */
-	/* blocking call, waits for mutex release */
-	if (pbs_client_thread_lock_connection(c) != 0)
-		return pbs_errno;
-
 	/* setup DIS support routines for following DIS calls */
 
 	DIS_tcp_funcs();
@@ -93,29 +91,77 @@ __runjob_inner(int c, const char *jobid, const char *location, const char *exten
 	    (rc = encode_DIS_Run(c, jobid, location, resch)) ||
 	    (rc = encode_DIS_ReqExtend(c, extend))) {
 		if (set_conn_errtxt(c, dis_emsg[rc]) != 0)
-			pbs_errno = PBSE_SYSTEM;
-		else
-			pbs_errno = PBSE_PROTOCOL;
-
-		pbs_client_thread_unlock_connection(c);
-		return pbs_errno;
+			return (pbs_errno = PBSE_SYSTEM);
+		return (pbs_errno = PBSE_PROTOCOL);
 	}
 
-	if (dis_flush(c)) {
-		pbs_errno = PBSE_PROTOCOL;
-		pbs_client_thread_unlock_connection(c);
+	if (dis_flush(c))
+		return (pbs_errno = PBSE_PROTOCOL);
+
+	return 0;
+}
+
+/**
+ * @brief
+ *	-read the reply of a run job batch request sent by PBSD_run_put()
+ *
+ * @param[in] c - connection handle
+ *
+ * @return      int
+ * @retval      0       success
+ * @retval      !0      error (the error text is kept on the connection)
+ */
+int
+PBSD_run_get(int c)
+{
+	struct batch_reply *reply;
+	int rc;
+
+	reply = PBSD_rdrpy(c);
+	rc = get_conn_errno(c);
+	PBSD_FreeReply(reply);
+
+	return rc;
+}
+
+/**
+ * @brief	Inner function for __pbs_runjob, __pbs_asynrunjob and __pbs_asynrunjob_ack
+ *
+ * @param[in] c - connection handle
+ * @param[in] jobid- job identifier
+ * @param[in] location - string of vnodes/resources to be allocated to the job
+ * @param[in] extend - extend string for encoding req
+ * @param[in] req_type - one of PBS_BATCH_RunJob, PBS_BATCH_AsyrunJob or PBS_BATCH_AsyrunJob_ack
+ *
+ * @return      int
+ * @retval      0       success
+ * @retval      !0      error
+ */
+static int
+__runjob_inner(int c, const char *jobid, const char *location, const char *extend, int req_type)
+{
+	int rc = 0;
+
+	if ((jobid == NULL) || (*jobid == '\0'))
+		return (pbs_errno = PBSE_IVALREQ);
+
+	/* initialize the thread context data, if not already initialized */
+	if (pbs_client_thread_init_thread_context() != 0)
 		return pbs_errno;
-	}
 
-	if (req_type != PBS_BATCH_AsyrunJob) {
-		struct batch_reply *reply = NULL;
+	/* lock pthread mutex here for this connection */
+	/* blocking call, waits for mutex release */
+	if (pbs_client_thread_lock_connection(c) != 0)
+		return pbs_errno;
 
-		/* Get reply */
-		reply = PBSD_rdrpy(c);
-		rc = get_conn_errno(c);
-		PBSD_FreeReply(reply);
+	if ((rc = PBSD_run_put(c, jobid, location, extend, req_type)) != 0) {
+		pbs_client_thread_unlock_connection(c);
+		return rc;
 	}
 
+	if (req_type != PBS_BATCH_AsyrunJob)
+		rc = PBSD_run_get(c);
+
 	/* unlock the thread lock and update the thread context data */
 	if (pbs_client_thread_unlock_connection(c) != 0)
 		return pbs_errno;
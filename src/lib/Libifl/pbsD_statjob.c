@@ -87,3 +87,67 @@ __pbs_statjob(int c, const char *id, struct attrl *attrib, const char *extend)
 
 	return ret;
 }
+
+/**
+ * @brief
+ *	-Return the status of jobs one part of the server's reply at a time.
+ *
+ * @par
+ *	Call first with *more set to 0 to send the request and get the first
+ *	part, then with *more as left by the previous call to get the next
+ *	parts until it is set back to 0.  id, attrib and extend are only used
+ *	by the first call.  Each part is freed with pbs_statfree() and a part
+ *	may be NULL with pbs_errno PBSE_NONE.
+ *
+ * @note
+ *	The connection stays locked until the last part is read, the caller
+ *	must read all the parts from the same thread before using the
+ *	connection for anything else.
+ *
+ * @param[in] c - communication handle
+ * @param[in] id - job id
+ * @param[in] attrib - pointer to attribute list
+ * @param[in] extend - extend string for req
+ * @param[in,out] more - 0 to start, set to 1 when more parts follow
+ *
+ * @return	structure handle
+ * @retval	pointer to batch_status struct		success
+ * @retval	NULL					error, or empty part
+ *
+ */
+struct batch_status *
+__pbs_statjob_iter(int c, const char *id, struct attrl *attrib, const char *extend, int *more)
+{
+	struct batch_status *ret = NULL;
+
+	if (*more == 0) {
+		/* initialize the thread context data, if not already initialized */
+		if (pbs_client_thread_init_thread_context() != 0)
+			return NULL;
+
+		/* first verify the attributes, if verification is enabled */
+		if ((pbs_verify_attributes(c, PBS_BATCH_StatusJob,
+					   MGR_OBJ_JOB, MGR_CMD_NONE, (struct attropl *) attrib)))
+			return NULL;
+
+		if (pbs_client_thread_lock_connection(c) != 0)
+			return NULL;
+
+		if (PBSD_status_put(c, PBS_BATCH_StatusJob, id ? id : "", attrib, extend, PROT_TCP, NULL) != 0) {
+			(void) pbs_client_thread_unlock_connection(c);
+			return NULL;
+		}
+	}
+
+	ret = PBSD_status_get_part(c, more);
+	if (*more)
+		return ret;
+
+	/* last part, unlock the thread lock and update the thread context data */
+	if (pbs_client_thread_unlock_connection(c) != 0) {
+		pbs_statfree(ret);
+		return NULL;
+	}
+
+	return ret;
+}
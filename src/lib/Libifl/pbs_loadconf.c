@@ -130,7 +130,10 @@ struct pbs_config pbs_conf = {
 	4,			    /* default number of threads */
 	NULL,			    /* mom short name override */
 	0,			    /* high resolution timestamp logging */
+	0,			    /* asynchronous logging off */
 	0,			    /* number of scheduler threads */
+	0,			    /* no server status threads */
+	1,			    /* compact DIS encoding offered */
 	NULL,			    /* default scheduler user */
 	NULL,			    /* default scheduler auth user */
 	NULL,			    /* privileged auth user */
@@ -527,9 +530,18 @@ __pbs_loadconf(int reload)
 			} else if (!strcmp(conf_name, PBS_CONF_LOG_HIGHRES_TIMESTAMP)) {
 				if (sscanf(conf_value, "%u", &uvalue) == 1)
 					pbs_conf.pbs_log_highres_timestamp = ((uvalue > 0) ? 1 : 0);
+			} else if (!strcmp(conf_name, PBS_CONF_LOG_ASYNC)) {
+				if (sscanf(conf_value, "%u", &uvalue) == 1)
+					pbs_conf.pbs_log_async = uvalue;
 			} else if (!strcmp(conf_name, PBS_CONF_SCHED_THREADS)) {
 				if (sscanf(conf_value, "%u", &uvalue) == 1)
 					pbs_conf.pbs_sched_threads = uvalue;
+			} else if (!strcmp(conf_name, PBS_CONF_SERVER_STAT_THREADS)) {
+				if (sscanf(conf_value, "%u", &uvalue) == 1)
+					pbs_conf.pbs_server_stat_threads = uvalue;
+			} else if (!strcmp(conf_name, PBS_CONF_DIS_COMPACT)) {
+				if (sscanf(conf_value, "%u", &uvalue) == 1)
+					pbs_conf.pbs_dis_compact = ((uvalue > 0) ? 1 : 0);
 			}
 #ifdef WIN32
 			else if (!strcmp(conf_name, PBS_CONF_REMOTE_VIEWER)) {
@@ -799,10 +811,22 @@ __pbs_loadconf(int reload)
 		if (sscanf(gvalue, "%u", &uvalue) == 1)
 			pbs_conf.pbs_log_highres_timestamp = ((uvalue > 0) ? 1 : 0);
 	}
+	if ((gvalue = getenv(PBS_CONF_LOG_ASYNC)) != NULL) {
+		if (sscanf(gvalue, "%u", &uvalue) == 1)
+			pbs_conf.pbs_log_async = uvalue;
+	}
 	if ((gvalue = getenv(PBS_CONF_SCHED_THREADS)) != NULL) {
 		if (sscanf(gvalue, "%u", &uvalue) == 1)
 			pbs_conf.pbs_sched_threads = uvalue;
 	}
+	if ((gvalue = getenv(PBS_CONF_SERVER_STAT_THREADS)) != NULL) {
+		if (sscanf(gvalue, "%u", &uvalue) == 1)
+			pbs_conf.pbs_server_stat_threads = uvalue;
+	}
+	if ((gvalue = getenv(PBS_CONF_DIS_COMPACT)) != NULL) {
+		if (sscanf(gvalue, "%u", &uvalue) == 1)
+			pbs_conf.pbs_dis_compact = ((uvalue > 0) ? 1 : 0);
+	}
 
 	if ((gvalue = getenv(PBS_CONF_DAEMON_SERVICE_USER)) != NULL) {
 		free(pbs_conf.pbs_daemon_service_user);
@@ -66,6 +66,9 @@
 #include <signal.h>
 #include <stddef.h>
 #include <stdarg.h>
+#ifndef WIN32
+#include <sys/uio.h>
+#endif
 
 #include "log.h"
 #include "pbs_ifl.h"
@@ -132,12 +135,63 @@ static unsigned int syslogfac = 0;
 static unsigned int syslogsvr = 3;
 static unsigned int pbs_log_highres_timestamp = 0;
 
+/*
+ * The log file itself (logfile, log_opened, log_open_day) is guarded by
+ * log_file_mutex.  In synchronous mode it is only ever taken inside
+ * log_write_mutex, in asynchronous mode the writer thread holds it while
+ * it writes out a batch or switches the log.
+ */
+static pthread_mutex_t log_file_mutex;
+
+#ifndef WIN32
+/*
+ * Asynchronous logging.
+ *
+ * Records are formatted by the logging thread into a slot of a bounded
+ * ring and written out by a single writer thread, in batches, with writev().
+ * Producers reserve slots lock free: each slot carries a sequence number
+ * which tells whether it is free for the producer at a given position
+ * (seq == pos) or holds a record ready for the writer (seq == pos + 1).
+ * Records which do not fit in a slot's inline buffer are allocated.
+ */
+#define LOG_ASYNC_SLOTS 4096 /* must be a power of 2 */
+#define LOG_ASYNC_INLINE 512 /* inline record buffer per slot */
+#define LOG_ASYNC_BATCH 64   /* records per writev() */
+
+typedef struct {
+	unsigned long seq;
+	int len;
+	int yday; /* day of year of the record, for the log switch */
+	char *line;
+	char inl[LOG_ASYNC_INLINE];
+} log_async_slot;
+
+static log_async_slot *log_async_ring = NULL;
+static unsigned long log_async_enq = 0; /* next position to reserve */
+static unsigned long log_async_deq = 0; /* next position to write */
+static volatile unsigned int log_async_mode = LOG_ASYNC_OFF;
+static int log_async_running = 0; /* writer thread exists in this process */
+static pthread_t log_async_tid;
+static pthread_mutex_t log_async_mutex;
+static pthread_cond_t log_async_work; /* writer waits for records */
+static pthread_cond_t log_async_space; /* producers wait for free slots */
+static int log_async_idle = 0;	      /* writer is waiting for records */
+static int log_async_waiters = 0;     /* producers waiting for slots */
+static unsigned long log_async_drops = 0;
+static unsigned long log_async_drops_reported = 0;
+static time_t log_async_drops_time = 0; /* last time drops were reported */
+
+static void log_async_flush(void);
+#endif
+
 static void log_init(void);
 static int log_mutex_lock();
 static int log_mutex_unlock();
 static void get_timestamp(ms_time *mst);
 static void log_record_inner(int eventtype, int objclass, int sev, const char *objname, const char *text, ms_time *mst);
 static void log_console_error(char *);
+static int log_open_locked(char *filename, char *directory, int silent);
+static void log_close_locked(int msg);
 
 void
 set_log_conf(char *leafname, char *nodename,
@@ -331,6 +385,7 @@ static void
 log_pre_fork_handler()
 {
 	log_mutex_lock();
+	pthread_mutex_lock(&log_file_mutex);
 }
 
 /**
@@ -341,17 +396,23 @@ log_pre_fork_handler()
 static void
 log_parent_post_fork_handler()
 {
+	pthread_mutex_unlock(&log_file_mutex);
 	log_mutex_unlock();
 }
 
 /**
  * @brief
  *	wrapper function for log_mutex_unlock().
+ *	The writer thread does not exist in the child, so the child
+ *	logs synchronously.  Records still queued belong to the parent.
  *
  */
 static void
 log_child_post_fork_handler()
 {
+	log_async_mode = LOG_ASYNC_OFF;
+	log_async_running = 0;
+	pthread_mutex_unlock(&log_file_mutex);
 	log_mutex_unlock();
 }
 #endif
@@ -373,6 +434,10 @@ log_init(void)
 		fprintf(stderr, "log write mutex init failed\n");
 		return;
 	}
+	if (pthread_mutex_init(&log_file_mutex, NULL) != 0) {
+		fprintf(stderr, "log file mutex init failed\n");
+		return;
+	}
 
 	/* 
 	 * atfork handlers are required for the logging layer
@@ -548,6 +613,31 @@ log_open(char *filename, char *directory)
  */
 int
 log_open_main(char *filename, char *directory, int silent)
+{
+	int rc;
+
+	pthread_once(&log_once_ctl, log_init); /* initialize mutex once */
+
+#ifndef WIN32
+	log_async_flush();
+#endif
+	pthread_mutex_lock(&log_file_mutex);
+	rc = log_open_locked(filename, directory, silent);
+	pthread_mutex_unlock(&log_file_mutex);
+
+	return rc;
+}
+
+/**
+ * @brief
+ *	log_open_main() with log_file_mutex already held by the caller.
+ *
+ * @return int
+ * @retval 0	for success
+ * @retval != 0 for failure
+ */
+static int
+log_open_locked(char *filename, char *directory, int silent)
 {
 	char buf[_POSIX_PATH_MAX];
 	int fds;
@@ -563,10 +653,8 @@ log_open_main(char *filename, char *directory, int silent)
 	 */
 	char tbuf[LOG_BUF_SIZE];
 
-	pthread_once(&log_once_ctl, log_init); /* initialize mutex once */
-
 	if (log_opened > 0) /* Close existing log */
-		log_close(0);
+		log_close_locked(0);
 
 	if (locallog != 0 || syslogfac == 0) {
 
@@ -963,6 +1051,436 @@ log_console_error(char *msg)
 	}
 }
 
+#ifndef WIN32
+/**
+ * @brief
+ *	Write all of an iovec array to a file descriptor, retrying on
+ *	partial writes and EINTR.
+ *
+ * @param[in] fd - file descriptor
+ * @param[in] iov - array of buffers, modified as it is written
+ * @param[in] cnt - number of buffers
+ *
+ * @return int
+ * @retval  0 - success
+ * @retval -1 - write failed
+ */
+static int
+log_async_writev(int fd, struct iovec *iov, int cnt)
+{
+	ssize_t n;
+
+	while (cnt > 0) {
+		n = writev(fd, iov, cnt);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		while (cnt > 0 && (size_t) n >= iov->iov_len) {
+			n -= iov->iov_len;
+			iov++;
+			cnt--;
+		}
+		if (cnt > 0) {
+			iov->iov_base = (char *) iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief
+ *	Write out the records of a batch and hand their slots back to
+ *	the producers.
+ *
+ * @param[in] iov - one buffer per record of the batch
+ * @param[in] cnt - number of records in the batch
+ *
+ * @par MT-safe: No, writer thread only, with log_file_mutex held
+ */
+static void
+log_async_write_batch(struct iovec *iov, int cnt)
+{
+	int i;
+	log_async_slot *slot;
+
+	if (cnt == 0)
+		return;
+
+	if (log_opened > 0 && log_async_writev(fileno(logfile), iov, cnt) != 0)
+		log_console_error("PBS cannot write to its log");
+
+	for (i = 0; i < cnt; i++) {
+		slot = &log_async_ring[(log_async_deq + i) & (LOG_ASYNC_SLOTS - 1)];
+		if (slot->line != slot->inl)
+			free(slot->line);
+		__atomic_store_n(&slot->seq, log_async_deq + i + LOG_ASYNC_SLOTS, __ATOMIC_RELEASE);
+	}
+	__atomic_store_n(&log_async_deq, log_async_deq + cnt, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief
+ *	Write out every record which is ready, switching the log at the
+ *	day boundary the same way log_record() does.
+ *
+ * @return int
+ * @retval number of records written
+ *
+ * @par MT-safe: No, writer thread only
+ */
+static int
+log_async_drain(void)
+{
+	struct iovec iov[LOG_ASYNC_BATCH];
+	log_async_slot *slot;
+	int cnt = 0;
+	int total = 0;
+	unsigned long drops;
+	char dbuf[LOG_BUF_SIZE];
+	ms_time mst;
+
+	pthread_mutex_lock(&log_file_mutex);
+	for (;;) {
+		slot = &log_async_ring[(log_async_deq + cnt) & (LOG_ASYNC_SLOTS - 1)];
+		if (cnt == LOG_ASYNC_BATCH ||
+		    __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != log_async_deq + cnt + 1) {
+			if (cnt == 0)
+				break;
+			log_async_write_batch(iov, cnt);
+			total += cnt;
+			cnt = 0;
+			continue;
+		}
+
+		/* Do we need to switch the log? */
+		if (log_auto_switch && slot->yday != log_open_day) {
+			log_async_write_batch(iov, cnt);
+			total += cnt;
+			cnt = 0;
+			log_close_locked(1);
+			log_open_locked(NULL, log_directory, 0);
+			if (log_opened < 1)
+				log_console_error("PBS cannot open its log");
+			continue;
+		}
+
+		iov[cnt].iov_base = slot->line;
+		iov[cnt].iov_len = slot->len;
+		cnt++;
+	}
+
+	drops = __atomic_load_n(&log_async_drops, __ATOMIC_RELAXED);
+	if (drops != log_async_drops_reported && log_opened > 0 && time(NULL) != log_async_drops_time) {
+		snprintf(dbuf, sizeof(dbuf), "%lu debug log records dropped, log buffer full",
+			 drops - log_async_drops_reported);
+		get_timestamp(&mst);
+		log_record_inner(PBSEVENT_SYSTEM, PBS_EVENTCLASS_SERVER, LOG_WARNING, msg_daemonname, dbuf, &mst);
+		log_async_drops_reported = drops;
+		log_async_drops_time = time(NULL);
+	}
+	pthread_mutex_unlock(&log_file_mutex);
+
+	if (total > 0 && __atomic_load_n(&log_async_waiters, __ATOMIC_SEQ_CST) > 0) {
+		pthread_mutex_lock(&log_async_mutex);
+		pthread_cond_broadcast(&log_async_space);
+		pthread_mutex_unlock(&log_async_mutex);
+	}
+
+	return total;
+}
+
+/**
+ * @brief
+ *	Main loop of the log writer thread.  Sleeps when there is nothing
+ *	to write, the timed wait is only a backstop for a missed wakeup.
+ *
+ * @param[in] arg - unused
+ *
+ * @return void *
+ */
+static void *
+log_async_writer(void *arg)
+{
+	struct timespec ts;
+	log_async_slot *slot;
+
+	for (;;) {
+		if (log_async_drain() > 0)
+			continue;
+
+		pthread_mutex_lock(&log_async_mutex);
+		__atomic_store_n(&log_async_idle, 1, __ATOMIC_SEQ_CST);
+		slot = &log_async_ring[log_async_deq & (LOG_ASYNC_SLOTS - 1)];
+		if (__atomic_load_n(&slot->seq, __ATOMIC_SEQ_CST) != log_async_deq + 1) {
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_sec++;
+			pthread_cond_timedwait(&log_async_work, &log_async_mutex, &ts);
+		}
+		__atomic_store_n(&log_async_idle, 0, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&log_async_mutex);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief
+ *	Wake the writer if it is waiting for records.
+ */
+static void
+log_async_wake(void)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&log_async_idle, __ATOMIC_SEQ_CST)) {
+		pthread_mutex_lock(&log_async_mutex);
+		pthread_cond_signal(&log_async_work);
+		pthread_mutex_unlock(&log_async_mutex);
+	}
+}
+
+/**
+ * @brief
+ *	Wait a little for the writer to free up slots.
+ */
+static void
+log_async_wait_space(void)
+{
+	struct timespec ts;
+
+	__atomic_add_fetch(&log_async_waiters, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_lock(&log_async_mutex);
+	pthread_cond_signal(&log_async_work);
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_nsec += 10000000;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+	pthread_cond_timedwait(&log_async_space, &log_async_mutex, &ts);
+	pthread_mutex_unlock(&log_async_mutex);
+	__atomic_sub_fetch(&log_async_waiters, 1, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief
+ *	Wait until everything queued so far has been written out.
+ *	Does nothing in synchronous mode or on the writer thread itself.
+ */
+static void
+log_async_flush(void)
+{
+	unsigned long target;
+
+	if (!log_async_running || pthread_equal(pthread_self(), log_async_tid))
+		return;
+
+	target = __atomic_load_n(&log_async_enq, __ATOMIC_ACQUIRE);
+	while ((long) (__atomic_load_n(&log_async_deq, __ATOMIC_ACQUIRE) - target) < 0)
+		log_async_wait_space();
+}
+
+/**
+ * @brief
+ *	atexit() handler, so records queued before exit() are not lost.
+ */
+static void
+log_async_atexit(void)
+{
+	log_async_flush();
+}
+
+/**
+ * @brief
+ *	Queue a record for the writer thread.
+ *
+ *	The timestamp is formatted once per second per thread.
+ *
+ * @param[in] eventtype - event type
+ * @param[in] objclass - event object class
+ * @param[in] objname - object name stating log msg related to which object
+ * @param[in] text - log msg to be logged
+ *
+ * @par MT-safe: Yes
+ */
+static void
+log_async_record(int eventtype, int objclass, const char *objname, const char *text)
+{
+	static __thread time_t ts_sec = -1;
+	static __thread int ts_yday;
+	/* worst case of the format below: six ints of up to 11 chars each */
+	static __thread char ts_buf[6 * 11 + 6];
+	struct timeval tp;
+	struct tm ltm;
+	char usec[8] = "";
+	unsigned long pos;
+	long diff;
+	log_async_slot *slot;
+	int len;
+
+	if (gettimeofday(&tp, NULL) == -1) {
+		tp.tv_sec = 0;
+		tp.tv_usec = 0;
+	}
+	if (tp.tv_sec != ts_sec) {
+		localtime_r(&tp.tv_sec, &ltm);
+		snprintf(ts_buf, sizeof(ts_buf), "%02d/%02d/%04d %02d:%02d:%02d",
+			 ltm.tm_mon + 1, ltm.tm_mday, ltm.tm_year + 1900,
+			 ltm.tm_hour, ltm.tm_min, ltm.tm_sec);
+		ts_yday = ltm.tm_yday;
+		ts_sec = tp.tv_sec;
+	}
+	if (pbs_log_highres_timestamp)
+		snprintf(usec, sizeof(usec), ".%06ld", (long) tp.tv_usec);
+
+	/* reserve a slot */
+	pos = __atomic_load_n(&log_async_enq, __ATOMIC_RELAXED);
+	for (;;) {
+		slot = &log_async_ring[pos & (LOG_ASYNC_SLOTS - 1)];
+		diff = (long) (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&log_async_enq, &pos, pos + 1, 1,
+							__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (diff < 0) {
+			/* ring is full */
+			if (log_async_mode == LOG_ASYNC_DROP_DEBUG && !(eventtype & PBSEVENT_FORCE) &&
+			    (eventtype & ~(PBSEVENT_DEBUG | PBSEVENT_DEBUG2 | PBSEVENT_DEBUG3 |
+					   PBSEVENT_DEBUG4 | PBSEVENT_DEBUGPRT)) == 0) {
+				__atomic_add_fetch(&log_async_drops, 1, __ATOMIC_RELAXED);
+				return;
+			}
+			log_async_wait_space();
+			pos = __atomic_load_n(&log_async_enq, __ATOMIC_RELAXED);
+		} else
+			pos = __atomic_load_n(&log_async_enq, __ATOMIC_RELAXED);
+	}
+
+#define LOG_ASYNC_FMT "%s%s;%04x;%s;%s;%s;%s\n"
+#define LOG_ASYNC_ARGS ts_buf, usec, eventtype & ~PBSEVENT_FORCE, msg_daemonname, \
+		       class_names[objclass], objname, text
+	slot->line = slot->inl;
+	len = snprintf(slot->inl, LOG_ASYNC_INLINE, LOG_ASYNC_FMT, LOG_ASYNC_ARGS);
+	if (len < 0)
+		len = 0;
+	else if (len >= LOG_ASYNC_INLINE) {
+		char *line;
+
+		if ((line = malloc(len + 1)) != NULL) {
+			snprintf(line, len + 1, LOG_ASYNC_FMT, LOG_ASYNC_ARGS);
+			slot->line = line;
+		} else {
+			/* keep the truncated record, newline terminated */
+			slot->inl[LOG_ASYNC_INLINE - 2] = '\n';
+			len = LOG_ASYNC_INLINE - 1;
+		}
+	}
+#undef LOG_ASYNC_FMT
+#undef LOG_ASYNC_ARGS
+	slot->len = len;
+	slot->yday = ts_yday;
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+	log_async_wake();
+}
+#endif /* WIN32 */
+
+/**
+ * @brief
+ *	Select the asynchronous logging mode, see LOG_ASYNC_* in log.h.
+ *
+ *	In asynchronous mode log_record() only formats the record into a
+ *	ring buffer and a writer thread writes it to the log file.  When
+ *	the buffer is full LOG_ASYNC_BLOCK waits for room, LOG_ASYNC_DROP_DEBUG
+ *	drops records of debug events only and counts them.
+ *
+ *	Call it after the daemon has forked into the background: a child
+ *	process does not inherit the writer thread and logs synchronously.
+ *	Not supported on Windows, where this is a no-op.
+ *
+ * @param[in] mode - LOG_ASYNC_OFF, LOG_ASYNC_BLOCK or LOG_ASYNC_DROP_DEBUG
+ *
+ */
+void
+log_set_async(unsigned int mode)
+{
+#ifndef WIN32
+	static int atexit_set = 0;
+	sigset_t block_mask;
+	sigset_t old_mask;
+	unsigned long i;
+	int rc;
+
+	pthread_once(&log_once_ctl, log_init); /* initialize mutex once */
+
+	if (mode > LOG_ASYNC_DROP_DEBUG)
+		mode = LOG_ASYNC_BLOCK;
+
+	if (mode == LOG_ASYNC_OFF) {
+		log_async_mode = LOG_ASYNC_OFF;
+		log_async_flush();
+		return;
+	}
+
+	if (!log_async_running) {
+		if (log_async_ring == NULL) {
+			log_async_ring = malloc(LOG_ASYNC_SLOTS * sizeof(log_async_slot));
+			if (log_async_ring == NULL) {
+				log_err(errno, __func__, "cannot allocate the log buffer, logging synchronously");
+				return;
+			}
+		}
+		/* also resets what a fork left behind */
+		for (i = 0; i < LOG_ASYNC_SLOTS; i++)
+			log_async_ring[i].seq = i;
+		log_async_enq = 0;
+		log_async_deq = 0;
+		log_async_idle = 0;
+		log_async_waiters = 0;
+		pthread_mutex_init(&log_async_mutex, NULL);
+		pthread_cond_init(&log_async_work, NULL);
+		pthread_cond_init(&log_async_space, NULL);
+
+		/* the writer thread must not take the daemon's signals */
+		sigfillset(&block_mask);
+		pthread_sigmask(SIG_BLOCK, &block_mask, &old_mask);
+		rc = pthread_create(&log_async_tid, NULL, log_async_writer, NULL);
+		pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+		if (rc != 0) {
+			log_err(rc, __func__, "cannot create the log writer thread, logging synchronously");
+			return;
+		}
+		pthread_detach(log_async_tid);
+		log_async_running = 1;
+
+		if (!atexit_set) {
+			atexit(log_async_atexit);
+			atexit_set = 1;
+		}
+	}
+	log_async_mode = mode;
+#endif
+}
+
+/**
+ * @brief
+ *	Number of debug records dropped because the asynchronous log
+ *	buffer was full.
+ *
+ * @return unsigned long
+ */
+unsigned long
+log_async_dropped(void)
+{
+#ifndef WIN32
+	return __atomic_load_n(&log_async_drops, __ATOMIC_RELAXED);
+#else
+	return 0;
+#endif
+}
+
 /**
  * @brief
  * 	log a message to the log file - this function acquires a lock
@@ -1012,6 +1530,14 @@ log_record(int eventtype, int objclass, int sev, const char *objname, const char
 	if ((text == NULL) || (objname == NULL))
 		goto sigunblock;
 
+#ifndef WIN32
+	if (log_async_mode != LOG_ASYNC_OFF && log_async_running) {
+		if (locallog != 0 || syslogfac == 0)
+			log_async_record(eventtype, objclass, objname, text);
+		goto sigunblock;
+	}
+#endif
+
 	/* lock the file mutex */
 	if (log_mutex_lock() == 0) {
 		get_timestamp(&mst);
@@ -1086,6 +1612,26 @@ log_record_inner(int eventtype, int objclass, int sev, const char *objname, cons
  */
 void
 log_close(int msg)
+{
+	pthread_once(&log_once_ctl, log_init); /* initialize mutex once */
+
+#ifndef WIN32
+	log_async_flush();
+#endif
+	pthread_mutex_lock(&log_file_mutex);
+	log_close_locked(msg);
+	pthread_mutex_unlock(&log_file_mutex);
+}
+
+/**
+ * @brief
+ *	log_close() with log_file_mutex already held by the caller.
+ *
+ * @param[in] msg - indicating whether to log a message of closing log file before closing it
+ *
+ */
+static void
+log_close_locked(int msg)
 {
 	if (log_opened == 1) {
 		log_auto_switch = 0;
@@ -100,6 +100,8 @@ static int init_poll_context(); /* Initialize the tpp context */
 static void (*read_func[2])(int);
 static int (*ready_read_func[2])(conn_t *);
 static char logbuf[256];
+static void (*poll_enter_func)(void); /* called before blocking in poll, see net_set_poll_hooks() */
+static void (*poll_leave_func)(void); /* called once poll returns */
 
 /* Private function within this file */
 static int conn_find_usable_index(int);
@@ -399,7 +401,7 @@ connection_idlecheck(void)
 			continue;
 		if ((now - cp->cn_lasttime) <= PBS_NET_MAXCONNECTIDLE)
 			continue;
-		if (cp->cn_authen & PBS_NET_CONN_NOTIMEOUT)
+		if (cp->cn_authen & (PBS_NET_CONN_NOTIMEOUT | PBS_NET_CONN_PAUSED))
 			continue; /* do not time-out this connection */
 
 		ipaddr = cp->cn_addr;
@@ -483,6 +485,8 @@ process_socket(int sock)
 	if (idx < 0) {
 		return -1;
 	}
+	if (svr_conn[idx]->cn_authen & PBS_NET_CONN_PAUSED)
+		return 0; /* event reported before the connection was paused */
 	svr_conn[idx]->cn_lasttime = time(NULL);
 	if ((svr_conn[idx]->cn_active != Primary) &&
 	    (svr_conn[idx]->cn_active != TppComm) &&
@@ -557,8 +561,12 @@ wait_request(float waittime, void *priority_context)
 
 	/* wait after unblocking signals in an atomic call */
 	sigemptyset(&emptyset);
+	if (poll_enter_func != NULL)
+		poll_enter_func();
 	nfds = tpp_em_pwait(poll_context, &events, timeout, &emptyset);
 	err = errno;
+	if (poll_leave_func != NULL)
+		poll_leave_func();
 #else
 	errno = 0;
 	nfds = tpp_em_wait(poll_context, &events, timeout);
@@ -788,6 +796,98 @@ set_conn_as_priority(conn_t *conn)
 	return 1;
 }
 
+/**
+ * @brief
+ *	net_pause_conn - stop polling a connection
+ *
+ * @par Functionality:
+ *	The socket is taken out of the poll list (and the priority poll list)
+ *	but the connection stays in the connection table.  A paused connection
+ *	is neither read nor timed out until net_resume_conn() is called; this
+ *	lets another thread own the socket for a while.
+ *
+ * @param[in]	sd: socket descriptor
+ *
+ * @return	int
+ * @retval	0 - success
+ * @retval	-1 - failure
+ */
+int
+net_pause_conn(int sd)
+{
+	int idx = conn_find_actual_index(sd);
+
+	if (idx == -1)
+		return -1;
+	if (svr_conn[idx]->cn_authen & PBS_NET_CONN_PAUSED)
+		return 0;
+
+	if (tpp_em_del_fd(poll_context, sd) < 0) {
+		log_errf(errno, __func__, "could not remove socket %d from poll list", sd);
+		return -1;
+	}
+	if (svr_conn[idx]->cn_prio_flag) {
+		if (tpp_em_del_fd(priority_context, sd) < 0)
+			log_errf(errno, __func__, "could not remove socket %d from priority poll list", sd);
+	}
+	svr_conn[idx]->cn_authen |= PBS_NET_CONN_PAUSED;
+	return 0;
+}
+
+/**
+ * @brief
+ *	net_resume_conn - poll again a connection paused by net_pause_conn()
+ *
+ * @param[in]	sd: socket descriptor
+ *
+ * @return	int
+ * @retval	0 - success
+ * @retval	-1 - failure
+ */
+int
+net_resume_conn(int sd)
+{
+	int idx = conn_find_actual_index(sd);
+
+	if (idx == -1)
+		return -1;
+	if (!(svr_conn[idx]->cn_authen & PBS_NET_CONN_PAUSED))
+		return 0;
+
+	if (tpp_em_add_fd(poll_context, sd, EM_IN | EM_HUP | EM_ERR) < 0) {
+		log_errf(errno, __func__, "could not add socket %d to the poll list", sd);
+		return -1;
+	}
+	if (svr_conn[idx]->cn_prio_flag) {
+		if (tpp_em_add_fd(priority_context, sd, EM_IN | EM_HUP | EM_ERR) < 0)
+			log_errf(errno, __func__, "could not add socket %d to the priority poll list", sd);
+	}
+	svr_conn[idx]->cn_authen &= ~PBS_NET_CONN_PAUSED;
+	svr_conn[idx]->cn_lasttime = time(NULL);
+	return 0;
+}
+
+/**
+ * @brief
+ *	net_set_poll_hooks - register functions that wait_request() calls
+ *	just before it blocks in poll and just after poll returns
+ *
+ * @par Functionality:
+ *	A daemon that shares its data with other threads uses these to drop
+ *	its lock while the main thread has nothing to do.
+ *
+ * @param[in]	enter: called before poll, may be NULL
+ * @param[in]	leave: called after poll, may be NULL
+ *
+ * @return void
+ */
+void
+net_set_poll_hooks(void (*enter)(void), void (*leave)(void))
+{
+	poll_enter_func = enter;
+	poll_leave_func = leave;
+}
+
 /**
  * @brief
  *	add_conn_data - add some data to a connection
@@ -930,13 +1030,15 @@ close_conn(int sd)
 static void
 cleanup_conn(int idx)
 {
-	if (tpp_em_del_fd(poll_context, svr_conn[idx]->cn_sock) < 0) {
+	if (svr_conn[idx]->cn_authen & PBS_NET_CONN_PAUSED) {
+		/* already out of the poll lists */
+	} else if (tpp_em_del_fd(poll_context, svr_conn[idx]->cn_sock) < 0) {
 		int err = errno;
 		snprintf(logbuf, sizeof(logbuf),
 			 "could not remove socket %d from poll list", svr_conn[idx]->cn_sock);
 		log_err(err, __func__, logbuf);
 	}
-	if (svr_conn[idx]->cn_prio_flag) {
+	if (svr_conn[idx]->cn_prio_flag && !(svr_conn[idx]->cn_authen & PBS_NET_CONN_PAUSED)) {
 		if (tpp_em_del_fd(priority_context, svr_conn[idx]->cn_sock) < 0) {
 			int err = errno;
 			snprintf(logbuf, sizeof(logbuf),
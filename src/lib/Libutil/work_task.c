@@ -53,23 +53,260 @@
 #include "server_limits.h"
 #include "list_link.h"
 #include "work_task.h"
+#include "pbs_idx.h"
 
 /* Global Data Items: */
 
 extern pbs_list_head task_list_immed;	   /* list of tasks that can execute now */
 extern pbs_list_head task_list_interleave; /* list of tasks that can execute after interleaving other tasks */
-extern pbs_list_head task_list_timed;	   /* list of tasks that have set start times */
 extern pbs_list_head task_list_event;	   /* list of tasks responding to an event */
 extern int svr_delay_entry;
 extern time_t time_now;
 
+/*
+ * Tasks that have set start times are kept in a binary min-heap ordered
+ * on (wt_event, wt_seq), so tasks set for the same time still run in the
+ * order they were set.  Each task holds its position in the heap
+ * (wt_heapidx) so it can be taken off the heap without a search.
+ */
+static struct work_task **timed_heap = NULL;
+static int timed_heap_cnt = 0;
+static int timed_heap_size = 0;
+static unsigned long task_seq = 0;
+
+/*
+ * Index of the tasks on their wt_parm1.  Each entry is a list of the
+ * tasks with that wt_parm1, linked by wt_linkparm1.
+ */
+static void *task_parm1_idx = NULL;
+
+/* where a task currently is, see task_where() */
+enum task_where {
+	TASK_NOWHERE,
+	TASK_IMMED,
+	TASK_INTERLEAVE,
+	TASK_TIMED,
+	TASK_EVENT
+};
+
+/**
+ * @brief
+ *	Order of two timed tasks in the timed task heap.
+ *
+ * @return int
+ * @retval 1 if 'a' runs before 'b'
+ * @retval 0 otherwise
+ */
+static int
+timed_before(struct work_task *a, struct work_task *b)
+{
+	if (a->wt_event != b->wt_event)
+		return (a->wt_event < b->wt_event);
+	return (a->wt_seq < b->wt_seq);
+}
+
+/**
+ * @brief
+ *	Put a task at position 'i' of the timed task heap.
+ */
+static void
+timed_heap_set(int i, struct work_task *ptask)
+{
+	timed_heap[i] = ptask;
+	ptask->wt_heapidx = i;
+}
+
+/**
+ * @brief
+ *	Move the task at position 'i' up the heap to its place.
+ */
+static void
+timed_heap_up(int i)
+{
+	struct work_task *ptask = timed_heap[i];
+	int parent;
+
+	while (i > 0) {
+		parent = (i - 1) / 2;
+		if (!timed_before(ptask, timed_heap[parent]))
+			break;
+		timed_heap_set(i, timed_heap[parent]);
+		i = parent;
+	}
+	timed_heap_set(i, ptask);
+}
+
+/**
+ * @brief
+ *	Move the task at position 'i' down the heap to its place.
+ */
+static void
+timed_heap_down(int i)
+{
+	struct work_task *ptask = timed_heap[i];
+	int child;
+
+	while ((child = 2 * i + 1) < timed_heap_cnt) {
+		if ((child + 1 < timed_heap_cnt) && timed_before(timed_heap[child + 1], timed_heap[child]))
+			child++;
+		if (!timed_before(timed_heap[child], ptask))
+			break;
+		timed_heap_set(i, timed_heap[child]);
+		i = child;
+	}
+	timed_heap_set(i, ptask);
+}
+
+/**
+ * @brief
+ *	Add a task to the timed task heap.
+ *
+ * @param[in]	ptask - the task, ordered on its wt_event
+ *
+ * @return int
+ * @retval 0: success
+ * @retval -1: out of memory
+ */
+static int
+timed_heap_insert(struct work_task *ptask)
+{
+	struct work_task **tmp;
+	int size;
+
+	if (timed_heap_cnt == timed_heap_size) {
+		size = timed_heap_size ? timed_heap_size * 2 : 1024;
+		tmp = (struct work_task **) realloc(timed_heap, size * sizeof(struct work_task *));
+		if (tmp == NULL)
+			return -1;
+		timed_heap = tmp;
+		timed_heap_size = size;
+	}
+	timed_heap_set(timed_heap_cnt, ptask);
+	timed_heap_up(timed_heap_cnt++);
+	return 0;
+}
+
+/**
+ * @brief
+ *	Take a task off the timed task heap, if it is on it.
+ *
+ * @param[in]	ptask - the task
+ */
+static void
+timed_heap_remove(struct work_task *ptask)
+{
+	struct work_task *last;
+	int i = ptask->wt_heapidx;
+
+	if (i < 0)
+		return;
+
+	ptask->wt_heapidx = -1;
+	last = timed_heap[--timed_heap_cnt];
+	if (last == ptask)
+		return;
+
+	timed_heap_set(i, last);
+	if ((i > 0) && timed_before(last, timed_heap[(i - 1) / 2]))
+		timed_heap_up(i);
+	else
+		timed_heap_down(i);
+}
+
+/**
+ * @brief
+ *	Add a task to the index on wt_parm1.  Tasks without a wt_parm1
+ *	are not indexed.
+ *
+ * @param[in]	ptask - the task
+ *
+ * @return int
+ * @retval 0: success
+ * @retval -1: out of memory
+ */
+static int
+parm1_index_add(struct work_task *ptask)
+{
+	pbs_list_head *head;
+	void *key = &ptask->wt_parm1;
+
+	if (ptask->wt_parm1 == NULL)
+		return 0;
+
+	if (task_parm1_idx == NULL) {
+		if ((task_parm1_idx = pbs_idx_create(0, sizeof(void *))) == NULL)
+			return -1;
+	}
+
+	if (pbs_idx_find(task_parm1_idx, &key, (void **) &head, NULL) != PBS_IDX_RET_OK) {
+		if ((head = (pbs_list_head *) malloc(sizeof(pbs_list_head))) == NULL)
+			return -1;
+		CLEAR_HEAD((*head));
+		if (pbs_idx_insert(task_parm1_idx, &ptask->wt_parm1, head) != PBS_IDX_RET_OK) {
+			free(head);
+			return -1;
+		}
+	}
+	append_link(head, &ptask->wt_linkparm1, ptask);
+	return 0;
+}
+
+/**
+ * @brief
+ *	Take a task out of the index on wt_parm1, dropping the entry
+ *	for its wt_parm1 when it was the last task with it.
+ *
+ * @param[in]	ptask - the task
+ */
+static void
+parm1_index_remove(struct work_task *ptask)
+{
+	pbs_list_head *head;
+
+	if (ptask->wt_linkparm1.ll_next == &ptask->wt_linkparm1)
+		return; /* not indexed */
+
+	if (ptask->wt_linkparm1.ll_next == ptask->wt_linkparm1.ll_prior) {
+		/* only task on the list, both links point to the head */
+		head = ptask->wt_linkparm1.ll_next;
+		delete_link(&ptask->wt_linkparm1);
+		pbs_idx_delete(task_parm1_idx, &ptask->wt_parm1);
+		free(head);
+	} else
+		delete_link(&ptask->wt_linkparm1);
+}
+
+/**
+ * @brief
+ *	Tell where a task currently is.
+ *
+ * @param[in]	ptask - the task
+ *
+ * @return enum task_where
+ * @retval TASK_NOWHERE if the task was taken off its event list,
+ *	   e.g. to go on a mom's deferred command list
+ */
+static enum task_where
+task_where(struct work_task *ptask)
+{
+	if (ptask->wt_heapidx >= 0)
+		return TASK_TIMED;
+	if (ptask->wt_linkevent.ll_next == &ptask->wt_linkevent)
+		return TASK_NOWHERE;
+	if (ptask->wt_list == &task_list_immed)
+		return TASK_IMMED;
+	if (ptask->wt_list == &task_list_interleave)
+		return TASK_INTERLEAVE;
+	return TASK_EVENT;
+}
+
 /**
  *
  * @brief
  * 	Creates a task of type 'type', 'event_id', and when task is dispatched,
  *	execute func with argument 'parm'. The task is added to
- *	'task_list_immed' if 'type' is  WORK_Immed; otherwise, task is added
- *	'task_list_event'.
+ *	'task_list_immed' if 'type' is  WORK_Immed, to the timed task heap if
+ *	'type' is WORK_Timed; otherwise, task is added 'task_list_event'.
  *
  * @param[in]	type - of task
  * @param[in]	event_id - event id of the task
@@ -85,7 +322,7 @@ struct work_task *
 set_task(enum work_type type, long event_id, void (*func)(struct work_task *), void *parm)
 {
 	struct work_task *pnew;
-	struct work_task *pold;
+	pbs_list_head *list;
 
 	pnew = (struct work_task *) malloc(sizeof(struct work_task));
 	if (pnew == NULL)
@@ -93,6 +330,7 @@ set_task(enum work_type type, long event_id, void (*func)(struct work_task *), v
 	CLEAR_LINK(pnew->wt_linkevent);
 	CLEAR_LINK(pnew->wt_linkobj);
 	CLEAR_LINK(pnew->wt_linkobj2);
+	CLEAR_LINK(pnew->wt_linkparm1);
 	pnew->wt_event = event_id;
 	pnew->wt_event2 = NULL;
 	pnew->wt_type = type;
@@ -102,25 +340,32 @@ set_task(enum work_type type, long event_id, void (*func)(struct work_task *), v
 	pnew->wt_parm3 = NULL;
 	pnew->wt_aux = 0;
 	pnew->wt_aux2 = 0;
+	pnew->wt_list = NULL;
+	pnew->wt_heapidx = -1;
+	pnew->wt_seq = task_seq++;
+
+	if (parm1_index_add(pnew) != 0) {
+		free(pnew);
+		return NULL;
+	}
+
+	if (type == WORK_Timed) {
+		if (timed_heap_insert(pnew) != 0) {
+			parm1_index_remove(pnew);
+			free(pnew);
+			return NULL;
+		}
+		return (pnew);
+	}
 
 	if (type == WORK_Immed)
-		append_link(&task_list_immed, &pnew->wt_linkevent, pnew);
+		list = &task_list_immed;
 	else if (type == WORK_Interleave)
-		append_link(&task_list_interleave, &pnew->wt_linkevent, pnew);
-	else if (type == WORK_Timed) {
-		pold = (struct work_task *) GET_NEXT(task_list_timed);
-		while (pold) {
-			if (pold->wt_event > pnew->wt_event)
-				break;
-			pold = (struct work_task *) GET_NEXT(pold->wt_linkevent);
-		}
-		if (pold)
-			insert_link(&pold->wt_linkevent, &pnew->wt_linkevent, pnew,
-				    LINK_INSET_BEFORE);
-		else
-			append_link(&task_list_timed, &pnew->wt_linkevent, pnew);
-	} else
-		append_link(&task_list_event, &pnew->wt_linkevent, pnew);
+		list = &task_list_interleave;
+	else
+		list = &task_list_event;
+	pnew->wt_list = list;
+	append_link(list, &pnew->wt_linkevent, pnew);
 	return (pnew);
 }
 
@@ -144,18 +389,24 @@ convert_work_task(struct work_task *ptask, enum work_type wtype)
 	if (!ptask)
 		return -1;
 
-	switch (wtype) {
-		case WORK_Immed:
-			list = &task_list_immed;
-			break;
-		case WORK_Timed:
-			list = &task_list_timed;
-			break;
-		default:
-			list = &task_list_event;
+	if (wtype == WORK_Timed) {
+		/* insert before unlinking, so a failure leaves the task as it was */
+		if (ptask->wt_heapidx >= 0)
+			timed_heap_remove(ptask);
+		if (timed_heap_insert(ptask) != 0)
+			return -1;
+		delete_link(&ptask->wt_linkevent);
+		return 0;
 	}
 
+	if (wtype == WORK_Immed)
+		list = &task_list_immed;
+	else
+		list = &task_list_event;
+
+	timed_heap_remove(ptask);
 	delete_link(&ptask->wt_linkevent);
+	ptask->wt_list = list;
 	append_link(list, &ptask->wt_linkevent, ptask);
 
 	return 0;
@@ -177,6 +428,8 @@ convert_work_task(struct work_task *ptask, enum work_type wtype)
 void
 dispatch_task(struct work_task *ptask)
 {
+	timed_heap_remove(ptask);
+	parm1_index_remove(ptask);
 	delete_link(&ptask->wt_linkevent);
 	delete_link(&ptask->wt_linkobj);
 	delete_link(&ptask->wt_linkobj2);
@@ -196,6 +449,8 @@ dispatch_task(struct work_task *ptask)
 void
 delete_task(struct work_task *ptask)
 {
+	timed_heap_remove(ptask);
+	parm1_index_remove(ptask);
 	delete_link(&ptask->wt_linkobj);
 	delete_link(&ptask->wt_linkobj2);
 	delete_link(&ptask->wt_linkevent);
@@ -236,10 +491,65 @@ find_worktask_by_parm_func(pbs_list_head task_list, void *parm1, void *func)
 	return NULL;
 }
 
+/**
+ * @brief
+ *	Find a task at 'where' with a wt_parm1 matching 'parm1' and a
+ *	wt_func matching 'func'.  Looks 'parm1' up in the wt_parm1 index
+ *	when it is given.  Of the matching timed tasks the one due first
+ *	is returned.
+ *
+ * @param[in]	where	- TASK_IMMED, TASK_TIMED or TASK_EVENT
+ * @param[in]	parm1	- parameter being matched. NULL to ignore this field.
+ * @param[in]	func	- function being matched. NULL to ignore this field.
+ *
+ * @return work task
+ * @retval	!NULL if 'parm1' and 'func' was matched
+ * @retval	NULL otherwise
+ */
+static struct work_task *
+find_task_at(enum task_where where, void *parm1, void *func)
+{
+	struct work_task *ptask;
+	struct work_task *found = NULL;
+	pbs_list_head *head;
+	void *key = &parm1;
+	int i;
+
+	if (parm1 != NULL) {
+		if (task_parm1_idx == NULL ||
+		    pbs_idx_find(task_parm1_idx, &key, (void **) &head, NULL) != PBS_IDX_RET_OK)
+			return NULL;
+		for (ptask = GET_NEXT(*head); ptask; ptask = GET_NEXT(ptask->wt_linkparm1)) {
+			if (task_where(ptask) != where)
+				continue;
+			if (func && (ptask->wt_func != func))
+				continue;
+			if (where != TASK_TIMED)
+				return ptask;
+			if (found == NULL || timed_before(ptask, found))
+				found = ptask;
+		}
+		return found;
+	}
+
+	if (where == TASK_TIMED) {
+		for (i = 0; i < timed_heap_cnt; i++) {
+			ptask = timed_heap[i];
+			if (func && (ptask->wt_func != func))
+				continue;
+			if (found == NULL || timed_before(ptask, found))
+				found = ptask;
+		}
+		return found;
+	}
+
+	return find_worktask_by_parm_func(where == TASK_IMMED ? task_list_immed : task_list_event, NULL, func);
+}
+
 /**
  * @brief
  *	Check if some task in in any of the task lists (task_list_event,
- *	task_list_timed, task_list_immed)
+ *	timed tasks, task_list_immed)
  *	has a wt_parm1 matching 'parm1'
  *	and wt_func matching 'func'
  *
@@ -257,19 +567,19 @@ find_work_task(enum work_type wtype, void *parm1, void *func)
 	struct work_task *ptask;
 
 	if (wtype == -1 || wtype == WORK_Immed) {
-		ptask = find_worktask_by_parm_func(task_list_immed, parm1, func);
+		ptask = find_task_at(TASK_IMMED, parm1, func);
 		if (ptask)
 			return ptask;
 	}
 
 	if (wtype == -1 || wtype == WORK_Timed) {
-		ptask = find_worktask_by_parm_func(task_list_timed, parm1, func);
+		ptask = find_task_at(TASK_TIMED, parm1, func);
 		if (ptask)
 			return ptask;
 	}
 
 	if (wtype == -1 || (wtype != WORK_Timed && wtype != WORK_Immed)) {
-		ptask = find_worktask_by_parm_func(task_list_event, parm1, func);
+		ptask = find_task_at(TASK_EVENT, parm1, func);
 		if (ptask)
 			return ptask;
 	}
@@ -281,7 +591,7 @@ find_work_task(enum work_type wtype, void *parm1, void *func)
  *
  * @brief
  *	Delete task found in task_list_event, task_list_immed, or
- *	task_list_timed by either its function pointer, parm1, or both.
+ *	the timed tasks by either its function pointer, parm1, or both.
  * 	At least one of the function pointer or parm1 must not be NULL.
  *
  * @param[in]	parm1	- wt->parm1 parameter to match (can be NULL)
@@ -297,25 +607,68 @@ delete_task_by_parm1_func(void *parm1, void (*func)(struct work_task *), enum wt
 {
 	struct work_task *ptask;
 	struct work_task *ptask_next;
-	pbs_list_head task_lists[] = {task_list_event, task_list_timed, task_list_immed};
+	enum task_where where[] = {TASK_EVENT, TASK_TIMED, TASK_IMMED};
+	enum task_where w;
+	pbs_list_head task_lists[] = {task_list_event, task_list_immed};
+	pbs_list_head *head;
+	void *key = &parm1;
 	int i;
+	int j;
 
 	if (parm1 == NULL && func == NULL)
 		return;
 
-	for (i = 0; i < 3; i++) {
-		for (ptask = (struct work_task *) GET_NEXT(task_lists[i]); ptask; ptask = ptask_next) {
-			ptask_next = (struct work_task *) GET_NEXT(ptask->wt_linkevent);
+	if (option == DELETE_ONE) {
+		for (i = 0; i < 3; i++) {
+			if ((ptask = find_task_at(where[i], parm1, (void *) func)) != NULL) {
+				delete_task(ptask);
+				return;
+			}
+		}
+		return;
+	}
+
+	if (parm1 != NULL) {
+		if (task_parm1_idx == NULL ||
+		    pbs_idx_find(task_parm1_idx, &key, (void **) &head, NULL) != PBS_IDX_RET_OK)
+			return;
+		/* the head goes away with the last task, by which time ptask_next is NULL */
+		for (ptask = GET_NEXT(*head); ptask; ptask = ptask_next) {
+			ptask_next = GET_NEXT(ptask->wt_linkparm1);
 
-			if ((parm1 != NULL) && (ptask->wt_parm1 != parm1))
+			w = task_where(ptask);
+			if ((w == TASK_NOWHERE) || (w == TASK_INTERLEAVE))
 				continue;
 			if ((func != NULL) && (ptask->wt_func != func))
 				continue;
 
 			delete_task(ptask);
-			if (option == DELETE_ONE)
-				return;
 		}
+		return;
+	}
+
+	for (i = 0; i < 2; i++) {
+		for (ptask = (struct work_task *) GET_NEXT(task_lists[i]); ptask; ptask = ptask_next) {
+			ptask_next = (struct work_task *) GET_NEXT(ptask->wt_linkevent);
+
+			if (ptask->wt_func == func)
+				delete_task(ptask);
+		}
+	}
+
+	/* drop the matching timed tasks, then rebuild the heap from the rest */
+	for (i = 0, j = 0; i < timed_heap_cnt; i++) {
+		ptask = timed_heap[i];
+		if (ptask->wt_func == func) {
+			ptask->wt_heapidx = -1;
+			delete_task(ptask);
+		} else
+			timed_heap_set(j++, ptask);
+	}
+	if (j != timed_heap_cnt) {
+		timed_heap_cnt = j;
+		for (i = timed_heap_cnt / 2 - 1; i >= 0; i--)
+			timed_heap_down(i);
 	}
 }
 
@@ -323,7 +676,7 @@ delete_task_by_parm1_func(void *parm1, void (*func)(struct work_task *), enum wt
  *
  * @brief
  *	Check if some task in any of the task lists (task_list_event,
- *	task_list_timed, task_list_immed) has a wt_parm1 matching 'parm1'.
+ *	timed tasks, task_list_immed) has a wt_parm1 matching 'parm1'.
  *
  * @param[in]	parm1	- parameter being matched.
  *
@@ -350,7 +703,7 @@ has_task_by_parm1(void *parm1)
  *	1. If svr_delay_entry is set, then a delayed task in the
  *	   task_list_event is ready so find and process it.
  *	2. All items on the immediate list, then
- *	3. All items on the timed task list which have expired times
+ *	3. All timed tasks which have expired times
  *
  * @return time_t
  * @retval The amount of time till next task
@@ -400,13 +753,14 @@ default_next_task(void)
 		tilwhen = 0;
 	}
 
-	while ((ptask = (struct work_task *) GET_NEXT(task_list_timed)) != NULL) {
+	while (timed_heap_cnt > 0) {
+		ptask = timed_heap[0];
 		if ((delay = ptask->wt_event - time_now) > 0) {
 			if (tilwhen > delay)
 				tilwhen = delay;
 			break;
 		} else {
-			dispatch_task(ptask); /* will delete link */
+			dispatch_task(ptask); /* will take it off the heap */
 		}
 	}
 
@@ -901,6 +901,9 @@ send_hellosvr(int stream)
 
 	if ((rc = diswui(stream, pbs_mom_port)) != DIS_SUCCESS)
 		goto err;
+	/* a server that does not know about capabilities ignores them */
+	if ((rc = diswui(stream, pbs_conf.pbs_dis_compact ? IS_CAP_DIS_COMPACT : 0)) != DIS_SUCCESS)
+		goto err;
 	if ((rc = dis_flush(stream)) != DIS_SUCCESS)
 		goto err;
 
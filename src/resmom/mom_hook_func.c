@@ -122,7 +122,6 @@ extern pbs_list_head svr_hook_job_actions;
 extern pbs_list_head svr_hook_vnl_actions;
 
 extern pbs_list_head task_list_immed;
-extern pbs_list_head task_list_timed;
 extern pbs_list_head task_list_event;
 extern pbs_list_head svr_alljobs;
 
@@ -368,7 +368,6 @@ pbs_list_head svr_execjob_preresume_hooks;
 /* the task lists */
 pbs_list_head task_list_immed;
 pbs_list_head task_list_interleave;
-pbs_list_head task_list_timed;
 pbs_list_head task_list_event;
 
 #ifdef WIN32
@@ -7792,6 +7791,9 @@ main(int argc, char *argv[])
 	if (write(lockfds, log_buffer, strlen(log_buffer)) == -1) 
 		log_errf(-1, __func__, "write failed. ERR : %s", strerror(errno));		
 
+	/* the log writer thread must be started in the backgrounded process */
+	log_set_async(pbs_conf.pbs_log_async);
+
 #ifndef WIN32 /* ------------------------------------------------------------*/
 
 	daemon_protect(0, PBS_DAEMON_PROTECT_ON);
@@ -7917,7 +7919,6 @@ main(int argc, char *argv[])
 	CLEAR_HEAD(svr_execjob_preresume_hooks);
 
 	CLEAR_HEAD(task_list_immed);
-	CLEAR_HEAD(task_list_timed);
 	CLEAR_HEAD(task_list_event);
 	CLEAR_HEAD(task_list_interleave);
 
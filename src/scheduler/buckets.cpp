@@ -641,7 +641,8 @@ bucket_match(chunk_map **cmap, resource_resv *resresv, schd_error *err)
 	int i;
 	int j;
 	int k;
-	static pbs_bitmap *zeromap = NULL;
+	static thread_local pbs_bitmap *zeromap = NULL;
+	static thread_local pbs_bitmap *takemap = NULL;
 	server_info *sinfo;
 
 	if (cmap == NULL || resresv == NULL || resresv->select == NULL)
@@ -652,6 +653,11 @@ bucket_match(chunk_map **cmap, resource_resv *resresv, schd_error *err)
 		if (zeromap == NULL)
 			return 0;
 	}
+	if (takemap == NULL) {
+		takemap = pbs_bitmap_alloc(NULL, 1);
+		if (takemap == NULL)
+			return 0;
+	}
 
 	sinfo = resresv->server;
 
@@ -695,6 +701,25 @@ bucket_match(chunk_map **cmap, resource_resv *resresv, schd_error *err)
 				}
 			}
 
+			/* Without provisioning, any free node will do.  Take as many as
+			 * we need off the front of the free pool a word at a time.
+			 */
+			if (resresv->aoename == NULL && num_chunks_needed > chunks_added) {
+				int chunk_count = cmap[i]->bkt_cnts[j]->chunk_count;
+				unsigned long nodes_needed = (num_chunks_needed - chunks_added + chunk_count - 1) / chunk_count;
+				unsigned long nodes_taken;
+
+				nodes_taken = pbs_bitmap_first_n_on_bits(takemap, bkt->free_pool->working, nodes_needed);
+				if (nodes_taken > 0) {
+					pbs_bitmap_andnot(bkt->free_pool->working, takemap);
+					bkt->free_pool->working_ct -= nodes_taken;
+					pbs_bitmap_or(bkt->busy_pool->working, takemap);
+					bkt->busy_pool->working_ct += nodes_taken;
+					pbs_bitmap_or(cmap[i]->node_bits, takemap);
+					chunks_added += nodes_taken * chunk_count;
+				}
+			}
+
 			for (k = pbs_bitmap_first_on_bit(bkt->free_pool->working);
 			     num_chunks_needed > chunks_added && k >= 0;
 			     k = pbs_bitmap_next_on_bit(bkt->free_pool->working, k)) {
@@ -954,7 +979,7 @@ find_correct_buckets(status *policy, node_bucket **buckets, resource_resv *resre
 	int i, j;
 	int can_run = 1;
 	chunk_map **cb_map;
-	static struct schd_error *failerr = NULL;
+	static thread_local struct schd_error *failerr = NULL;
 
 	if (policy == NULL || buckets == NULL || resresv == NULL || resresv->select == NULL || resresv->select->chunks == NULL || err == NULL)
 		return NULL;
@@ -1096,7 +1121,7 @@ check_node_buckets(status *policy, server_info *sinfo, queue_info *qinfo, resour
 	if (nodepart != NULL) {
 		int i;
 		int can_run = 0;
-		static schd_error *failerr = NULL;
+		static thread_local schd_error *failerr = NULL;
 		if (failerr == NULL) {
 			failerr = new_schd_error();
 			if (failerr == NULL)
@@ -83,6 +83,7 @@
 #include "job_info.h"
 #include "misc.h"
 #include "constant.h"
+#include "cycle_stats.h"
 #include "globals.h"
 #include "dedtime.h"
 #include "node_info.h"
@@ -711,6 +712,7 @@ is_ok_to_run(status *policy, server_info *sinfo,
 	    resresv->ec_index != UNSPECIFIED &&
 	    sinfo->equiv_classes[resresv->ec_index]->can_not_run) {
 		copy_schd_error(err, sinfo->equiv_classes[resresv->ec_index]->err);
+		cycle_stats_count(CTR_EQUIV_CLASS_SKIPS);
 		return {};
 	}
 
@@ -927,7 +929,7 @@ is_ok_to_run(status *policy, server_info *sinfo,
 		if (qinfo->qres != NULL) {
 			if (resresv->job->resv == NULL) {
 				res = simulate_resmin(qinfo->qres, endtime, sinfo->calendar,
-						      qinfo->jobs, resresv);
+						      qinfo->jobs, qinfo, resresv);
 			} else
 #ifdef NAS /* localmod 036 */
 			{
@@ -996,7 +998,7 @@ is_ok_to_run(status *policy, server_info *sinfo,
 	if (sinfo->res != NULL) {
 		if (resresv->is_resv ||
 		    (resresv->is_job && resresv->job != NULL && resresv->job->resv == NULL)) {
-			res = simulate_resmin(sinfo->res, endtime, sinfo->calendar, NULL, resresv);
+			res = simulate_resmin(sinfo->res, endtime, sinfo->calendar, NULL, sinfo, resresv);
 			if ((resresv->job != NULL) && (resresv->job->resreq_rel != NULL))
 				resreq = resresv->job->resreq_rel;
 			else
@@ -1050,8 +1052,8 @@ is_ok_to_run(status *policy, server_info *sinfo,
 }
 
 /**
- * @brief find the resources associated with the resource_req's def
- * @param[in] reslist - schd_resource list to search in
+ * @brief resolve the resource found for a resource_req into the one to check
+ * @param[in] res - resource found for resreq (or NULL if not found)
  * @param[in] resreq - requested resource
  * @param[in] flags to modify behavior (@see check_avail_resources())
  * @return schd_resource
@@ -1060,16 +1062,13 @@ is_ok_to_run(status *policy, server_info *sinfo,
  * @retval if indirect, point to the real resource
  * @retval NULL if resource is to be ignored
  */
-schd_resource *
-find_check_resource(schd_resource *reslist, resource_req *resreq, unsigned int flags)
+static schd_resource *
+resolve_check_resource(schd_resource *res, resource_req *resreq, unsigned int flags)
 {
-	schd_resource *res;
 	schd_resource *fres = false_res();
 	schd_resource *zres = zero_res();
 	schd_resource *ustr = unset_str_res();
 
-	res = find_resource(reslist, resreq->def);
-
 	if (res == NULL || res->orig_str_avail == NULL) {
 		/* if resources_assigned.res is unset and resources is in
 		 * resource_unset_infinite, ignore the check and assume a match
@@ -1101,6 +1100,35 @@ find_check_resource(schd_resource *reslist, resource_req *resreq, unsigned int f
 	return res;
 }
 
+/**
+ * @brief find the resources associated with the resource_req's def
+ * @param[in] reslist - schd_resource list to search in
+ * @param[in] resreq - requested resource
+ * @param[in] flags to modify behavior (@see check_avail_resources())
+ * @return schd_resource
+ * @retval @see resolve_check_resource()
+ */
+schd_resource *
+find_check_resource(schd_resource *reslist, resource_req *resreq, unsigned int flags)
+{
+	return resolve_check_resource(find_resource(reslist, resreq->def), resreq, flags);
+}
+
+/**
+ * @brief find the resources of a node associated with the resource_req's def
+ *	  by way of the node's resdef id index
+ * @param[in] ninfo - node whose resources to search in
+ * @param[in] resreq - requested resource
+ * @param[in] flags to modify behavior (@see check_avail_resources())
+ * @return schd_resource
+ * @retval @see resolve_check_resource()
+ */
+schd_resource *
+find_check_resource(node_info *ninfo, resource_req *resreq, unsigned int flags)
+{
+	return resolve_check_resource(find_node_resource(ninfo, resreq->def), resreq, flags);
+}
+
 /**
  * @brief do resource matching between a resource_req and a schd_resource
  * @param[in] res - schd_resource to match
@@ -1198,7 +1226,8 @@ match_resource(schd_resource *res, resource_req *resreq, unsigned int flags, enu
  *		which can be satisfied by the resources
  *		available in the reslist for the resources in checklist
  *
- * @param[in]	reslist	-	resources list
+ * @param[in]	resholder	-	resource list or node to find resources in
+ * @param[in]	reslist	-	resources list (only checked for NULL)
  * @param[in]	reqlist	-	the list of resources requested
  * @param[in]	flags	-	valid flags:
  *							CHECK_ALL_BOOLS - always check all boolean resources
@@ -1207,7 +1236,7 @@ match_resource(schd_resource *res, resource_req *resreq, unsigned int flags, enu
  *							than what is currently available
  *							ONLY_COMP_NONCONS - only compare non-consumable resources
  *							ONLY_COMP_CONS - only compare consumable resources
- * @param[in]	checklist	-	set of resources to check
+ * @param[in]	checklist	-	set of resources to check (NULL for all)
  * @param[in]	fail_code	-	error code if resource request is rejected
  *	@param[out]	perr	-	if not NULL the the reason request is not
  *							satisfiable (i.e. the resource there is not
@@ -1219,10 +1248,11 @@ match_resource(schd_resource *res, resource_req *resreq, unsigned int flags, enu
  * @retval	-1	: on error
  *
  */
-long long
-check_avail_resources(schd_resource *reslist, resource_req *reqlist,
-		      unsigned int flags, std::unordered_set<resdef *> &checklist,
-		      enum sched_error_code fail_code, schd_error *perr)
+template <typename T>
+static long long
+count_avail_chunks(T *resholder, schd_resource *reslist, resource_req *reqlist,
+		   unsigned int flags, std::unordered_set<resdef *> *checklist,
+		   enum sched_error_code fail_code, schd_error *perr)
 {
 	long long num_chunk = SCHD_INFINITY;
 	long long match_chunk = SCHD_INFINITY;
@@ -1241,74 +1271,11 @@ check_avail_resources(schd_resource *reslist, resource_req *reqlist,
 	err = perr;
 
 	for (resource_req *resreq = reqlist; resreq != NULL; resreq = resreq->next) {
-		if (((flags & CHECK_ALL_BOOLS) && resreq->type.is_boolean) ||
-		    (checklist.find(resreq->def) != checklist.end())) {
-
-			schd_resource *res = find_check_resource(reslist, resreq, flags);
-			if (res == NULL)
-				continue;
-
-			match_chunk = match_resource(res, resreq, flags, fail_code, err);
-
-			if (num_chunk == SCHD_INFINITY)
-				num_chunk = match_chunk;
-			else if (match_chunk != SCHD_INFINITY && match_chunk < num_chunk)
-				num_chunk = match_chunk;
-
-			if (num_chunk == 0) {
-				any_fail = 1;
-				if (flags & RETURN_ALL_ERR) {
-					if (err != NULL) {
-						err->next = new_schd_error();
-						if (err->next == NULL)
-							return 0;
-						prev_err = err;
-						err = err->next;
-					}
-				} else
-					break;
-			}
-		}
-	}
-
-	if (any_fail)
-		num_chunk = 0;
-
-	if (prev_err != NULL && (flags & RETURN_ALL_ERR)) {
-		if (prev_err != NULL) {
-			free_schd_error(err);
-			prev_err->next = NULL;
-		}
-	}
-
-	return num_chunk;
-}
-
-/** @brief overloaded version of check_avail_resources() which matches all resources.  
- * @see other function for argument description
-*/
-long long
-check_avail_resources(schd_resource *reslist, resource_req *reqlist,
-		      unsigned int flags, enum sched_error_code fail_code, schd_error *perr)
-{
-	long long num_chunk = SCHD_INFINITY;
-	long long match_chunk = SCHD_INFINITY;
-
-	int any_fail = 0;
-	schd_error *prev_err = NULL;
-	schd_error *err;
-
-	if (reslist == NULL || reqlist == NULL) {
-		if (perr != NULL)
-			set_schd_error_codes(perr, NOT_RUN, SCHD_ERROR);
-
-		return -1;
-	}
-
-	err = perr;
+		if (checklist != NULL && !((flags & CHECK_ALL_BOOLS) && resreq->type.is_boolean) &&
+		    (checklist->find(resreq->def) == checklist->end()))
+			continue;
 
-	for (resource_req *resreq = reqlist; resreq != NULL; resreq = resreq->next) {
-		schd_resource *res = find_check_resource(reslist, resreq, flags);
+		schd_resource *res = find_check_resource(resholder, resreq, flags);
 		if (res == NULL)
 			continue;
 
@@ -1347,6 +1314,56 @@ check_avail_resources(schd_resource *reslist, resource_req *reqlist,
 	return num_chunk;
 }
 
+/**
+ * @brief
+ * 		calculate the number of multiples of the requested resources in
+ *		reqlist which can be satisfied by the resources in reslist for the
+ *		resources in checklist
+ *
+ * @see count_avail_chunks() for argument description
+ */
+long long
+check_avail_resources(schd_resource *reslist, resource_req *reqlist,
+		      unsigned int flags, std::unordered_set<resdef *> &checklist,
+		      enum sched_error_code fail_code, schd_error *perr)
+{
+	return count_avail_chunks(reslist, reslist, reqlist, flags, &checklist, fail_code, perr);
+}
+
+/** @brief overloaded version of check_avail_resources() which matches all resources.
+ * @see count_avail_chunks() for argument description
+*/
+long long
+check_avail_resources(schd_resource *reslist, resource_req *reqlist,
+		      unsigned int flags, enum sched_error_code fail_code, schd_error *perr)
+{
+	return count_avail_chunks(reslist, reslist, reqlist, flags, NULL, fail_code, perr);
+}
+
+/** @brief overloaded version of check_avail_resources() which checks against
+ *	   the resources of a node.  The node's resources are found by way of its
+ *	   resdef id index rather than by walking its resource list.
+ * @see count_avail_chunks() for argument description
+*/
+long long
+check_avail_resources(node_info *ninfo, resource_req *reqlist,
+		      unsigned int flags, std::unordered_set<resdef *> &checklist,
+		      enum sched_error_code fail_code, schd_error *perr)
+{
+	return count_avail_chunks(ninfo, ninfo == NULL ? NULL : ninfo->res, reqlist, flags, &checklist, fail_code, perr);
+}
+
+/** @brief overloaded version of check_avail_resources() which checks all
+ *	   resources against the resources of a node.
+ * @see count_avail_chunks() for argument description
+*/
+long long
+check_avail_resources(node_info *ninfo, resource_req *reqlist,
+		      unsigned int flags, enum sched_error_code fail_code, schd_error *perr)
+{
+	return count_avail_chunks(ninfo, ninfo == NULL ? NULL : ninfo->res, reqlist, flags, NULL, fail_code, perr);
+}
+
 /**
  * @brief
  *		dynamic_avail - find out how much of a resource is available on a
@@ -1842,12 +1859,12 @@ check_prime_boundary(status *policy, resource_resv *resresv, struct schd_error *
  *
  * @return	schd_resource * (set to False)
  *
- * @par MT-safe: No
+ * @par MT-safe: Yes (one resource per thread)
  */
 schd_resource *
 false_res()
 {
-	static schd_resource *res = NULL;
+	static thread_local schd_resource *res = NULL;
 
 	if (res == NULL) {
 		res = new_resource();
@@ -1874,12 +1891,12 @@ false_res()
  * @return	schd_resource *
  * @retval	NULL	: fail
  *
- * @par MT-safe: No
+ * @par MT-safe: Yes (one resource per thread)
  */
 schd_resource *
 unset_str_res()
 {
-	static schd_resource *res = NULL;
+	static thread_local schd_resource *res = NULL;
 
 	if (res == NULL) {
 		res = new_resource();
@@ -1916,7 +1933,7 @@ unset_str_res()
 schd_resource *
 zero_res()
 {
-	static schd_resource *res = NULL;
+	static thread_local schd_resource *res = NULL;
 
 	if (res == NULL) {
 		res = new_resource();
@@ -1942,16 +1959,16 @@ zero_res()
  * @param[out] **spec output select specification
  * @param[out] **pl  output placement specification
  *
- * @par MT-Safe: No
+ * @par MT-Safe: Yes (one place per thread)
  * @return void
  */
 void
 get_resresv_spec(resource_resv *resresv, selspec **spec, place **pl)
 {
-	static place place_spec;
+	static thread_local place place_spec;
 	if (resresv->is_job && resresv->job != NULL) {
 		if (resresv->execselect != NULL) {
-			*spec = resresv->execselect;
+			*spec = resresv->execselect.get();
 			place_spec = *resresv->place_spec;
 
 			/* Placement was handled the first time.  Don't let it get in the way */
@@ -1959,8 +1976,8 @@ get_resresv_spec(resource_resv *resresv, selspec **spec, place **pl)
 			place_spec.free = 1;
 			*pl = &place_spec;
 		} else {
-			*pl = resresv->place_spec;
-			*spec = resresv->select;
+			*pl = resresv->place_spec.get();
+			*spec = resresv->select.get();
 		}
 	} else if (resresv->is_resv && resresv->resv != NULL) {
 		/* The execselect should be used when the resv is running.  We can't
@@ -1969,9 +1986,9 @@ get_resresv_spec(resource_resv *resresv, selspec **spec, place **pl)
 		 */
 		if (resresv->resv->is_running)
 
-			*spec = resresv->execselect;
+			*spec = resresv->execselect.get();
 		else
-			*spec = resresv->select;
+			*spec = resresv->select.get();
 		place_spec = *resresv->place_spec;
 		*pl = &place_spec;
 	}
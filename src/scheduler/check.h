@@ -114,6 +114,19 @@ check_avail_resources(schd_resource *reslist, resource_req *reqlist,
 long long
 check_avail_resources(schd_resource *reslist, resource_req *reqlist,
 		      unsigned int flags, enum sched_error_code fail_code, schd_error *perr);
+long long
+check_avail_resources(node_info *ninfo, resource_req *reqlist,
+		      unsigned int flags, std::unordered_set<resdef *> &checklist,
+		      enum sched_error_code fail_code, schd_error *perr);
+long long
+check_avail_resources(node_info *ninfo, resource_req *reqlist,
+		      unsigned int flags, enum sched_error_code fail_code, schd_error *perr);
+
+/*
+ *	find_check_resource - find the resource to check a resource_req against
+ */
+schd_resource *find_check_resource(schd_resource *reslist, resource_req *resreq, unsigned int flags);
+schd_resource *find_check_resource(node_info *ninfo, resource_req *resreq, unsigned int flags);
 
 /*
  *	dynamic_avail - find out how much of a resource is available on a
@@ -57,6 +57,8 @@
 #define HOLIDAYS_FILE "holidays"
 #define RESGROUP_FILE "resource_group"
 #define DEDTIME_FILE "dedicated_time"
+#define CYCLE_STATS_FILE "sched_stats.json"
+#define CYCLE_SNAPSHOT_FILE "sched_snapshot"
 
 /* usage file "magic number" - needs to be 8 chars */
 #define USAGE_MAGIC "PBS_MAG!"
@@ -140,6 +142,11 @@
 #define PARSE_STRICT_ORDERING "strict_ordering"
 #define PARSE_RES_UNSET_INFINITE "resource_unset_infinite"
 #define PARSE_SELECT_PROVISION "provision_policy"
+#define PARSE_INCR_JOB_QUERY "incremental_job_query"
+#define PARSE_PAR_TOPJOB_EST "parallel_topjob_estimation"
+#define PARSE_CYCLE_STATS "cycle_stats"
+#define PARSE_RUN_JOB_WINDOW "run_job_window"
+#define PARSE_CYCLE_SNAPSHOT "cycle_snapshot"
 
 #ifdef NAS
 /* localmod 034 */
@@ -196,6 +203,25 @@
 #define SORT_NODECT "nodect"
 #endif
 
+/* number of incremental job queries of a queue between full queries */
+#define JOB_STATUS_CACHE_REFRESH 50
+
+/* eval_simple_selspec() only uses a node fit mask with at least this many nodes */
+#define NODE_FIT_MASK_MIN_NODES 512
+/* ... and only if no more than 1 / NODE_FIT_MASK_MAX_RATIO of them fit */
+#define NODE_FIT_MASK_MAX_RATIO 4
+
+/* number of distinct select and place specs kept parsed across cycles */
+#define SPEC_CACHE_SIZE 4096
+
+/* sorts on precomputed keys use a radix sort from this many objects */
+#define RADIX_SORT_MIN 64
+
+/* number of duration histogram buckets kept per phase by the cycle stats.
+ * Bucket i counts durations under 2^i microseconds, the last one the rest
+ */
+#define CYCLE_STATS_HIST_BUCKETS 26
+
 /* max num of retries for preemption */
 #define MAX_PREEMPT_RETRIES 5
 
@@ -169,7 +169,52 @@ enum thread_task_type {
 	TS_FREE_ND_INFO,
 	TS_DUP_RESRESV,
 	TS_QUERY_JOB_INFO,
-	TS_FREE_RESRESV
+	TS_FREE_RESRESV,
+	TS_EVAL_FORMULA,
+	TS_FILL_SORT_KEYS,
+	TS_EST_TOPJOB,
+	TS_NUM_TASK_TYPES
+};
+
+/* phases of a scheduling cycle which are timed by the cycle stats */
+enum cycle_phase {
+	PHASE_QUERY_SERVER,
+	PHASE_QUERY_NODES,
+	PHASE_QUERY_JOBS,
+	PHASE_RESRESV_SETS,
+	PHASE_PLACEMENT_SETS,
+	PHASE_INIT_CYCLE,
+	PHASE_SORT_JOBS,
+	PHASE_MAIN_LOOP,
+	PHASE_IS_OK_TO_RUN,
+	PHASE_RUN_JOB,
+	PHASE_PREEMPT,
+	PHASE_CALENDAR,
+	PHASE_NUM_PHASES
+};
+
+/* events of a scheduling cycle which are counted by the cycle stats */
+enum cycle_counter {
+	CTR_JOBS_CONSIDERED,
+	CTR_JOBS_RUN,
+	CTR_EQUIV_CLASS_SKIPS,
+	CTR_BUCKET_JOBS,
+	CTR_SIMULATIONS,
+	CTR_PREEMPT_ATTEMPTS,
+	CTR_TOPJOBS,
+	CTR_NUM_COUNTERS
+};
+
+/* server queries recorded in a cycle snapshot (see snapshot.cpp) */
+enum snap_call {
+	SNAP_STATSERVER,
+	SNAP_STATSCHED,
+	SNAP_STATQUEUE,
+	SNAP_STATVNODE,
+	SNAP_STATRESV,
+	SNAP_STATRSC,
+	SNAP_SELSTAT,
+	SNAP_NUM_CALLS
 };
 
 /* return codes for is_ok_to_run_* functions
@@ -375,8 +420,9 @@ enum incr_decr {
 enum run_update_resresv_flags {
 	RURR_NO_FLAGS = 0,
 	RURR_ADD_END_EVENT = 1, /* add end events to calendar for job */
-	RURR_NOPRINT = 2	/* don't print messages */
-				/* next value 4 */
+	RURR_NOPRINT = 2,	/* don't print messages */
+	RURR_NO_PIPELINE = 4	/* wait for the reply to the run request */
+				/* next value 8 */
 };
 
 enum delete_event_flags {
@@ -0,0 +1,384 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+/**
+ * @file    cycle_stats.cpp
+ *
+ * @brief
+ * 		cycle_stats.cpp - per phase timings and counters of scheduling cycles.
+ *
+ *	When cycle_stats is set in the sched_config, the wall and cpu time of
+ *	each phase of a cycle (see enum cycle_phase) and a few counters (see
+ *	enum cycle_counter) are kept.  At the end of the cycle they are added
+ *	to totals kept since the scheduler started and both are written in
+ *	JSON to CYCLE_STATS_FILE in sched_priv.  The totals have a log2
+ *	histogram of the time spent in each entry of a phase so one bad day
+ *	is not lost in the averages.
+ *
+ * Functions included are:
+ * 	cycle_stats_begin()
+ * 	cycle_stats_end()
+ * 	cycle_stats_count()
+ * 	cycle_stats_report()
+ * 	phase_timer::phase_timer()
+ * 	phase_timer::~phase_timer()
+ *
+ */
+#include <pbs_config.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <log.h>
+
+#include "config.h"
+#include "constant.h"
+#include "cycle_stats.h"
+#include "data_types.h"
+#include "globals.h"
+
+struct phase_stat {
+	long count;				 /* number of times the phase was entered */
+	double wall;				 /* wall clock seconds in the phase */
+	double cpu;				 /* process cpu seconds (worker threads included) */
+	double max_wall;			 /* longest single time in the phase */
+	long hist[CYCLE_STATS_HIST_BUCKETS];	 /* times in the phase by duration */
+};
+
+struct cycle_stat {
+	double wall; /* wall clock seconds of the cycle(s) */
+	double cpu;  /* process cpu seconds of the cycle(s) */
+	struct phase_stat phases[PHASE_NUM_PHASES];
+	long counters[CTR_NUM_COUNTERS];
+};
+
+static const char *phase_names[PHASE_NUM_PHASES] = {
+	"query_server",
+	"query_nodes",
+	"query_jobs",
+	"create_resresv_sets",
+	"placement_sets",
+	"init_cycle",
+	"sort_jobs",
+	"main_loop",
+	"is_ok_to_run",
+	"run_job",
+	"preemption",
+	"calendar"};
+
+static const char *counter_names[CTR_NUM_COUNTERS] = {
+	"jobs_considered",
+	"jobs_run",
+	"equiv_class_skips",
+	"bucket_jobs",
+	"simulations",
+	"preempt_attempts",
+	"topjobs"};
+
+static bool stats_on;		      /* stats are being kept for this cycle */
+static time_t cycle_start;	      /* time the current cycle started */
+static struct timespec cycle_wall;    /* wall clock at the start of the cycle */
+static struct timespec cycle_cpu;     /* cpu clock at the start of the cycle */
+static struct cycle_stat cur_stats;   /* the current cycle */
+static struct cycle_stat total_stats; /* all cycles since the scheduler started */
+
+/* protects cur_stats from the worker threads (e.g., top job estimates) */
+static pthread_mutex_t cur_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static long num_cycles;		      /* number of cycles in total_stats */
+
+/**
+ * @brief	seconds between two timespecs
+ */
+static inline double
+ts_diff(const struct timespec &start, const struct timespec &end)
+{
+	return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/**
+ * @brief	find the histogram bucket of a duration
+ *
+ * @param[in]	secs - the duration
+ *
+ * @return	int
+ * @retval	the bucket: the first one whose bound of 2^i usec is over secs
+ */
+static int
+hist_bucket(double secs)
+{
+	long usec = static_cast<long>(secs * 1e6);
+	int b = 0;
+
+	while (b < CYCLE_STATS_HIST_BUCKETS - 1 && usec >= (1L << b))
+		b++;
+
+	return b;
+}
+
+/**
+ * @brief	write one phase_stat as a JSON object
+ *
+ * @param[in]	fp - file to write to
+ * @param[in]	ps - the phase stats
+ * @param[in]	with_hist - write the histogram as well
+ *
+ * @return	void
+ */
+static void
+write_phase_stat(FILE *fp, const struct phase_stat &ps, bool with_hist)
+{
+	fprintf(fp, "{\"count\": %ld, \"wall\": %.6f, \"cpu\": %.6f, \"max_wall\": %.6f",
+		ps.count, ps.wall, ps.cpu, ps.max_wall);
+	if (with_hist) {
+		fprintf(fp, ", \"hist\": [");
+		for (int i = 0; i < CYCLE_STATS_HIST_BUCKETS; i++)
+			fprintf(fp, "%s%ld", i ? ", " : "", ps.hist[i]);
+		fprintf(fp, "]");
+	}
+	fprintf(fp, "}");
+}
+
+/**
+ * @brief	write the phases and counters of a cycle_stat as JSON members
+ *
+ * @param[in]	fp - file to write to
+ * @param[in]	cs - the stats
+ * @param[in]	with_hist - write the histograms of the phases
+ *
+ * @return	void
+ */
+static void
+write_cycle_stat(FILE *fp, const struct cycle_stat &cs, bool with_hist)
+{
+	int i;
+
+	fprintf(fp, "\t\t\"wall\": %.6f,\n\t\t\"cpu\": %.6f,\n\t\t\"phases\": {\n", cs.wall, cs.cpu);
+	for (i = 0; i < PHASE_NUM_PHASES; i++) {
+		fprintf(fp, "\t\t\t\"%s\": ", phase_names[i]);
+		write_phase_stat(fp, cs.phases[i], with_hist);
+		fprintf(fp, "%s\n", i < PHASE_NUM_PHASES - 1 ? "," : "");
+	}
+	fprintf(fp, "\t\t},\n\t\t\"counters\": {\n");
+	for (i = 0; i < CTR_NUM_COUNTERS; i++)
+		fprintf(fp, "\t\t\t\"%s\": %ld%s\n", counter_names[i], cs.counters[i],
+			i < CTR_NUM_COUNTERS - 1 ? "," : "");
+	fprintf(fp, "\t\t}\n");
+}
+
+/**
+ * @brief	write the stats of the last cycle and the totals to the stats
+ *		file.  The file is written under a temporary name and renamed
+ *		so a reader never sees a partial file.
+ *
+ * @return	void
+ */
+static void
+write_cycle_stats(void)
+{
+	const char *tmpname = CYCLE_STATS_FILE ".new";
+	FILE *fp;
+
+	if ((fp = fopen(tmpname, "w")) == NULL) {
+		log_errf(errno, __func__, "Error opening file %s", tmpname);
+		return;
+	}
+
+	fprintf(fp, "{\n\t\"cycle\": {\n\t\t\"start\": %ld,\n", (long) cycle_start);
+	write_cycle_stat(fp, cur_stats, false);
+	fprintf(fp, "\t},\n\t\"total\": {\n\t\t\"cycles\": %ld,\n", num_cycles);
+	write_cycle_stat(fp, total_stats, true);
+	fprintf(fp, "\t},\n\t\"hist_bounds_usec\": [");
+	for (int i = 0; i < CYCLE_STATS_HIST_BUCKETS - 1; i++)
+		fprintf(fp, "%s%ld", i ? ", " : "", 1L << i);
+	fprintf(fp, "]\n}\n");
+
+	if (fclose(fp) != 0 || rename(tmpname, CYCLE_STATS_FILE) != 0) {
+		log_errf(errno, __func__, "Error writing file %s", CYCLE_STATS_FILE);
+		remove(tmpname);
+	}
+}
+
+/**
+ * @brief	start keeping stats for a new scheduling cycle.  Nothing is
+ *		kept unless cycle_stats is set in the sched_config.
+ *
+ * @return	void
+ */
+void
+cycle_stats_begin(void)
+{
+	stats_on = conf.cycle_stats;
+	if (!stats_on)
+		return;
+
+	memset(&cur_stats, 0, sizeof(cur_stats));
+	cycle_start = time(NULL);
+	clock_gettime(CLOCK_MONOTONIC, &cycle_wall);
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cycle_cpu);
+}
+
+/**
+ * @brief	finish the stats of the current cycle, add them to the totals
+ *		and write the stats file
+ *
+ * @return	void
+ */
+void
+cycle_stats_end(void)
+{
+	struct timespec wall;
+	struct timespec cpu;
+
+	if (!stats_on)
+		return;
+	stats_on = false;
+
+	clock_gettime(CLOCK_MONOTONIC, &wall);
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+	cur_stats.wall = ts_diff(cycle_wall, wall);
+	cur_stats.cpu = ts_diff(cycle_cpu, cpu);
+
+	num_cycles++;
+	total_stats.wall += cur_stats.wall;
+	total_stats.cpu += cur_stats.cpu;
+	for (int i = 0; i < PHASE_NUM_PHASES; i++) {
+		struct phase_stat &tp = total_stats.phases[i];
+		const struct phase_stat &cp = cur_stats.phases[i];
+
+		tp.count += cp.count;
+		tp.wall += cp.wall;
+		tp.cpu += cp.cpu;
+		if (cp.max_wall > tp.max_wall)
+			tp.max_wall = cp.max_wall;
+		for (int j = 0; j < CYCLE_STATS_HIST_BUCKETS; j++)
+			tp.hist[j] += cp.hist[j];
+	}
+	for (int i = 0; i < CTR_NUM_COUNTERS; i++)
+		total_stats.counters[i] += cur_stats.counters[i];
+
+	write_cycle_stats();
+}
+
+/**
+ * @brief	count an event in the current cycle
+ *
+ * @param[in]	ctr - the event
+ *
+ * @return	void
+ */
+void
+cycle_stats_count(enum cycle_counter ctr)
+{
+	if (stats_on) {
+		pthread_mutex_lock(&cur_stats_lock);
+		cur_stats.counters[ctr]++;
+		pthread_mutex_unlock(&cur_stats_lock);
+	}
+}
+
+/**
+ * @brief	print a table of the totals of all cycles since the scheduler
+ *		started (e.g., at the end of a replay)
+ *
+ * @param[in]	fp - file to print to
+ *
+ * @return	void
+ */
+void
+cycle_stats_report(FILE *fp)
+{
+	int i;
+
+	fprintf(fp, "%ld cycle(s): %.6f wall, %.6f cpu seconds\n", num_cycles, total_stats.wall, total_stats.cpu);
+	fprintf(fp, "%-20s %10s %12s %12s %12s\n", "phase", "count", "wall", "cpu", "max_wall");
+	for (i = 0; i < PHASE_NUM_PHASES; i++) {
+		const struct phase_stat &ps = total_stats.phases[i];
+
+		fprintf(fp, "%-20s %10ld %12.6f %12.6f %12.6f\n",
+			phase_names[i], ps.count, ps.wall, ps.cpu, ps.max_wall);
+	}
+	fprintf(fp, "%-20s %10s\n", "counter", "count");
+	for (i = 0; i < CTR_NUM_COUNTERS; i++)
+		fprintf(fp, "%-20s %10ld\n", counter_names[i], total_stats.counters[i]);
+}
+
+/**
+ * @brief	start timing a phase
+ *
+ * @param[in]	phase - the phase
+ */
+phase_timer::phase_timer(enum cycle_phase phase) : phase(phase), on(stats_on)
+{
+	if (!on)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &wall);
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+}
+
+/**
+ * @brief	stop timing a phase and add the time to the current cycle
+ */
+phase_timer::~phase_timer()
+{
+	struct timespec end_wall;
+	struct timespec end_cpu;
+	double w;
+
+	/* the cycle could have ended while we were timing */
+	if (!on || !stats_on)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &end_wall);
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end_cpu);
+
+	pthread_mutex_lock(&cur_stats_lock);
+	struct phase_stat &ps = cur_stats.phases[phase];
+	w = ts_diff(wall, end_wall);
+	ps.count++;
+	ps.wall += w;
+	ps.cpu += ts_diff(cpu, end_cpu);
+	if (w > ps.max_wall)
+		ps.max_wall = w;
+	ps.hist[hist_bucket(w)]++;
+	pthread_mutex_unlock(&cur_stats_lock);
+}
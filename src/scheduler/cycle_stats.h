@@ -37,25 +37,43 @@
  * subject to Altair's trademark licensing policies.
  */
 
-#ifndef SRC_SCHEDULER_QUEUE_H_
-#define SRC_SCHEDULER_QUEUE_H_
+#ifndef _CYCLE_STATS_H
+#define _CYCLE_STATS_H
 
-#define QUEUE_DS_MIN_SIZE 512 /* Minimum size of the queue data structure */
+#include <stdio.h>
+#include <time.h>
 
-typedef struct ds_queue ds_queue;
+#include "constant.h"
 
-struct ds_queue {
-	int min_size;
-	long front;
-	long rear;
-	long q_size;
-	void **content_arr;
-};
+/* start keeping stats for a new scheduling cycle (if cycle_stats is set) */
+void cycle_stats_begin(void);
+
+/* finish the cycle's stats, add them to the totals, and write the stats file */
+void cycle_stats_end(void);
+
+/* count an event in the current cycle */
+void cycle_stats_count(enum cycle_counter ctr);
+
+/* print a table of the totals of all cycles */
+void cycle_stats_report(FILE *fp);
 
-ds_queue *new_ds_queue(void);
-void free_ds_queue(ds_queue *queue);
-int ds_enqueue(ds_queue *queue, void *obj);
-void *ds_dequeue(ds_queue *queue);
-int ds_queue_is_empty(ds_queue *queue);
+/*
+ * Times a phase of the cycle from construction to destruction.
+ * Only to be used from the main thread.
+ */
+class phase_timer
+{
+	public:
+	explicit phase_timer(enum cycle_phase phase);
+	~phase_timer();
+	phase_timer(const phase_timer &) = delete;
+	phase_timer &operator=(const phase_timer &) = delete;
+
+	private:
+	enum cycle_phase phase;
+	bool on;		/* stats were being kept when the timer started */
+	struct timespec wall;	/* wall clock at the start of the phase */
+	struct timespec cpu;	/* process cpu clock at the start of the phase */
+};
 
-#endif /* SRC_SCHEDULER_QUEUE_H_ */
+#endif /* _CYCLE_STATS_H */
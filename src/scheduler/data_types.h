@@ -53,6 +53,10 @@
 #ifndef	_DATA_TYPES_H
 #define	_DATA_TYPES_H
 
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -89,6 +93,7 @@ class np_cache;
 struct chunk;
 class selspec;
 class resdef;
+class compiled_formula;
 struct event_list;
 struct status;
 class fairshare_head;
@@ -136,6 +141,9 @@ typedef struct th_data_free_ninfo th_data_free_ninfo;
 typedef struct th_data_dup_resresv th_data_dup_resresv;
 typedef struct th_data_query_jinfo th_data_query_jinfo;
 typedef struct th_data_free_resresv th_data_free_resresv;
+typedef struct th_data_eval_formula th_data_eval_formula;
+typedef struct th_data_sort_keys th_data_sort_keys;
+typedef struct th_data_est_topjob th_data_est_topjob;
 
 using counts_umap = std::unordered_map<std::string, counts *>;
 #ifdef NAS
@@ -243,6 +251,34 @@ struct th_data_free_resresv
 	int eidx;
 };
 
+struct th_data_eval_formula
+{
+	const compiled_formula *cf;
+	resource_resv **resresv_arr;
+	bool *need_python;	/* set for the jobs Python needs to evaluate */
+	int sidx;
+	int eidx;
+};
+
+struct th_data_sort_keys
+{
+	const std::function<void(int idx, double *key)> *fill_key;
+	double *keys;
+	int num_keys;
+	int sidx;
+	int eidx;
+};
+
+struct th_data_est_topjob
+{
+	server_info **nsinfos;	/* private copy of the universe for each job */
+	resource_resv **jobs;	/* the jobs to estimate */
+	time_t *starts;		/* estimated start times */
+	std::string *execs;	/* estimated execvnodes */
+	int sidx;
+	int eidx;
+};
+
 struct schd_error
 {
 	enum sched_error_code error_code;	/* scheduler error code (see constant.h) */
@@ -682,8 +718,11 @@ class node_info
 	const std::string name;		/* name of the node */
 	char *mom;			/* host name on which mom resides */
 
-	char **jobs;			/* the name of the jobs currently on the node */
-	char **resvs;			/* the name of the reservations currently on the node */
+	/* The job and resv names are never modified once queried.  They are
+	 * shared with the copies of the node in simulated universes.
+	 */
+	std::shared_ptr<char *> jobs;	/* the name of the jobs currently on the node */
+	std::shared_ptr<char *> resvs;	/* the name of the reservations currently on the node */
 	resource_resv **job_arr;	/* ptrs to structs of the jobs on the node */
 	resource_resv **run_resvs_arr;	/* ptrs to structs of resvs holding resources on the node */
 
@@ -710,6 +749,9 @@ class node_info
 	int max_group_run;		/* max number of jobs running by a UNIX group */
 
 	schd_resource *res;		/* list of resources max/current usage */
+	std::vector<schd_resource *> res_by_id;	/* res indexed by resdef id (see index_node_resources()) */
+	schd_resource *res_index_head;	/* head of res when res_by_id was built */
+	schd_resource *res_index_tail;	/* tail of res when res_by_id was built */
 
 	int rank;			/* unique numeric identifier for node */
 
@@ -803,9 +845,12 @@ class resource_resv
 	time_t min_duration;		/* minimum duration of STF job */
 
 	resource_req *resreq;		/* list of resources requested */
-	selspec *select;		/* select spec */
-	selspec *execselect;		/* select spec from exec_vnode and resv_nodes */
-	place *place_spec;		/* placement spec */
+	/* The select specs are never modified once parsed, only replaced.  They
+	 * are shared with the copies of the resresv in simulated universes.
+	 */
+	std::shared_ptr<selspec> select;	/* select spec */
+	std::shared_ptr<selspec> execselect;	/* select spec from exec_vnode and resv_nodes */
+	std::shared_ptr<place> place_spec;	/* placement spec */
 
 	server_info *server;		/* pointer to server which owns res resv */
 	node_info **ninfo_arr; 		/* nodes belonging to res resv */
@@ -884,7 +929,8 @@ class resdef
 	const std::string name;	/* name of resource */
 	resource_type type;	/* resource type */
 	unsigned int flags;	/* resource flags (see pbs_ifl.h) */
-	resdef(char *rname, unsigned int rflags, resource_type rtype) : name(rname), type(rtype), flags(rflags) {}
+	const int id;		/* dense index of resource, unique within one set of resdefs */
+	resdef(char *rname, unsigned int rflags, resource_type rtype, int rid) : name(rname), type(rtype), flags(rflags), id(rid) {}
 };
 
 class prev_job_info
@@ -924,18 +970,6 @@ struct resource_count
 
 /* global data types */
 
-/* fairshare head structure */
-class fairshare_head
-{
-	public:
-	group_info *root;			/* root of fairshare tree */
-	time_t last_decay;			/* last time tree was decayed */
-	fairshare_head();
-	fairshare_head(fairshare_head&);
-	fairshare_head& operator=(fairshare_head&);
-	virtual ~fairshare_head();
-};
-
 class group_info
 {
 	public:
@@ -957,6 +991,7 @@ class group_info
 
 	std::vector<group_info *> gpath;	/* path from the root of the tree */
 
+	int idx;				/* slot in the fairshare_head's nodes */
 	group_info *parent;			/* parent node */
 	group_info *sibling;			/* sibling node */
 	group_info *child;			/* child node */
@@ -965,6 +1000,24 @@ class group_info
 	group_info &operator=(const group_info &);
 };
 
+/* fairshare head structure */
+class fairshare_head
+{
+	public:
+	group_info *root;			/* root of fairshare tree */
+	time_t last_decay;			/* last time tree was decayed */
+	/* The tree's nodes in topological order (a parent is always before its
+	 * children).  nodes[0] is the root.  A deque is used so adding a node
+	 * never moves the ones already in the tree.
+	 */
+	std::deque<group_info> nodes;
+	std::unordered_map<std::string, int> index;	/* name -> slot in nodes */
+	fairshare_head();
+	fairshare_head(fairshare_head&);
+	fairshare_head& operator=(fairshare_head&);
+	virtual ~fairshare_head();
+};
+
 /**
  * Set of equivalent resresvs.  It is used to keep track if one can't run, the rest cannot.
  * The set is defined by a number of attributes of the resresv.  If the attributes do
@@ -978,8 +1031,8 @@ struct resresv_set
 	char *user;			/* user of set, can be NULL */
 	char *group;			/* group of set, can be NULL */
 	char *project;			/* project of set, can be NULL */
-	selspec *select_spec;		/* select spec of set */
-	place *place_spec;		/* place spec of set */
+	std::shared_ptr<selspec> select_spec;	/* select spec of set (shared) */
+	std::shared_ptr<place> place_spec;	/* place spec of set (shared) */
 	resource_req *req;		/* ATTR_L (qsub -l) resources of set.  Only contains resources on the resources line */
 	queue_info *qinfo;		/* The queue the resresv is in if the queue has nodes associated */
 };
@@ -1167,6 +1220,10 @@ struct config
 	bool node_sort_unused:1;	/* node sorting by unused/assigned is used */
 	bool resv_conf_ignore:1;	/* if we want to ignore dedicated time when confirming reservations.  Move to enum if ever expanded */
 	bool allow_aoe_calendar:1;	/* allow jobs requesting aoe in calendar*/
+	bool incremental_job_query:1;	/* only query jobs which changed since the last cycle */
+	bool parallel_topjob_estimation:1; /* estimate top job start times in forked children */
+	bool cycle_stats:1;		/* write per phase timings of each cycle to a stats file */
+	bool cycle_snapshot:1;		/* write the server's replies of each cycle to a snapshot file */
 #ifdef NAS /* localmod 034 */
 	bool prime_sto:1;	/* shares_track_only--no enforce shares */
 	bool non_prime_sto:1;
@@ -1189,6 +1246,7 @@ struct config
 	int unknown_shares;			/* unknown group shares */
 	int max_preempt_attempts;		/* max num of preempt attempts per cyc*/
 	int max_jobs_to_check;			/* max number of jobs to check in cyc*/
+	int run_job_window;			/* max run requests awaiting a reply */
 	std::string ded_prefix;			/* prefix to dedicated queues */
 	std::string pt_prefix;			/* prefix to primetime queues */
 	std::string npt_prefix;			/* prefix to non primetime queues */
@@ -1226,6 +1284,32 @@ struct rescheck
 	char *debug_msg;
 };
 
+/* step function of the peak amount of consumable resources assigned by the
+ * run/end events of a calendar (see simulate_resmin())
+ */
+struct resmin_profile
+{
+	unsigned long gen;		/* calendar generation the profile was built from */
+	timed_event *start;		/* event the profile was built from */
+	resource_resv **incl_arr;	/* resresvs the profile was built for */
+	std::vector<time_t> times;	/* time of each event in the profile */
+	std::vector<resdef *> defs;	/* resources assigned, in order first assigned */
+	std::vector<size_t> first;	/* index of the first event which assigns defs[i] */
+	std::vector<std::vector<sch_resource_t>> peak;	/* peak[i][j]: max change in defs[i] assigned over events 0-j */
+};
+
+/*
+ * Indexes over the events of an event_list so an event can be placed or
+ * found without walking the calendar.  An event's resource_resv points to
+ * its run and end events directly (run_event/end_event).
+ */
+struct event_index
+{
+	std::map<time_t, timed_event *> first_at;	/* first event at each time */
+	std::unordered_multimap<std::string, timed_event *> by_name;	/* events by name */
+	timed_event *last;			/* last event in the calendar */
+};
+
 struct event_list
 {
 	bool eol:1;		/* we've reached the end of time */
@@ -1233,6 +1317,9 @@ struct event_list
 	timed_event *next_event;	/* the next event to be performed */
 	timed_event *first_run_event;	/* The first run event in the calendar */
 	time_t *current_time;		/* [reference] current time in the calendar */
+	std::unordered_map<const void *, resmin_profile> *resmin_profiles;	/* profiles by owner of simulate_resmin() incl_arr */
+	event_index *index;		/* indexes over events */
+	unsigned long gen;		/* bumped whenever the events change */
 };
 
 struct timed_event
@@ -1288,6 +1375,20 @@ struct resresv_filter {
 	schd_error *err;		/* reason why set can not run*/
 };
 
+/*
+ * Index of the preemption candidates of one high priority job.  Everything
+ * kept here stays the same while preemption is simulated, so it is worked
+ * out once per candidate or node instead of on every select_index_to_preempt().
+ * Jobs and nodes are keyed by rank so the index can be shared between the
+ * real universe and its duplicate.
+ */
+struct preempt_index {
+	std::unordered_set<int> failed;			/* jobs which previously failed to be preempted */
+	std::unordered_set<int> hjob_nodes;		/* nodes a running/suspended high priority job is on */
+	std::unordered_map<int, bool> node_useful;	/* node rank -> can satisfy a chunk of the high priority job */
+	std::unordered_map<int, bool> cand_ok;		/* job rank -> passes the checks which do not change */
+};
+
 class sched_exception: public std::exception
 {
 	public:
@@ -45,6 +45,7 @@
  *
  * Functions included are:
  * 	add_child()
+ * 	alloc_ginfo()
  * 	add_unknown()
  * 	find_group_info()
  * 	find_alloc_ginfo()
@@ -55,17 +56,16 @@
  * 	calc_fair_share_perc()
  * 	test_perc()
  * 	update_usage_on_run()
+ * 	undo_usage_on_run()
  * 	decay_fairshare_tree()
  * 	compare_path()
  * 	print_fairshare()
  * 	write_usage()
- * 	rec_write_usage()
  * 	read_usage()
  * 	read_usage_v1()
  * 	read_usage_v2()
  * 	over_fs_usage()
  * 	dup_fairshare_tree()
- * 	free_fairshare_tree()
  * 	reset_temp_usage()
  *
  */
@@ -118,49 +118,75 @@ add_child(group_info *ginfo, group_info *parent)
 	}
 }
 
+/**
+ * @brief
+ *		alloc_ginfo - allocate a new group_info in a fairshare tree's node
+ *			array and index it by name.  The new ginfo is not
+ *			linked into the tree; use add_child() for that.
+ *
+ * @par	Since a ginfo can only be added to a parent which already exists,
+ *	appending to the array keeps it in topological order.
+ *
+ * @param[in]	name	-	name of the new ginfo
+ * @param[in]	fhead	-	the fairshare tree
+ *
+ * @return	the new ginfo
+ *
+ */
+group_info *
+alloc_ginfo(const std::string &name, fairshare_head *fhead)
+{
+	group_info *ginfo;
+
+	fhead->nodes.emplace_back(name);
+	ginfo = &fhead->nodes.back();
+	ginfo->idx = fhead->nodes.size() - 1;
+	fhead->index[name] = ginfo->idx;
+
+	return ginfo;
+}
+
 /**
  * @brief
  * 		add a ginfo to the "unknown" group
  *
  * @param[in]	ginfo	-	ginfo to add
- * @param[in]	root	-	root of fairshare tree
+ * @param[in]	fhead	-	the fairshare tree
  *
  * @return	nothing
  *
  */
 void
-add_unknown(group_info *ginfo, group_info *root)
+add_unknown(group_info *ginfo, fairshare_head *fhead)
 {
 	group_info *unknown; /* ptr to the "unknown" group */
 
-	unknown = find_group_info("unknown", root);
+	unknown = find_group_info(UNKNOWN_GROUP_NAME, fhead);
 	add_child(ginfo, unknown);
 	calc_fair_share_perc(unknown->child, UNSPECIFIED);
 }
 
 /**
  * @brief
- *		find_group_info - recursive function to find a group_info in the
- *			  resgroup tree
+ *		find_group_info - find a group_info in the resgroup tree
  *
  * @param[in]	name	-	name of the ginfo to find
- * @param[in]	root	-	the root of the current sub-tree
+ * @param[in]	fhead	-	the fairshare tree
  *
  * @return	the found group_info or NULL
  *
  */
 group_info *
-find_group_info(const std::string &name, group_info *root)
+find_group_info(const std::string &name, fairshare_head *fhead)
 {
-	group_info *ginfo; /* the found group */
-	if (root == NULL || name == root->name)
-		return root;
+	if (fhead == NULL)
+		return NULL;
 
-	ginfo = find_group_info(name, root->sibling);
-	if (ginfo == NULL)
-		ginfo = find_group_info(name, root->child);
+	auto it = fhead->index.find(name);
+	if (it == fhead->index.end())
+		return NULL;
 
-	return ginfo;
+	return &fhead->nodes[it->second];
 }
 
 /**
@@ -170,27 +196,25 @@ find_group_info(const std::string &name, group_info *root)
  *			  add it to the "unknown" group
  *
  * @param[in]	name	-	name of the ginfo to find
- * @param[in]	root	-	root of the fairshare tree
+ * @param[in]	fhead	-	the fairshare tree
  *
  * @return	the found ginfo or the newly allocated ginfo
  *
  */
 group_info *
-find_alloc_ginfo(const std::string &name, group_info *root)
+find_alloc_ginfo(const std::string &name, fairshare_head *fhead)
 {
 	group_info *ginfo; /* the found group or allocated group */
 
-	if (root == NULL)
+	if (fhead == NULL || fhead->root == NULL)
 		return NULL;
 
-	ginfo = find_group_info(name, root);
+	ginfo = find_group_info(name, fhead);
 
 	if (ginfo == NULL) {
-		if ((ginfo = new group_info(name)) == NULL)
-			return NULL;
-
+		ginfo = alloc_ginfo(name, fhead);
 		ginfo->shares = 1;
-		add_unknown(ginfo, root);
+		add_unknown(ginfo, fhead);
 	}
 	return ginfo;
 }
@@ -200,7 +224,7 @@ find_alloc_ginfo(const std::string &name, group_info *root)
  * 		parse the resource group file
  *
  * @param[in]	fname	-	name of the file
- * @param[in]	root	-	root of fairshare tree
+ * @param[in]	fhead	-	the fairshare tree
  *
  * @return	success/failure
  *
@@ -213,7 +237,7 @@ find_alloc_ginfo(const std::string &name, group_info *root)
  *
  */
 int
-parse_group(const char *fname, group_info *root)
+parse_group(const char *fname, fairshare_head *fhead)
 {
 	group_info *ginfo;     /* ptr to parent group */
 	group_info *new_ginfo; /* used to add each new group */
@@ -249,7 +273,7 @@ parse_group(const char *fname, group_info *root)
 			if (nametok == NULL || cgrouptok == NULL ||
 			    grouptok == NULL || sharestok == NULL) {
 				error = 1;
-			} else if (find_group_info(nametok, root) != NULL) {
+			} else if (find_group_info(nametok, fhead) != NULL) {
 				error = 1;
 				sprintf(log_buffer, "entity %s is not unique", nametok);
 				fprintf(stderr, "%s\n", log_buffer);
@@ -257,17 +281,16 @@ parse_group(const char *fname, group_info *root)
 					  "fairshare", log_buffer);
 			} else {
 				if (!strcmp(grouptok, "root"))
-					ginfo = find_group_info(FAIRSHARE_ROOT_NAME, root);
+					ginfo = find_group_info(FAIRSHARE_ROOT_NAME, fhead);
 				else
-					ginfo = find_group_info(grouptok, root);
+					ginfo = find_group_info(grouptok, fhead);
 
 				if (ginfo != NULL) {
 					shares = strtol(sharestok, &endp, 10);
 					if (*endp == '\0') {
 						cgroup = strtol(cgrouptok, &endp, 10);
 						if (*endp == '\0') {
-							if ((new_ginfo = new group_info(nametok)) == NULL)
-								return 0;
+							new_ginfo = alloc_ginfo(nametok, fhead);
 							new_ginfo->resgroup = ginfo->cresgroup;
 							new_ginfo->cresgroup = cgroup;
 							new_ginfo->shares = shares;
@@ -319,7 +342,7 @@ preload_tree()
 	if ((head = new fairshare_head()) == NULL)
 		return 0;
 
-	root = new group_info(FAIRSHARE_ROOT_NAME);
+	root = alloc_ginfo(FAIRSHARE_ROOT_NAME, head);
 
 	head->root = root;
 
@@ -327,10 +350,7 @@ preload_tree()
 	root->cresgroup = 0;
 	root->tree_percentage = 1.0;
 
-	if ((unknown = new group_info(UNKNOWN_GROUP_NAME)) == NULL) {
-		delete head;
-		return NULL;
-	}
+	unknown = alloc_ginfo(UNKNOWN_GROUP_NAME, head);
 
 	unknown->shares = conf.unknown_shares;
 	unknown->resgroup = 0;
@@ -437,28 +457,53 @@ update_usage_on_run(resource_resv *resresv)
 			  "Job doesn't have a group_info ptr set, usage not updated.");
 }
 
+/**
+ * @brief
+ * 		Take back the usage update_usage_on_run() accrued for a job
+ *	       whose run was rejected by the server after the fact.
+ *
+ * @param[in]	resresv	-	the job to take the usage back from
+ *
+ * @return nothing
+ *
+ */
+void
+undo_usage_on_run(resource_resv *resresv)
+{
+	usage_t u;
+
+	if (resresv == NULL)
+		return;
+
+	if (!resresv->is_job || resresv->job == NULL || resresv->job->ginfo == NULL)
+		return;
+
+	u = formula_evaluate(conf.fairshare_res.c_str(), resresv, resresv->resreq);
+	for (auto &g : resresv->job->ginfo->gpath)
+		g->temp_usage -= u;
+}
+
 /**
  * @brief
  *		decay_fairshare_tree - decay the usage information kept in the fair
  *			       share tree
  *
- * @param[in,out]	root	-	the root of the fairshare tree
+ * @param[in,out]	fhead	-	the fairshare tree
  *
  * @return nothing
  *
  */
 void
-decay_fairshare_tree(group_info *root)
+decay_fairshare_tree(fairshare_head *fhead)
 {
-	if (root == NULL)
+	if (fhead == NULL)
 		return;
 
-	decay_fairshare_tree(root->sibling);
-	decay_fairshare_tree(root->child);
-
-	root->usage *= conf.fairshare_decay_factor;
-	if (root->usage < FAIRSHARE_MIN_USAGE)
-		root->usage = FAIRSHARE_MIN_USAGE;
+	for (auto &g : fhead->nodes) {
+		g.usage *= conf.fairshare_decay_factor;
+		if (g.usage < FAIRSHARE_MIN_USAGE)
+			g.usage = FAIRSHARE_MIN_USAGE;
+	}
 }
 
 /**
@@ -555,44 +600,23 @@ write_usage(const char *filename, fairshare_head *fhead)
 	fwrite(&head, sizeof(struct group_node_header), 1, fp);
 	fwrite(&fhead->last_decay, sizeof(time_t), 1, fp);
 
-	rec_write_usage(fhead->root, fp);
-	fclose(fp);
-	return 1;
-}
-
-/**
- * @brief
- *		rec_write_usage - recursive helper function which will write out all
- *			  the group_info structs of the resgroup tree
- *
- * @param[in]	root	-	the root of the current subtree
- * @param[in]	fp	-	the file to write the ginfo out to
- *
- * @return nothing
- *
- */
-void
-rec_write_usage(group_info *root, FILE *fp)
-{
-	struct group_node_usage_v2 grp; /* used to write out usage info */
-
-	if (root == NULL)
-		return;
+	for (auto &g : fhead->nodes) {
+		struct group_node_usage_v2 grp; /* used to write out usage info */
 
-	/* only write out leaves of the tree (fairshare entities)
-	 * usage defaults to 1 so don't bother writing those out either
-	 * It is possible that the unknown group is empty.  Don't want to write it out
-	 */
-	if (root->usage != 1 && root->child == NULL && root->name != UNKNOWN_GROUP_NAME) {
-		memset(&grp, 0, sizeof(struct group_node_usage_v2));
-		snprintf(grp.name, sizeof(grp.name), "%s", root->name.c_str());
-		grp.usage = root->usage;
+		/* only write out leaves of the tree (fairshare entities)
+		 * usage defaults to 1 so don't bother writing those out either
+		 * It is possible that the unknown group is empty.  Don't want to write it out
+		 */
+		if (g.usage != 1 && g.child == NULL && g.name != UNKNOWN_GROUP_NAME) {
+			memset(&grp, 0, sizeof(struct group_node_usage_v2));
+			snprintf(grp.name, sizeof(grp.name), "%s", g.name.c_str());
+			grp.usage = g.usage;
 
-		fwrite(&grp, sizeof(struct group_node_usage_v2), 1, fp);
+			fwrite(&grp, sizeof(struct group_node_usage_v2), 1, fp);
+		}
 	}
-
-	rec_write_usage(root->sibling, fp);
-	rec_write_usage(root->child, fp);
+	fclose(fp);
+	return 1;
 }
 
 /**
@@ -641,7 +665,7 @@ read_usage(const char *filename, int flags, fairshare_head *fhead)
 						error = 1;
 				}
 				if (!error)
-					read_usage_v2(fp, flags, fhead->root);
+					read_usage_v2(fp, flags, fhead);
 			} else
 				error = 1;
 
@@ -651,7 +675,7 @@ read_usage(const char *filename, int flags, fairshare_head *fhead)
 
 		} else { /* original headerless usage file */
 			rewind(fp);
-			read_usage_v1(fp, fhead->root);
+			read_usage_v1(fp, fhead);
 		}
 	}
 
@@ -663,7 +687,7 @@ read_usage(const char *filename, int flags, fairshare_head *fhead)
  * 		read version 1 usage file
  *
  * @param[in]	fp	-	the file pointer to the open file
- * @param[in]	root	-	root of the fairshare tree
+ * @param[in]	fhead	-	the fairshare tree
  *
  * @return	int
  *	@retval	1	: success
@@ -671,7 +695,7 @@ read_usage(const char *filename, int flags, fairshare_head *fhead)
  *
  */
 int
-read_usage_v1(FILE *fp, group_info *root)
+read_usage_v1(FILE *fp, fairshare_head *fhead)
 {
 	struct group_node_usage_v1 grp;
 	group_info *ginfo;
@@ -681,7 +705,7 @@ read_usage_v1(FILE *fp, group_info *root)
 	memset(&grp, 0, sizeof(struct group_node_usage_v1));
 	while (fread(&grp, sizeof(struct group_node_usage_v1), 1, fp)) {
 		if (grp.usage >= 0 && is_valid_pbs_name(grp.name, USAGE_NAME_MAX)) {
-			ginfo = find_alloc_ginfo(grp.name, root);
+			ginfo = find_alloc_ginfo(grp.name, fhead);
 			if (ginfo != NULL) {
 				ginfo->usage = grp.usage;
 				ginfo->temp_usage = grp.usage;
@@ -709,14 +733,14 @@ read_usage_v1(FILE *fp, group_info *root)
  *
  * @param[in]	fp	- the file pointer to the open file
  * @param[in]	flags	- flags to check whether to trim or not.
- * @param[in]	root	- root of the fairshare tree
+ * @param[in]	fhead	- the fairshare tree
  *
  *	@retval 1 success
  *	@retval 0 failure
  *
  */
 int
-read_usage_v2(FILE *fp, int flags, group_info *root)
+read_usage_v2(FILE *fp, int flags, fairshare_head *fhead)
 {
 	struct group_node_usage_v2 grp;
 	group_info *ginfo;
@@ -731,9 +755,9 @@ read_usage_v2(FILE *fp, int flags, group_info *root)
 			 * already in the resource_group file
 			 */
 			if (flags & FS_TRIM)
-				ginfo = find_group_info(grp.name, root);
+				ginfo = find_group_info(grp.name, fhead);
 			else
-				ginfo = find_alloc_ginfo(grp.name, root);
+				ginfo = find_alloc_ginfo(grp.name, fhead);
 
 			if (ginfo != NULL) {
 				ginfo->usage = grp.usage;
@@ -817,6 +841,7 @@ group_info::group_info(const std::string &gname) : name(gname)
 	usage = FAIRSHARE_MIN_USAGE;
 	temp_usage = FAIRSHARE_MIN_USAGE;
 	usage_factor = 0.0;
+	idx = -1;
 	parent = NULL;
 	sibling = NULL;
 	child = NULL;
@@ -832,6 +857,7 @@ group_info::group_info(group_info &oginfo) : name(oginfo.name)
 	usage = oginfo.usage;
 	usage_factor = oginfo.usage_factor;
 	temp_usage = oginfo.temp_usage;
+	idx = oginfo.idx;
 	sibling = NULL;
 	child = NULL;
 	parent = NULL;
@@ -848,6 +874,7 @@ group_info::operator=(const group_info &oginfo)
 	usage = oginfo.usage;
 	usage_factor = oginfo.usage_factor;
 	temp_usage = oginfo.temp_usage;
+	idx = oginfo.idx;
 	sibling = NULL;
 	child = NULL;
 	parent = NULL;
@@ -857,48 +884,40 @@ group_info::operator=(const group_info &oginfo)
 
 /**
  * @brief
- * 		copy constructor for the fairshare tree
+ * 		copy a fairshare tree.  Since the tree is kept in an array
+ *		in topological order, the nodes are copied in one pass and
+ *		their links are remapped by slot in a second.
  *
- * @param[in]	root	-	root of the tree
- * @param[in] nparent	-	the parent of the root in the new dup'd tree
+ * @param[out]	nfhead	-	the empty fairshare_head to copy into
+ * @param[in]	ofhead	-	the fairshare_head to copy
  *
- * @return	duplicated fairshare tree
- */
-group_info *
-dup_fairshare_tree(group_info *root, group_info *nparent)
-{
-	group_info *nroot;
-	if (root == NULL)
-		return NULL;
-
-	nroot = new group_info(*root);
-
-	if (nroot == NULL)
-		return NULL;
-
-	add_child(nroot, nparent);
-
-	nroot->sibling = dup_fairshare_tree(root->sibling, nparent);
-	nroot->child = dup_fairshare_tree(root->child, nroot);
-
-	return nroot;
-}
-
-/**
- *	@brief
- *		free the entire fairshare tree
- *
- * @param[in]	root	-	root of the tree
+ * @return	nothing
  */
 void
-free_fairshare_tree(group_info *root)
+dup_fairshare_tree(fairshare_head *nfhead, fairshare_head *ofhead)
 {
-	if (root == NULL)
-		return;
+	int i;
+
+	for (auto &og : ofhead->nodes)
+		nfhead->nodes.emplace_back(og);
+	nfhead->index = ofhead->index;
+
+	i = 0;
+	for (auto &og : ofhead->nodes) {
+		group_info &ng = nfhead->nodes[i++];
+
+		if (og.parent != NULL)
+			ng.parent = &nfhead->nodes[og.parent->idx];
+		if (og.sibling != NULL)
+			ng.sibling = &nfhead->nodes[og.sibling->idx];
+		if (og.child != NULL)
+			ng.child = &nfhead->nodes[og.child->idx];
+		ng.gpath.reserve(og.gpath.size());
+		for (auto g : og.gpath)
+			ng.gpath.push_back(&nfhead->nodes[g->idx]);
+	}
 
-	free_fairshare_tree(root->sibling);
-	free_fairshare_tree(root->child);
-	delete root;
+	nfhead->root = nfhead->nodes.empty() ? NULL : &nfhead->nodes.front();
 }
 
 /**
@@ -924,7 +943,7 @@ fairshare_head::fairshare_head()
 fairshare_head::fairshare_head(fairshare_head &ofhead)
 {
 	last_decay = ofhead.last_decay;
-	root = dup_fairshare_tree(ofhead.root, NULL);
+	dup_fairshare_tree(this, &ofhead);
 }
 
 /**
@@ -933,9 +952,12 @@ fairshare_head::fairshare_head(fairshare_head &ofhead)
 fairshare_head &
 fairshare_head::operator=(fairshare_head &ofhead)
 {
-	free_fairshare_tree(root);
+	if (this == &ofhead)
+		return *this;
+	nodes.clear();
+	index.clear();
 	last_decay = ofhead.last_decay;
-	root = dup_fairshare_tree(ofhead.root, NULL);
+	dup_fairshare_tree(this, &ofhead);
 	return *this;
 }
 
@@ -947,49 +969,24 @@ fairshare_head::operator=(fairshare_head &ofhead)
  */
 fairshare_head::~fairshare_head()
 {
-	free_fairshare_tree(root);
 }
 
 /**
  * @brief
- * 		recursively walk the fairshare tree resetting temp_usage = usage
+ * 		walk the fairshare tree resetting temp_usage = usage
  *
- * @param[in]	head	-	fairshare node to reset
+ * @param[in]	fhead	-	the fairshare tree
  *
  * @return	void
  */
 void
-reset_temp_usage(group_info *head)
-{
-	if (head == NULL)
-		return;
-
-	head->temp_usage = head->usage;
-	reset_temp_usage(head->sibling);
-	reset_temp_usage(head->child);
-}
-
-/**
- * @brief
- *		recursive helper function to calc_usage_factor()
- * @param root	- parent fairshare tree node
- * @param ginfo	- child fairshare tree node
- *
- * @return void
- */
-static void
-calc_usage_factor_rec(group_info *root, group_info *ginfo)
+reset_temp_usage(fairshare_head *fhead)
 {
-	float usage;
-
-	if (root == NULL || ginfo == NULL)
+	if (fhead == NULL)
 		return;
 
-	usage = ginfo->usage / root->usage;
-	ginfo->usage_factor = usage + ((ginfo->parent->usage_factor - usage) * ginfo->group_percentage);
-
-	calc_usage_factor_rec(root, ginfo->sibling);
-	calc_usage_factor_rec(root, ginfo->child);
+	for (auto &g : fhead->nodes)
+		g.temp_usage = g.usage;
 }
 
 /**
@@ -999,6 +996,9 @@ calc_usage_factor_rec(group_info *root, group_info *ginfo)
  *		plus part of its parent's usage_factor into account.  This
  *		will give a number that is comparable across the tree.
  *
+ * @par	The tree is swept in topological order so a node's parent has
+ *	always been calculated before the node itself.
+ *
  * @param[in] tree - fairshare tree
  *
  * @return void
@@ -1006,17 +1006,24 @@ calc_usage_factor_rec(group_info *root, group_info *ginfo)
 void
 calc_usage_factor(fairshare_head *tree)
 {
-	group_info *ginfo;
 	group_info *root;
 
-	if (tree == NULL)
+	if (tree == NULL || tree->root == NULL)
 		return;
 
 	root = tree->root;
-	/* Root's children use their real usage as their arbitrary usage */
-	for (ginfo = root->child; ginfo != NULL; ginfo = ginfo->sibling) {
-		ginfo->usage_factor = ginfo->usage / root->usage;
-		calc_usage_factor_rec(root, ginfo->child);
+	for (auto &g : tree->nodes) {
+		float usage;
+
+		if (g.parent == NULL)
+			continue;
+
+		usage = g.usage / root->usage;
+		/* Root's children use their real usage as their arbitrary usage */
+		if (g.parent == root)
+			g.usage_factor = usage;
+		else
+			g.usage_factor = usage + ((g.parent->usage_factor - usage) * g.group_percentage);
 	}
 }
 
@@ -1024,15 +1031,16 @@ calc_usage_factor(fairshare_head *tree)
  * @brief reset the usage of the fairshare tree so the usage can be reread.
  *	If the usage is not reset first, any entity that is no longer in the
  *	fairshare usage file will retain their original usage.
- * @param node - the fairshare node
+ * @param fhead - the fairshare tree
  */
 void
-reset_usage(group_info *node)
+reset_usage(fairshare_head *fhead)
 {
-	if (node == NULL)
+	if (fhead == NULL)
 		return;
-	reset_usage(node->sibling);
-	reset_usage(node->child);
-	node->usage = 1;
-	node->temp_usage = 1;
+
+	for (auto &g : fhead->nodes) {
+		g.usage = 1;
+		g.temp_usage = 1;
+	}
 }
@@ -47,24 +47,28 @@
 void add_child(group_info *ginfo, group_info *parent);
 
 /*
- *      find_group_info - recursive function to find a ginfo in the
- resgroup tree
+ *      alloc_ginfo - allocate a new ginfo in the fairshare tree's node array
  */
-group_info *find_group_info(const std::string &name, group_info *root);
+group_info *alloc_ginfo(const std::string &name, fairshare_head *fhead);
+
+/*
+ *      find_group_info - find a ginfo in the resgroup tree
+ */
+group_info *find_group_info(const std::string &name, fairshare_head *fhead);
 
 /*
  *      find_alloc_ginfo - trys to find a ginfo in the fair share tree.  If it
  *                        can not find the ginfo, then allocate a new one and
  *                        add it to the "unknown" group
  */
-group_info *find_alloc_ginfo(const std::string &name, group_info *root);
+group_info *find_alloc_ginfo(const std::string &name, fairshare_head *fhead);
 
 /*
  *
  *	parse_group - parse the resource group file
  *
  *	  fname - name of the file
- *	  root  - root of fairshare tree
+ *	  fhead - the fairshare tree
  *
  *	return success/failure
  *
@@ -77,7 +81,7 @@ group_info *find_alloc_ginfo(const std::string &name, group_info *root);
  *	  shares  - the amount of shares the user/group has in its resgroup
  *
  */
-int parse_group(const char *fname, group_info *root);
+int parse_group(const char *fname, fairshare_head *fhead);
 
 /*
  *
@@ -109,24 +113,23 @@ int calc_fair_share_perc(group_info *root, int shares);
  */
 void update_usage_on_run(resource_resv *resresv);
 
+/*
+ *      undo_usage_on_run - take back the usage added by update_usage_on_run()
+ *                          for a job whose run was rejected
+ */
+void undo_usage_on_run(resource_resv *resresv);
+
 /*
  *      decay_fairshare_tree - decay the usage information kept in the fair
  *                             share tree
  */
-void decay_fairshare_tree(group_info *root);
+void decay_fairshare_tree(fairshare_head *fhead);
 
 /*
  *      write_usage - write the usage information to the usage file
- *                    This fuction uses a recursive helper function
  */
 int write_usage(const char *filename, fairshare_head *fhead);
 
-/*
- *      rec_write_usage - recursive helper function which will write out all
- *                        the group_info structs of the resgroup tree
- */
-void rec_write_usage(group_info *root, FILE *fp);
-
 /*
  *      read_usage - read the usage information and load it into the
  *                   resgroup tree.
@@ -136,12 +139,12 @@ void read_usage(const char *filename, int flags, fairshare_head *fhead);
 /*
  *      read_usage_v1 - read version 1 usage file
  */
-int read_usage_v1(FILE *fp, group_info *root);
+int read_usage_v1(FILE *fp, fairshare_head *fhead);
 
 /*
  *      read_usage_v2 - read version 2 usage file
  */
-int read_usage_v2(FILE *fp, int flags, group_info *root);
+int read_usage_v2(FILE *fp, int flags, fairshare_head *fhead);
 
 /*
  *      create_group_path - create a path from the root to the leaf of the tree
@@ -165,41 +168,36 @@ int over_fs_usage(group_info *ginfo);
 /*
  *	dup_fairshare_tree
  *
- *	  root - root of the tree
- *	  nparent - the parent of the root in the "new" duplicated tree
+ *	  nfhead - the empty fairshare_head to copy into
+ *	  ofhead - the fairshare_head to copy
  *
- *	return duplicated fairshare tree
- */
-group_info *dup_fairshare_tree(group_info *root, group_info *nparent);
-
-/*
- *	free_fairshare_tree - free the entire fairshare tree
+ *	return nothing
  */
-void free_fairshare_tree(group_info *root);
+void dup_fairshare_tree(fairshare_head *nfhead, fairshare_head *ofhead);
 
 /*
  *
  *	add_unknown - add a ginfo to the "unknown" group
  *
  *	  ginfo - ginfo to add
- *	  root  - root of fairshare tre
+ *	  fhead - the fairshare tree
  *
  *	return nothing
  *
  */
-void add_unknown(group_info *ginfo, group_info *root);
+void add_unknown(group_info *ginfo, fairshare_head *fhead);
 
 /*
  * 	reset_temp_usage - walk the fairshare tree resetting temp_usage = usage
  *
- * 	  head - fairshare node to reset
+ * 	  fhead - the fairshare tree
  *
  * 	return nothing
  */
-void reset_temp_usage(group_info *head);
+void reset_temp_usage(fairshare_head *fhead);
 
 /* reset the tree to 1 usage */
-void reset_usage(group_info *node);
+void reset_usage(fairshare_head *fhead);
 
 /* Calculate the arbitrary usage of the tree */
 void calc_usage_factor(fairshare_head *tree);
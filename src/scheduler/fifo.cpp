@@ -51,14 +51,19 @@
 #endif
 
 #include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "buckets.h"
 #include "check.h"
 #include "config.h"
 #include "constant.h"
+#include "cycle_stats.h"
 #include "dedtime.h"
 #include "fairshare.h"
 #include "fifo.h"
+#include "formula.h"
 #include "globals.h"
 #include "job_info.h"
 #include "libpbs.h"
@@ -81,6 +86,7 @@
 #include "resv_info.h"
 #include "server_info.h"
 #include "simulate.h"
+#include "snapshot.h"
 #include "sort.h"
 #include <errno.h>
 #include <fcntl.h>
@@ -125,6 +131,7 @@ schedinit(int nthreads)
 #endif
 
 	conf = parse_config(CONFIG_FILE);
+	invalidate_job_status_cache();
 
 	parse_holidays(HOLIDAYS_FILE);
 	time(&(cstat.current_time));
@@ -148,7 +155,7 @@ schedinit(int nthreads)
 	/* preload the static members to the fairshare tree */
 	fstree = preload_tree();
 	if (fstree != NULL) {
-		parse_group(RESGROUP_FILE, fstree->root);
+		parse_group(RESGROUP_FILE, fstree);
 		calc_fair_share_perc(fstree->root->child, UNSPECIFIED);
 		read_usage(USAGE_FILE, 0, fstree);
 
@@ -345,6 +352,7 @@ update_cycle_status(status &policy, time_t current_time)
 int
 init_scheduling_cycle(status *policy, int pbs_sd, server_info *sinfo)
 {
+	phase_timer timer(PHASE_INIT_CYCLE);
 	group_info *user = NULL; /* the user for the running jobs of the last cycle */
 	static schd_error *err;
 
@@ -360,7 +368,7 @@ init_scheduling_cycle(status *policy, int pbs_sd, server_info *sinfo)
 		bool resort = false;
 		if ((fp = fopen(USAGE_TOUCH, "r")) != NULL) {
 			fclose(fp);
-			reset_usage(fstree->root);
+			reset_usage(fstree);
 			read_usage(USAGE_FILE, NO_FLAGS, fstree);
 			if (fstree->last_decay == 0)
 				fstree->last_decay = policy->current_time;
@@ -373,7 +381,7 @@ init_scheduling_cycle(status *policy, int pbs_sd, server_info *sinfo)
 			 */
 
 			for (const auto &lj : last_running) {
-				user = find_alloc_ginfo(lj.entity_name, sinfo->fstree->root);
+				user = find_alloc_ginfo(lj.entity_name, sinfo->fstree);
 
 				if (user != NULL) {
 					auto rj = find_resource_resv(sinfo->running_jobs, lj.name);
@@ -406,7 +414,7 @@ init_scheduling_cycle(status *policy, int pbs_sd, server_info *sinfo)
 			log_event(PBSEVENT_DEBUG2, PBS_EVENTCLASS_SERVER, LOG_DEBUG,
 				  "Fairshare", "Decaying Fairshare Tree");
 			if (fstree != NULL)
-				decay_fairshare_tree(sinfo->fstree->root);
+				decay_fairshare_tree(sinfo->fstree);
 			t -= conf.decay_time;
 			decayed = true;
 			resort = true;
@@ -426,7 +434,7 @@ init_scheduling_cycle(status *policy, int pbs_sd, server_info *sinfo)
 			log_event(PBSEVENT_DEBUG2, PBS_EVENTCLASS_SERVER, LOG_DEBUG,
 				  "Fairshare", "Usage Sync");
 		}
-		reset_temp_usage(sinfo->fstree->root);
+		reset_temp_usage(sinfo->fstree);
 		calc_usage_factor(sinfo->fstree);
 		if (resort)
 			sort_jobs(policy, sinfo);
@@ -448,6 +456,9 @@ init_scheduling_cycle(status *policy, int pbs_sd, server_info *sinfo)
 		}
 	}
 	if (sinfo->jobs != NULL) {
+		if (sinfo->job_sort_formula != NULL)
+			eval_formula_array(sinfo->job_sort_formula, sinfo->jobs);
+
 		for (int i = 0; sinfo->jobs[i] != NULL; i++) {
 			resource_resv *resresv = sinfo->jobs[i];
 			if (resresv->job != NULL) {
@@ -459,7 +470,6 @@ init_scheduling_cycle(status *policy, int pbs_sd, server_info *sinfo)
 				}
 				if (sinfo->job_sort_formula != NULL) {
 					double threshold = sc_attrs.job_sort_formula_threshold;
-					resresv->job->formula_value = formula_evaluate(sinfo->job_sort_formula, resresv, resresv->resreq);
 					log_eventf(PBSEVENT_DEBUG2, PBS_EVENTCLASS_JOB, LOG_DEBUG, resresv->name, "Formula Evaluation = %.*f",
 						   float_digits(resresv->job->formula_value, FLOAT_NUM_DIGITS), resresv->job->formula_value);
 
@@ -514,6 +524,9 @@ schedule(int sd, const sched_cmd *cmd)
 			 */
 			update_resource_defs(sd);
 
+			/* job mtimes can't be trusted across a server restart */
+			invalidate_job_status_cache();
+
 			/* Get config from the qmgr sched object */
 			if (!set_validate_sched_attrs(sd))
 				return 0;
@@ -624,13 +637,21 @@ scheduling_cycle(int sd, const sched_cmd *cmd)
 	log_event(PBSEVENT_DEBUG, PBS_EVENTCLASS_REQUEST, LOG_DEBUG,
 		  "", "Starting Scheduling Cycle");
 
+	cycle_stats_begin();
+
 	/* Decide whether we need to send "can't run" type updates this cycle */
 	if (time(NULL) - last_attr_updates >= sc_attrs.attr_update_period)
 		send_job_attr_updates = 1;
 	else
 		send_job_attr_updates = 0;
 
-	update_cycle_status(cstat, 0);
+	/* a replayed cycle happens at the time it was recorded */
+	update_cycle_status(cstat, snapshot_time());
+	snapshot_cycle_begin();
+	if (snapshot_missing_defs()) {
+		update_resource_defs(sd);
+		set_validate_sched_attrs(sd);
+	}
 
 #ifdef NAS /* localmod 030 */
 	do_soft_cycle_interrupt = 0;
@@ -771,6 +792,10 @@ get_high_prio_cmd(int *is_conn_lost, sched_cmd *high_prior_cmd)
 	sched_cmd cmd;
 	int rc;
 
+	/* not connected to a server (e.g., replaying a snapshot) */
+	if (clust_secondary_sock < 0)
+		return 0;
+
 	rc = get_sched_cmd_noblk(clust_secondary_sock, &cmd);
 	if (rc == -2) {
 		*is_conn_lost = 1;
@@ -821,6 +846,7 @@ get_high_prio_cmd(int *is_conn_lost, sched_cmd *high_prior_cmd)
 int
 main_sched_loop(status *policy, int sd, server_info *sinfo, schd_error **rerr)
 {
+	phase_timer timer(PHASE_MAIN_LOOP);
 	resource_resv *njob;	     /* ptr to the next job to see if it can run */
 	int rc = 0;		     /* return code to the function */
 	int num_topjobs = 0;	     /* number of jobs we've added to the calendar */
@@ -883,16 +909,22 @@ main_sched_loop(status *policy, int sd, server_info *sinfo, schd_error **rerr)
 
 		log_event(PBSEVENT_DEBUG, PBS_EVENTCLASS_JOB, LOG_DEBUG,
 			  njob->name, "Considering job to run");
+		cycle_stats_count(CTR_JOBS_CONSIDERED);
 
 		should_use_buckets = job_should_use_buckets(njob);
-		if (should_use_buckets)
+		if (should_use_buckets) {
 			flags = USE_BUCKETS;
+			cycle_stats_count(CTR_BUCKET_JOBS);
+		}
 
-		if (njob->is_shrink_to_fit) {
-			/* Pass the suitable heuristic for shrinking */
-			ns_arr = is_ok_to_run_STF(policy, sinfo, qinfo, njob, flags, err, shrink_job_algorithm);
-		} else
-			ns_arr = is_ok_to_run(policy, sinfo, qinfo, njob, flags, err);
+		{
+			phase_timer ok_timer(PHASE_IS_OK_TO_RUN);
+			if (njob->is_shrink_to_fit) {
+				/* Pass the suitable heuristic for shrinking */
+				ns_arr = is_ok_to_run_STF(policy, sinfo, qinfo, njob, flags, err, shrink_job_algorithm);
+			} else
+				ns_arr = is_ok_to_run(policy, sinfo, qinfo, njob, flags, err);
+		}
 
 		if (err->status_code == NEVER_RUN)
 			njob->can_never_run = 1;
@@ -901,6 +933,7 @@ main_sched_loop(status *policy, int sd, server_info *sinfo, schd_error **rerr)
 			if (rc != SCHD_ERROR) {
 				if (run_update_job(policy, sd, sinfo, qinfo, njob, ns_arr, RURR_ADD_END_EVENT, err)) {
 					rc = SUCCESS;
+					clear_topjob_estimates();
 					if (sinfo->has_soft_limit || qinfo->has_soft_limit)
 						sort_again = MUST_RESORT_JOBS;
 					else
@@ -920,8 +953,13 @@ main_sched_loop(status *policy, int sd, server_info *sinfo, schd_error **rerr)
 				sort_again = MUST_RESORT_JOBS;
 			} else
 				sort_again = SORTED;
+			/* jobs may have been preempted even if njob didn't run */
+			clear_topjob_estimates();
 		}
 
+		if (rc == SUCCESS)
+			cycle_stats_count(CTR_JOBS_RUN);
+
 #ifdef NAS /* localmod 034 */
 		if (rc == SUCCESS && !site_is_queue_topjob_set_aside(njob)) {
 			site_bump_topjobs(njob);
@@ -947,6 +985,7 @@ main_sched_loop(status *policy, int sd, server_info *sinfo, schd_error **rerr)
 				auto cal_rc = add_job_to_calendar(sd, policy, sinfo, njob, should_use_buckets);
 
 				if (cal_rc > 0) { /* Success! */
+					cycle_stats_count(CTR_TOPJOBS);
 #ifdef NAS					  /* localmod 034 */
 					switch (bf_rc) {
 						case 1:
@@ -1100,8 +1139,12 @@ main_sched_loop(status *policy, int sd, server_info *sinfo, schd_error **rerr)
 		send_job_updates(sd, njob);
 	}
 
+	/* settle any pipelined run requests while the universe is still around */
+	reap_run_job_replies(0);
+
 	*rerr = err;
 
+	clear_topjob_estimates();
 	free_schd_error(chk_lim_err);
 	return rc;
 }
@@ -1118,6 +1161,8 @@ main_sched_loop(status *policy, int sd, server_info *sinfo, schd_error **rerr)
 void
 end_cycle_tasks(server_info *sinfo)
 {
+	reap_run_job_replies(0);
+
 	/* keep track of update used resources for fairshare */
 	if (sinfo != NULL && sinfo->policy->fair_share)
 		create_prev_job_info(sinfo->running_jobs);
@@ -1146,6 +1191,9 @@ end_cycle_tasks(server_info *sinfo)
 		cmp_aoename = NULL;
 	}
 
+	cycle_stats_end();
+	snapshot_cycle_end();
+
 	log_event(PBSEVENT_DEBUG, PBS_EVENTCLASS_REQUEST, LOG_DEBUG,
 		  "", "Leaving Scheduling Cycle");
 }
@@ -1246,6 +1294,118 @@ move_peer_job(resource_resv *rr)
 	return rc;
 }
 
+/**
+ * @brief
+ * 		can the run request of a job be pipelined with send_run_job_pipelined()?
+ *		Only requests which wait for the runjob hook are answered by the
+ *		server in the order they were sent.  Without a runjob hook
+ *		(or with job_run_wait set to none) the scheduler never waits, and
+ *		with execjob_hook the reply only comes once MoM has the job.
+ *		qrun requests are never pipelined since they need the outcome
+ *		before the cycle replies to qrun.  Neither are runs made with
+ *		RURR_NO_PIPELINE, like the run of a job which preempted work.
+ *
+ * @param[in]	rr	-	the job to run
+ * @param[in]	flags	-	run_update_job() flags
+ *
+ * @return	bool
+ * @retval	true	: pipeline the request
+ * @retval	false	: send it and wait for the reply
+ */
+static bool
+can_pipeline_run_job(resource_resv *rr, unsigned int flags)
+{
+	return conf.run_job_window > 1 && sc_attrs.runjob_mode == RJ_RUNJOB_HOOK &&
+	       rr->server->has_runjob_hook && rr->server->qrun_job == NULL &&
+	       !(flags & RURR_NO_PIPELINE);
+}
+
+/**
+ * @brief
+ * 		undo_run_job - undo the run of a job whose pipelined run request
+ *			was rejected by the server.  The job is put back in the
+ *			universe as queued and gets the same comment as a job
+ *			which failed to run when waiting for the reply.  Its end
+ *			event, its parent array's queued subjobs, its fairshare
+ *			usage and its preempted state are put back as they were
+ *			before the run.
+ *
+ * @param[in]	pbs_sd	-	connection the run request was sent over
+ * @param[in]	rr	-	the job
+ * @param[in]	array_queued	-	the job's parent array was queued before the run
+ * @param[in]	time_preempted	-	when the job was preempted, UNSPECIFIED if it wasn't
+ * @param[in]	pbsrc	-	error code of the run request
+ * @param[in]	errbuf	-	error text of the run request
+ *
+ * @return	void
+ */
+void
+undo_run_job(int pbs_sd, resource_resv *rr, bool array_queued, time_t time_preempted, int pbsrc, const char *errbuf)
+{
+	schd_error *err;
+	char buf[MAX_LOG_SIZE];
+	server_info *sinfo = rr->server;
+	resource_resv *array = rr->job->parent_job;
+
+	log_eventf(PBSEVENT_SCHED, PBS_EVENTCLASS_JOB, LOG_INFO, rr->name,
+		   "Run request rejected (%d), returning job to queued", pbsrc);
+
+	update_universe_on_end(sinfo->policy, rr, "Q", NO_FLAGS);
+
+	/* The job never ran, so it won't end either */
+	if (rr->end_event != NULL) {
+		delete_event(sinfo, rr->end_event);
+		rr->end_event = NULL;
+	}
+
+	if (array != NULL) {
+		range_add_value(&array->job->queued_subjobs, rr->job->array_index, ENABLE_SUBRANGE_STEPPING);
+		if (array_queued) {
+			array->job->is_begin = 0;
+			array->job->is_queued = 1;
+		}
+		update_accruetype(pbs_sd, sinfo, ACCRUE_MAKE_ELIGIBLE, SUCCESS, array);
+	}
+
+	if (sinfo->policy->fair_share)
+		undo_usage_on_run(rr);
+
+	/* The run unset the job's preempted state, set it again */
+	if (time_preempted != UNSPECIFIED && !rr->job->is_preempted) {
+		struct attrl **pattr = &rr->job->attr_updates;
+
+		/* drop the unset of sched_preempted if it hasn't gone out yet */
+		while (*pattr != NULL) {
+			if (!strcmp((*pattr)->name, ATTR_sched_preempted)) {
+				struct attrl *a = *pattr;
+
+				*pattr = a->next;
+				a->next = NULL;
+				free_attrl(a);
+			} else
+				pattr = &(*pattr)->next;
+		}
+		snprintf(buf, sizeof(buf), "%ld", (long) time_preempted);
+		update_job_attr(pbs_sd, rr, ATTR_sched_preempted, NULL, buf, NULL, UPDATE_LATER);
+		rr->job->is_preempted = 1;
+		rr->job->time_preempted = time_preempted;
+		sinfo->num_preempted++;
+	}
+
+	rr->can_not_run = true;
+	sinfo->pset_metadata_stale = 1;
+	clear_topjob_estimates();
+
+	if ((err = new_schd_error()) == NULL)
+		return;
+	set_schd_error_codes(err, NOT_RUN, RUN_FAILURE);
+	set_schd_error_arg(err, ARG1, errbuf);
+	snprintf(buf, sizeof(buf), "%d", pbsrc);
+	set_schd_error_arg(err, ARG2, buf);
+	update_job_can_not_run(pbs_sd, rr, err);
+	free_schd_error(err);
+}
+
 /**
  * @brief
  * 		run_job - handle the running of a pbs job.  If it's a peer job
@@ -1255,6 +1415,7 @@ move_peer_job(resource_resv *rr)
  * @param[in]	pbs_sd	-	pbs connection descriptor to the server
  * @param[in]	rr	-	the job to run
  * @param[in]	ns_arr		where to run the job
+ * @param[in]	flags	-	run_update_job() flags
  * @param[out]	err	-	error struct to return errors
  *
  *
@@ -1263,7 +1424,7 @@ move_peer_job(resource_resv *rr)
  * 
  */
 bool
-run_job(status *policy, int pbs_sd, resource_resv *rr, std::vector<nspec *> &ns_arr, schd_error *err)
+run_job(status *policy, int pbs_sd, resource_resv *rr, std::vector<nspec *> &ns_arr, unsigned int flags, schd_error *err)
 {
 	bool ret = true;
 	int pbsrc = 0; /* Return code from IFL call, 0 success, 1 failure */
@@ -1332,7 +1493,9 @@ run_job(status *policy, int pbs_sd, resource_resv *rr, std::vector<nspec *> &ns_
 				pbsrc = send_run_job(pbs_sd, rr->server->has_runjob_hook, rr->name, execvnode);
 			} else
 				pbsrc = 1;
-		} else
+		} else if (can_pipeline_run_job(rr, flags))
+			pbsrc = send_run_job_pipelined(pbs_sd, rr, execvnode);
+		else
 			pbsrc = send_run_job(pbs_sd, rr->server->has_runjob_hook, rr->name, execvnode);
 	}
 
@@ -1449,6 +1612,7 @@ resume_job(status *policy, int pbs_sd, resource_resv *rr, unsigned int flags, sc
  * @param[in]	flags	-	flags to modify procedure
  *							RURR_ADD_END_EVENT - add an end event to calendar for this job
  * 							RURR_NOPRINT - Don't print anything
+ * 							RURR_NO_PIPELINE - wait for the reply to the run request
  * @param[out]	err	-	error struct to return errors
  *
  * @retval	true	: success
@@ -1501,6 +1665,7 @@ run_update_job(status *policy, int pbs_sd, server_info *sinfo,
  * @param[in]	flags	-	flags to modify procedure
  *							RURR_ADD_END_EVENT - add an end event to calendar for this job
  * 							RURR_NOPRINT - Don't print anything
+ * 							RURR_NO_PIPELINE - wait for the reply to the run request
  * @param[out]	err	-	error struct to return errors
  *
  * @retval	true	: success
@@ -1541,7 +1706,7 @@ run_update_job(status *policy, int pbs_sd, server_info *sinfo,
 	if (!rr->nspec_arr.empty()) {
 		/* We're not using this, so free it */
 		free_nspecs(nspec_arr);
-		ret = run_job(policy, pbs_sd, rr, rr->nspec_arr, err);
+		ret = run_job(policy, pbs_sd, rr, rr->nspec_arr, flags, err);
 		if (ret) {
 			ret = update_universe_on_run(policy, pbs_sd, rr, flags);
 			if (!ret)
@@ -1549,7 +1714,7 @@ run_update_job(status *policy, int pbs_sd, server_info *sinfo,
 		}
 	} else {
 		std::sort(nspec_arr.begin(), nspec_arr.end(), cmp_nspec);
-		ret = run_job(policy, pbs_sd, rr, nspec_arr, err);
+		ret = run_job(policy, pbs_sd, rr, nspec_arr, flags, err);
 		if (!ret)
 			free_nspecs(nspec_arr);
 		else {
@@ -1703,63 +1868,189 @@ should_backfill_with_job(status *policy, server_info *sinfo, resource_resv *resr
 	return 0;
 }
 
+/*
+ * Start time estimates of likely top jobs made on the worker threads by
+ * estimate_topjobs().  They were made against the universe as it was when
+ * they were started.  The top jobs added to the calendar since then are
+ * tracked so an estimate can be revalidated before it is used.
+ */
+struct topjob_estimate {
+	time_t start;	  /* start time as returned by calc_run_time() */
+	std::string exec; /* estimated execvnode */
+};
+
+struct topjob_estimates {
+	server_info *sinfo;				       /* universe the estimates were made in */
+	bool has_limits;				       /* the universe has hard limits */
+	bool shared_res;				       /* a top job added since uses a server/queue consumable */
+	int num_added;					       /* top jobs added to the calendar since */
+	std::unordered_set<std::string> busy_hosts;	       /* hosts of those top jobs */
+	std::unordered_map<std::string, topjob_estimate> ests; /* estimates by job name */
+};
+
+static topjob_estimates topjob_ests;
+
 /**
  * @brief
- * 		Find the start time of the top job and init
- *       all the necessary variables in sinfo to correctly backfill
- *       around it.  If no start time can be found, the job is not added
- *	     to the calendar.
+ *		throw away the speculative top job start time estimates.  Called
+ *		whenever the universe changes in a way the estimates can not be
+ *		revalidated against (e.g., a job is run or preempted).
  *
- * @param[in]	policy	-	policy info
- * @param[in]	pbs_sd	-	connection descriptor to pbs server
- * @param[in]	policy	-	policy structure
- * @param[in]	sinfo	-	the server to find the topjob in
- * @param[in]	topjob	-	the job we want to backfill around
- * @param[in]	use_bucekts	use the bucket algorithm to add the job to the calendar
+ * @return	void
+ */
+void
+clear_topjob_estimates(void)
+{
+	topjob_ests.sinfo = NULL;
+	topjob_ests.has_limits = false;
+	topjob_ests.shared_res = false;
+	topjob_ests.num_added = 0;
+	topjob_ests.busy_hosts.clear();
+	topjob_ests.ests.clear();
+}
+
+/**
+ * @brief
+ *		the host a vnode is on.  Vnodes not in a host set are their own host.
  *
- * @retval	1	: success
- * @retval	0	: failure
- * @retval	-1	: error
+ * @param[in]	ninfo	-	the vnode
  *
- * @par Side-Effect:
- * 			Use caution when returning failure from this function.
- *		    It will have the effect of exiting the cycle and possibily
- *		    stalling scheduling.  It should only be done for important
- *		    reasons like jobs can't be added to the calendar.
+ * @return	std::string
  */
-int
-add_job_to_calendar(int pbs_sd, status *policy, server_info *sinfo,
-		    resource_resv *topjob, int use_buckets)
+static std::string
+topjob_host(node_info *ninfo)
+{
+	if (ninfo->hostset != NULL && ninfo->hostset->name != NULL)
+		return ninfo->hostset->name;
+
+	return ninfo->name;
+}
+
+/**
+ * @brief
+ *		does a job request a consumable resource which is limited at the
+ *		server or its queue
+ *
+ * @param[in]	sinfo	-	the server
+ * @param[in]	resresv	-	the job
+ *
+ * @return	bool
+ * @retval	true	: it does
+ * @retval	false	: it does not
+ */
+static bool
+uses_shared_consumable(server_info *sinfo, resource_resv *resresv)
+{
+	for (auto req = resresv->resreq; req != NULL; req = req->next) {
+		schd_resource *res;
+
+		if (!req->type.is_consumable)
+			continue;
+
+		res = find_resource(sinfo->res, req->def);
+		if (res != NULL && res->avail != SCHD_INFINITY_RES)
+			return true;
+
+		if (resresv->job != NULL && resresv->job->queue != NULL) {
+			res = find_resource(resresv->job->queue->qres, req->def);
+			if (res != NULL && res->avail != SCHD_INFINITY_RES)
+				return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief
+ *		simulate a copy of the universe forward until a job can run.
+ *		Only nsinfo is modified, so each thread can simulate its own copy.
+ *
+ * @param[in,out]	nsinfo	-	the copy of the universe to simulate in
+ * @param[in]	job	-	the job to estimate (in the original universe)
+ * @param[in]	use_buckets	-	use the bucket algorithm
+ * @param[out]	exec	-	the estimated execvnode
+ *
+ * @return	time_t
+ * @retval	start time of the job
+ * @retval	-1	: the job can not run
+ * @retval	0	: error
+ *
+ * @par MT-safe: Yes
+ */
+static time_t
+simulate_topjob_start(server_info *nsinfo, resource_resv *job, int use_buckets, std::string &exec)
+{
+	resource_resv *njob; /* the job in the copy of the universe */
+	std::string subjob_name;
+	time_t start_time;
+
+	if ((njob = find_resource_resv_by_indrank(nsinfo->jobs, job->resresv_ind, job->rank)) == NULL)
+		return 0;
+
+	/* A job array runs as its next subjob, which is what we backfill around.
+	 * The simulation creates it, so find out its name before it is run.
+	 */
+	if (njob->job->is_array)
+		subjob_name = create_subjob_name(njob->name, range_next_value(njob->job->queued_subjobs, -1));
+
+	if (use_buckets)
+		start_time = calc_run_time(njob->name, nsinfo, SIM_RUN_JOB | USE_BUCKETS);
+	else
+		start_time = calc_run_time(njob->name, nsinfo, SIM_RUN_JOB);
+
+	if (start_time > 0) {
+		if (njob->job->is_array) {
+			njob = find_resource_resv(nsinfo->jobs, subjob_name);
+			if (njob == NULL) {
+				log_event(PBSEVENT_DEBUG, PBS_EVENTCLASS_JOB, LOG_DEBUG, __func__,
+					  "Can't find new subjob in simulated universe");
+				return 0;
+			}
+		}
+		char *ev = create_execvnode(njob->nspec_arr);
+		if (ev == NULL)
+			return 0;
+		exec = ev;
+	}
+
+	return start_time;
+}
+
+/**
+ * @brief
+ *		estimate the start time of a top job by simulating the universe
+ *		forward in a copy of it
+ *
+ * @param[in]	sinfo	-	the server to find the topjob in
+ * @param[in]	topjob	-	the job to estimate
+ * @param[in]	use_buckets	-	use the bucket algorithm
+ * @param[out]	bjob	-	the job to backfill around.  This is either topjob
+ *				or, for a job array, a new subjob queued in sinfo.
+ * @param[out]	exec	-	the estimated execvnode.  Must be freed by the caller.
+ *
+ * @return	time_t
+ * @retval	start time of the job
+ * @retval	-1	: the job can not run
+ * @retval	0	: error
+ */
+static time_t
+estimate_topjob_start(server_info *sinfo, resource_resv *topjob, int use_buckets,
+		      resource_resv **bjob, char **exec)
 {
 	server_info *nsinfo; /* dup'd universe to simulate in */
-	resource_resv *njob; /* the topjob in the dup'd universe */
-	resource_resv *bjob; /* job pointer which becomes the topjob*/
 	resource_resv *tjob; /* temporary job pointer for job arrays */
 	time_t start_time;   /* calculated start time of topjob */
+	std::string nexec;
 
-	if (policy == NULL || sinfo == NULL ||
-	    topjob == NULL || topjob->job == NULL)
-		return 0;
+	*bjob = NULL;
+	*exec = NULL;
 
-	if (sinfo->calendar != NULL) {
-		/* if the job is in the calendar, then there is nothing to do
-		 * Note: We only ever look from now into the future
-		 */
-		auto nexte = get_next_event(sinfo->calendar);
-		if (find_timed_event(nexte, topjob->name, IGNORE_DISABLED_EVENTS, TIMED_NOEVENT, 0) != NULL)
-			return 1;
-	}
 	try {
 		nsinfo = new server_info(*sinfo);
 	} catch (std::exception &e) {
 		return 0;
 	}
 
-	if ((njob = find_resource_resv_by_indrank(nsinfo->jobs, topjob->resresv_ind, topjob->rank)) == NULL) {
-		delete nsinfo;
-		return 0;
-	}
-
 #ifdef NAS /* localmod 031 */
 	log_eventf(PBSEVENT_DEBUG2, PBS_EVENTCLASS_JOB, LOG_DEBUG,
 		   topjob->name, "Estimating the start time for a top job (q=%s schedselect=%.1000s).", topjob->job->queue->name, topjob->job->schedsel);
@@ -1767,15 +2058,10 @@ add_job_to_calendar(int pbs_sd, status *policy, server_info *sinfo,
 	log_event(PBSEVENT_DEBUG2, PBS_EVENTCLASS_JOB, LOG_DEBUG,
 		  topjob->name, "Estimating the start time for a top job.");
 #endif /* localmod 031 */
-	if (use_buckets)
-		start_time = calc_run_time(njob->name, nsinfo, SIM_RUN_JOB | USE_BUCKETS);
-	else
-		start_time = calc_run_time(njob->name, nsinfo, SIM_RUN_JOB);
+	start_time = simulate_topjob_start(nsinfo, topjob, use_buckets, nexec);
+	delete nsinfo;
 
 	if (start_time > 0) {
-		char *exec; /* used to hold execvnode for topjob */
-		char log_buf[MAX_LOG_SIZE];
-
 		/* If our top job is a job array, we don't backfill around the
 		 * parent array... rather a subjob.  Normally subjobs don't actually
 		 * exist until they are started.  In our case here, we need to create
@@ -1783,118 +2069,390 @@ add_job_to_calendar(int pbs_sd, status *policy, server_info *sinfo,
 		 */
 		if (topjob->job->is_array) {
 			tjob = queue_subjob(topjob, sinfo, topjob->job->queue);
-			if (tjob == NULL) {
-				delete nsinfo;
+			if (tjob == NULL)
 				return 0;
-			}
 
-			/* Can't search by rank, we just created tjob and it has a new rank*/
-			njob = find_resource_resv(nsinfo->jobs, tjob->name);
-			if (njob == NULL) {
-				log_event(PBSEVENT_DEBUG, PBS_EVENTCLASS_JOB, LOG_DEBUG, __func__,
-					  "Can't find new subjob in simulated universe");
-				delete nsinfo;
-				return 0;
-			}
 			/* The subjob is just for the calendar, not for running */
 			tjob->can_not_run = 1;
-			bjob = tjob;
+			*bjob = tjob;
 		} else
-			bjob = topjob;
-
-		exec = create_execvnode(njob->nspec_arr);
-		if (exec != NULL) {
-			free_nspecs(bjob->nspec_arr);
-			bjob->nspec_arr = parse_execvnode(exec, sinfo, NULL);
-			if (!bjob->nspec_arr.empty()) {
-				std::string selectspec;
-				if (bjob->ninfo_arr != NULL)
-					free(bjob->ninfo_arr);
-				bjob->ninfo_arr =
-					create_node_array_from_nspec(bjob->nspec_arr);
-				selectspec = create_select_from_nspec(bjob->nspec_arr);
-				if (!selectspec.empty()) {
-					delete bjob->execselect;
-					bjob->execselect = parse_selspec(selectspec);
-				}
-			} else {
-				delete nsinfo;
-				return 0;
-			}
-		} else {
-			delete nsinfo;
+			*bjob = topjob;
+
+		*exec = string_dup(nexec.c_str());
+		if (*exec == NULL)
 			return 0;
+	} else if (start_time == 0)
+		log_event(PBSEVENT_SCHED, PBS_EVENTCLASS_JOB, LOG_WARNING, topjob->name,
+			  "Error in calculation of start time of top job");
+
+	return start_time;
+}
+
+/**
+ * @brief
+ *		estimate the start times of a chunk of jobs.  Each job is
+ *		simulated in its own copy of the universe.
+ *
+ * @param[in,out]	data	-	the thread data of the chunk
+ *
+ * @return	void
+ */
+void
+estimate_topjob_chunk(th_data_est_topjob *data)
+{
+	for (int i = data->sidx; i <= data->eidx; i++) {
+		resource_resv *job = data->jobs[i];
+
+		data->starts[i] = simulate_topjob_start(data->nsinfos[i], job, job_should_use_buckets(job), data->execs[i]);
+	}
+}
+
+/**
+ * @brief
+ *		estimate the start times of a top job and the next jobs likely to
+ *		become top jobs in parallel on the worker threads.  Each job is
+ *		simulated in its own copy of the universe, up to one job per
+ *		thread.  Previous estimates are thrown away.
+ *
+ * @param[in]	policy	-	policy info
+ * @param[in]	sinfo	-	the server to find the jobs in
+ * @param[in]	topjob	-	the top job which needs an estimate now
+ *
+ * @return	void
+ */
+static void
+estimate_topjobs(status *policy, server_info *sinfo, resource_resv *topjob)
+{
+	std::vector<resource_resv *> cands;
+	std::vector<server_info *> nsinfos;
+	std::vector<time_t> starts;
+	std::vector<std::string> execs;
+	std::vector<void *> tdatas;
+	int num_cands;
+	int i;
+
+	clear_topjob_estimates();
+	topjob_ests.sinfo = sinfo;
+	topjob_ests.has_limits = sinfo->has_hard_limit;
+	for (auto qinfo : sinfo->queues) {
+		if (qinfo->has_hard_limit)
+			topjob_ests.has_limits = true;
+	}
+
+	/* The jobs after the top job in sorted order which would be added to
+	 * the calendar if they can't run now.  This is only a guess.  A wrong
+	 * guess only costs a thread's time.
+	 */
+	cands.push_back(topjob);
+	for (i = 0; sinfo->jobs[i] != NULL && sinfo->jobs[i] != topjob; i++)
+		;
+	if (sinfo->jobs[i] != NULL) {
+		for (i++; sinfo->jobs[i] != NULL && static_cast<int>(cands.size()) < num_threads; i++) {
+			resource_resv *job = sinfo->jobs[i];
+
+			if (job->can_not_run || !in_runnable_state(job))
+				continue;
+			if (should_backfill_with_job(policy, sinfo, job, 0) == 0)
+				continue;
+			cands.push_back(job);
 		}
+	}
 
-		if (bjob->job->est_execvnode != NULL)
-			free(bjob->job->est_execvnode);
-		bjob->job->est_execvnode = string_dup(exec);
-		bjob->job->est_start_time = start_time;
-		bjob->start = start_time;
-		bjob->end = start_time + bjob->duration;
+	/* Copying a universe uses the worker threads itself, so the copies
+	 * are made here before the simulations are handed out.
+	 */
+	for (auto job : cands) {
+		try {
+			nsinfos.push_back(new server_info(*sinfo));
+		} catch (std::exception &e) {
+			break;
+		}
+		log_event(PBSEVENT_DEBUG2, PBS_EVENTCLASS_JOB, LOG_DEBUG,
+			  job->name, "Estimating the start time for a top job in parallel.");
+	}
+	num_cands = nsinfos.size();
+	starts.assign(num_cands, 0);
+	execs.resize(num_cands);
 
-		auto te_start = create_event(TIMED_RUN_EVENT, bjob->start, bjob, NULL, NULL);
-		if (te_start == NULL) {
-			delete nsinfo;
-			return 0;
+	parallel_for(TS_EST_TOPJOB, num_cands, [&](int sidx, int eidx) {
+		th_data_est_topjob *tdata;
+
+		tdata = static_cast<th_data_est_topjob *>(malloc(sizeof(th_data_est_topjob)));
+		if (tdata == NULL) {
+			log_err(errno, __func__, MEM_ERR_MSG);
+			return static_cast<void *>(NULL);
 		}
-		add_event(sinfo->calendar, te_start);
+		tdata->nsinfos = nsinfos.data();
+		tdata->jobs = cands.data();
+		tdata->starts = starts.data();
+		tdata->execs = execs.data();
+		tdata->sidx = sidx;
+		tdata->eidx = eidx;
+		return static_cast<void *>(tdata);
+	}, tdatas);
+
+	for (auto td : tdatas)
+		free(td);
+
+	for (i = 0; i < num_cands; i++) {
+		delete nsinfos[i];
+
+		/* jobs whose simulation was not run are left to be estimated the old way */
+		if (starts[i] == 0)
+			continue;
+		topjob_ests.ests[cands[i]->name] = {starts[i], execs[i]};
+	}
+}
 
-		auto te_end = create_event(TIMED_END_EVENT, bjob->end, bjob, NULL, NULL);
-		if (te_end == NULL) {
-			delete nsinfo;
-			return 0;
+/**
+ * @brief
+ *		find a speculative start time estimate of a job and revalidate it
+ *		against the top jobs added to the calendar since it was made.
+ *		Those can only delay the job.  If none of them landed on a host
+ *		of the estimated placement, the estimated start time is still the
+ *		earliest one.  Hosts are compared rather than vnodes since
+ *		host level resources and exclhost placement span all of a host's
+ *		vnodes.
+ *
+ * @param[in]	sinfo	-	the server the job is in
+ * @param[in]	topjob	-	the job
+ *
+ * @return	topjob_estimate *
+ * @retval	the estimate
+ * @retval	NULL	: no estimate or it could conflict
+ */
+static topjob_estimate *
+find_topjob_estimate(server_info *sinfo, resource_resv *topjob)
+{
+	std::vector<nspec *> ns_arr;
+	bool conflict = false;
+
+	if (topjob_ests.sinfo != sinfo)
+		return NULL;
+
+	auto it = topjob_ests.ests.find(topjob->name);
+	if (it == topjob_ests.ests.end())
+		return NULL;
+	auto &est = it->second;
+
+	/* A job which can't run in the old universe can't run in this one */
+	if (topjob_ests.num_added == 0 || est.start < 0)
+		return &est;
+
+	if (topjob_ests.has_limits)
+		return NULL;
+	if (topjob_ests.shared_res && uses_shared_consumable(sinfo, topjob))
+		return NULL;
+
+	ns_arr = parse_execvnode(const_cast<char *>(est.exec.c_str()), sinfo, NULL);
+	if (ns_arr.empty())
+		return NULL;
+	for (auto ns : ns_arr) {
+		if (topjob_ests.busy_hosts.find(topjob_host(ns->ninfo)) != topjob_ests.busy_hosts.end()) {
+			conflict = true;
+			break;
 		}
-		add_event(sinfo->calendar, te_end);
+	}
+	free_nspecs(ns_arr);
+
+	return conflict ? NULL : &est;
+}
 
-		if (update_estimated_attrs(pbs_sd, bjob, bjob->job->est_start_time,
-					   bjob->job->est_execvnode, 0) < 0) {
-			log_event(PBSEVENT_SCHED, PBS_EVENTCLASS_SCHED, LOG_WARNING,
-				  bjob->name, "Failed to update estimated attrs.");
+/**
+ * @brief
+ *		add a top job to the calendar at its estimated start time and
+ *		update sinfo to correctly backfill around it
+ *
+ * @param[in]	pbs_sd	-	connection descriptor to pbs server
+ * @param[in]	policy	-	policy structure
+ * @param[in]	sinfo	-	the server the job is in
+ * @param[in]	bjob	-	the job to backfill around
+ * @param[in]	start_time	-	estimated start time of the job
+ * @param[in]	exec	-	estimated execvnode of the job
+ *
+ * @retval	1	: success
+ * @retval	0	: failure
+ */
+static int
+commit_topjob(int pbs_sd, status *policy, server_info *sinfo, resource_resv *bjob,
+	      time_t start_time, char *exec)
+{
+	char log_buf[MAX_LOG_SIZE];
+
+	free_nspecs(bjob->nspec_arr);
+	bjob->nspec_arr = parse_execvnode(exec, sinfo, NULL);
+	if (!bjob->nspec_arr.empty()) {
+		std::string selectspec;
+		if (bjob->ninfo_arr != NULL)
+			free(bjob->ninfo_arr);
+		bjob->ninfo_arr =
+			create_node_array_from_nspec(bjob->nspec_arr);
+		selectspec = create_select_from_nspec(bjob->nspec_arr);
+		if (!selectspec.empty()) {
+			bjob->execselect.reset(parse_selspec(selectspec));
 		}
+	} else
+		return 0;
 
-		for (auto ns : bjob->nspec_arr) {
-			int ind = ns->ninfo->node_ind;
-			add_te_list(&(ns->ninfo->node_events), te_start);
+	if (bjob->job->est_execvnode != NULL)
+		free(bjob->job->est_execvnode);
+	bjob->job->est_execvnode = string_dup(exec);
+	bjob->job->est_start_time = start_time;
+	bjob->start = start_time;
+	bjob->end = start_time + bjob->duration;
 
-			if (ind != -1 && sinfo->unordered_nodes[ind]->bucket_ind != -1) {
-				node_bucket *bkt;
+	auto te_start = create_event(TIMED_RUN_EVENT, bjob->start, bjob, NULL, NULL);
+	if (te_start == NULL)
+		return 0;
+	add_event(sinfo->calendar, te_start);
 
-				bkt = sinfo->buckets[sinfo->unordered_nodes[ind]->bucket_ind];
-				if (pbs_bitmap_get_bit(bkt->free_pool->truth, ind)) {
-					pbs_bitmap_bit_off(bkt->free_pool->truth, ind);
-					bkt->free_pool->truth_ct--;
-					pbs_bitmap_bit_on(bkt->busy_later_pool->truth, ind);
-					bkt->busy_later_pool->truth_ct++;
-				}
+	auto te_end = create_event(TIMED_END_EVENT, bjob->end, bjob, NULL, NULL);
+	if (te_end == NULL)
+		return 0;
+	add_event(sinfo->calendar, te_end);
+
+	if (update_estimated_attrs(pbs_sd, bjob, bjob->job->est_start_time,
+				   bjob->job->est_execvnode, 0) < 0) {
+		log_event(PBSEVENT_SCHED, PBS_EVENTCLASS_SCHED, LOG_WARNING,
+			  bjob->name, "Failed to update estimated attrs.");
+	}
+
+	for (auto ns : bjob->nspec_arr) {
+		int ind = ns->ninfo->node_ind;
+		add_te_list(&(ns->ninfo->node_events), te_start);
+
+		if (ind != -1 && sinfo->unordered_nodes[ind]->bucket_ind != -1) {
+			node_bucket *bkt;
+
+			bkt = sinfo->buckets[sinfo->unordered_nodes[ind]->bucket_ind];
+			if (pbs_bitmap_get_bit(bkt->free_pool->truth, ind)) {
+				pbs_bitmap_bit_off(bkt->free_pool->truth, ind);
+				bkt->free_pool->truth_ct--;
+				pbs_bitmap_bit_on(bkt->busy_later_pool->truth, ind);
+				bkt->busy_later_pool->truth_ct++;
 			}
 		}
+	}
 
-		if (policy->fair_share) {
-			/* update the fairshare usage of this job.  This only modifies the
-			 * temporary usage used for this cycle.  Updating this will help the
-			 * problem of backfilling other jobs which will affect the fairshare
-			 * priority of the top job.  If the priority changes too much
-			 * before it is run, the current top job may change in subsequent
-			 * cycles
-			 */
-			update_usage_on_run(bjob);
-			log_eventf(PBSEVENT_DEBUG, PBS_EVENTCLASS_JOB, LOG_DEBUG, bjob->name,
-				   "Fairshare usage of entity %s increased due to job becoming a top job.", bjob->job->ginfo->name.c_str());
-		}
+	if (policy->fair_share) {
+		/* update the fairshare usage of this job.  This only modifies the
+		 * temporary usage used for this cycle.  Updating this will help the
+		 * problem of backfilling other jobs which will affect the fairshare
+		 * priority of the top job.  If the priority changes too much
+		 * before it is run, the current top job may change in subsequent
+		 * cycles
+		 */
+		update_usage_on_run(bjob);
+		log_eventf(PBSEVENT_DEBUG, PBS_EVENTCLASS_JOB, LOG_DEBUG, bjob->name,
+			   "Fairshare usage of entity %s increased due to job becoming a top job.", bjob->job->ginfo->name.c_str());
+	}
 
-		sprintf(log_buf, "Job is a top job and will run at %s",
-			ctime(&bjob->start));
+	sprintf(log_buf, "Job is a top job and will run at %s",
+		ctime(&bjob->start));
 
-		log_buf[strlen(log_buf) - 1] = '\0'; /* ctime adds a \n */
-		log_event(PBSEVENT_DEBUG, PBS_EVENTCLASS_JOB, LOG_DEBUG, bjob->name, log_buf);
-	} else if (start_time == 0) {
-		log_event(PBSEVENT_SCHED, PBS_EVENTCLASS_JOB, LOG_WARNING, topjob->name,
-			  "Error in calculation of start time of top job");
-		delete nsinfo;
+	log_buf[strlen(log_buf) - 1] = '\0'; /* ctime adds a \n */
+	log_event(PBSEVENT_DEBUG, PBS_EVENTCLASS_JOB, LOG_DEBUG, bjob->name, log_buf);
+
+	/* Estimates made before this job was added must now avoid it */
+	if (topjob_ests.sinfo == sinfo) {
+		topjob_ests.num_added++;
+		for (auto ns : bjob->nspec_arr)
+			topjob_ests.busy_hosts.insert(topjob_host(ns->ninfo));
+		if (uses_shared_consumable(sinfo, bjob))
+			topjob_ests.shared_res = true;
+	}
+
+	return 1;
+}
+
+/**
+ * @brief
+ * 		Find the start time of the top job and init
+ *       all the necessary variables in sinfo to correctly backfill
+ *       around it.  If no start time can be found, the job is not added
+ *	     to the calendar.
+ *
+ * @par	If parallel_topjob_estimation is set, the start time comes from an
+ *	estimate made in parallel by estimate_topjobs() if one is still valid.
+ *
+ * @param[in]	policy	-	policy info
+ * @param[in]	pbs_sd	-	connection descriptor to pbs server
+ * @param[in]	policy	-	policy structure
+ * @param[in]	sinfo	-	the server to find the topjob in
+ * @param[in]	topjob	-	the job we want to backfill around
+ * @param[in]	use_bucekts	use the bucket algorithm to add the job to the calendar
+ *
+ * @retval	1	: success
+ * @retval	0	: failure
+ * @retval	-1	: error
+ *
+ * @par Side-Effect:
+ * 			Use caution when returning failure from this function.
+ *		    It will have the effect of exiting the cycle and possibily
+ *		    stalling scheduling.  It should only be done for important
+ *		    reasons like jobs can't be added to the calendar.
+ */
+int
+add_job_to_calendar(int pbs_sd, status *policy, server_info *sinfo,
+		    resource_resv *topjob, int use_buckets)
+{
+	phase_timer timer(PHASE_CALENDAR);
+	resource_resv *bjob = NULL; /* job pointer which becomes the topjob*/
+	char *exec = NULL;	    /* used to hold execvnode for topjob */
+	time_t start_time = 0;	    /* calculated start time of topjob */
+	topjob_estimate *est = NULL;
+	int rc;
+
+	if (policy == NULL || sinfo == NULL ||
+	    topjob == NULL || topjob->job == NULL)
 		return 0;
+
+	/* estimate against a universe with no run requests in flight */
+	reap_run_job_replies(0);
+
+	if (sinfo->calendar != NULL) {
+		/* if the job is in the calendar, then there is nothing to do
+		 * Note: We only ever look from now into the future
+		 */
+		auto nexte = get_next_event(sinfo->calendar);
+		if (nexte != NULL &&
+		    find_timed_event(sinfo->calendar, nexte, topjob->name, IGNORE_DISABLED_EVENTS, TIMED_NOEVENT, 0) != NULL)
+			return 1;
 	}
-	delete nsinfo;
+
+	if (conf.parallel_topjob_estimation && num_threads > 1) {
+		est = find_topjob_estimate(sinfo, topjob);
+		if (est == NULL) {
+			estimate_topjobs(policy, sinfo, topjob);
+			est = find_topjob_estimate(sinfo, topjob);
+		}
+	}
+
+	if (est != NULL) {
+		start_time = est->start;
+		if (start_time > 0) {
+			/* see estimate_topjob_start() for why we queue a subjob */
+			if (topjob->job->is_array) {
+				bjob = queue_subjob(topjob, sinfo, topjob->job->queue);
+				if (bjob == NULL)
+					return 0;
+				bjob->can_not_run = 1;
+			} else
+				bjob = topjob;
+			exec = string_dup(est->exec.c_str());
+		}
+		topjob_ests.ests.erase(topjob->name);
+		if (start_time > 0 && exec == NULL)
+			return 0;
+	} else
+		start_time = estimate_topjob_start(sinfo, topjob, use_buckets, &bjob, &exec);
+
+	if (start_time > 0) {
+		rc = commit_topjob(pbs_sd, policy, sinfo, bjob, start_time, exec);
+		free(exec);
+		return rc;
+	} else if (start_time == 0)
+		return 0;
 
 	return 1;
 }
@@ -2426,7 +2984,8 @@ parse_sched_obj(int connector, struct batch_status *status)
 		attrp = attrp->next;
 	}
 
-	if (!dflt_sched) {
+	/* a replay runs in a copy of sched_priv and has no server to tell */
+	if (!dflt_sched && !snapshot_replaying()) {
 		int err;
 		int priv_dir_update_fail = 0;
 		int validate_log_dir = 0;
@@ -2624,7 +3183,7 @@ set_validate_sched_attrs(int connector)
 	struct batch_status *ss = NULL;
 	struct batch_status *all_ss = NULL;
 
-	if (connector < 0)
+	if (connector < 0 && !snapshot_replaying())
 		return 0;
 
 	/* Stat the scheduler to get details of sched */
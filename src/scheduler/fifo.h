@@ -184,6 +184,18 @@ void end_cycle_tasks(server_info *sinfo);
  */
 int add_job_to_calendar(int pbs_sd, status *policy, server_info *sinfo, resource_resv *topjob, int use_buckets);
 
+/*
+ *	clear_topjob_estimates - throw away the speculative top job start
+ *		time estimates made for parallel_topjob_estimation
+ */
+void clear_topjob_estimates(void);
+
+/*
+ *	estimate_topjob_chunk - estimate the start times of a chunk of likely
+ *		top jobs, each in its own copy of the universe
+ */
+void estimate_topjob_chunk(th_data_est_topjob *data);
+
 /*
  * 	run_job - handle the running of a pbs job.  If it's a peer job
  *	       first move it to the local server and then run it.
@@ -243,6 +255,15 @@ int validate_running_user(char *exename);
 
 int send_run_job(int virtual_sd, int has_runjob_hook, const std::string &jobid, char *execvnode);
 
+/* send a run request without waiting for its reply (see run_job_window) */
+int send_run_job_pipelined(int virtual_sd, resource_resv *rr, char *execvnode);
+
+/* read replies of pipelined run requests until at most max_pending are left */
+void reap_run_job_replies(size_t max_pending);
+
+/* undo the run of a job whose pipelined run request was rejected */
+void undo_run_job(int pbs_sd, resource_resv *rr, bool array_queued, time_t time_preempted, int pbsrc, const char *errbuf);
+
 struct batch_status *send_statsched(int virtual_fd, struct attrl *attrib, char *extend);
 
 #endif /* _FIFO_H */
@@ -0,0 +1,1005 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+/**
+ * @file    formula.cpp
+ *
+ * @brief
+ * 		formula.cpp - native evaluation of job_sort_formula.
+ *
+ * @par	A formula is compiled once into a small stack program over the job's
+ *	consumable resources and the formula keywords.  The compiler only
+ *	accepts the arithmetic subset of Python: numbers, names, parentheses,
+ *	unary + and -, and + - * / // % **.  The program computes what the
+ *	Python interpreter would, including the rounding the values get when
+ *	they are printed into the Python globals.  Anything else is left to
+ *	the Python interpreter (see formula_evaluate()).
+ *
+ * @par	Values which Python sees as ints (integer literals, whole resource
+ *	amounts, and the integer keywords) are kept as 64 bit integers until
+ *	they meet a float, so int arithmetic is exact like Python's.  Python
+ *	ints have no size limit.  When an int would not fit in 64 bits, the
+ *	evaluation gives up and the job is evaluated by Python instead.
+ *
+ * Functions included are:
+ * 	get_compiled_formula()
+ * 	eval_compiled_formula()
+ * 	clear_formula_cache()
+ * 	eval_formula_chunk()
+ * 	eval_formula_array()
+ *
+ */
+#include <pbs_config.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <libutil.h>
+#include <log.h>
+#include <pbs_share.h>
+
+#include "data_types.h"
+#include "formula.h"
+#include "globals.h"
+#include "job_info.h"
+#include "misc.h"
+#include "multi_threading.h"
+#include "resource.h"
+#include "resource_resv.h"
+
+/* deepest stack (and nesting) a compiled formula may use */
+#define FORMULA_MAX_DEPTH 64
+
+enum formula_op {
+	FOP_CONST,    /* push a number */
+	FOP_RES,      /* push a consumable resource of the job */
+	FOP_VAR,      /* push a formula keyword of the job */
+	FOP_NEG,
+	FOP_ADD,
+	FOP_SUB,
+	FOP_MUL,
+	FOP_DIV,
+	FOP_FLOORDIV,
+	FOP_MOD,
+	FOP_POW
+};
+
+enum formula_var {
+	FVAR_ELIGIBLE_TIME,
+	FVAR_QUEUE_PRIO,
+	FVAR_JOB_PRIO,
+	FVAR_FSPERC,
+	FVAR_TREE_USAGE,
+	FVAR_FSFACTOR,
+	FVAR_ACCRUE_TYPE
+};
+
+struct formula_insn {
+	enum formula_op op;
+	double val;	       /* FOP_CONST */
+	resdef *def;	       /* FOP_RES */
+	enum formula_var var;  /* FOP_VAR */
+	bool is_int;	       /* FOP_CONST is an integer literal */
+	long long ival;	       /* FOP_CONST if is_int */
+};
+
+/* a value on the evaluation stack: a Python int or float */
+struct formula_val {
+	bool is_int;
+	long long i; /* if is_int */
+	double d;    /* if not is_int */
+};
+
+class compiled_formula
+{
+	public:
+	std::vector<formula_insn> code;
+};
+
+/* recursive descent parser of the formula into a compiled_formula */
+struct formula_parser {
+	const char *p;		/* current position */
+	int depth;		/* stack depth at the current position */
+	int max_depth;
+	int nesting;		/* nesting of the current expression */
+	std::string err;	/* why the formula was rejected */
+	compiled_formula *cf;
+};
+
+static bool parse_formula_expr(formula_parser &fp);
+
+/**
+ * @brief	skip white space in the formula
+ *
+ * @param[in,out]	fp - the parser
+ *
+ * @return	the next character
+ */
+static char
+formula_peek(formula_parser &fp)
+{
+	while (*fp.p == ' ' || *fp.p == '\t')
+		fp.p++;
+	return *fp.p;
+}
+
+/**
+ * @brief	add an instruction and track the stack depth
+ *
+ * @param[in,out]	fp - the parser
+ * @param[in]	insn - instruction to add
+ * @param[in]	delta - how the instruction changes the stack depth
+ *
+ * @return	bool
+ * @retval	true	: success
+ * @retval	false	: the formula is too deep
+ */
+static bool
+formula_emit(formula_parser &fp, const formula_insn &insn, int delta)
+{
+	fp.cf->code.push_back(insn);
+	fp.depth += delta;
+	if (fp.depth > fp.max_depth)
+		fp.max_depth = fp.depth;
+	if (fp.max_depth > FORMULA_MAX_DEPTH) {
+		fp.err = "formula is too deep";
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief	parse a number.  Only plain decimal integers and floats are
+ *		accepted.
+ *
+ * @param[in,out]	fp - the parser
+ *
+ * @return	bool
+ * @retval	true	: success
+ * @retval	false	: rejected
+ */
+static bool
+parse_formula_number(formula_parser &fp)
+{
+	const char *start = fp.p;
+	const char *s = fp.p;
+	bool is_int = true;
+	formula_insn insn = {FOP_CONST, 0, NULL, FVAR_ELIGIBLE_TIME, false, 0};
+	char *endp;
+
+	while (isdigit(*s))
+		s++;
+	if (*s == '.') {
+		is_int = false;
+		s++;
+		while (isdigit(*s))
+			s++;
+	}
+	if (*s == 'e' || *s == 'E') {
+		is_int = false;
+		s++;
+		if (*s == '+' || *s == '-')
+			s++;
+		if (!isdigit(*s)) {
+			fp.err = "bad number";
+			return false;
+		}
+		while (isdigit(*s))
+			s++;
+	}
+	/* Python rejects 01, and things like 1j or 0x1 are not handled */
+	if (isalnum(*s) || *s == '_' || *s == '.' || (s - start == 1 && *start == '.')) {
+		fp.err = "unsupported number";
+		return false;
+	}
+	if (is_int && *start == '0' && strspn(start, "0") != static_cast<size_t>(s - start)) {
+		fp.err = "unsupported number";
+		return false;
+	}
+
+	insn.val = strtod(start, &endp);
+	if (endp != s) {
+		fp.err = "bad number";
+		return false;
+	}
+	if (is_int) {
+		errno = 0;
+		insn.ival = strtoll(start, &endp, 10);
+		if (errno == ERANGE) {
+			fp.err = "integer is too large";
+			return false;
+		}
+		insn.is_int = true;
+	}
+	fp.p = s;
+	return formula_emit(fp, insn, 1);
+}
+
+/**
+ * @brief	parse a name: a formula keyword or a consumable resource
+ *
+ * @param[in,out]	fp - the parser
+ *
+ * @return	bool
+ * @retval	true	: success
+ * @retval	false	: rejected
+ */
+static bool
+parse_formula_name(formula_parser &fp)
+{
+	static const std::unordered_map<std::string, formula_var> keywords = {
+		{FORMULA_ELIGIBLE_TIME, FVAR_ELIGIBLE_TIME},
+		{FORMULA_QUEUE_PRIO, FVAR_QUEUE_PRIO},
+		{FORMULA_JOB_PRIO, FVAR_JOB_PRIO},
+		{FORMULA_FSPERC, FVAR_FSPERC},
+		{FORMULA_FSPERC_DEP, FVAR_FSPERC},
+		{FORMULA_TREE_USAGE, FVAR_TREE_USAGE},
+		{FORMULA_FSFACTOR, FVAR_FSFACTOR},
+		{FORMULA_ACCRUE_TYPE, FVAR_ACCRUE_TYPE}};
+	const char *s = fp.p;
+	formula_insn insn = {FOP_VAR, 0, NULL, FVAR_ELIGIBLE_TIME, false, 0};
+
+	while (isalnum(*s) || *s == '_')
+		s++;
+	std::string name(fp.p, s - fp.p);
+	fp.p = s;
+
+	/* the keywords come after the resources in the Python globals */
+	auto kw = keywords.find(name);
+	if (kw != keywords.end()) {
+		insn.var = kw->second;
+		return formula_emit(fp, insn, 1);
+	}
+
+	auto def = find_resdef(name);
+	if (def != NULL && consres.find(def) != consres.end()) {
+		insn.op = FOP_RES;
+		insn.def = def;
+		return formula_emit(fp, insn, 1);
+	}
+
+	fp.err = "unknown name " + name;
+	return false;
+}
+
+/**
+ * @brief	parse an atom: a number, a name, or an expression in parentheses
+ *
+ * @param[in,out]	fp - the parser
+ *
+ * @return	bool
+ * @retval	true	: success
+ * @retval	false	: rejected
+ */
+static bool
+parse_formula_atom(formula_parser &fp)
+{
+	char c = formula_peek(fp);
+
+	if (isdigit(c) || c == '.')
+		return parse_formula_number(fp);
+	if (isalpha(c) || c == '_')
+		return parse_formula_name(fp);
+	if (c == '(') {
+		fp.p++;
+		if (++fp.nesting > FORMULA_MAX_DEPTH) {
+			fp.err = "formula is too deep";
+			return false;
+		}
+		if (!parse_formula_expr(fp))
+			return false;
+		fp.nesting--;
+		if (formula_peek(fp) != ')') {
+			fp.err = "expected )";
+			return false;
+		}
+		fp.p++;
+		return true;
+	}
+
+	fp.err = std::string("unexpected character '") + c + "'";
+	return false;
+}
+
+/**
+ * @brief	parse a factor: unary + and - bind looser than ** on their
+ *		right, but ** binds its right operand as a factor (e.g., -2**-1)
+ *
+ * @param[in,out]	fp - the parser
+ *
+ * @return	bool
+ * @retval	true	: success
+ * @retval	false	: rejected
+ */
+static bool
+parse_formula_factor(formula_parser &fp)
+{
+	formula_insn insn = {FOP_NEG, 0, NULL, FVAR_ELIGIBLE_TIME, false, 0};
+	char c = formula_peek(fp);
+
+	if (c == '+' || c == '-') {
+		fp.p++;
+		if (++fp.nesting > FORMULA_MAX_DEPTH) {
+			fp.err = "formula is too deep";
+			return false;
+		}
+		if (!parse_formula_factor(fp))
+			return false;
+		fp.nesting--;
+		if (c == '-')
+			return formula_emit(fp, insn, 0);
+		return true;
+	}
+
+	if (!parse_formula_atom(fp))
+		return false;
+
+	if (formula_peek(fp) == '*' && fp.p[1] == '*') {
+		fp.p += 2;
+		if (++fp.nesting > FORMULA_MAX_DEPTH) {
+			fp.err = "formula is too deep";
+			return false;
+		}
+		if (!parse_formula_factor(fp))
+			return false;
+		fp.nesting--;
+		insn.op = FOP_POW;
+		return formula_emit(fp, insn, -1);
+	}
+	return true;
+}
+
+/**
+ * @brief	parse a term: factors joined by * / // and %
+ *
+ * @param[in,out]	fp - the parser
+ *
+ * @return	bool
+ * @retval	true	: success
+ * @retval	false	: rejected
+ */
+static bool
+parse_formula_term(formula_parser &fp)
+{
+	formula_insn insn = {FOP_MUL, 0, NULL, FVAR_ELIGIBLE_TIME, false, 0};
+
+	if (!parse_formula_factor(fp))
+		return false;
+
+	while (true) {
+		char c = formula_peek(fp);
+
+		if (c == '*' && fp.p[1] != '*') {
+			insn.op = FOP_MUL;
+			fp.p++;
+		} else if (c == '/' && fp.p[1] == '/') {
+			insn.op = FOP_FLOORDIV;
+			fp.p += 2;
+		} else if (c == '/') {
+			insn.op = FOP_DIV;
+			fp.p++;
+		} else if (c == '%') {
+			insn.op = FOP_MOD;
+			fp.p++;
+		} else
+			return true;
+
+		if (!parse_formula_factor(fp))
+			return false;
+		if (!formula_emit(fp, insn, -1))
+			return false;
+	}
+}
+
+/**
+ * @brief	parse an expression: terms joined by + and -
+ *
+ * @param[in,out]	fp - the parser
+ *
+ * @return	bool
+ * @retval	true	: success
+ * @retval	false	: rejected
+ */
+static bool
+parse_formula_expr(formula_parser &fp)
+{
+	formula_insn insn = {FOP_ADD, 0, NULL, FVAR_ELIGIBLE_TIME, false, 0};
+
+	if (!parse_formula_term(fp))
+		return false;
+
+	while (true) {
+		char c = formula_peek(fp);
+
+		if (c == '+')
+			insn.op = FOP_ADD;
+		else if (c == '-')
+			insn.op = FOP_SUB;
+		else
+			return true;
+		fp.p++;
+
+		if (!parse_formula_term(fp))
+			return false;
+		if (!formula_emit(fp, insn, -1))
+			return false;
+	}
+}
+
+/**
+ * @brief	compile a formula
+ *
+ * @param[in]	formula - the formula
+ * @param[out]	errmsg - why the formula was rejected
+ *
+ * @return	compiled_formula *
+ * @retval	the compiled formula
+ * @retval	NULL	: the formula can't be compiled
+ */
+static compiled_formula *
+compile_formula(const char *formula, std::string &errmsg)
+{
+	formula_parser fp;
+
+	fp.p = formula;
+	fp.depth = 0;
+	fp.max_depth = 0;
+	fp.nesting = 0;
+	fp.cf = new compiled_formula();
+
+	if (parse_formula_expr(fp) && formula_peek(fp) != '\0')
+		fp.err = std::string("unexpected character '") + *fp.p + "'";
+
+	if (!fp.err.empty()) {
+		errmsg = fp.err;
+		delete fp.cf;
+		return NULL;
+	}
+
+	return fp.cf;
+}
+
+/* compiled formulas by their text.  A NULL entry couldn't be compiled */
+static std::unordered_map<std::string, std::shared_ptr<compiled_formula>> formula_cache;
+static pthread_mutex_t formula_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief	compile a formula or reuse it from the formula cache.  A
+ *		formula is only compiled the first time it is seen.
+ *
+ * @param[in]	formula - the formula
+ *
+ * @return	std::shared_ptr<compiled_formula>
+ * @retval	the compiled formula
+ * @retval	nullptr	: the formula can't be compiled
+ *
+ * @par MT-safe: Yes
+ */
+std::shared_ptr<compiled_formula>
+get_compiled_formula(const char *formula)
+{
+	std::shared_ptr<compiled_formula> cf;
+	std::string errmsg;
+
+	if (formula == NULL)
+		return nullptr;
+
+	pthread_mutex_lock(&formula_cache_lock);
+	auto it = formula_cache.find(formula);
+	if (it != formula_cache.end()) {
+		cf = it->second;
+		pthread_mutex_unlock(&formula_cache_lock);
+		return cf;
+	}
+
+	cf.reset(compile_formula(formula, errmsg));
+	formula_cache[formula] = cf;
+	pthread_mutex_unlock(&formula_cache_lock);
+
+	if (cf == nullptr)
+		log_eventf(PBSEVENT_DEBUG, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+			   "Formula will be evaluated by Python (%s): %.1000s", errmsg.c_str(), formula);
+
+	return cf;
+}
+
+/**
+ * @brief	empty the formula cache.  Compiled formulas point at resource
+ *		definitions, so this must be called when those are replaced.
+ *
+ * @return	void
+ */
+void
+clear_formula_cache(void)
+{
+	pthread_mutex_lock(&formula_cache_lock);
+	formula_cache.clear();
+	pthread_mutex_unlock(&formula_cache_lock);
+}
+
+/**
+ * @brief	round a value the way printing it with %.*f and reading it back
+ *		does.  This is how values reach the Python interpreter.
+ *
+ * @param[in]	val - the value
+ * @param[in]	digits - digits after the decimal point
+ *
+ * @return	double
+ */
+static double
+printed_value(double val, int digits)
+{
+	static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6};
+	char buf[512];
+
+	if (val == trunc(val) && fabs(val) < 9007199254740992.0)
+		return val;
+
+	if (digits >= 0 && digits <= 6) {
+		double scaled = val * pow10[digits];
+
+		/* away from a tie, rounding the scaled value is exact */
+		if (fabs(scaled) < 4503599627370496.0) {
+			double fl = floor(scaled);
+			double frac = scaled - fl;
+			if (fabs(frac - 0.5) > 1e-6)
+				return (frac < 0.5 ? fl : fl + 1) / pow10[digits];
+		}
+	}
+
+	snprintf(buf, sizeof(buf), "%.*f", digits, val);
+	return strtod(buf, NULL);
+}
+
+/**
+ * @brief	a stack value as a float, the way Python converts an int
+ *
+ * @param[in]	v - the value
+ *
+ * @return	double
+ */
+static double
+formula_val_double(const formula_val &v)
+{
+	return v.is_int ? static_cast<double>(v.i) : v.d;
+}
+
+/**
+ * @brief	apply a binary operator to two floats like Python does
+ *
+ * @param[in]	op - the operator
+ * @param[in]	a - left operand
+ * @param[in]	b - right operand
+ * @param[out]	r - the result
+ * @param[out]	errmsg - the error Python would raise
+ *
+ * @return	enum formula_eval_result
+ */
+static enum formula_eval_result
+formula_float_op(enum formula_op op, double a, double b, formula_val &r, std::string &errmsg)
+{
+	double mod;
+	double div;
+
+	r.is_int = false;
+	switch (op) {
+		case FOP_ADD:
+			r.d = a + b;
+			break;
+		case FOP_SUB:
+			r.d = a - b;
+			break;
+		case FOP_MUL:
+			r.d = a * b;
+			break;
+		case FOP_DIV:
+			if (b == 0) {
+				errmsg = "float division by zero";
+				return FORMULA_EVAL_ERR;
+			}
+			r.d = a / b;
+			break;
+		case FOP_FLOORDIV:
+		case FOP_MOD:
+			if (b == 0) {
+				errmsg = op == FOP_MOD ? "float modulo" : "float floor division by zero";
+				return FORMULA_EVAL_ERR;
+			}
+			/* Python's float divmod(), e.g., 1 // 0.1 is 9.0 not 10.0 */
+			mod = fmod(a, b);
+			div = (a - mod) / b;
+			if (mod != 0) {
+				/* the result has the sign of the divisor */
+				if ((b < 0) != (mod < 0)) {
+					mod += b;
+					div -= 1.0;
+				}
+			} else
+				mod = copysign(0.0, b);
+			if (op == FOP_MOD)
+				r.d = mod;
+			else if (div != 0) {
+				r.d = floor(div);
+				if (div - r.d > 0.5)
+					r.d += 1.0;
+			} else
+				r.d = copysign(0.0, a / b);
+			break;
+		case FOP_POW:
+			if (a == 0 && b < 0) {
+				errmsg = "0.0 cannot be raised to a negative power";
+				return FORMULA_EVAL_ERR;
+			}
+			/* Python makes this a complex number */
+			if (a < 0 && b != floor(b))
+				return FORMULA_EVAL_PYTHON;
+			r.d = pow(a, b);
+			if (isinf(r.d) && !isinf(a) && !isinf(b)) {
+				errmsg = "Numerical result out of range";
+				return FORMULA_EVAL_ERR;
+			}
+			break;
+		default:
+			r.d = 0;
+	}
+	return FORMULA_EVAL_OK;
+}
+
+/**
+ * @brief	apply a binary operator to two ints like Python does
+ *
+ * @param[in]	op - the operator
+ * @param[in]	a - left operand
+ * @param[in]	b - right operand
+ * @param[out]	r - the result
+ * @param[out]	errmsg - the error Python would raise
+ *
+ * @return	enum formula_eval_result
+ * @retval	FORMULA_EVAL_PYTHON	: the result does not fit in 64 bits
+ */
+static enum formula_eval_result
+formula_int_op(enum formula_op op, long long a, long long b, formula_val &r, std::string &errmsg)
+{
+	/* doubles hold the ints up to this exactly */
+	const long long max_exact = 1LL << 53;
+	long long q;
+	long long m;
+
+	r.is_int = true;
+	switch (op) {
+		case FOP_ADD:
+			if (__builtin_add_overflow(a, b, &r.i))
+				return FORMULA_EVAL_PYTHON;
+			break;
+		case FOP_SUB:
+			if (__builtin_sub_overflow(a, b, &r.i))
+				return FORMULA_EVAL_PYTHON;
+			break;
+		case FOP_MUL:
+			if (__builtin_mul_overflow(a, b, &r.i))
+				return FORMULA_EVAL_PYTHON;
+			break;
+		case FOP_DIV:
+			if (b == 0) {
+				errmsg = "division by zero";
+				return FORMULA_EVAL_ERR;
+			}
+			/* Python rounds the quotient of the ints once.  Dividing
+			 * their doubles only does that while they are exact.
+			 */
+			if (a > max_exact || a < -max_exact || b > max_exact || b < -max_exact)
+				return FORMULA_EVAL_PYTHON;
+			r.is_int = false;
+			r.d = static_cast<double>(a) / static_cast<double>(b);
+			break;
+		case FOP_FLOORDIV:
+		case FOP_MOD:
+			if (b == 0) {
+				errmsg = "integer division or modulo by zero";
+				return FORMULA_EVAL_ERR;
+			}
+			if (b == -1) {
+				if (op == FOP_MOD)
+					r.i = 0;
+				else if (__builtin_sub_overflow(0LL, a, &r.i))
+					return FORMULA_EVAL_PYTHON;
+				break;
+			}
+			/* C truncates, Python floors */
+			q = a / b;
+			m = a % b;
+			if (m != 0 && ((m < 0) != (b < 0))) {
+				q--;
+				m += b;
+			}
+			r.i = op == FOP_MOD ? m : q;
+			break;
+		case FOP_POW:
+			/* a negative power of an int is a float */
+			if (b < 0)
+				return formula_float_op(op, static_cast<double>(a), static_cast<double>(b), r, errmsg);
+			r.i = 1;
+			while (b > 0) {
+				if ((b & 1) && __builtin_mul_overflow(r.i, a, &r.i))
+					return FORMULA_EVAL_PYTHON;
+				b >>= 1;
+				if (b > 0 && __builtin_mul_overflow(a, a, &a))
+					return FORMULA_EVAL_PYTHON;
+			}
+			break;
+		default:
+			r.i = 0;
+	}
+	return FORMULA_EVAL_OK;
+}
+
+/**
+ * @brief	evaluate a compiled formula for a job
+ *
+ * @param[in]	cf - the compiled formula
+ * @param[in]	resresv - job for the formula keywords
+ * @param[in]	resreq - resources to use when evaluating
+ * @param[out]	ans - the answer
+ * @param[out]	errmsg - the error if the evaluation failed (e.g., division by zero)
+ *
+ * @return	enum formula_eval_result
+ * @retval	FORMULA_EVAL_OK	: success
+ * @retval	FORMULA_EVAL_ERR	: error, *ans is 0
+ * @retval	FORMULA_EVAL_PYTHON	: an int outgrew 64 bits, the job needs
+ *					  to be evaluated by Python.  *ans is 0.
+ *
+ * @par MT-safe: Yes
+ */
+enum formula_eval_result
+eval_compiled_formula(const compiled_formula &cf, resource_resv *resresv, resource_req *resreq, sch_resource_t *ans, std::string &errmsg)
+{
+	formula_val stack[FORMULA_MAX_DEPTH];
+	int sp = 0;
+	job_info *job = resresv->job;
+
+	*ans = 0;
+
+	for (const auto &insn : cf.code) {
+		formula_val r = {false, 0, 0};
+		formula_val a;
+		formula_val b;
+		enum formula_eval_result rc;
+
+		switch (insn.op) {
+			case FOP_CONST:
+				r.is_int = insn.is_int;
+				r.i = insn.ival;
+				r.d = insn.val;
+				stack[sp++] = r;
+				continue;
+			case FOP_RES: {
+				auto req = find_resource_req(resreq, insn.def);
+				if (req != NULL) {
+					int digits = float_digits(req->amount, FLOAT_NUM_DIGITS);
+
+					r.d = printed_value(req->amount, digits);
+					/* printed without a decimal point, Python sees an int */
+					if (digits == 0) {
+						if (!(fabs(r.d) < 9223372036854775808.0))
+							return FORMULA_EVAL_PYTHON;
+						r.is_int = true;
+						r.i = static_cast<long long>(r.d);
+					}
+				} else
+					r.is_int = true;
+				stack[sp++] = r;
+				continue;
+			}
+			case FOP_VAR:
+				switch (insn.var) {
+					case FVAR_ELIGIBLE_TIME:
+						r.is_int = true;
+						r.i = job->eligible_time;
+						break;
+					case FVAR_QUEUE_PRIO:
+						r.is_int = true;
+						r.i = job->queue->priority;
+						break;
+					case FVAR_JOB_PRIO:
+						r.is_int = true;
+						r.i = job->priority;
+						break;
+					case FVAR_FSPERC:
+						r.d = job->ginfo == NULL ? 0 : printed_value(job->ginfo->tree_percentage, 6);
+						break;
+					case FVAR_TREE_USAGE:
+						r.d = job->ginfo == NULL ? 0 : printed_value(job->ginfo->usage_factor, 6);
+						break;
+					case FVAR_FSFACTOR:
+						if (job->ginfo == NULL || job->ginfo->tree_percentage == 0)
+							r.d = 0;
+						else
+							r.d = printed_value(pow(2, -(job->ginfo->usage_factor / job->ginfo->tree_percentage)), 6);
+						break;
+					case FVAR_ACCRUE_TYPE:
+						r.is_int = true;
+						r.i = job->accrue_type;
+						break;
+					default:
+						break;
+				}
+				stack[sp++] = r;
+				continue;
+			case FOP_NEG:
+				if (!stack[sp - 1].is_int)
+					stack[sp - 1].d = -stack[sp - 1].d;
+				else if (__builtin_sub_overflow(0LL, stack[sp - 1].i, &stack[sp - 1].i))
+					return FORMULA_EVAL_PYTHON;
+				continue;
+			default:
+				break;
+		}
+
+		b = stack[--sp];
+		a = stack[sp - 1];
+		if (a.is_int && b.is_int)
+			rc = formula_int_op(insn.op, a.i, b.i, r, errmsg);
+		else
+			rc = formula_float_op(insn.op, formula_val_double(a), formula_val_double(b), r, errmsg);
+		if (rc != FORMULA_EVAL_OK)
+			return rc;
+		stack[sp - 1] = r;
+	}
+
+	if (sp == 1)
+		*ans = formula_val_double(stack[0]);
+	return FORMULA_EVAL_OK;
+}
+
+/**
+ * @brief	evaluate a formula for a job with the compiled formula and log
+ *		any error like formula_evaluate() does
+ *
+ * @param[in]	cf - the compiled formula
+ * @param[in]	resresv - the job
+ * @param[out]	need_python - the job needs to be evaluated by Python
+ *
+ * @return	sch_resource_t
+ * @retval	the answer or 0 on error
+ */
+static sch_resource_t
+eval_formula_for_job(const compiled_formula &cf, resource_resv *resresv, bool *need_python)
+{
+	sch_resource_t ans;
+	std::string errmsg;
+	enum formula_eval_result rc;
+
+	rc = eval_compiled_formula(cf, resresv, resresv->resreq, &ans, errmsg);
+	if (rc == FORMULA_EVAL_ERR)
+		log_eventf(PBSEVENT_DEBUG2, PBS_EVENTCLASS_JOB, LOG_DEBUG, resresv->name,
+			   "Formula evaluation for job had an error.  Zero value will be used: %s", errmsg.c_str());
+	*need_python = rc == FORMULA_EVAL_PYTHON;
+	return ans;
+}
+
+/**
+ * @brief	evaluate the job sort formula of a chunk of jobs into
+ *		job->formula_value
+ *
+ * @param[in,out]	data - the thread data of the chunk
+ *
+ * @return	void
+ */
+void
+eval_formula_chunk(th_data_eval_formula *data)
+{
+	for (int i = data->sidx; i <= data->eidx && data->resresv_arr[i] != NULL; i++) {
+		resource_resv *resresv = data->resresv_arr[i];
+
+		if (resresv->job != NULL)
+			resresv->job->formula_value = eval_formula_for_job(*data->cf, resresv, &data->need_python[i]);
+	}
+}
+
+/**
+ * @brief	evaluate the job sort formula of an array of jobs into
+ *		job->formula_value.  If the formula compiles, the jobs are
+ *		evaluated in parallel.  Otherwise they are evaluated one at a
+ *		time by the Python interpreter, as are the jobs whose ints
+ *		outgrew the compiled evaluation.
+ *
+ * @param[in]	formula - the formula
+ * @param[in,out]	resresv_arr - the jobs
+ *
+ * @return	void
+ */
+void
+eval_formula_array(const char *formula, resource_resv **resresv_arr)
+{
+	std::vector<void *> tdatas;
+	std::unique_ptr<bool[]> need_python;
+	int num_jobs;
+
+	if (formula == NULL || resresv_arr == NULL)
+		return;
+
+	auto cf = get_compiled_formula(formula);
+	if (cf == nullptr) {
+		for (int i = 0; resresv_arr[i] != NULL; i++) {
+			if (resresv_arr[i]->job != NULL)
+				resresv_arr[i]->job->formula_value = formula_evaluate(formula, resresv_arr[i], resresv_arr[i]->resreq);
+		}
+		return;
+	}
+
+	num_jobs = count_array(resresv_arr);
+	need_python.reset(new bool[num_jobs]());
+	parallel_for(TS_EVAL_FORMULA, num_jobs, [&](int sidx, int eidx) {
+		th_data_eval_formula *tdata;
+
+		tdata = static_cast<th_data_eval_formula *>(malloc(sizeof(th_data_eval_formula)));
+		if (tdata == NULL) {
+			log_err(errno, __func__, MEM_ERR_MSG);
+			return static_cast<void *>(NULL);
+		}
+		tdata->cf = cf.get();
+		tdata->resresv_arr = resresv_arr;
+		tdata->need_python = need_python.get();
+		tdata->sidx = sidx;
+		tdata->eidx = eidx;
+		return static_cast<void *>(tdata);
+	}, tdatas);
+
+	for (auto td : tdatas)
+		free(td);
+
+#ifdef PYTHON
+	/* the Python interpreter can only be used by the main thread */
+	for (int i = 0; i < num_jobs; i++) {
+		if (need_python[i])
+			resresv_arr[i]->job->formula_value = formula_evaluate_python(formula, resresv_arr[i], resresv_arr[i]->resreq);
+	}
+#endif
+}
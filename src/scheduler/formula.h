@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+#ifndef _FORMULA_H
+#define _FORMULA_H
+
+#include <memory>
+#include <string>
+
+#include "data_types.h"
+
+/* a formula compiled into a small stack program */
+class compiled_formula;
+
+/* compile a formula or reuse it from the formula cache.  NULL if it can't be compiled */
+std::shared_ptr<compiled_formula> get_compiled_formula(const char *formula);
+
+/* result of evaluating a compiled formula */
+enum formula_eval_result {
+	FORMULA_EVAL_OK,    /* the answer is set */
+	FORMULA_EVAL_ERR,   /* Python would raise an exception, the answer is 0 */
+	FORMULA_EVAL_PYTHON /* an int outgrew 64 bits, evaluate with Python */
+};
+
+/* evaluate a compiled formula for a job */
+enum formula_eval_result eval_compiled_formula(const compiled_formula &cf, resource_resv *resresv, resource_req *resreq, sch_resource_t *ans, std::string &errmsg);
+
+/* empty the formula cache */
+void clear_formula_cache(void);
+
+/* evaluate the job sort formula of a chunk of jobs (multi-threaded) */
+void eval_formula_chunk(th_data_eval_formula *data);
+
+/* evaluate the job sort formula of an array of jobs */
+void eval_formula_array(const char *formula, resource_resv **resresv_arr);
+
+#endif /* _FORMULA_H */
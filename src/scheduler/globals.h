@@ -43,7 +43,6 @@
 #include <limits.h>
 
 #include "data_types.h"
-#include "queue.h"
 #include "sched_cmds.h"
 
 extern void *poll_context;
@@ -86,8 +85,6 @@ extern pthread_mutex_t work_lock;
 extern pthread_cond_t work_cond;
 extern pthread_mutex_t result_lock;
 extern pthread_cond_t result_cond;
-extern ds_queue *work_queue;
-extern ds_queue *result_queue;
 extern pthread_t *threads;
 extern int threads_die;
 extern int num_threads;
@@ -99,6 +99,10 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <math.h>
+#include <climits>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include <pbs_ifl.h>
 #include <log.h>
 #include <libutil.h>
@@ -109,6 +113,7 @@
 #include "job_info.h"
 #include "resv_info.h"
 #include "constant.h"
+#include "cycle_stats.h"
 #include "misc.h"
 #include "config.h"
 #include "globals.h"
@@ -117,10 +122,12 @@
 #include "check.h"
 #include "sort.h"
 #include "fifo.h"
+#include "formula.h"
 #include "range.h"
 #include "resource_resv.h"
 #include "limits_if.h"
 #include "simulate.h"
+#include "snapshot.h"
 #include "resource.h"
 #include "server_info.h"
 #include "attribute.h"
@@ -587,6 +594,322 @@ alloc_tdata_jquery(status *policy, int pbs_sd, struct batch_status *jobs, queue_
 	return tdata;
 }
 
+/*
+ * Job batch_status objects kept between cycles for incremental job queries.
+ * There is one entry per queue.  An entry owns the batch_status objects it
+ * holds.  They are relinked into a new list each cycle, so they must only
+ * be freed one at a time through free_cached_job_status().
+ */
+struct job_status_cache {
+	bool valid:1;		/* entry holds the result of a successful query */
+	bool used:1;		/* entry was used this cycle */
+	int pbs_sd;		/* connection the statuses were queried over */
+	int num_queries;	/* incremental queries since the last full query */
+	long watermark;		/* highest mtime seen in the last query */
+	std::unordered_map<std::string, std::pair<long, struct batch_status *>> jobs;
+};
+
+static std::unordered_map<std::string, job_status_cache> job_status_caches;
+
+/**
+ * @brief	get the mtime of a job from its batch_status
+ *
+ * @param[in]	bs - batch_status of the job
+ *
+ * @return	long
+ * @retval	mtime of the job
+ * @retval	0 if the job has no mtime
+ */
+static long
+get_job_status_mtime(struct batch_status *bs)
+{
+	for (struct attrl *attrp = bs->attribs; attrp != NULL; attrp = attrp->next) {
+		if (!strcmp(attrp->name, ATTR_mtime))
+			return strtol(attrp->value, NULL, 10);
+	}
+	return 0;
+}
+
+/**
+ * @brief	is a job running or exiting according to its batch_status
+ *
+ * @param[in]	bs - batch_status of the job
+ *
+ * @return	bool
+ * @retval	true if the job_state is R or E
+ * @retval	false otherwise
+ */
+static bool
+is_job_status_running(struct batch_status *bs)
+{
+	for (struct attrl *attrp = bs->attribs; attrp != NULL; attrp = attrp->next) {
+		if (!strcmp(attrp->name, ATTR_state))
+			return (attrp->value[0] == 'R' || attrp->value[0] == 'E');
+	}
+	return false;
+}
+
+/**
+ * @brief	free a single batch_status held by the job status cache
+ *
+ * @param[in]	bs - batch_status to free
+ *
+ * @return	void
+ */
+static void
+free_cached_job_status(struct batch_status *bs)
+{
+	bs->next = NULL;
+	pbs_statfree(bs);
+}
+
+/**
+ * @brief	free all the batch_status objects of a job status cache entry
+ *		and mark it invalid so the next query of the queue is a full one
+ *
+ * @param[in,out]	cache - cache entry to clear
+ *
+ * @return	void
+ */
+static void
+clear_job_status_cache(job_status_cache &cache)
+{
+	for (auto &j : cache.jobs)
+		free_cached_job_status(j.second.second);
+	cache.jobs.clear();
+	cache.valid = false;
+	cache.num_queries = 0;
+	cache.watermark = 0;
+}
+
+/**
+ * @brief	throw away all cached job statuses.  The next cycle will do a
+ *		full query of every queue.  Called when the watermark can no
+ *		longer be trusted (e.g., server restart or reconfigure).
+ *
+ * @return	void
+ */
+void
+invalidate_job_status_cache(void)
+{
+	for (auto &c : job_status_caches)
+		clear_job_status_cache(c.second);
+	job_status_caches.clear();
+}
+
+/**
+ * @brief	drop the cache entries of queues which were not queried this
+ *		cycle (e.g., deleted queues) and get ready for the next cycle
+ *
+ * @return	void
+ */
+void
+prune_job_status_cache(void)
+{
+	for (auto it = job_status_caches.begin(); it != job_status_caches.end();) {
+		if (!it->second.used) {
+			clear_job_status_cache(it->second);
+			it = job_status_caches.erase(it);
+		} else {
+			it->second.used = false;
+			++it;
+		}
+	}
+}
+
+/**
+ * @brief	query the jobs of a queue, only fetching the full status of jobs
+ *		which have changed since the last cycle.
+ *
+ * @par	The server stamps a job's mtime every time it is saved.  First we
+ *	select the queue's jobs, asking only for mtime and job_state.  Any job
+ *	which isn't cached, whose mtime changed, or whose mtime is at or beyond
+ *	the watermark of the last query (it might have changed again within the
+ *	same second) is refetched in one select on mtime >= the oldest such
+ *	mtime.  Running and exiting jobs are always refetched in a select on
+ *	job_state: the server updates their resources_used from Mom's status
+ *	without saving them, so their mtime does not move.  Everything else is
+ *	reused from the cache.  Jobs which are no longer in the queue fall out
+ *	of the cache.  A full query is done if the cache
+ *	is not valid, the connection changed, or every JOB_STATUS_CACHE_REFRESH
+ *	queries just to be safe.
+ *
+ * @param[in]	pbs_sd - connection to pbs_server
+ * @param[in]	opl - selection criteria of the queue's jobs (single element)
+ * @param[in]	attrib - attributes to return (must include mtime)
+ * @param[in]	queue_name - the queue being queried
+ *
+ * @return	struct batch_status *
+ * @retval	list of job statuses.  They are owned by the cache; do not free.
+ * @retval	NULL if there are no jobs or on error (pbs_errno is set)
+ */
+static struct batch_status *
+query_job_statuses_incremental(int pbs_sd, struct attropl *opl, struct attrl *attrib, const std::string &queue_name)
+{
+	static struct attrl state_attr = {NULL, const_cast<char *>(ATTR_state), NULL, const_cast<char *>(""), SET};
+	static struct attrl mtime_attr = {&state_attr, const_cast<char *>(ATTR_mtime), NULL, const_cast<char *>(""), SET};
+	char since_buf[32];
+	struct attropl since_opl = {NULL, const_cast<char *>(ATTR_mtime), NULL, since_buf, GE};
+	struct attropl running_opl = {NULL, const_cast<char *>(ATTR_state), NULL, const_cast<char *>("RE"), EQ};
+	struct attropl qopl = *opl;
+	struct batch_status *stubs;
+	struct batch_status *fresh = NULL;
+	struct batch_status *head = NULL;
+	struct batch_status *tail = NULL;
+	std::unordered_map<std::string, std::pair<long, struct batch_status *>> new_jobs;
+	std::unordered_map<std::string, struct batch_status *> fresh_jobs;
+	std::vector<struct batch_status *> fresh_arr;
+	long since = LONG_MAX;
+	int num_changed = 0;
+	int num_running = 0;
+	int num_queries;
+
+	auto &cache = job_status_caches[queue_name];
+	cache.used = true;
+
+	if (!cache.valid || cache.pbs_sd != pbs_sd || cache.num_queries >= JOB_STATUS_CACHE_REFRESH) {
+		struct batch_status *jobs;
+
+		clear_job_status_cache(cache);
+		jobs = send_selstat(pbs_sd, opl, attrib, const_cast<char *>("S"));
+		if (jobs == NULL && pbs_errno > 0)
+			return NULL;
+
+		for (auto bs = jobs; bs != NULL; bs = bs->next) {
+			long mtime = get_job_status_mtime(bs);
+			cache.jobs[bs->name] = std::make_pair(mtime, bs);
+			if (mtime > cache.watermark)
+				cache.watermark = mtime;
+		}
+		cache.pbs_sd = pbs_sd;
+		cache.valid = true;
+		return jobs;
+	}
+
+	stubs = send_selstat(pbs_sd, opl, &mtime_attr, const_cast<char *>("S"));
+	if (stubs == NULL && pbs_errno > 0) {
+		clear_job_status_cache(cache);
+		return NULL;
+	}
+
+	for (auto bs = stubs; bs != NULL; bs = bs->next) {
+		long mtime = get_job_status_mtime(bs);
+		auto cj = cache.jobs.find(bs->name);
+
+		if (is_job_status_running(bs))
+			num_running++;
+		else if (cj == cache.jobs.end() || cj->second.first != mtime || mtime >= cache.watermark) {
+			if (mtime < since)
+				since = mtime;
+			num_changed++;
+		}
+	}
+
+	if (num_changed > 0) {
+		snprintf(since_buf, sizeof(since_buf), "%ld", since);
+		qopl.next = &since_opl;
+		fresh = send_selstat(pbs_sd, &qopl, attrib, const_cast<char *>("S"));
+		if (fresh == NULL && pbs_errno > 0) {
+			pbs_statfree(stubs);
+			clear_job_status_cache(cache);
+			return NULL;
+		}
+		for (auto bs = fresh; bs != NULL; bs = bs->next) {
+			fresh_jobs[bs->name] = bs;
+			fresh_arr.push_back(bs);
+		}
+	}
+
+	if (num_running > 0) {
+		qopl.next = &running_opl;
+		fresh = send_selstat(pbs_sd, &qopl, attrib, const_cast<char *>("S"));
+		if (fresh == NULL && pbs_errno > 0) {
+			pbs_statfree(stubs);
+			for (auto bs : fresh_arr)
+				free_cached_job_status(bs);
+			clear_job_status_cache(cache);
+			return NULL;
+		}
+		for (auto bs = fresh; bs != NULL; bs = bs->next) {
+			fresh_jobs[bs->name] = bs;
+			fresh_arr.push_back(bs);
+		}
+	}
+
+	/* Rebuild the list in the server's order.  Anything left in the old
+	 * cache afterwards has either been replaced or has left the queue.
+	 */
+	new_jobs.reserve(cache.jobs.size() + fresh_jobs.size());
+	for (auto stub = stubs; stub != NULL || !fresh_jobs.empty(); stub = (stub == NULL ? NULL : stub->next)) {
+		struct batch_status *bs = NULL;
+		bool from_cache = false;
+
+		if (stub != NULL) {
+			auto fj = fresh_jobs.find(stub->name);
+			if (fj != fresh_jobs.end()) {
+				bs = fj->second;
+				fresh_jobs.erase(fj);
+			} else {
+				long mtime = get_job_status_mtime(stub);
+				auto cj = cache.jobs.find(stub->name);
+				/* changed or running jobs not returned by the later selects have left the queue */
+				if (cj != cache.jobs.end() && cj->second.first == mtime && mtime < cache.watermark &&
+				    !is_job_status_running(stub)) {
+					bs = cj->second.second;
+					cache.jobs.erase(cj);
+					from_cache = true;
+				}
+			}
+		} else {
+			/* jobs which arrived in between the two selects */
+			bs = fresh_jobs.begin()->second;
+			fresh_jobs.erase(fresh_jobs.begin());
+		}
+
+		if (bs == NULL)
+			continue;
+		if (new_jobs.find(bs->name) != new_jobs.end()) {
+			if (from_cache)
+				free_cached_job_status(bs);
+			continue;
+		}
+
+		new_jobs[bs->name] = std::make_pair(get_job_status_mtime(bs), bs);
+		if (tail == NULL)
+			head = bs;
+		else
+			tail->next = bs;
+		tail = bs;
+	}
+	if (tail != NULL)
+		tail->next = NULL;
+
+	pbs_statfree(stubs);
+	num_queries = cache.num_queries + 1;
+	clear_job_status_cache(cache);
+
+	for (const auto &j : new_jobs) {
+		if (j.second.first > cache.watermark)
+			cache.watermark = j.second.first;
+	}
+	cache.jobs = std::move(new_jobs);
+	cache.pbs_sd = pbs_sd;
+	cache.valid = true;
+	cache.num_queries = num_queries;
+
+	/* free the fresh statuses which were not used (i.e., duplicates) */
+	for (auto bs : fresh_arr) {
+		auto cj = cache.jobs.find(bs->name);
+		if (cj == cache.jobs.end() || cj->second.second != bs)
+			free_cached_job_status(bs);
+	}
+
+	log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_QUEUE, LOG_DEBUG, queue_name,
+		   "Incremental job query: %zu jobs, %d changed, %d running", cache.jobs.size(), num_changed, num_running);
+
+	return head;
+}
+
 /**
  * @brief
  * 		create an array of jobs in a specified queue
@@ -608,6 +931,7 @@ alloc_tdata_jquery(status *policy, int pbs_sd, struct batch_status *jobs, queue_
 resource_resv **
 query_jobs(status *policy, int pbs_sd, queue_info *qinfo, resource_resv **pjobs, const std::string &queue_name)
 {
+	phase_timer timer(PHASE_QUERY_JOBS);
 	/* pbs_selstat() takes a linked list of attropl structs which tell it
 	 * what information about what jobs to return.  We want all jobs which are
 	 * in a specified queue
@@ -635,9 +959,11 @@ query_jobs(status *policy, int pbs_sd, queue_info *qinfo, resource_resv **pjobs,
 	/* for multi-threading */
 	int jidx;
 	th_data_query_jinfo *tdata = NULL;
-	th_task_info *task = NULL;
-	resource_resv ***jinfo_arrs_tasks;
-	int tid;
+	std::vector<void *> tdatas;
+	int th_err;
+
+	/* the job statuses are owned by the job status cache */
+	bool use_cache;
 
 	if (policy == NULL || qinfo == NULL || queue_name.empty())
 		return pjobs;
@@ -685,6 +1011,7 @@ query_jobs(status *policy, int pbs_sd, queue_info *qinfo, resource_resv **pjobs,
 			ATTR_depend,
 			ATTR_A,
 			ATTR_max_run_subjobs,
+			ATTR_mtime,
 			NULL};
 
 		for (int i = 0; jobattrs[i] != NULL; i++) {
@@ -698,8 +1025,20 @@ query_jobs(status *policy, int pbs_sd, queue_info *qinfo, resource_resv **pjobs,
 		}
 	}
 
+	/* eligible_time is calculated by the server when the job is statused
+	 * without changing the job's mtime, so it would go stale in the cache.
+	 * A snapshot needs the full status of every job.
+	 */
+	use_cache = conf.incremental_job_query && !qinfo->is_peer_queue && !qinfo->server->eligible_time_enable &&
+		    !snapshot_recording();
+
 	/* get jobs from PBS server */
-	if ((jobs = send_selstat(pbs_sd, &opl, attrib, const_cast<char *>("S"))) == NULL) {
+	if (use_cache)
+		jobs = query_job_statuses_incremental(pbs_sd, &opl, attrib, queue_name);
+	else
+		jobs = send_selstat(pbs_sd, &opl, attrib, const_cast<char *>("S"));
+
+	if (jobs == NULL) {
 		if (pbs_errno > 0) {
 			const char *errmsg = pbs_geterrmsg(pbs_sd);
 			if (errmsg == NULL)
@@ -727,110 +1066,47 @@ query_jobs(status *policy, int pbs_sd, queue_info *qinfo, resource_resv **pjobs,
 
 	if (resresv_arr == NULL) {
 		log_err(errno, __func__, MEM_ERR_MSG);
-		pbs_statfree(jobs);
+		if (!use_cache)
+			pbs_statfree(jobs);
 		return NULL;
 	}
 	resresv_arr[num_prev_jobs] = NULL;
 
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_jquery(policy, pbs_sd, jobs, qinfo, 0, num_new_jobs - 1);
-		if (tdata == NULL) {
-			free_resource_resv_array(resresv_arr);
-			pbs_statfree(jobs);
-			return NULL;
-		}
-		query_jobs_chunk(tdata);
-
-		if (tdata->error || tdata->oarr == NULL) {
-			free_resource_resv_array(resresv_arr);
-			pbs_statfree(jobs);
+	/* Hand each chunk the job it starts at so the chunks don't all have to
+	 * walk the list from the beginning.
+	 */
+	cur_job = jobs;
+	th_err = !parallel_for(TS_QUERY_JOB_INFO, num_new_jobs, [&](int sidx, int eidx) {
+		tdata = alloc_tdata_jquery(policy, pbs_sd, cur_job, qinfo, 0, eidx - sidx);
+		for (int i = sidx; i <= eidx && cur_job != NULL; i++)
+			cur_job = cur_job->next;
+		return tdata;
+	}, tdatas);
+
+	/* Assemble job info objects from the chunks into the resresv_arr */
+	jidx = num_prev_jobs;
+	for (auto td : tdatas) {
+		tdata = static_cast<th_data_query_jinfo *>(td);
+		if (tdata->error)
+			th_err = 1;
+		if (tdata->oarr != NULL) {
+			for (int j = 0; tdata->oarr[j] != NULL; j++)
+				resresv_arr[jidx++] = tdata->oarr[j];
 			free(tdata->oarr);
-			free(tdata);
-			return NULL;
-		}
-
-		jidx = num_prev_jobs;
-		for (int j = 0; tdata->oarr[j] != NULL; j++) {
-			resresv_arr[jidx++] = tdata->oarr[j];
 		}
-		free(tdata->oarr);
 		free(tdata);
-		resresv_arr[jidx] = NULL;
-	} else {
-		int chunk_size = num_new_jobs / num_threads;
-		int th_err = 0;
-		int num_tasks = 0;
-
-		chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-		chunk_size = (chunk_size < MT_CHUNK_SIZE_MAX) ? chunk_size : MT_CHUNK_SIZE_MAX;
-		for (int j = 0; num_new_jobs > 0;
-		     num_tasks++, j += chunk_size, num_new_jobs -= chunk_size) {
-			tdata = alloc_tdata_jquery(policy, pbs_sd, jobs, qinfo, j, j + chunk_size - 1);
-			if (tdata == NULL) {
-				th_err = 1;
-				break;
-			}
-			task = static_cast<th_task_info *>(malloc(sizeof(th_task_info)));
-			if (task == NULL) {
-				free(tdata);
-				log_err(errno, __func__, MEM_ERR_MSG);
-				th_err = 1;
-				break;
-			}
-			task->task_id = num_tasks;
-			task->task_type = TS_QUERY_JOB_INFO;
-			task->thread_data = (void *) tdata;
-
-			pthread_mutex_lock(&work_lock);
-			ds_enqueue(work_queue, (void *) task);
-			pthread_cond_signal(&work_cond);
-			pthread_mutex_unlock(&work_lock);
-		}
-		jinfo_arrs_tasks = static_cast<resource_resv ***>(malloc(num_tasks * sizeof(resource_resv **)));
-		if (jinfo_arrs_tasks == NULL) {
-			log_err(errno, __func__, MEM_ERR_MSG);
-			th_err = 1;
-		}
-		/* Get results from worker threads */
-		for (int i = 0; i < num_tasks;) {
-			pthread_mutex_lock(&result_lock);
-			while (ds_queue_is_empty(result_queue))
-				pthread_cond_wait(&result_cond, &result_lock);
-			while (!ds_queue_is_empty(result_queue)) {
-				task = static_cast<th_task_info *>(ds_dequeue(result_queue));
-				tdata = static_cast<th_data_query_jinfo *>(task->thread_data);
-				if (tdata->error)
-					th_err = 1;
-				jinfo_arrs_tasks[task->task_id] = tdata->oarr;
-				free(tdata);
-				free(task);
-				i++;
-			}
-			pthread_mutex_unlock(&result_lock);
-		}
-		if (th_err) {
+	}
+	resresv_arr[jidx] = NULL;
+
+	if (th_err) {
+		if (!use_cache)
 			pbs_statfree(jobs);
-			free_resource_resv_array(resresv_arr);
-			free(jinfo_arrs_tasks);
-			return NULL;
-		}
-		/* Assemble job info objects from various threads into the resresv_arr */
-		jidx = num_prev_jobs;
-		for (int i = 0; i < num_tasks; i++) {
-			if (jinfo_arrs_tasks[i] != NULL) {
-				for (int j = 0; jinfo_arrs_tasks[i][j] != NULL; j++) {
-					resresv_arr[jidx++] = jinfo_arrs_tasks[i][j];
-				}
-				free(jinfo_arrs_tasks[i]);
-			}
-		}
-		resresv_arr[jidx] = NULL;
-		free(jinfo_arrs_tasks);
+		free_resource_resv_array(resresv_arr);
+		return NULL;
 	}
 
-	pbs_statfree(jobs);
+	if (!use_cache)
+		pbs_statfree(jobs);
 
 	return resresv_arr;
 }
@@ -891,13 +1167,13 @@ query_job(int pbs_sd, struct batch_status *job, server_info *sinfo, queue_info *
 				if (strchr(attrp->value, ':') != NULL) {
 					/* moved to query_jobs() in order to include the queue name
 					 resresv->job->ginfo = find_alloc_ginfo( attrp->value,
-					 sinfo->fstree->root );
+					 sinfo->fstree );
 					 */
 					/* localmod 034 */
 					resresv->job->sh_info = site_find_alloc_share(sinfo, attrp->value);
 				}
 #else
-				resresv->job->ginfo = find_alloc_ginfo(attrp->value, sinfo->fstree->root);
+				resresv->job->ginfo = find_alloc_ginfo(attrp->value, sinfo->fstree);
 #endif /* localmod 059 */
 			} else
 				resresv->job->ginfo = NULL;
@@ -977,7 +1253,7 @@ query_job(int pbs_sd, struct batch_status *job, server_info *sinfo, queue_info *
 			resresv->job->schedsel = string_dup(attrp->value);
 #endif /* localmod 031 */
 
-			resresv->select = parse_selspec(attrp->value);
+			resresv->select = parse_cached_selspec(attrp->value);
 #ifdef NAS /* localmod 031 */
 		}
 #endif /* localmod 031 */
@@ -1044,7 +1320,7 @@ query_job(int pbs_sd, struct batch_status *job, server_info *sinfo, queue_info *
 				}
 #endif
 				if (!strcmp(attrp->resource, "place")) {
-					resresv->place_spec = parse_placespec(attrp->value);
+					resresv->place_spec = parse_cached_placespec(attrp->value);
 					if (resresv->place_spec == NULL) {
 						set_schd_error_codes(err, NEVER_RUN, ERR_SPECIAL);
 						set_schd_error_arg(err, SPECMSG, "invalid placement spec");
@@ -1109,9 +1385,9 @@ query_job(int pbs_sd, struct batch_status *job, server_info *sinfo, queue_info *
 		resresv->job->peer_sd = pbs_sd;
 	}
 
-	if ((resresv->aoename = getaoename(resresv->select)) != NULL)
+	if ((resresv->aoename = getaoename(resresv->select.get())) != NULL)
 		resresv->is_prov_needed = true;
-	if ((resresv->eoename = geteoename(resresv->select)) != NULL) {
+	if ((resresv->eoename = geteoename(resresv->select.get())) != NULL) {
 		/* job with a power profile can't be checkpointed or suspended */
 		resresv->job->can_checkpoint = false;
 		resresv->job->can_suspend = false;
@@ -1160,7 +1436,7 @@ query_job(int pbs_sd, struct batch_status *job, server_info *sinfo, queue_info *
 		selectspec = create_select_from_nspec(resresv->nspec_arr);
 
 	if (!selectspec.empty())
-		resresv->execselect = parse_selspec(selectspec);
+		resresv->execselect.reset(parse_selspec(selectspec));
 
 	set_job_times(pbs_sd, resresv, sinfo->server_time);
 
@@ -1184,7 +1460,7 @@ query_job(int pbs_sd, struct batch_status *job, server_info *sinfo, queue_info *
 	if (conf.fairshare_ent == "queue") {
 		if (sinfo->fstree != NULL) {
 			resresv->job->ginfo =
-				find_alloc_ginfo(qinfo->name, sinfo->fstree->root);
+				find_alloc_ginfo(qinfo->name, sinfo->fstree);
 		} else
 			resresv->job->ginfo = NULL;
 	}
@@ -1202,7 +1478,7 @@ query_job(int pbs_sd, struct batch_status *job, server_info *sinfo, queue_info *
 		sprintf(fairshare_name, "%s:%s", resresv->group.c_str(), resresv->user.c_str());
 #endif /* localmod 058 */
 		if (resresv->server->fstree != NULL) {
-			resresv->job->ginfo = find_alloc_ginfo(fairshare_name, sinfo->fstree->root);
+			resresv->job->ginfo = find_alloc_ginfo(fairshare_name, sinfo->fstree);
 		} else
 			resresv->job->ginfo = NULL;
 	}
@@ -2013,20 +2289,14 @@ new_resresv_set(void)
 {
 	resresv_set *rset;
 
-	rset = static_cast<resresv_set *>(malloc(sizeof(resresv_set)));
-	if (rset == NULL) {
-		log_err(errno, __func__, MEM_ERR_MSG);
-		return NULL;
-	}
+	rset = new resresv_set();
 
 	rset->can_not_run = 0;
 	rset->err = NULL;
 	rset->user = NULL;
 	rset->group = NULL;
 	rset->project = NULL;
-	rset->place_spec = NULL;
 	rset->req = NULL;
-	rset->select_spec = NULL;
 	rset->qinfo = NULL;
 
 	return rset;
@@ -2044,10 +2314,8 @@ free_resresv_set(resresv_set *rset)
 	free(rset->user);
 	free(rset->group);
 	free(rset->project);
-	delete rset->select_spec;
-	free_place(rset->place_spec);
 	free_resource_req_list(rset->req);
-	free(rset);
+	delete rset;
 }
 /**
  *  @brief resresv_set array destructor
@@ -2104,16 +2372,9 @@ dup_resresv_set(resresv_set *oset, server_info *nsinfo)
 		free_resresv_set(rset);
 		return NULL;
 	}
-	rset->select_spec = new selspec(*oset->select_spec);
-	if (rset->select_spec == NULL) {
-		free_resresv_set(rset);
-		return NULL;
-	}
-	rset->place_spec = dup_place(oset->place_spec);
-	if (rset->place_spec == NULL) {
-		free_resresv_set(rset);
-		return NULL;
-	}
+	/* the specs are never modified, so the copies share them */
+	rset->select_spec = oset->select_spec;
+	rset->place_spec = oset->place_spec;
 	rset->req = dup_resource_req_list(oset->req);
 	if (oset->req != NULL && rset->req == NULL) {
 		free_resresv_set(rset);
@@ -2251,16 +2512,12 @@ resresv_set_use_queue(queue_info *qinfo)
  *	looked at is if they are requeued.  At that point they are back in
  *	the queued state and have the same select spec as they originally did.
  *
- * @return selspec *
+ * @return std::shared_ptr<selspec>
  * @retval selspec to use
- * @retval NULL on error
  */
-selspec *
+static const std::shared_ptr<selspec> &
 resresv_set_which_selspec(resource_resv *resresv)
 {
-	if (resresv == NULL)
-		return NULL;
-
 	if (resresv->job != NULL && !resresv->job->is_running && resresv->execselect != NULL)
 		return resresv->execselect;
 
@@ -2334,12 +2591,12 @@ create_resresv_set_by_resresv(status *policy, server_info *sinfo, resource_resv
 	if (resresv_set_use_proj(sinfo, rset->qinfo))
 		rset->project = string_dup(resresv->project.c_str());
 
-	rset->select_spec = new selspec(*resresv_set_which_selspec(resresv));
+	rset->select_spec = resresv_set_which_selspec(resresv);
 	if (rset->select_spec == NULL) {
 		free_resresv_set(rset);
 		return NULL;
 	}
-	rset->place_spec = dup_place(resresv->place_spec);
+	rset->place_spec = resresv->place_spec;
 	if (rset->place_spec == NULL) {
 		free_resresv_set(rset);
 		return NULL;
@@ -2350,6 +2607,55 @@ create_resresv_set_by_resresv(status *policy, server_info *sinfo, resource_resv
 	return rset;
 }
 
+/**
+ * @brief does a resresv_set match the component parts of a set
+ * @par qinfo, user, group, project, or req can be NULL if the resresv_set does not have one
+ * @param[in] policy - policy info
+ * @param[in] rset - resresv_set to check
+ * @param[in] user - user name
+ * @param[in] group - group name
+ * @param[in] project - project name
+ * @param[in] sel - select spec
+ * @param[in] pl - place spec
+ * @param[in] req - list of resources (i.e., qsub -l)
+ * @param[in] qinfo - queue
+ * @return bool
+ * @retval true if it matches
+ * @retval false if not
+ */
+static bool
+resresv_set_matches(status *policy, resresv_set *rset, const char *user, const char *group, const char *project, selspec *sel, place *pl, resource_req *req, queue_info *qinfo)
+{
+	if ((qinfo != NULL && rset->qinfo == NULL) || (qinfo == NULL && rset->qinfo != NULL))
+		return false;
+	if ((qinfo != NULL && rset->qinfo != NULL) && qinfo->name != rset->qinfo->name)
+		return false;
+
+	if ((user != NULL && rset->user == NULL) || (user == NULL && rset->user != NULL))
+		return false;
+	if (user != NULL && cstrcmp(user, rset->user) != 0)
+		return false;
+
+	if ((group != NULL && rset->group == NULL) || (group == NULL && rset->group != NULL))
+		return false;
+	if (group != NULL && cstrcmp(group, rset->group) != 0)
+		return false;
+
+	if ((project != NULL && rset->project == NULL) || (project == NULL && rset->project != NULL))
+		return false;
+	if (project != NULL && cstrcmp(project, rset->project) != 0)
+		return false;
+
+	if (compare_selspec(rset->select_spec.get(), sel) == 0)
+		return false;
+	if (compare_place(rset->place_spec.get(), pl) == 0)
+		return false;
+	if (compare_resource_req_list(rset->req, req, policy->equiv_class_resdef) == 0)
+		return false;
+
+	return true;
+}
+
 /**
  * @brief find the index of a resresv_set by its component parts
  * @par qinfo, user, group, project, or req can be NULL if the resresv_set does not have one
@@ -2375,36 +2681,41 @@ find_resresv_set(status *policy, resresv_set **rsets, const char *user, const ch
 		return -1;
 
 	for (i = 0; rsets[i] != NULL; i++) {
-		if ((qinfo != NULL && rsets[i]->qinfo == NULL) || (qinfo == NULL && rsets[i]->qinfo != NULL))
-			continue;
-		if ((qinfo != NULL && rsets[i]->qinfo != NULL) && qinfo->name != rsets[i]->qinfo->name)
+		if (resresv_set_matches(policy, rsets[i], user, group, project, sel, pl, req, qinfo))
+			return i;
+	}
+	return -1;
+}
 
-			continue;
-		if ((user != NULL && rsets[i]->user == NULL) || (user == NULL && rsets[i]->user != NULL))
-			continue;
-		if (user != NULL && cstrcmp(user, rsets[i]->user) != 0)
-			continue;
+/**
+ * @brief get the parts of a resresv's resresv_set which depend on policy
+ * @param[in] resresv - the resresv
+ * @param[out] user - user name or NULL if the set doesn't use it
+ * @param[out] group - group name or NULL if the set doesn't use it
+ * @param[out] project - project name or NULL if the set doesn't use it
+ * @param[out] qinfo - queue or NULL if the set doesn't use it
+ * @return void
+ */
+static void
+get_resresv_set_owner(resource_resv *resresv, const char **user, const char **group, const char **project, queue_info **qinfo)
+{
+	*user = NULL;
+	*group = NULL;
+	*project = NULL;
+	*qinfo = NULL;
 
-		if ((group != NULL && rsets[i]->group == NULL) || (group == NULL && rsets[i]->group != NULL))
-			continue;
-		if (group != NULL && cstrcmp(group, rsets[i]->group) != 0)
-			continue;
+	if (resresv->is_job && resresv->job != NULL)
+		if (resresv_set_use_queue(resresv->job->queue))
+			*qinfo = resresv->job->queue;
 
-		if ((project != NULL && rsets[i]->project == NULL) || (project == NULL && rsets[i]->project != NULL))
-			continue;
-		if (project != NULL && cstrcmp(project, rsets[i]->project) != 0)
-			continue;
+	if (resresv_set_use_user(resresv->server, *qinfo))
+		*user = resresv->user.c_str();
 
-		if (compare_selspec(rsets[i]->select_spec, sel) == 0)
-			continue;
-		if (compare_place(rsets[i]->place_spec, pl) == 0)
-			continue;
-		if (compare_resource_req_list(rsets[i]->req, req, policy->equiv_class_resdef) == 0)
-			continue;
-		/* If we got here, we have found our set */
-		return i;
-	}
-	return -1;
+	if (resresv_set_use_grp(resresv->server, *qinfo))
+		*group = resresv->group.c_str();
+
+	if (resresv_set_use_proj(resresv->server, *qinfo))
+		*project = resresv->project.c_str();
 }
 
 /**
@@ -2417,35 +2728,113 @@ find_resresv_set(status *policy, resresv_set **rsets, const char *user, const ch
 int
 find_resresv_set_by_resresv(status *policy, resresv_set **rsets, resource_resv *resresv)
 {
-	const char *user = NULL;
-	const char *grp = NULL;
-	const char *proj = NULL;
-	queue_info *qinfo = NULL;
-	selspec *sspec;
+	const char *user;
+	const char *grp;
+	const char *proj;
+	queue_info *qinfo;
 
 	if (policy == NULL || rsets == NULL || resresv == NULL)
 		return -1;
 
-	if (resresv->is_job && resresv->job != NULL)
-		if (resresv_set_use_queue(resresv->job->queue))
-			qinfo = resresv->job->queue;
+	get_resresv_set_owner(resresv, &user, &grp, &proj, &qinfo);
+
+	return find_resresv_set(policy, rsets, user, grp, proj, resresv_set_which_selspec(resresv).get(), resresv->place_spec.get(), resresv->resreq, qinfo);
+}
+
+/**
+ * @brief mix a value into a hash
+ * @param[in,out] h - the hash
+ * @param[in] v - the value's hash
+ * @return void
+ */
+static inline void
+hash_combine(size_t &h, size_t v)
+{
+	h ^= v + 0x9e3779b9 + (h << 6) + (h >> 2);
+}
+
+/**
+ * @brief hash a resource_req list the way compare_resource_req_list() compares it.
+ *	Only resources in comparr count, a resource requested twice counts
+ *	by its first request, and the order of the list doesn't matter.
+ * @param[in] reqs - the list
+ * @param[in] comparr - resources to hash
+ * @return size_t
+ */
+static size_t
+hash_resource_req_list(resource_req *reqs, std::unordered_set<resdef *> &comparr)
+{
+	size_t h = 0;
 
-	if (resresv_set_use_user(resresv->server, qinfo))
-		user = resresv->user.c_str();
+	for (auto req = reqs; req != NULL; req = req->next) {
+		size_t rh;
 
-	if (resresv_set_use_grp(resresv->server, qinfo))
-		grp = resresv->group.c_str();
+		if (comparr.find(req->def) == comparr.end())
+			continue;
+		if (find_resource_req(reqs, req->def) != req)
+			continue;
 
-	if (resresv_set_use_proj(resresv->server, qinfo))
-		proj = resresv->project.c_str();
+		rh = std::hash<resdef *>()(req->def);
+		if (req->type.is_consumable || req->type.is_boolean)
+			hash_combine(rh, std::hash<sch_resource_t>()(req->amount));
+		else if (req->type.is_string && req->res_str != NULL)
+			hash_combine(rh, std::hash<std::string>()(req->res_str));
+		h += rh;
+	}
+	return h;
+}
+
+/**
+ * @brief hash a select spec the way compare_selspec() compares it
+ * @param[in] sel - the select spec
+ * @return size_t
+ */
+static size_t
+hash_selspec(selspec *sel)
+{
+	size_t h = 0;
 
-	sspec = resresv_set_which_selspec(resresv);
+	if (sel == NULL)
+		return 0;
 
-	return find_resresv_set(policy, rsets, user, grp, proj, sspec, resresv->place_spec, resresv->resreq, qinfo);
+	hash_combine(h, sel->total_chunks);
+	if (sel->chunks != NULL) {
+		for (int i = 0; sel->chunks[i] != NULL; i++) {
+			hash_combine(h, sel->chunks[i]->num_chunks);
+			hash_combine(h, hash_resource_req_list(sel->chunks[i]->req, conf.resdef_to_check));
+		}
+	}
+	return h;
+}
+
+/**
+ * @brief hash a place spec the way compare_place() compares it
+ * @param[in] pl - the place spec
+ * @return size_t
+ */
+static size_t
+hash_place(place *pl)
+{
+	size_t h = 0;
+
+	if (pl == NULL)
+		return 0;
+
+	hash_combine(h, pl->excl | pl->exclhost << 1 | pl->share << 2 | pl->free << 3 |
+				pl->pack << 4 | pl->scatter << 5 | pl->vscatter << 6);
+	if (pl->group != NULL)
+		hash_combine(h, std::hash<std::string>()(pl->group));
+	return h;
 }
 
 /**
  * @brief create equivalence classes based on an array of resresvs
+ *
+ * @par The sets are hashed by the same parts resresv_set_matches() compares,
+ *	so each resresv is only compared with the sets of the same hash.
+ *	Jobs with the same select or place spec share it (see
+ *	parse_cached_selspec()), so the spec hashes are only computed once.
+ *
  * @param[in] policy - policy info
  * @param[in] sinfo - server universe
  * @return array of equivalence classes (resresv_sets)
@@ -2453,6 +2842,7 @@ find_resresv_set_by_resresv(status *policy, resresv_set **rsets, resource_resv *
 resresv_set **
 create_resresv_sets(status *policy, server_info *sinfo)
 {
+	phase_timer timer(PHASE_RESRESV_SETS);
 	int i;
 	int j = 0;
 	int len;
@@ -2461,6 +2851,9 @@ create_resresv_sets(status *policy, server_info *sinfo)
 	resresv_set **rsets;
 	resresv_set **tmp_rset_arr;
 	resresv_set *cur_rset;
+	std::unordered_map<size_t, std::vector<int>> rset_index;
+	std::unordered_map<selspec *, size_t> sel_hashes;
+	std::unordered_map<place *, size_t> pl_hashes;
 
 	if (policy == NULL || sinfo == NULL)
 		return NULL;
@@ -2477,7 +2870,45 @@ create_resresv_sets(status *policy, server_info *sinfo)
 	rsets[0] = NULL;
 
 	for (i = 0; resresvs[i] != NULL; i++) {
-		auto cur_ind = find_resresv_set_by_resresv(policy, rsets, resresvs[i]);
+		const char *user;
+		const char *grp;
+		const char *proj;
+		queue_info *qinfo;
+		selspec *sel;
+		place *pl;
+		size_t h = 0;
+		int cur_ind = -1;
+
+		get_resresv_set_owner(resresvs[i], &user, &grp, &proj, &qinfo);
+		sel = resresv_set_which_selspec(resresvs[i]).get();
+		pl = resresvs[i]->place_spec.get();
+
+		auto sh = sel_hashes.find(sel);
+		if (sh == sel_hashes.end())
+			sh = sel_hashes.emplace(sel, hash_selspec(sel)).first;
+		auto ph = pl_hashes.find(pl);
+		if (ph == pl_hashes.end())
+			ph = pl_hashes.emplace(pl, hash_place(pl)).first;
+
+		if (qinfo != NULL)
+			hash_combine(h, std::hash<std::string>()(qinfo->name));
+		if (user != NULL)
+			hash_combine(h, std::hash<std::string>()(user));
+		if (grp != NULL)
+			hash_combine(h, std::hash<std::string>()(grp));
+		if (proj != NULL)
+			hash_combine(h, std::hash<std::string>()(proj));
+		hash_combine(h, sh->second);
+		hash_combine(h, ph->second);
+		hash_combine(h, hash_resource_req_list(resresvs[i]->resreq, policy->equiv_class_resdef));
+
+		auto &cands = rset_index[h];
+		for (auto ind : cands) {
+			if (resresv_set_matches(policy, rsets[ind], user, grp, proj, sel, pl, resresvs[i]->resreq, qinfo)) {
+				cur_ind = ind;
+				break;
+			}
+		}
 
 		/* Didn't find the set, create it.*/
 		if (cur_ind == -1) {
@@ -2489,6 +2920,7 @@ create_resresv_sets(status *policy, server_info *sinfo)
 			cur_ind = j;
 			rsets[j++] = cur_rset;
 			rsets[j] = NULL;
+			cands.push_back(cur_ind);
 		}
 		resresvs[i]->ec_index = cur_ind;
 	}
@@ -2581,7 +3013,7 @@ dup_job_info(job_info *ojinfo, queue_info *nqinfo, server_info *nsinfo)
 
 	if (nqinfo->server->fstree != NULL) {
 		njinfo->ginfo = find_group_info(ojinfo->ginfo->name,
-						nqinfo->server->fstree->root);
+						nqinfo->server->fstree);
 	} else
 		njinfo->ginfo = NULL;
 
@@ -2756,6 +3188,7 @@ schd_get_preempt_order(resource_resv *resresv)
 int
 find_and_preempt_jobs(status *policy, int pbs_sd, resource_resv *hjob, server_info *sinfo, schd_error *err)
 {
+	phase_timer timer(PHASE_PREEMPT);
 
 	int i = 0;
 	int *jobs = NULL;
@@ -2771,6 +3204,11 @@ find_and_preempt_jobs(status *policy, int pbs_sd, resource_resv *hjob, server_in
 	char **preempt_jobs_list = NULL;
 	preempt_job_info *preempt_jobs_reply = NULL;
 
+	cycle_stats_count(CTR_PREEMPT_ATTEMPTS);
+
+	/* choose what to preempt from a universe with no run requests in flight */
+	reap_run_job_replies(0);
+
 	/* jobs with AOE cannot preempt (atleast for now) */
 	if (hjob->aoename != NULL)
 		return 0;
@@ -2888,7 +3326,11 @@ find_and_preempt_jobs(status *policy, int pbs_sd, resource_resv *hjob, server_in
 
 	if (done) {
 		clear_schd_error(err);
-		auto ret = run_update_job(policy, pbs_sd, sinfo, hjob->job->queue, hjob, RURR_ADD_END_EVENT, err);
+		/* Wait for the reply.  If the run is rejected, the preempted work
+		 * needs to be restored below.
+		 */
+		auto ret = run_update_job(policy, pbs_sd, sinfo, hjob->job->queue, hjob,
+					  RURR_ADD_END_EVENT | RURR_NO_PIPELINE, err);
 
 		/* oops... we screwed up.. the high priority job didn't run.  Forget about
 		 * running it now and resume preempted work
@@ -2983,6 +3425,7 @@ find_jobs_to_preempt(status *policy, resource_resv *hjob, server_info *sinfo, in
 	char **preempt_targets_list = NULL;
 	resource_resv **prjobs = NULL;
 	int rjobs_count = 0;
+	preempt_index pidx;
 
 	*no_of_jobs = 0;
 	if (hjob == NULL || sinfo == NULL)
@@ -3094,6 +3537,51 @@ find_jobs_to_preempt(status *policy, resource_resv *hjob, server_info *sinfo, in
 		}
 	}
 
+	for (i = 0; fail_list[i] != 0; i++)
+		pidx.failed.insert(fail_list[i]);
+	if (hjob->ninfo_arr != NULL) {
+		for (i = 0; hjob->ninfo_arr[i] != NULL; i++)
+			pidx.hjob_nodes.insert(hjob->ninfo_arr[i]->rank);
+	}
+
+	/* Duplicating the universe is expensive.  Before we do, make sure there
+	 * is at least one job which can be preempted.  What is learned about the
+	 * candidates here is kept in pidx and reused in the simulation.
+	 */
+	err = dup_schd_error(full_err); /* only first element */
+	if (err == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		free_schd_error_list(full_err);
+		free(pjobs);
+		free_string_array(preempt_targets_list);
+		return NULL;
+	}
+	if (preempt_targets_req != NULL)
+		prjobs = resource_resv_filter(sinfo->running_jobs, sinfo->sc.running,
+					      preempt_job_set_filter, (void *) preempt_targets_list, NO_FLAGS);
+	if (prjobs != NULL && prjobs[0] == NULL) {
+		log_eventf(PBSEVENT_DEBUG2, PBS_EVENTCLASS_JOB, LOG_DEBUG, hjob->name,
+			   "Limited running jobs used for preemption from %d to 0: No jobs to preempt", sinfo->sc.running);
+		indexfound = NO_JOB_FOUND;
+	} else {
+		rjobs_subset = filter_preemptable_jobs(prjobs != NULL ? prjobs : sinfo->running_jobs, hjob, err);
+		indexfound = select_index_to_preempt(policy, hjob, rjobs_subset, 0, err, pidx);
+		if (indexfound == NO_JOB_FOUND)
+			log_event(PBSEVENT_DEBUG2, PBS_EVENTCLASS_JOB, LOG_INFO, hjob->name, "Found no preemptable candidates");
+	}
+	free(rjobs_subset);
+	rjobs_subset = NULL;
+	free(prjobs);
+	prjobs = NULL;
+	free_schd_error(err);
+	err = NULL;
+	if (indexfound == NO_JOB_FOUND) {
+		free_schd_error_list(full_err);
+		free(pjobs);
+		free_string_array(preempt_targets_list);
+		return NULL;
+	}
+
 	/* use locally dup'd copy of sinfo so we don't modify the original */
 	try {
 		nsinfo = new server_info(*sinfo);
@@ -3162,7 +3650,7 @@ find_jobs_to_preempt(status *policy, resource_resv *hjob, server_info *sinfo, in
 	}
 
 	skipto = 0;
-	while ((indexfound = select_index_to_preempt(npolicy, nhjob, rjobs_subset, skipto, err, fail_list)) != NO_JOB_FOUND) {
+	while ((indexfound = select_index_to_preempt(npolicy, nhjob, rjobs_subset, skipto, err, pidx)) != NO_JOB_FOUND) {
 		struct preempt_ordering *po;
 		int dont_preempt_job = 0;
 		int ind = 0;
@@ -3365,191 +3853,230 @@ cleanup:
 
 /**
  * @brief
- *		select a good candidate for preemption
+ *		check if any of a running job's nodes could satisfy a chunk of the
+ *		high priority job.  The nodes are compared against their total
+ *		resources, so the answer for a node is remembered in the index.
  *
  * @param[in] policy - policy info
  * @param[in] hjob - the high priority job to preempt for
- * @param[in] rjobs - the list of running jobs to select from
- * @param[in] skipto - Index from where we need to start looking into rjobs
- * @param[in] err    - reason the high prio job isn't running
- * @param[in] fail_list - list of jobs to skip. They previously failed to be preempted.
- *			  Do not select them again.
+ * @param[in] rjob - the running job
+ * @param[in,out] pidx - preemption index of hjob
  *
- * @return long
- * @retval index of the job to preempt
- * @retval NO_JOB_FOUND nothing can be selected for preemption
- * @retval ERR_IN_SELECT error
+ * @return int
+ * @retval 1 a node is useful
+ * @retval 0 no node is useful
+ * @retval -1 error
  */
-long
-select_index_to_preempt(status *policy, resource_resv *hjob,
-			resource_resv **rjobs, long skipto, schd_error *err,
-			int *fail_list)
+static int
+preempt_nodes_useful(status *policy, resource_resv *hjob, resource_resv *rjob, preempt_index &pidx)
 {
-	int i, j, k;
-	int good = 1; /* good boolean: Is job eligible to be preempted */
-	struct preempt_ordering *po;
+	schd_error *err = NULL;
+	int node_good = 0;
 
-	if (err == NULL || hjob == NULL || hjob->job == NULL ||
-	    rjobs == NULL || rjobs[0] == NULL)
-		return NO_JOB_FOUND;
+	for (int j = 0; rjob->ninfo_arr[j] != NULL && !node_good; j++) {
+		node_info *node = rjob->ninfo_arr[j];
+		bool only_check_noncons = false;
 
-	/* This shouldn't happen, but you can never be too paranoid */
-	if (hjob->job->is_running && hjob->ninfo_arr == NULL)
-		return NO_JOB_FOUND;
+		auto nu = pidx.node_useful.find(node->rank);
+		if (nu != pidx.node_useful.end()) {
+			node_good = nu->second;
+			continue;
+		}
 
-	/* if we find a good job, we'll break out at the bottom
-	 * we can't break out up here since i will be incremented by this point
-	 * and we'll be returning the job AFTER the one we want too
-	 */
-	for (i = skipto; rjobs[i] != NULL; i++) {
-		/* Does the running job have any resource we need? */
-		int node_good = 1;
+		if (err == NULL) {
+			err = new_schd_error();
+			if (err == NULL)
+				return -1;
+		}
 
-		/* lets be optimistic.. we'll start off assuming this is a good candidate */
-		good = 1;
+		if (node->is_multivnoded) {
+			/* unsafe to consider vnodes from multivnoded hosts "no good" when "not enough" of some consumable
+			 * resource can be found in the vnode, since rest may be provided by other vnodes on the same host
+			 * restrict check on these vnodes to check only against non consumable resources
+			 */
+			if (policy->resdef_to_check_noncons.empty()) {
+				for (const auto &rtc : policy->resdef_to_check) {
+					if (rtc->type.is_non_consumable)
+						policy->resdef_to_check_noncons.insert(rtc);
+				}
+			}
+			only_check_noncons = true;
+		}
+		for (int k = 0; hjob->select->chunks[k] != NULL; k++) {
+			long num_chunks_returned = 0;
+			unsigned int flags = COMPARE_TOTAL | CHECK_ALL_BOOLS | UNSET_RES_ZERO;
+			/* if only non consumables are checked, infinite number of chunks can be satisfied,
+			 * and SCHD_INFINITY is negative, so don't be tempted to check on positive value
+			 */
+			clear_schd_error(err);
+			if (only_check_noncons) {
+				if (!policy->resdef_to_check_noncons.empty())
+					num_chunks_returned = check_avail_resources(node, hjob->select->chunks[k]->req,
+										    flags, policy->resdef_to_check_noncons, INSUFFICIENT_RESOURCE, err);
+				else
+					num_chunks_returned = SCHD_INFINITY;
+			} else
+				num_chunks_returned = check_avail_resources(node, hjob->select->chunks[k]->req,
+									    flags, INSUFFICIENT_RESOURCE, err);
 
-		/* if hjob hit a hard limit, check if candidate job has requested that resource
-		 * if reason is different then set flag as if resource was found
-		 */
+			if ((num_chunks_returned > 0) || (num_chunks_returned == SCHD_INFINITY)) {
+				node_good = 1;
+				break;
+			}
+		}
+		pidx.node_useful[node->rank] = node_good;
+	}
+	free_schd_error(err);
 
-		if (rjobs[i]->job == NULL || rjobs[i]->ninfo_arr == NULL)
-			continue; /* we have problems... */
+	return node_good;
+}
 
-		if (!rjobs[i]->job->is_running)
-			/* Only running jobs have resources allocated to them.
-			 * They are only eligible to preempt.
-			 */
-			good = 0;
+/**
+ * @brief
+ *		check the parts of a running job's eligibility for preemption which
+ *		do not change while preemption is simulated: whether it can be
+ *		preempted at all, by which method, and whether its nodes are of any
+ *		use to the high priority job.  The answer is remembered in the index.
+ *
+ * @param[in] policy - policy info
+ * @param[in] hjob - the high priority job to preempt for
+ * @param[in] rjob - the running job
+ * @param[in,out] pidx - preemption index of hjob
+ *
+ * @return int
+ * @retval 1 job is a candidate
+ * @retval 0 job is not a candidate
+ * @retval -1 error
+ */
+static int
+preempt_candidate_ok(status *policy, resource_resv *hjob, resource_resv *rjob, preempt_index &pidx)
+{
+	struct preempt_ordering *po;
+	int good = 1;
+	int j;
 
-		if (rjobs[i]->job->is_provisioning)
-			good = 0; /* provisioning job cannot be preempted */
+	auto co = pidx.cand_ok.find(rjob->rank);
+	if (co != pidx.cand_ok.end())
+		return co->second;
 
-		if (good) {
-			if (rjobs[i]->job->can_not_preempt ||
-			    rjobs[i]->job->preempt >= hjob->job->preempt)
-				good = 0;
-		}
+	if (rjob->job->is_provisioning)
+		good = 0; /* provisioning job cannot be preempted */
 
-		if (good) {
-			for (j = 0; fail_list[j] != 0; j++) {
-				if (fail_list[j] == rjobs[i]->rank) {
-					good = 0;
-					break;
-				}
-			}
-		}
+	if (good && rjob->job->can_not_preempt)
+		good = 0;
 
-		if (good) {
-			/* get the preemption order to be used for this job */
-			po = schd_get_preempt_order(rjobs[i]);
+	if (good && pidx.failed.find(rjob->rank) != pidx.failed.end())
+		good = 0;
 
-			/* check whether chosen order is enabled for this job */
-			for (j = 0; j < PREEMPT_METHOD_HIGH; j++) {
-				if (po->order[j] == PREEMPT_METHOD_SUSPEND &&
-				    rjobs[i]->job->can_suspend)
-					break; /* suspension is always allowed */
+	if (good) {
+		/* get the preemption order to be used for this job */
+		po = schd_get_preempt_order(rjob);
 
-				if (po->order[j] == PREEMPT_METHOD_CHECKPOINT &&
-				    rjobs[i]->job->can_checkpoint)
-					break; /* choose if checkpoint is allowed */
+		/* check whether chosen order is enabled for this job */
+		for (j = 0; j < PREEMPT_METHOD_HIGH; j++) {
+			if (po->order[j] == PREEMPT_METHOD_SUSPEND &&
+			    rjob->job->can_suspend)
+				break; /* suspension is always allowed */
 
-				if (po->order[j] == PREEMPT_METHOD_REQUEUE &&
-				    rjobs[i]->job->can_requeue)
-					break; /* choose if requeue is allowed */
-				if (po->order[j] == PREEMPT_METHOD_DELETE)
-					break;
-			}
-			if (j == PREEMPT_METHOD_HIGH) /* no preemption method good */
+			if (po->order[j] == PREEMPT_METHOD_CHECKPOINT &&
+			    rjob->job->can_checkpoint)
+				break; /* choose if checkpoint is allowed */
+
+			if (po->order[j] == PREEMPT_METHOD_REQUEUE &&
+			    rjob->job->can_requeue)
+				break; /* choose if requeue is allowed */
+			if (po->order[j] == PREEMPT_METHOD_DELETE)
+				break;
+		}
+		if (j == PREEMPT_METHOD_HIGH) /* no preemption method good */
+			good = 0;
+	}
+
+	if (good) {
+		for (j = 0; good && rjob->ninfo_arr[j] != NULL; j++) {
+			if (rjob->ninfo_arr[j]->is_down || rjob->ninfo_arr[j]->is_offline)
 				good = 0;
 		}
+	}
 
-		if (good) {
-			for (j = 0; good && rjobs[i]->ninfo_arr[j] != NULL; j++) {
-				if (rjobs[i]->ninfo_arr[j]->is_down || rjobs[i]->ninfo_arr[j]->is_offline)
-					good = 0;
+	/* if the high priority job is suspended then make sure we only
+	 * select jobs from the node the job is currently suspended on
+	 */
+	if (good && hjob->ninfo_arr != NULL) {
+		good = 0;
+		for (j = 0; rjob->ninfo_arr[j] != NULL; j++) {
+			if (pidx.hjob_nodes.find(rjob->ninfo_arr[j]->rank) != pidx.hjob_nodes.end()) {
+				good = 1;
+				break;
 			}
 		}
+	}
 
-		/* if the high priority job is suspended then make sure we only
-		 * select jobs from the node the job is currently suspended on
-		 */
+	if (good) {
+		good = preempt_nodes_useful(policy, hjob, rjob, pidx);
+		if (good == -1)
+			return -1;
+	}
 
-		if (good) {
-			if (hjob->ninfo_arr != NULL) {
-				for (j = 0; hjob->ninfo_arr[j] != NULL; j++) {
-					if (find_node_by_rank(rjobs[i]->ninfo_arr,
-							      hjob->ninfo_arr[j]->rank) != NULL)
-						break;
-				}
+	pidx.cand_ok[rjob->rank] = good;
+	return good;
+}
 
-				/* if we made all the way through the list, then rjobs[i] has no useful
-				 * nodes for us to use... don't select it, unless it's not node resources we're after
-				 */
+/**
+ * @brief
+ *		select a good candidate for preemption
+ *
+ * @param[in] policy - policy info
+ * @param[in] hjob - the high priority job to preempt for
+ * @param[in] rjobs - the list of running jobs to select from
+ * @param[in] skipto - Index from where we need to start looking into rjobs
+ * @param[in] err    - reason the high prio job isn't running
+ * @param[in,out] pidx - preemption index of hjob.  pidx.failed holds the jobs
+ *			 which previously failed to be preempted.  Do not select
+ *			 them again.
+ *
+ * @return long
+ * @retval index of the job to preempt
+ * @retval NO_JOB_FOUND nothing can be selected for preemption
+ * @retval ERR_IN_SELECT error
+ */
+long
+select_index_to_preempt(status *policy, resource_resv *hjob,
+			resource_resv **rjobs, long skipto, schd_error *err,
+			preempt_index &pidx)
+{
+	int i;
 
-				if (hjob->ninfo_arr[j] == NULL)
-					good = 0;
-			}
-		}
-		if (good) {
-			schd_error *err;
-			node_good = 0;
+	if (err == NULL || hjob == NULL || hjob->job == NULL ||
+	    rjobs == NULL || rjobs[0] == NULL)
+		return NO_JOB_FOUND;
 
-			err = new_schd_error();
-			if (err == NULL)
-				return NO_JOB_FOUND;
+	/* This shouldn't happen, but you can never be too paranoid */
+	if (hjob->job->is_running && hjob->ninfo_arr == NULL)
+		return NO_JOB_FOUND;
 
-			for (j = 0; rjobs[i]->ninfo_arr[j] != NULL && !node_good; j++) {
-				node_info *node = rjobs[i]->ninfo_arr[j];
-				bool only_check_noncons = false;
+	for (i = skipto; rjobs[i] != NULL; i++) {
+		int rc;
 
-				if (node->is_multivnoded) {
-					/* unsafe to consider vnodes from multivnoded hosts "no good" when "not enough" of some consumable
-					 * resource can be found in the vnode, since rest may be provided by other vnodes on the same host
-					 * restrict check on these vnodes to check only against non consumable resources
-					 */
-					if (policy->resdef_to_check_noncons.empty()) {
-						for (const auto &rtc : policy->resdef_to_check) {
-							if (rtc->type.is_non_consumable)
-								policy->resdef_to_check_noncons.insert(rtc);
-						}
-					}
-					only_check_noncons = true;
-				}
-				for (k = 0; hjob->select->chunks[k] != NULL; k++) {
-					long num_chunks_returned = 0;
-					unsigned int flags = COMPARE_TOTAL | CHECK_ALL_BOOLS | UNSET_RES_ZERO;
-					/* if only non consumables are checked, infinite number of chunks can be satisfied,
-					 * and SCHD_INFINITY is negative, so don't be tempted to check on positive value
-					 */
-					clear_schd_error(err);
-					if (only_check_noncons) {
-						if (!policy->resdef_to_check_noncons.empty())
-							num_chunks_returned = check_avail_resources(node->res, hjob->select->chunks[k]->req,
-												    flags, policy->resdef_to_check_noncons, INSUFFICIENT_RESOURCE, err);
-						else
-							num_chunks_returned = SCHD_INFINITY;
-					} else
-						num_chunks_returned = check_avail_resources(node->res, hjob->select->chunks[k]->req,
-											    flags, INSUFFICIENT_RESOURCE, err);
-
-					if ((num_chunks_returned > 0) || (num_chunks_returned == SCHD_INFINITY)) {
-						node_good = 1;
-						break;
-					}
-				}
-			}
-			free_schd_error(err);
-		}
+		if (rjobs[i]->job == NULL || rjobs[i]->ninfo_arr == NULL)
+			continue; /* we have problems... */
 
-		if (node_good == 0)
-			good = 0;
+		/* Only running jobs have resources allocated to them.
+		 * They are only eligible to preempt.
+		 */
+		if (!rjobs[i]->job->is_running)
+			continue;
 
-		if (good)
-			break;
-	}
+		/* a job's preemption priority can change as work is preempted */
+		if (rjobs[i]->job->preempt >= hjob->job->preempt)
+			continue;
 
-	if (good && rjobs[i] != NULL)
-		return i;
+		rc = preempt_candidate_ok(policy, hjob, rjobs[i], pidx);
+		if (rc == -1)
+			return NO_JOB_FOUND;
+		if (rc == 1)
+			return i;
+	}
 
 	return NO_JOB_FOUND;
 }
@@ -3959,10 +4486,11 @@ queue_subjob(resource_resv *array, server_info *sinfo,
 	return rresv;
 }
 
+#ifdef PYTHON
 /**
  * @brief
  * 		evaluate a math formula for jobs based on their resources
- *		NOTE: currently done through embedded python interpreter
+ *		through the embedded python interpreter
  *
  * @param[in]	formula	-	formula to evaluate
  * @param[in]	resresv	-	job for special case key words
@@ -3970,11 +4498,10 @@ queue_subjob(resource_resv *array, server_info *sinfo,
  *
  * @return	evaluated formula answer or 0 on exception
  *
+ * @par MT-safe: No
  */
-
-#ifdef PYTHON
 sch_resource_t
-formula_evaluate(const char *formula, resource_resv *resresv, resource_req *resreq)
+formula_evaluate_python(const char *formula, resource_resv *resresv, resource_req *resreq)
 {
 	char buf[1024];
 	char *globals;
@@ -4085,13 +4612,47 @@ formula_evaluate(const char *formula, resource_resv *resresv, resource_req *resr
 
 	return ans;
 }
-#else
+#endif
+
+/**
+ * @brief
+ * 		evaluate a math formula for jobs based on their resources
+ *		NOTE: formulas which can be compiled are evaluated natively,
+ *		      anything else is done through embedded python interpreter
+ *
+ * @param[in]	formula	-	formula to evaluate
+ * @param[in]	resresv	-	job for special case key words
+ * @param[in]	resreq	-	resources to use when evaluating
+ *
+ * @return	evaluated formula answer or 0 on exception
+ *
+ */
 sch_resource_t
-formula_evaluate(char *formula, resource_resv *resresv, resource_req *resreq)
+formula_evaluate(const char *formula, resource_resv *resresv, resource_req *resreq)
 {
+	sch_resource_t ans = 0;
+	std::string errmsg;
+
+	if (formula == NULL || resresv == NULL ||
+	    resresv->job == NULL)
+		return 0;
+
+	auto cf = get_compiled_formula(formula);
+	if (cf != nullptr) {
+		auto rc = eval_compiled_formula(*cf, resresv, resreq, &ans, errmsg);
+		if (rc == FORMULA_EVAL_ERR)
+			log_eventf(PBSEVENT_DEBUG2, PBS_EVENTCLASS_JOB, LOG_DEBUG, resresv->name,
+				   "Formula evaluation for job had an error.  Zero value will be used: %s", errmsg.c_str());
+		if (rc != FORMULA_EVAL_PYTHON)
+			return ans;
+	}
+
+#ifdef PYTHON
+	return formula_evaluate_python(formula, resresv, resreq);
+#else
 	return 0;
-}
 #endif
+}
 
 /**
  * @brief
@@ -4624,8 +5185,7 @@ create_res_released(status *policy, resource_resv *pjob)
 		pjob->job->resreq_rel = create_resreq_rel_list(policy, pjob);
 	}
 	selectspec = create_select_from_nspec(pjob->job->resreleased);
-	delete pjob->execselect;
-	pjob->execselect = parse_selspec(selectspec);
+	pjob->execselect.reset(parse_selspec(selectspec));
 	return;
 }
 
@@ -71,6 +71,18 @@ job_info *new_job_info();
 
 void free_job_info(job_info *jinfo);
 
+/*
+ *	invalidate_job_status_cache - throw away the job statuses cached for
+ *				      incremental job queries
+ */
+void invalidate_job_status_cache(void);
+
+/*
+ *	prune_job_status_cache - drop cached job statuses of queues not queried
+ *				 this cycle
+ */
+void prune_job_status_cache(void);
+
 /*
  *      set_job_state - set the state flag in a job_info structure
  *                      i.e. the is_* bit
@@ -167,7 +179,7 @@ find_jobs_to_preempt(status *policy, resource_resv *hjob,
 long
 select_index_to_preempt(status *policy, resource_resv *hjob,
 			resource_resv **rjobs, long skipto, schd_error *err,
-			int *fail_list);
+			preempt_index &pidx);
 
 /*
  *      preempt_level - take a preemption priority and return a preemption
@@ -249,6 +261,14 @@ queue_subjob(resource_resv *array, server_info *sinfo,
 
 sch_resource_t formula_evaluate(const char *formula, resource_resv *resresv, resource_req *resreq);
 
+#ifdef PYTHON
+/*
+ *	formula_evaluate_python - evaluate a math formula for a job through
+ *		the embedded python interpreter
+ */
+sch_resource_t formula_evaluate_python(const char *formula, resource_resv *resresv, resource_req *resreq);
+#endif
+
 /*
  *
  *      update_accruetype - Updates accrue_type of job on server.
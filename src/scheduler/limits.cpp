@@ -89,11 +89,10 @@
  * 	lim_setoldlimits()
  * 	lim_dup_ctx()
  * 	is_hardlimit()
- * 	lim_gengroupreskey()
- * 	lim_genprojectreskey()
- * 	lim_genuserreskey()
  * 	lim_callback()
  * 	lim_get()
+ * 	lim_get_run()
+ * 	lim_get_res()
  * 	schderr_args_q()
  * 	schderr_args_q_res()
  * 	schderr_args_server()
@@ -116,6 +115,12 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
 #include "pbs_config.h"
 #include "pbs_ifl.h"
 #include "data_types.h"
@@ -128,19 +133,34 @@
 #include "resource.h"
 #include "globals.h"
 
+/*
+ * The counts a limit is checked against.  The counts are either copies owned
+ * by the limcounts (e.g., to be updated for a calendar walk) or a read-only
+ * view of counts owned by someone else.
+ */
 class limcounts {
+      private:
+	counts_umap own_user;
+	counts_umap own_group;
+	counts_umap own_project;
+	counts_umap own_all;
+
       public:
-	counts_umap user;
-	counts_umap group;
-	counts_umap project;
-	counts_umap all;
+	counts_umap &user;
+	counts_umap &group;
+	counts_umap &project;
+	counts_umap &all;
 	limcounts() = delete;
 	limcounts(const counts_umap &ruser,
 		  const counts_umap &rgroup,
 		  const counts_umap &rproject,
 		  const counts_umap &rall);
+	limcounts(counts_umap *vuser,
+		  counts_umap *vgroup,
+		  counts_umap *vproject,
+		  counts_umap *vall);
 	limcounts(const limcounts &);
-	limcounts &operator=(const limcounts &);
+	limcounts &operator=(const limcounts &) = delete;
 	~limcounts();
 };
 
@@ -369,9 +389,6 @@ static int
 lim_callback(void *, enum lim_keytypes, char *, char *,
 	     char *, char *);
 static void *lim_dup_ctx(void *);
-static char *lim_gengroupreskey(const char *);
-static char *lim_genprojectreskey(const char *);
-static char *lim_genuserreskey(const char *);
 static void schderr_args_q(const std::string &, const char *, schd_error *);
 static void schderr_args_q(const std::string &, const std::string &, schd_error *);
 static void schderr_args_q_res(const std::string &, const char *, char *, schd_error *);
@@ -380,6 +397,8 @@ static void schderr_args_server(const char *, schd_error *);
 static void schderr_args_server(const std::string &, schd_error *);
 static void schderr_args_server_res(std::string &, const char *, schd_error *);
 static sch_resource_t lim_get(const char *, void *);
+static sch_resource_t lim_get_run(void *, enum lim_keytypes, const char *);
+static sch_resource_t lim_get_res(void *, enum lim_keytypes, const char *, const schd_resource *);
 static int lim_setoldlimits(const struct attrl *, void *);
 static int lim_setreslimits(const struct attrl *, void *);
 static int lim_setrunlimits(const struct attrl *, void *);
@@ -421,6 +440,34 @@ struct limit_info {
  *		issue.
  */
 static schd_resource *limres; /* list of resources that have limits */
+
+/*
+ * Limit values already fetched from a limit context for an entity.  Fetching
+ * a limit means building its key, looking it up in the context, and parsing
+ * its value.  The limit checks ask for the same limits over and over, so each
+ * is fetched only once.
+ */
+struct lim_entity_limits {
+	bool has_run;		/* run limit has been fetched */
+	sch_resource_t run;	/* run limit */
+	std::unordered_map<const schd_resource *, sch_resource_t> res; /* resource limits by limres entry */
+};
+typedef std::unordered_map<std::string, lim_entity_limits> lim_ctx_cache;
+
+/*
+ * The cached limits of each limit context.  A duplicated context holds the
+ * same limits as the original, so it shares the original's cache until
+ * either has a limit set.
+ */
+static std::unordered_map<void *, std::shared_ptr<lim_ctx_cache>> lim_caches;
+
+/*
+ * protects lim_caches, the universes simulated on the worker threads share
+ * caches.  Lookups of cached limits only take it for reading.  Filling in a
+ * limit on a miss and changing the caches take it for writing.
+ */
+static pthread_rwlock_t lim_caches_lock = PTHREAD_RWLOCK_INITIALIZER;
+
 /**
  * @brief
  * 		We currently store both resource and run limits in a
@@ -497,6 +544,12 @@ lim_dup_liminfo(void *p)
 		} else
 			LI2RESCTXSOFT(newlip) = ctx;
 
+		/* the copies hold the same limits, so share the cached ones */
+		pthread_rwlock_wrlock(&lim_caches_lock);
+		lim_caches[LI2RESCTX(newlip)] = lim_caches[LI2RESCTX(oldlip)];
+		lim_caches[LI2RESCTXSOFT(newlip)] = lim_caches[LI2RESCTXSOFT(oldlip)];
+		pthread_rwlock_unlock(&lim_caches_lock);
+
 		/*
 		 *	We currently store both resource and run limits in a
 		 *	single member of the limit_info structure.  That might
@@ -527,10 +580,16 @@ lim_free_liminfo(void *p)
 		return;
 
 	if (LI2RESCTX(lip) != NULL) {
+		pthread_rwlock_wrlock(&lim_caches_lock);
+		lim_caches.erase(LI2RESCTX(lip));
+		pthread_rwlock_unlock(&lim_caches_lock);
 		(void) entlim_free_ctx(LI2RESCTX(lip), free);
 		LI2RESCTX(lip) = NULL;
 	}
 	if (LI2RESCTXSOFT(lip) != NULL) {
+		pthread_rwlock_wrlock(&lim_caches_lock);
+		lim_caches.erase(LI2RESCTXSOFT(lip));
+		pthread_rwlock_unlock(&lim_caches_lock);
 		(void) entlim_free_ctx(LI2RESCTXSOFT(lip), free);
 		LI2RESCTXSOFT(lip) = NULL;
 	}
@@ -727,41 +786,41 @@ has_softlimits(void *p)
 limcounts::limcounts(const counts_umap &ruser,
 		     const counts_umap &rgroup,
 		     const counts_umap &rproject,
-		     const counts_umap &rall)
+		     const counts_umap &rall) : own_user(dup_counts_umap(ruser)),
+						own_group(dup_counts_umap(rgroup)),
+						own_project(dup_counts_umap(rproject)),
+						own_all(dup_counts_umap(rall)),
+						user(own_user), group(own_group),
+						project(own_project), all(own_all)
 {
-	user = dup_counts_umap(ruser);
-	group = dup_counts_umap(rgroup);
-	project = dup_counts_umap(rproject);
-	all = dup_counts_umap(rall);
 }
 
-// Copy Constructor
-limcounts::limcounts(const limcounts &rlimit)
+// View Constructor: refers to the counts without copying them
+limcounts::limcounts(counts_umap *vuser,
+		     counts_umap *vgroup,
+		     counts_umap *vproject,
+		     counts_umap *vall) : user(*vuser), group(*vgroup),
+					  project(*vproject), all(*vall)
 {
-	user = dup_counts_umap(rlimit.user);
-	group = dup_counts_umap(rlimit.group);
-	project = dup_counts_umap(rlimit.project);
-	all = dup_counts_umap(rlimit.all);
 }
 
-// Assignment operator
-limcounts &
-limcounts::operator=(const limcounts &rlimit)
+// Copy Constructor
+limcounts::limcounts(const limcounts &rlimit) : own_user(dup_counts_umap(rlimit.user)),
+						own_group(dup_counts_umap(rlimit.group)),
+						own_project(dup_counts_umap(rlimit.project)),
+						own_all(dup_counts_umap(rlimit.all)),
+						user(own_user), group(own_group),
+						project(own_project), all(own_all)
 {
-	user = dup_counts_umap(rlimit.user);
-	group = dup_counts_umap(rlimit.group);
-	project = dup_counts_umap(rlimit.project);
-	all = dup_counts_umap(rlimit.all);
-	return *this;
 }
 
-// destructor
+// destructor: only the copies are ours to free
 limcounts::~limcounts()
 {
-	free_counts_list(user);
-	free_counts_list(group);
-	free_counts_list(project);
-	free_counts_list(all);
+	free_counts_list(own_user);
+	free_counts_list(own_group);
+	free_counts_list(own_project);
+	free_counts_list(own_all);
 }
 
 /**
@@ -958,34 +1017,37 @@ check_limits(server_info *si, queue_info *qi, resource_resv *rr, schd_error *err
 			}
 		}
 	}
+	/* The limit functions only read the counts.  Unless we had to walk the
+	 * calendar, check against the counts themselves rather than copies.
+	 */
 	if ((flags & CHECK_LIMIT)) {
 		if (svr_counts_max != NULL) {
 			server_lim = svr_counts_max;
 		} else {
-			server_lim = new limcounts(si->user_counts,
-						   si->group_counts,
-						   si->project_counts,
-						   si->alljobcounts);
+			server_lim = new limcounts(&si->user_counts,
+						   &si->group_counts,
+						   &si->project_counts,
+						   &si->alljobcounts);
 		}
 		if (que_counts_max != NULL) {
 			queue_lim = que_counts_max;
 		} else {
-			queue_lim = new limcounts(qi->user_counts,
-						  qi->group_counts,
-						  qi->project_counts,
-						  qi->alljobcounts);
+			queue_lim = new limcounts(&qi->user_counts,
+						  &qi->group_counts,
+						  &qi->project_counts,
+						  &qi->alljobcounts);
 		}
 	} else if ((flags & CHECK_CUMULATIVE_LIMIT)) {
 		if (!si->has_hard_limit && !qi->has_hard_limit)
 			return SE_NONE;
-		server_lim = new limcounts(si->total_user_counts,
-					   si->total_group_counts,
-					   si->total_project_counts,
-					   si->total_alljobcounts);
-		queue_lim = new limcounts(qi->total_user_counts,
-					  qi->total_group_counts,
-					  qi->total_project_counts,
-					  qi->total_alljobcounts);
+		server_lim = new limcounts(&si->total_user_counts,
+					   &si->total_group_counts,
+					   &si->total_project_counts,
+					   &si->total_alljobcounts);
+		queue_lim = new limcounts(&qi->total_user_counts,
+					  &qi->total_group_counts,
+					  &qi->total_project_counts,
+					  &qi->total_alljobcounts);
 	}
 	for (i = 0; i < sizeof(limfuncs) / sizeof(limfuncs[0]); i++) {
 		rc = static_cast<enum sched_error_code>((limfuncs[i])(si, qi, rr, server_lim, queue_lim, err));
@@ -1142,7 +1204,6 @@ static int
 check_server_max_user_run(server_info *si, queue_info *qi, resource_resv *rr,
 			  limcounts *sc, limcounts *qc, schd_error *err)
 {
-	char *key;
 	std::string user;
 	int used;
 	int max_user_run, max_genuser_run;
@@ -1157,15 +1218,9 @@ check_server_max_user_run(server_info *si, queue_info *qi, resource_resv *rr,
 
 	auto &cts = sc->user;
 
-	if ((key = entlim_mk_runkey(LIM_USER, user.c_str())) == NULL)
-		return (SCHD_ERROR);
-	max_user_run = (int) lim_get(key, LI2RUNCTX(si->liminfo));
-	free(key);
+	max_user_run = (int) lim_get_run(LI2RUNCTX(si->liminfo), LIM_USER, user.c_str());
 
-	if ((key = entlim_mk_runkey(LIM_USER, genparam)) == NULL)
-		return (SCHD_ERROR);
-	max_genuser_run = (int) lim_get(key, LI2RUNCTX(si->liminfo));
-	free(key);
+	max_genuser_run = (int) lim_get_run(LI2RUNCTX(si->liminfo), LIM_USER, genparam);
 
 	if ((max_user_run == SCHD_INFINITY) &&
 	    (max_genuser_run == SCHD_INFINITY))
@@ -1212,7 +1267,6 @@ static int
 check_server_max_group_run(server_info *si, queue_info *qi, resource_resv *rr,
 			   limcounts *sc, limcounts *qc, schd_error *err)
 {
-	char *key;
 	std::string group;
 	int used;
 	int max_group_run, max_gengroup_run;
@@ -1227,15 +1281,9 @@ check_server_max_group_run(server_info *si, queue_info *qi, resource_resv *rr,
 
 	auto &cts = sc->group;
 
-	if ((key = entlim_mk_runkey(LIM_GROUP, group.c_str())) == NULL)
-		return (SCHD_ERROR);
-	max_group_run = (int) lim_get(key, LI2RUNCTX(si->liminfo));
-	free(key);
+	max_group_run = (int) lim_get_run(LI2RUNCTX(si->liminfo), LIM_GROUP, group.c_str());
 
-	if ((key = entlim_mk_runkey(LIM_GROUP, genparam)) == NULL)
-		return (SCHD_ERROR);
-	max_gengroup_run = (int) lim_get(key, LI2RUNCTX(si->liminfo));
-	free(key);
+	max_gengroup_run = (int) lim_get_run(LI2RUNCTX(si->liminfo), LIM_GROUP, genparam);
 
 	if ((max_group_run == SCHD_INFINITY) &&
 	    (max_gengroup_run == SCHD_INFINITY))
@@ -1392,7 +1440,6 @@ static int
 check_queue_max_user_run(server_info *si, queue_info *qi, resource_resv *rr,
 			 limcounts *sc, limcounts *qc, schd_error *err)
 {
-	char *key;
 	std::string user;
 	int used;
 	int max_user_run, max_genuser_run;
@@ -1407,15 +1454,9 @@ check_queue_max_user_run(server_info *si, queue_info *qi, resource_resv *rr,
 
 	auto &cts = qc->user;
 
-	if ((key = entlim_mk_runkey(LIM_USER, user.c_str())) == NULL)
-		return (SCHD_ERROR);
-	max_user_run = (int) lim_get(key, LI2RUNCTX(qi->liminfo));
-	free(key);
+	max_user_run = (int) lim_get_run(LI2RUNCTX(qi->liminfo), LIM_USER, user.c_str());
 
-	if ((key = entlim_mk_runkey(LIM_USER, genparam)) == NULL)
-		return (SCHD_ERROR);
-	max_genuser_run = (int) lim_get(key, LI2RUNCTX(qi->liminfo));
-	free(key);
+	max_genuser_run = (int) lim_get_run(LI2RUNCTX(qi->liminfo), LIM_USER, genparam);
 
 	if ((max_user_run == SCHD_INFINITY) &&
 	    (max_genuser_run == SCHD_INFINITY))
@@ -1462,7 +1503,6 @@ static int
 check_queue_max_group_run(server_info *si, queue_info *qi, resource_resv *rr,
 			  limcounts *sc, limcounts *qc, schd_error *err)
 {
-	char *key;
 	std::string group;
 	int used;
 	int max_group_run, max_gengroup_run;
@@ -1477,15 +1517,9 @@ check_queue_max_group_run(server_info *si, queue_info *qi, resource_resv *rr,
 
 	auto &cts = qc->group;
 
-	if ((key = entlim_mk_runkey(LIM_GROUP, group.c_str())) == NULL)
-		return (SCHD_ERROR);
-	max_group_run = (int) lim_get(key, LI2RUNCTX(qi->liminfo));
-	free(key);
+	max_group_run = (int) lim_get_run(LI2RUNCTX(qi->liminfo), LIM_GROUP, group.c_str());
 
-	if ((key = entlim_mk_runkey(LIM_GROUP, genparam)) == NULL)
-		return (SCHD_ERROR);
-	max_gengroup_run = (int) lim_get(key, LI2RUNCTX(qi->liminfo));
-	free(key);
+	max_gengroup_run = (int) lim_get_run(LI2RUNCTX(qi->liminfo), LIM_GROUP, genparam);
 
 	if ((max_group_run == SCHD_INFINITY) &&
 	    (max_gengroup_run == SCHD_INFINITY))
@@ -1645,7 +1679,6 @@ static int
 check_queue_max_res(server_info *si, queue_info *qi, resource_resv *rr,
 		    limcounts *sc, limcounts *qc, schd_error *err)
 {
-	char *reskey;
 	sch_resource_t max_res;
 	sch_resource_t used;
 	schd_resource *res;
@@ -1669,11 +1702,7 @@ check_queue_max_res(server_info *si, queue_info *qi, resource_resv *rr,
 		if ((req = find_resource_req(rr->resreq, res->def)) == NULL)
 			continue;
 
-		if ((reskey = entlim_mk_reskey(LIM_OVERALL, allparam,
-					       res->name)) == NULL)
-			return (SCHD_ERROR);
-		max_res = lim_get(reskey, LI2RESCTX(qi->liminfo));
-		free(reskey);
+		max_res = lim_get_res(LI2RESCTX(qi->liminfo), LIM_OVERALL, allparam, res);
 
 		if (max_res == SCHD_INFINITY)
 			continue;
@@ -1718,7 +1747,6 @@ static int
 check_server_max_res(server_info *si, queue_info *qi, resource_resv *rr,
 		     limcounts *sc, limcounts *qc, schd_error *err)
 {
-	char *reskey;
 	sch_resource_t max_res;
 	sch_resource_t used;
 	schd_resource *res;
@@ -1743,11 +1771,7 @@ check_server_max_res(server_info *si, queue_info *qi, resource_resv *rr,
 		if ((req = find_resource_req(rr->resreq, res->def)) == NULL)
 			continue;
 
-		if ((reskey = entlim_mk_reskey(LIM_OVERALL, allparam,
-					       res->name)) == NULL)
-			return (SCHD_ERROR);
-		max_res = lim_get(reskey, LI2RESCTX(si->liminfo));
-		free(reskey);
+		max_res = lim_get_res(LI2RESCTX(si->liminfo), LIM_OVERALL, allparam, res);
 
 		if (max_res == SCHD_INFINITY)
 			continue;
@@ -1792,7 +1816,6 @@ check_server_max_run(server_info *si, queue_info *qi, resource_resv *rr,
 		     limcounts *sc, limcounts *qc, schd_error *err)
 {
 	int max_running;
-	char *key;
 	int running;
 
 	if (si == NULL)
@@ -1803,10 +1826,7 @@ check_server_max_run(server_info *si, queue_info *qi, resource_resv *rr,
 
 	auto &cts = sc->all;
 
-	if ((key = entlim_mk_runkey(LIM_OVERALL, allparam)) == NULL)
-		return (SCHD_ERROR);
-	max_running = (int) lim_get(key, LI2RUNCTX(si->liminfo));
-	free(key);
+	max_running = (int) lim_get_run(LI2RUNCTX(si->liminfo), LIM_OVERALL, allparam);
 
 	running = find_counts_elm(cts, PBS_ALL_ENTITY, NULL, NULL, NULL);
 
@@ -1843,7 +1863,6 @@ check_queue_max_run(server_info *si, queue_info *qi, resource_resv *rr,
 		    limcounts *sc, limcounts *qc, schd_error *err)
 {
 	int max_running;
-	char *key;
 	int running;
 
 	if (qi == NULL)
@@ -1854,11 +1873,7 @@ check_queue_max_run(server_info *si, queue_info *qi, resource_resv *rr,
 
 	auto &cts = qc->all;
 
-	if ((key = entlim_mk_runkey(LIM_OVERALL, allparam)) == NULL)
-		return (SCHD_ERROR);
-
-	max_running = (int) lim_get(key, LI2RUNCTX(qi->liminfo));
-	free(key);
+	max_running = (int) lim_get_run(LI2RUNCTX(qi->liminfo), LIM_OVERALL, allparam);
 
 	running = find_counts_elm(cts, PBS_ALL_ENTITY, NULL, NULL, NULL);
 
@@ -1891,7 +1906,6 @@ static int
 check_queue_max_run_soft(server_info *si, queue_info *qi, resource_resv *rr)
 {
 	int max_running;
-	char *key;
 	counts *cnt = NULL;
 	int used = 0;
 
@@ -1901,10 +1915,7 @@ check_queue_max_run_soft(server_info *si, queue_info *qi, resource_resv *rr)
 	if (!qi->has_all_limit)
 		return (0);
 
-	if ((key = entlim_mk_runkey(LIM_OVERALL, allparam)) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_running = (int) lim_get(key, LI2RUNCTXSOFT(qi->liminfo));
-	free(key);
+	max_running = (int) lim_get_run(LI2RUNCTXSOFT(qi->liminfo), LIM_OVERALL, allparam);
 
 	/* at this point, we know a limit is set for PBS_ALL*/
 	used = find_counts_elm(qi->alljobcounts, PBS_ALL_ENTITY, NULL, &cnt, NULL);
@@ -1938,7 +1949,6 @@ check_queue_max_run_soft(server_info *si, queue_info *qi, resource_resv *rr)
 static int
 check_queue_max_user_run_soft(server_info *si, queue_info *qi, resource_resv *rr)
 {
-	char *key;
 	std::string user;
 	int used;
 	int max_user_run_soft, max_genuser_run_soft;
@@ -1952,15 +1962,9 @@ check_queue_max_user_run_soft(server_info *si, queue_info *qi, resource_resv *rr
 
 	user = rr->user;
 
-	if ((key = entlim_mk_runkey(LIM_USER, user.c_str())) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_user_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(qi->liminfo));
-	free(key);
+	max_user_run_soft = (int) lim_get_run(LI2RUNCTXSOFT(qi->liminfo), LIM_USER, user.c_str());
 
-	if ((key = entlim_mk_runkey(LIM_USER, genparam)) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_genuser_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(qi->liminfo));
-	free(key);
+	max_genuser_run_soft = (int) lim_get_run(LI2RUNCTXSOFT(qi->liminfo), LIM_USER, genparam);
 
 	if ((max_user_run_soft == SCHD_INFINITY) &&
 	    (max_genuser_run_soft == SCHD_INFINITY))
@@ -2014,7 +2018,6 @@ static int
 check_queue_max_group_run_soft(server_info *si, queue_info *qi,
 			       resource_resv *rr)
 {
-	char *key;
 	std::string group;
 	int used;
 	int max_group_run_soft, max_gengroup_run_soft;
@@ -2028,15 +2031,9 @@ check_queue_max_group_run_soft(server_info *si, queue_info *qi,
 
 	group = rr->group;
 
-	if ((key = entlim_mk_runkey(LIM_GROUP, group.c_str())) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_group_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(qi->liminfo));
-	free(key);
+	max_group_run_soft = (int) lim_get_run(LI2RUNCTXSOFT(qi->liminfo), LIM_GROUP, group.c_str());
 
-	if ((key = entlim_mk_runkey(LIM_GROUP, genparam)) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_gengroup_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(qi->liminfo));
-	free(key);
+	max_gengroup_run_soft = (int) lim_get_run(LI2RUNCTXSOFT(qi->liminfo), LIM_GROUP, genparam);
 
 	if ((max_group_run_soft == SCHD_INFINITY) &&
 	    (max_gengroup_run_soft == SCHD_INFINITY))
@@ -2147,7 +2144,6 @@ static int
 check_server_max_run_soft(server_info *si, queue_info *qi, resource_resv *rr)
 {
 	int max_running;
-	char *key;
 	counts *cnt = NULL;
 	int used = 0;
 
@@ -2157,10 +2153,7 @@ check_server_max_run_soft(server_info *si, queue_info *qi, resource_resv *rr)
 	if (!si->has_all_limit)
 		return (0);
 
-	if ((key = entlim_mk_runkey(LIM_OVERALL, allparam)) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_running = (int) lim_get(key, LI2RUNCTXSOFT(si->liminfo));
-	free(key);
+	max_running = (int) lim_get_run(LI2RUNCTXSOFT(si->liminfo), LIM_OVERALL, allparam);
 
 	/* at this point, we know a limit is set for PBS_ALL*/
 	used = find_counts_elm(si->alljobcounts, PBS_ALL_ENTITY, NULL, &cnt, NULL);
@@ -2195,7 +2188,6 @@ static int
 check_server_max_user_run_soft(server_info *si, queue_info *qi,
 			       resource_resv *rr)
 {
-	char *key;
 	std::string user;
 	int used;
 	int max_user_run_soft, max_genuser_run_soft;
@@ -2209,15 +2201,9 @@ check_server_max_user_run_soft(server_info *si, queue_info *qi,
 
 	user = rr->user;
 
-	if ((key = entlim_mk_runkey(LIM_USER, user.c_str())) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_user_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(si->liminfo));
-	free(key);
+	max_user_run_soft = (int) lim_get_run(LI2RUNCTXSOFT(si->liminfo), LIM_USER, user.c_str());
 
-	if ((key = entlim_mk_runkey(LIM_USER, genparam)) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_genuser_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(si->liminfo));
-	free(key);
+	max_genuser_run_soft = (int) lim_get_run(LI2RUNCTXSOFT(si->liminfo), LIM_USER, genparam);
 
 	if ((max_user_run_soft == SCHD_INFINITY) &&
 	    (max_genuser_run_soft == SCHD_INFINITY))
@@ -2270,7 +2256,6 @@ static int
 check_server_max_group_run_soft(server_info *si, queue_info *qi,
 				resource_resv *rr)
 {
-	char *key;
 	std::string group;
 	int used;
 	int max_group_run_soft, max_gengroup_run_soft;
@@ -2284,15 +2269,9 @@ check_server_max_group_run_soft(server_info *si, queue_info *qi,
 
 	group = rr->group;
 
-	if ((key = entlim_mk_runkey(LIM_GROUP, group.c_str())) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_group_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(si->liminfo));
-	free(key);
+	max_group_run_soft = (int) lim_get_run(LI2RUNCTXSOFT(si->liminfo), LIM_GROUP, group.c_str());
 
-	if ((key = entlim_mk_runkey(LIM_GROUP, genparam)) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_gengroup_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(si->liminfo));
-	free(key);
+	max_gengroup_run_soft = (int) lim_get_run(LI2RUNCTXSOFT(si->liminfo), LIM_GROUP, genparam);
 
 	if ((max_group_run_soft == SCHD_INFINITY) &&
 	    (max_gengroup_run_soft == SCHD_INFINITY))
@@ -2404,7 +2383,6 @@ check_server_max_group_res_soft(server_info *si, queue_info *qi,
 static int
 check_server_max_res_soft(server_info *si, queue_info *qi, resource_resv *rr)
 {
-	char *reskey;
 	sch_resource_t max_res_soft;
 	sch_resource_t used;
 	schd_resource *res;
@@ -2423,11 +2401,7 @@ check_server_max_res_soft(server_info *si, queue_info *qi, resource_resv *rr)
 		if (find_resource_req(rr->resreq, res->def) == NULL)
 			continue;
 
-		if ((reskey = entlim_mk_reskey(LIM_OVERALL, allparam,
-					       res->name)) == NULL)
-			return (PREEMPT_TO_BIT(PREEMPT_ERR));
-		max_res_soft = lim_get(reskey, LI2RESCTXSOFT(si->liminfo));
-		free(reskey);
+		max_res_soft = lim_get_res(LI2RESCTXSOFT(si->liminfo), LIM_OVERALL, allparam, res);
 
 		if (max_res_soft == SCHD_INFINITY)
 			continue;
@@ -2473,7 +2447,6 @@ check_server_max_res_soft(server_info *si, queue_info *qi, resource_resv *rr)
 static int
 check_queue_max_res_soft(server_info *si, queue_info *qi, resource_resv *rr)
 {
-	char *reskey;
 	sch_resource_t max_res_soft;
 	sch_resource_t used;
 	schd_resource *res;
@@ -2492,11 +2465,7 @@ check_queue_max_res_soft(server_info *si, queue_info *qi, resource_resv *rr)
 		if (find_resource_req(rr->resreq, res->def) == NULL)
 			continue;
 
-		if ((reskey = entlim_mk_reskey(LIM_OVERALL, allparam,
-					       res->name)) == NULL)
-			return (PREEMPT_TO_BIT(PREEMPT_ERR));
-		max_res_soft = lim_get(reskey, LI2RESCTXSOFT(qi->liminfo));
-		free(reskey);
+		max_res_soft = lim_get_res(LI2RESCTXSOFT(qi->liminfo), LIM_OVERALL, allparam, res);
 
 		if (max_res_soft == SCHD_INFINITY)
 			continue;
@@ -2544,8 +2513,6 @@ static int
 check_max_group_res(resource_resv *rr, counts_umap &cts_list,
 		    resdef **rdef, void *limitctx)
 {
-	char *groupreskey;
-	char *gengroupreskey;
 	std::string group;
 	schd_resource *res;
 	sch_resource_t max_group_res;
@@ -2565,17 +2532,10 @@ check_max_group_res(resource_resv *rr, counts_umap &cts_list,
 			continue;
 
 		/* individual group limit check */
-		if ((groupreskey = entlim_mk_reskey(LIM_GROUP, group.c_str(),
-						    res->name)) == NULL)
-			return (-1);
-		max_group_res = lim_get(groupreskey, limitctx);
-		free(groupreskey);
+		max_group_res = lim_get_res(limitctx, LIM_GROUP, group.c_str(), res);
 
 		/* generic group limit check */
-		if ((gengroupreskey = lim_gengroupreskey(res->name)) == NULL)
-			return (-1);
-		max_gengroup_res = lim_get(gengroupreskey, limitctx);
-		free(gengroupreskey);
+		max_gengroup_res = lim_get_res(limitctx, LIM_GROUP, genparam, res);
 
 		if ((max_group_res == SCHD_INFINITY) &&
 		    (max_gengroup_res == SCHD_INFINITY))
@@ -2622,8 +2582,6 @@ check_max_group_res(resource_resv *rr, counts_umap &cts_list,
 static int
 check_max_group_res_soft(resource_resv *rr, counts_umap &cts_list, void *limitctx, int preempt_bit)
 {
-	char *groupreskey;
-	char *gengroupreskey;
 	std::string group;
 	schd_resource *res;
 	sch_resource_t max_group_res_soft;
@@ -2645,17 +2603,10 @@ check_max_group_res_soft(resource_resv *rr, counts_umap &cts_list, void *limitct
 			continue;
 
 		/* individual group limit check */
-		if ((groupreskey = entlim_mk_reskey(LIM_GROUP, group.c_str(),
-						    res->name)) == NULL)
-			return (-1);
-		max_group_res_soft = lim_get(groupreskey, limitctx);
-		free(groupreskey);
+		max_group_res_soft = lim_get_res(limitctx, LIM_GROUP, group.c_str(), res);
 
 		/* generic group limit check */
-		if ((gengroupreskey = lim_gengroupreskey(res->name)) == NULL)
-			return (-1);
-		max_gengroup_res_soft = lim_get(gengroupreskey, limitctx);
-		free(gengroupreskey);
+		max_gengroup_res_soft = lim_get_res(limitctx, LIM_GROUP, genparam, res);
 
 		if ((max_group_res_soft == SCHD_INFINITY) &&
 		    (max_gengroup_res_soft == SCHD_INFINITY))
@@ -2712,8 +2663,6 @@ static int
 check_max_user_res(resource_resv *rr, counts_umap &cts_list, resdef **rdef,
 		   void *limitctx)
 {
-	char *userreskey;
-	char *genuserreskey;
 	std::string user;
 	schd_resource *res;
 	sch_resource_t max_user_res;
@@ -2734,17 +2683,10 @@ check_max_user_res(resource_resv *rr, counts_umap &cts_list, resdef **rdef,
 			continue;
 
 		/* individual user limit check */
-		if ((userreskey = entlim_mk_reskey(LIM_USER, user.c_str(),
-						   res->name)) == NULL)
-			return (-1);
-		max_user_res = lim_get(userreskey, limitctx);
-		free(userreskey);
+		max_user_res = lim_get_res(limitctx, LIM_USER, user.c_str(), res);
 
 		/* generic user limit check */
-		if ((genuserreskey = lim_genuserreskey(res->name)) == NULL)
-			return (-1);
-		max_genuser_res = lim_get(genuserreskey, limitctx);
-		free(genuserreskey);
+		max_genuser_res = lim_get_res(limitctx, LIM_USER, genparam, res);
 
 		if ((max_user_res == SCHD_INFINITY) &&
 		    (max_genuser_res == SCHD_INFINITY))
@@ -2793,8 +2735,6 @@ static int
 check_max_user_res_soft(resource_resv **rr_arr, resource_resv *rr,
 			counts_umap &cts_list, void *limitctx, int preempt_bit)
 {
-	char *userreskey;
-	char *genuserreskey;
 	std::string user;
 	schd_resource *res;
 	sch_resource_t max_user_res_soft;
@@ -2816,17 +2756,10 @@ check_max_user_res_soft(resource_resv **rr_arr, resource_resv *rr,
 			continue;
 
 		/* individual user limit check */
-		if ((userreskey = entlim_mk_reskey(LIM_USER, user.c_str(),
-						   res->name)) == NULL)
-			return (-1);
-		max_user_res_soft = lim_get(userreskey, limitctx);
-		free(userreskey);
+		max_user_res_soft = lim_get_res(limitctx, LIM_USER, user.c_str(), res);
 
 		/* generic user limit check */
-		if ((genuserreskey = lim_genuserreskey(res->name)) == NULL)
-			return (-1);
-		max_genuser_res_soft = lim_get(genuserreskey, limitctx);
-		free(genuserreskey);
+		max_genuser_res_soft = lim_get_res(limitctx, LIM_USER, genparam, res);
 
 		if ((max_user_res_soft == SCHD_INFINITY) &&
 		    (max_genuser_res_soft == SCHD_INFINITY))
@@ -2911,6 +2844,11 @@ clear_limres(void)
 {
 	free_resource_list(limres);
 	limres = NULL;
+
+	/* cached resource limits are by limres entry */
+	pthread_rwlock_wrlock(&lim_caches_lock);
+	lim_caches.clear();
+	pthread_rwlock_unlock(&lim_caches_lock);
 }
 
 /**
@@ -3128,54 +3066,6 @@ is_hardlimit(const struct attrl *a)
 		return (0);
 }
 
-/**
- * @brief
- *		lim_gengroupreskey	special-purpose shortcut function to construct a
- *				generic group resource key
- *
- * @param[in]	res	-	the resource
- *
- * @return	a resource limit key if successful
- * @retval	NULL	: if not
- */
-static char *
-lim_gengroupreskey(const char *res)
-{
-	return (entlim_mk_reskey(LIM_GROUP, genparam, res));
-}
-
-/**
- * @brief
- *		lim_genprojectreskey	special-purpose shortcut function to construct a
- *				generic project resource key
- *
- * @param[in]	res	-	the resource
- *
- * @return	a resource limit key if successful
- * @retval	NULL	: if not
- */
-static char *
-lim_genprojectreskey(const char *res)
-{
-	return (entlim_mk_reskey(LIM_PROJECT, genparam, res));
-}
-
-/**
- * @brief
- *		lim_genuserreskey	special-purpose shortcut function to construct a
- *				generic user resource key
- *
- * @param[in]	res	-	the resource
- *
- * @return	a resource limit key on success
- * @retval	NULL	: on failure
- */
-static char *
-lim_genuserreskey(const char *res)
-{
-	return (entlim_mk_reskey(LIM_USER, genparam, res));
-}
-
 /**
  * @brief
  *		lim_callback install a new key of the given type and value
@@ -3215,6 +3105,11 @@ lim_callback(void *ctx, enum lim_keytypes kt, char *param, char *namestring,
 		return (-1);
 	}
 
+	/* the context's limits change, stop sharing its cached limits */
+	pthread_rwlock_wrlock(&lim_caches_lock);
+	lim_caches.erase(ctx);
+	pthread_rwlock_unlock(&lim_caches_lock);
+
 	if (entlim_add(key, v, ctx) != 0) {
 		log_eventf(PBSEVENT_SCHED, PBS_EVENTCLASS_SCHED, LOG_ERR, __func__,
 			   "limit set %s %s %s failed", key, res, val);
@@ -3260,6 +3155,175 @@ lim_get(const char *param, void *ctx)
 	}
 }
 
+/**
+ * @brief
+ *		lim_peek_entity	look up the cached limits of an entity in a limit
+ *		context without adding them
+ *
+ * @param[in]	ctx	-	the limit storage context
+ * @param[in]	kt	-	the entity type
+ * @param[in]	entity	-	the entity name
+ *
+ * @return	const lim_entity_limits *
+ * @retval	NULL	: the entity has no cached limits
+ *
+ * @par MT-safe: Only with lim_caches_lock held for reading
+ */
+static const lim_entity_limits *
+lim_peek_entity(void *ctx, enum lim_keytypes kt, const char *entity)
+{
+	auto c = lim_caches.find(ctx);
+	std::string ekey(1, static_cast<char>('0' + kt));
+
+	if (c == lim_caches.end() || c->second == nullptr)
+		return NULL;
+
+	ekey += entity;
+	auto ent = c->second->find(ekey);
+	if (ent == c->second->end())
+		return NULL;
+
+	return &ent->second;
+}
+
+/**
+ * @brief
+ *		lim_find_entity	find the cached limits of an entity in a limit context
+ *
+ * @param[in]	ctx	-	the limit storage context
+ * @param[in]	kt	-	the entity type
+ * @param[in]	entity	-	the entity name
+ *
+ * @return	lim_entity_limits &
+ *
+ * @par MT-safe: Only with lim_caches_lock held for writing
+ */
+static lim_entity_limits &
+lim_find_entity(void *ctx, enum lim_keytypes kt, const char *entity)
+{
+	auto &cache = lim_caches[ctx];
+	std::string ekey(1, static_cast<char>('0' + kt));
+
+	if (cache == nullptr)
+		cache = std::make_shared<lim_ctx_cache>();
+
+	ekey += entity;
+	auto ent = cache->find(ekey);
+	if (ent == cache->end()) {
+		ent = cache->emplace(ekey, lim_entity_limits()).first;
+		ent->second.has_run = false;
+		ent->second.run = SCHD_INFINITY;
+	}
+
+	return ent->second;
+}
+
+/**
+ * @brief
+ *		lim_get_run	fetch the run limit of an entity
+ *
+ * @param[in]	ctx	-	the limit storage context
+ * @param[in]	kt	-	the entity type
+ * @param[in]	entity	-	the entity name (or genparam/allparam)
+ *
+ * @return	sch_resource_t
+ * @retval	the value of the limit
+ * @retval	SCHD_INFINITY if no such limit exists in the named context
+ *
+ * @par MT-safe: Yes
+ */
+static sch_resource_t
+lim_get_run(void *ctx, enum lim_keytypes kt, const char *entity)
+{
+	const lim_entity_limits *cached;
+	sch_resource_t v;
+
+	pthread_rwlock_rdlock(&lim_caches_lock);
+	cached = lim_peek_entity(ctx, kt, entity);
+	if (cached != NULL && cached->has_run) {
+		v = cached->run;
+		pthread_rwlock_unlock(&lim_caches_lock);
+		return (v);
+	}
+	pthread_rwlock_unlock(&lim_caches_lock);
+
+	pthread_rwlock_wrlock(&lim_caches_lock);
+	auto &ent = lim_find_entity(ctx, kt, entity);
+
+	if (!ent.has_run) {
+		char *key;
+
+		if ((key = entlim_mk_runkey(kt, entity)) == NULL) {
+			pthread_rwlock_unlock(&lim_caches_lock);
+			log_err(errno, __func__, MEM_ERR_MSG);
+			return (SCHD_INFINITY);
+		}
+		ent.run = lim_get(key, ctx);
+		ent.has_run = true;
+		free(key);
+	}
+	v = ent.run;
+	pthread_rwlock_unlock(&lim_caches_lock);
+
+	return (v);
+}
+
+/**
+ * @brief
+ *		lim_get_res	fetch a resource limit of an entity
+ *
+ * @param[in]	ctx	-	the limit storage context
+ * @param[in]	kt	-	the entity type
+ * @param[in]	entity	-	the entity name (or genparam/allparam)
+ * @param[in]	res	-	the limited resource (an entry of limres)
+ *
+ * @return	sch_resource_t
+ * @retval	the value of the limit
+ * @retval	SCHD_INFINITY if no such limit exists in the named context
+ *
+ * @par MT-safe: Yes
+ */
+static sch_resource_t
+lim_get_res(void *ctx, enum lim_keytypes kt, const char *entity, const schd_resource *res)
+{
+	const lim_entity_limits *cached;
+	sch_resource_t v;
+
+	pthread_rwlock_rdlock(&lim_caches_lock);
+	cached = lim_peek_entity(ctx, kt, entity);
+	if (cached != NULL) {
+		auto r = cached->res.find(res);
+
+		if (r != cached->res.end()) {
+			v = r->second;
+			pthread_rwlock_unlock(&lim_caches_lock);
+			return (v);
+		}
+	}
+	pthread_rwlock_unlock(&lim_caches_lock);
+
+	pthread_rwlock_wrlock(&lim_caches_lock);
+	auto &ent = lim_find_entity(ctx, kt, entity);
+	auto r = ent.res.find(res);
+
+	if (r == ent.res.end()) {
+		char *key;
+
+		if ((key = entlim_mk_reskey(kt, entity, res->name)) == NULL) {
+			pthread_rwlock_unlock(&lim_caches_lock);
+			log_err(errno, __func__, MEM_ERR_MSG);
+			return (SCHD_INFINITY);
+		}
+		v = lim_get(key, ctx);
+		free(key);
+		ent.res[res] = v;
+	} else
+		v = r->second;
+	pthread_rwlock_unlock(&lim_caches_lock);
+
+	return (v);
+}
+
 /**
  * @brief
  *		schderr_args_q	log a queue-related run limit exceeded message
@@ -3369,8 +3433,6 @@ static int
 check_max_project_res(resource_resv *rr, counts_umap &cts_list,
 		      resdef **rdef, void *limitctx)
 {
-	char *projectreskey;
-	char *genprojectreskey;
 	schd_resource *res;
 	std::string project;
 	sch_resource_t max_project_res;
@@ -3389,17 +3451,10 @@ check_max_project_res(resource_resv *rr, counts_umap &cts_list,
 			continue;
 
 		/* individual project limit check */
-		if ((projectreskey = entlim_mk_reskey(LIM_PROJECT,
-						      project.c_str(), res->name)) == NULL)
-			return (-1);
-		max_project_res = lim_get(projectreskey, limitctx);
-		free(projectreskey);
+		max_project_res = lim_get_res(limitctx, LIM_PROJECT, project.c_str(), res);
 
 		/* generic project limit check */
-		if ((genprojectreskey = lim_genprojectreskey(res->name)) == NULL)
-			return (-1);
-		max_genproject_res = lim_get(genprojectreskey, limitctx);
-		free(genprojectreskey);
+		max_genproject_res = lim_get_res(limitctx, LIM_PROJECT, genparam, res);
 
 		if ((max_project_res == SCHD_INFINITY) &&
 		    (max_genproject_res == SCHD_INFINITY))
@@ -3446,8 +3501,6 @@ check_max_project_res(resource_resv *rr, counts_umap &cts_list,
 static int
 check_max_project_res_soft(resource_resv *rr, counts_umap &cts_list, void *limitctx, int preempt_bit)
 {
-	char *projectreskey;
-	char *genprojectreskey;
 	std::string project;
 	schd_resource *res;
 	sch_resource_t max_project_res_soft;
@@ -3468,17 +3521,10 @@ check_max_project_res_soft(resource_resv *rr, counts_umap &cts_list, void *limit
 			continue;
 
 		/* individual project limit check */
-		if ((projectreskey = entlim_mk_reskey(LIM_PROJECT, project.c_str(),
-						      res->name)) == NULL)
-			return (-1);
-		max_project_res_soft = lim_get(projectreskey, limitctx);
-		free(projectreskey);
+		max_project_res_soft = lim_get_res(limitctx, LIM_PROJECT, project.c_str(), res);
 
 		/* generic project limit check */
-		if ((genprojectreskey = lim_genprojectreskey(res->name)) == NULL)
-			return (-1);
-		max_genproject_res_soft = lim_get(genprojectreskey, limitctx);
-		free(genprojectreskey);
+		max_genproject_res_soft = lim_get_res(limitctx, LIM_PROJECT, genparam, res);
 
 		if ((max_project_res_soft == SCHD_INFINITY) &&
 		    (max_genproject_res_soft == SCHD_INFINITY))
@@ -3594,7 +3640,6 @@ static int
 check_server_max_project_run_soft(server_info *si, queue_info *qi,
 				  resource_resv *rr)
 {
-	char *key;
 	std::string project;
 	int used;
 	int max_project_run_soft, max_genproject_run_soft;
@@ -3610,15 +3655,9 @@ check_server_max_project_run_soft(server_info *si, queue_info *qi,
 		return (0);
 
 	project = rr->project;
-	if ((key = entlim_mk_runkey(LIM_PROJECT, project.c_str())) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_project_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(si->liminfo));
-	free(key);
+	max_project_run_soft = (int) lim_get_run(LI2RUNCTXSOFT(si->liminfo), LIM_PROJECT, project.c_str());
 
-	if ((key = entlim_mk_runkey(LIM_PROJECT, genparam)) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_genproject_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(si->liminfo));
-	free(key);
+	max_genproject_run_soft = (int) lim_get_run(LI2RUNCTXSOFT(si->liminfo), LIM_PROJECT, genparam);
 
 	if ((max_project_run_soft == SCHD_INFINITY) &&
 	    (max_genproject_run_soft == SCHD_INFINITY))
@@ -3759,7 +3798,6 @@ static int
 check_queue_max_project_run_soft(server_info *si, queue_info *qi,
 				 resource_resv *rr)
 {
-	char *key;
 	std::string project;
 	int used;
 	int max_project_run_soft, max_genproject_run_soft;
@@ -3775,15 +3813,9 @@ check_queue_max_project_run_soft(server_info *si, queue_info *qi,
 		return (0);
 
 	project = rr->project;
-	if ((key = entlim_mk_runkey(LIM_PROJECT, project.c_str())) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_project_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(qi->liminfo));
-	free(key);
+	max_project_run_soft = (int) lim_get_run(LI2RUNCTXSOFT(qi->liminfo), LIM_PROJECT, project.c_str());
 
-	if ((key = entlim_mk_runkey(LIM_PROJECT, genparam)) == NULL)
-		return (PREEMPT_TO_BIT(PREEMPT_ERR));
-	max_genproject_run_soft = (int) lim_get(key, LI2RUNCTXSOFT(qi->liminfo));
-	free(key);
+	max_genproject_run_soft = (int) lim_get_run(LI2RUNCTXSOFT(qi->liminfo), LIM_PROJECT, genparam);
 
 	if ((max_project_run_soft == SCHD_INFINITY) &&
 	    (max_genproject_run_soft == SCHD_INFINITY))
@@ -3869,7 +3901,6 @@ static int
 check_server_max_project_run(server_info *si, queue_info *qi, resource_resv *rr,
 			     limcounts *sc, limcounts *qc, schd_error *err)
 {
-	char *key;
 	std::string project;
 	int used;
 	int max_project_run, max_genproject_run;
@@ -3886,15 +3917,9 @@ check_server_max_project_run(server_info *si, queue_info *qi, resource_resv *rr,
 		return (0);
 
 	project = rr->project;
-	if ((key = entlim_mk_runkey(LIM_PROJECT, project.c_str())) == NULL)
-		return (SCHD_ERROR);
-	max_project_run = (int) lim_get(key, LI2RUNCTX(si->liminfo));
-	free(key);
+	max_project_run = (int) lim_get_run(LI2RUNCTX(si->liminfo), LIM_PROJECT, project.c_str());
 
-	if ((key = entlim_mk_runkey(LIM_PROJECT, genparam)) == NULL)
-		return (SCHD_ERROR);
-	max_genproject_run = (int) lim_get(key, LI2RUNCTX(si->liminfo));
-	free(key);
+	max_genproject_run = (int) lim_get_run(LI2RUNCTX(si->liminfo), LIM_PROJECT, genparam);
 
 	if ((max_project_run == SCHD_INFINITY) &&
 	    (max_genproject_run == SCHD_INFINITY))
@@ -3943,7 +3968,6 @@ static int
 check_queue_max_project_run(server_info *si, queue_info *qi, resource_resv *rr,
 			    limcounts *sc, limcounts *qc, schd_error *err)
 {
-	char *key;
 	std::string project;
 	int used;
 	int max_project_run, max_genproject_run;
@@ -3960,15 +3984,9 @@ check_queue_max_project_run(server_info *si, queue_info *qi, resource_resv *rr,
 	if (!qi->has_proj_limit)
 		return (0);
 
-	if ((key = entlim_mk_runkey(LIM_PROJECT, project.c_str())) == NULL)
-		return (SCHD_ERROR);
-	max_project_run = (int) lim_get(key, LI2RUNCTX(qi->liminfo));
-	free(key);
+	max_project_run = (int) lim_get_run(LI2RUNCTX(qi->liminfo), LIM_PROJECT, project.c_str());
 
-	if ((key = entlim_mk_runkey(LIM_PROJECT, genparam)) == NULL)
-		return (SCHD_ERROR);
-	max_genproject_run = (int) lim_get(key, LI2RUNCTX(qi->liminfo));
-	free(key);
+	max_genproject_run = (int) lim_get_run(LI2RUNCTX(qi->liminfo), LIM_PROJECT, genparam);
 
 	if ((max_project_run == SCHD_INFINITY) &&
 	    (max_genproject_run == SCHD_INFINITY))
@@ -45,6 +45,12 @@
 #include <pthread.h>
 #include <errno.h>
 #include <signal.h>
+#include <time.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <vector>
 
 #include "log.h"
 #include "pbs_idx.h"
@@ -54,11 +60,43 @@
 #include "data_types.h"
 #include "globals.h"
 #include "node_info.h"
-#include "queue.h"
 #include "fifo.h"
+#include "formula.h"
 #include "resource_resv.h"
+#include "sort.h"
 #include "multi_threading.h"
 
+/*
+ * Each thread has its own deque of tasks.  The main thread is index 0 and
+ * the worker threads are 1 through num_threads.  A thread pops tasks off the
+ * back of its own deque and steals from the front of the others' deques
+ * when it runs out of work.
+ */
+struct th_task_deque {
+	pthread_mutex_t lock;
+	std::deque<th_task_info *> tasks;
+};
+
+static th_task_deque *task_deques = NULL;
+
+/* number of tasks sitting in the deques, idle workers sleep while it is 0 */
+static std::atomic<int> tasks_queued(0);
+
+/* number of tasks of the current parallel_for() which haven't finished */
+static std::atomic<int> tasks_left(0);
+
+/* total time spent running the tasks of the current parallel_for() */
+static std::atomic<long> tasks_nsecs(0);
+
+/* task descriptors, reused by every call to parallel_for() */
+static std::vector<th_task_info> task_pool;
+
+/* average time it takes to process one item of each task type */
+static double task_nsecs_per_item[TS_NUM_TASK_TYPES];
+
+/* set while the main thread is in parallel_for() */
+static bool in_parallel_for = false;
+
 /**
  * @brief	create the thread id key & set it for the main thread
  *
@@ -82,6 +120,25 @@ create_id_key(void)
 	pthread_setspecific(th_id_key, (void *) mainid);
 }
 
+/**
+ * @brief	free the task deques
+ *
+ * @param[in]	ndeques - number of deques in task_deques
+ *
+ * @return	void
+ */
+static void
+free_task_deques(int ndeques)
+{
+	if (task_deques == NULL)
+		return;
+
+	for (int i = 0; i < ndeques; i++)
+		pthread_mutex_destroy(&task_deques[i].lock);
+	delete[] task_deques;
+	task_deques = NULL;
+}
+
 /**
  * @brief	convenience function to kill worker threads
  *
@@ -112,12 +169,10 @@ kill_threads(void)
 	pthread_cond_destroy(&result_cond);
 	pthread_mutex_destroy(&general_lock);
 	free(threads);
-	free_ds_queue(work_queue);
-	free_ds_queue(result_queue);
+	free_task_deques(num_threads + 1);
 	threads = NULL;
 	num_threads = 0;
-	work_queue = NULL;
-	result_queue = NULL;
+	tasks_queued = 0;
 }
 
 /**
@@ -184,19 +239,11 @@ init_multi_threading(int nthreads)
 		return 0;
 	}
 
-	/* Create task and result queues */
-	work_queue = new_ds_queue();
-	if (work_queue == NULL) {
-		free(threads);
-		return 0;
-	}
-	result_queue = new_ds_queue();
-	if (result_queue == NULL) {
-		free(threads);
-		free_ds_queue(work_queue);
-		work_queue = NULL;
-		return 0;
-	}
+	/* Create a task deque for each worker thread and the main thread */
+	task_deques = new th_task_deque[num_threads + 1];
+	for (i = 0; i <= num_threads; i++)
+		pthread_mutex_init(&task_deques[i].lock, NULL);
+	tasks_queued = 0;
 
 	pthread_once(&key_once, create_id_key);
 	for (i = 0; i < num_threads; i++) {
@@ -205,10 +252,7 @@ init_multi_threading(int nthreads)
 		thid = static_cast<int *>(malloc(sizeof(int)));
 		if (thid == NULL) {
 			free(threads);
-			free_ds_queue(work_queue);
-			free_ds_queue(result_queue);
-			work_queue = NULL;
-			result_queue = NULL;
+			free_task_deques(num_threads + 1);
 			log_err(errno, __func__, MEM_ERR_MSG);
 			return 0;
 		}
@@ -219,6 +263,141 @@ init_multi_threading(int nthreads)
 	return 1;
 }
 
+/**
+ * @brief	get the next task for a thread to run.  The thread's own deque
+ *		is checked first, and then the work is stolen from the other
+ *		threads' deques.
+ *
+ * @param[in]	tid - thread id of the calling thread
+ *
+ * @return	th_task_info *
+ * @retval	the task to run
+ * @retval	NULL if there is no work queued
+ */
+static th_task_info *
+get_next_task(int tid)
+{
+	th_task_info *task = NULL;
+
+	if (tasks_queued == 0)
+		return NULL;
+
+	for (int i = 0; i <= num_threads && task == NULL; i++) {
+		th_task_deque *dq = &task_deques[(tid + i) % (num_threads + 1)];
+
+		pthread_mutex_lock(&dq->lock);
+		if (!dq->tasks.empty()) {
+			if (i == 0) {
+				task = dq->tasks.back();
+				dq->tasks.pop_back();
+			} else {
+				task = dq->tasks.front();
+				dq->tasks.pop_front();
+			}
+		}
+		pthread_mutex_unlock(&dq->lock);
+	}
+	if (task != NULL)
+		tasks_queued--;
+
+	return task;
+}
+
+/**
+ * @brief	run a task
+ *
+ * @param[in]	task - the task to run
+ * @param[in]	tid - thread id of the calling thread
+ *
+ * @return void
+ */
+static void
+run_task(th_task_info *task, int tid)
+{
+	switch (task->task_type) {
+		case TS_IS_ND_ELIGIBLE:
+			log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+				   "Thread %d calling check_node_eligibility_chunk()", tid);
+			check_node_eligibility_chunk(static_cast<th_data_nd_eligible *>(task->thread_data));
+			break;
+		case TS_DUP_ND_INFO:
+			log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+				   "Thread %d calling dup_node_info_chunk()", tid);
+			dup_node_info_chunk(static_cast<th_data_dup_nd_info *>(task->thread_data));
+			break;
+		case TS_QUERY_ND_INFO:
+			log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+				   "Thread %d calling query_node_info_chunk()", tid);
+			query_node_info_chunk(static_cast<th_data_query_ninfo *>(task->thread_data));
+			break;
+		case TS_FREE_ND_INFO:
+			log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+				   "Thread %d calling free_node_info_chunk()", tid);
+			free_node_info_chunk(static_cast<th_data_free_ninfo *>(task->thread_data));
+			break;
+		case TS_DUP_RESRESV:
+			log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+				   "Thread %d calling dup_resource_resv_array_chunk()", tid);
+			dup_resource_resv_array_chunk(static_cast<th_data_dup_resresv *>(task->thread_data));
+			break;
+		case TS_QUERY_JOB_INFO:
+			log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+				   "Thread %d calling query_jobs_chunk()", tid);
+			query_jobs_chunk(static_cast<th_data_query_jinfo *>(task->thread_data));
+			break;
+		case TS_FREE_RESRESV:
+			log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+				   "Thread %d calling free_resource_resv_array_chunk()", tid);
+			free_resource_resv_array_chunk(static_cast<th_data_free_resresv *>(task->thread_data));
+			break;
+		case TS_EVAL_FORMULA:
+			log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+				   "Thread %d calling eval_formula_chunk()", tid);
+			eval_formula_chunk(static_cast<th_data_eval_formula *>(task->thread_data));
+			break;
+		case TS_FILL_SORT_KEYS:
+			log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+				   "Thread %d calling fill_sort_keys_chunk()", tid);
+			fill_sort_keys_chunk(static_cast<th_data_sort_keys *>(task->thread_data));
+			break;
+		case TS_EST_TOPJOB:
+			log_eventf(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__,
+				   "Thread %d calling estimate_topjob_chunk()", tid);
+			estimate_topjob_chunk(static_cast<th_data_est_topjob *>(task->thread_data));
+			break;
+		default:
+			log_event(PBSEVENT_ERROR, PBS_EVENTCLASS_SCHED, LOG_ERR, __func__,
+				  "Invalid task type passed to worker thread");
+	}
+}
+
+/**
+ * @brief	run a task of the current parallel_for() and let the main
+ *		thread know once the last one is done
+ *
+ * @param[in]	task - the task to run
+ * @param[in]	tid - thread id of the calling thread
+ *
+ * @return void
+ */
+static void
+run_queued_task(th_task_info *task, int tid)
+{
+	struct timespec start;
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	run_task(task, tid);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	tasks_nsecs += (end.tv_sec - start.tv_sec) * 1000000000L + (end.tv_nsec - start.tv_nsec);
+
+	if (--tasks_left == 0) {
+		pthread_mutex_lock(&result_lock);
+		pthread_cond_signal(&result_cond);
+		pthread_mutex_unlock(&result_lock);
+	}
+}
+
 /**
  * @brief	Main pthread routine for worker threads
  *
@@ -232,7 +411,6 @@ worker(void *tid)
 	th_task_info *work = NULL;
 	sigset_t set;
 	int ntid;
-	char buf[1024];
 
 	pthread_setspecific(th_id_key, tid);
 	ntid = *(int *) tid;
@@ -248,80 +426,184 @@ worker(void *tid)
 	}
 
 	while (!threads_die) {
-		/* Get the next work task from work queue */
+		work = get_next_task(ntid);
+		if (work != NULL) {
+			run_queued_task(work, ntid);
+			continue;
+		}
+
+		/* Nothing to do or steal, wait for more work */
 		pthread_mutex_lock(&work_lock);
-		while (ds_queue_is_empty(work_queue) && !threads_die) {
+		while (tasks_queued == 0 && !threads_die)
 			pthread_cond_wait(&work_cond, &work_lock);
-		}
-		work = static_cast<th_task_info *>(ds_dequeue(work_queue));
 		pthread_mutex_unlock(&work_lock);
-
-		/* find out what task we need to do */
-		if (work != NULL) {
-			switch (work->task_type) {
-				case TS_IS_ND_ELIGIBLE:
-					snprintf(buf, sizeof(buf), "Thread %d calling check_node_eligibility_chunk()", ntid);
-					log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-					check_node_eligibility_chunk(static_cast<th_data_nd_eligible *>(work->thread_data));
-					break;
-				case TS_DUP_ND_INFO:
-					snprintf(buf, sizeof(buf), "Thread %d calling dup_node_info_chunk()", ntid);
-					log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-					dup_node_info_chunk(static_cast<th_data_dup_nd_info *>(work->thread_data));
-					break;
-				case TS_QUERY_ND_INFO:
-					snprintf(buf, sizeof(buf), "Thread %d calling query_node_info_chunk()", ntid);
-					log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-					query_node_info_chunk(static_cast<th_data_query_ninfo *>(work->thread_data));
-					break;
-				case TS_FREE_ND_INFO:
-					snprintf(buf, sizeof(buf), "Thread %d calling free_node_info_chunk()", ntid);
-					log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-					free_node_info_chunk(static_cast<th_data_free_ninfo *>(work->thread_data));
-					break;
-				case TS_DUP_RESRESV:
-					snprintf(buf, sizeof(buf), "Thread %d calling dup_resource_resv_array_chunk()", ntid);
-					log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-					dup_resource_resv_array_chunk(static_cast<th_data_dup_resresv *>(work->thread_data));
-					break;
-				case TS_QUERY_JOB_INFO:
-					snprintf(buf, sizeof(buf), "Thread %d calling query_jobs_chunk()", ntid);
-					log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-					query_jobs_chunk(static_cast<th_data_query_jinfo *>(work->thread_data));
-					break;
-				case TS_FREE_RESRESV:
-					snprintf(buf, sizeof(buf), "Thread %d calling free_resource_resv_array_chunk()", ntid);
-					log_event(PBSEVENT_DEBUG3, PBS_EVENTCLASS_SCHED, LOG_DEBUG, __func__, buf);
-					free_resource_resv_array_chunk(static_cast<th_data_free_resresv *>(work->thread_data));
-					break;
-				default:
-					log_event(PBSEVENT_ERROR, PBS_EVENTCLASS_SCHED, LOG_ERR, __func__,
-						  "Invalid task type passed to worker thread");
-			}
-
-			/* Post results */
-			pthread_mutex_lock(&result_lock);
-			ds_enqueue(result_queue, (void *) work);
-			pthread_cond_signal(&result_cond);
-			pthread_mutex_unlock(&result_lock);
-		}
 	}
 
 	pthread_exit(NULL);
 }
 
 /**
- * @brief	Convenience function to queue up work for worker threads
+ * @brief	the smallest chunk of items of a task type worth handing to
+ *		another thread
  *
- * @param[in]	task - the task to queue up
+ * @param[in]	task_type - type of the task
  *
- * @return void
+ * @return	int
+ * @retval	minimum number of items per chunk
  */
-void
-queue_work_for_threads(th_task_info *task)
+static int
+mt_chunk_size_min(enum thread_task_type task_type)
+{
+	if (task_type == TS_EST_TOPJOB)
+		return MT_CHUNK_SIZE_MIN_EST_TOPJOB;
+
+	return MT_CHUNK_SIZE_MIN;
+}
+
+/**
+ * @brief	figure out how many items to put in each chunk of a parallel_for()
+ *
+ * @par	Chunks are sized so each takes about MT_CHUNK_TARGET_NSECS to process
+ *	based on how long previous chunks of the same task type took.  Without
+ *	any history, the items are split into MT_TASKS_PER_THREAD chunks per
+ *	thread so idle threads have something to steal.  A chunk is never
+ *	smaller than mt_chunk_size_min() items, and there are never fewer chunks
+ *	than threads.
+ *
+ * @param[in]	task_type - type of the task
+ * @param[in]	num_items - number of items to split up
+ *
+ * @return	int
+ * @retval	number of items per chunk
+ */
+int
+mt_chunk_size(enum thread_task_type task_type, int num_items)
+{
+	int nthreads = num_threads + 1; /* the main thread works too */
+	int max_size;
+	int chunk_size;
+
+	if (task_nsecs_per_item[task_type] > 0)
+		chunk_size = MT_CHUNK_TARGET_NSECS / task_nsecs_per_item[task_type];
+	else
+		chunk_size = num_items / (nthreads * MT_TASKS_PER_THREAD);
+
+	max_size = (num_items + nthreads - 1) / nthreads;
+	if (chunk_size > max_size)
+		chunk_size = max_size;
+	if (chunk_size < mt_chunk_size_min(task_type))
+		chunk_size = mt_chunk_size_min(task_type);
+
+	return chunk_size;
+}
+
+/**
+ * @brief	split a range of items into chunks and run a task on each chunk
+ *		on the worker threads.  The main thread works on the chunks too.
+ *		Returns once all the chunks are done.
+ *
+ * @par	If called from a worker thread, when there is only one thread, or when
+ *	there are too few items to be worth splitting up, the work is done
+ *	in one chunk by the calling thread.
+ *
+ * @param[in]	task_type - type of task to run on each chunk
+ * @param[in]	num_items - number of items to split up
+ * @param[in]	alloc_tdata - allocates the thread data for the chunk of
+ *			      items sidx through eidx.  Returns NULL on error.
+ * @param[out]	tdatas - thread data of each chunk in order.  The caller
+ *			 collects the results from these and frees them.
+ *
+ * @return	bool
+ * @retval	true	: success
+ * @retval	false	: alloc_tdata failed, chunks after the failed one were not run
+ *
+ * @par MT-safe: No
+ */
+bool
+parallel_for(enum thread_task_type task_type, int num_items,
+	     const std::function<void *(int sidx, int eidx)> &alloc_tdata,
+	     std::vector<void *> &tdatas)
 {
+	int tid;
+	int chunk_size;
+	int num_tasks;
+	bool ret = true;
+
+	tdatas.clear();
+
+	tid = *((int *) pthread_getspecific(th_id_key));
+	if (tid != 0 || num_threads <= 1 || in_parallel_for || num_items < 2 * mt_chunk_size_min(task_type)) {
+		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
+		th_task_info task;
+
+		task.task_id = 0;
+		task.task_type = task_type;
+		task.thread_data = alloc_tdata(0, num_items - 1);
+		if (task.thread_data == NULL)
+			return false;
+		tdatas.push_back(task.thread_data);
+		run_task(&task, tid);
+		return true;
+	}
+
+	in_parallel_for = true;
+	chunk_size = mt_chunk_size(task_type, num_items);
+	num_tasks = (num_items + chunk_size - 1) / chunk_size;
+	if (static_cast<int>(task_pool.size()) < num_tasks)
+		task_pool.resize(num_tasks);
+	tdatas.reserve(num_tasks);
+	tasks_nsecs = 0;
+
+	for (int i = 0; i < num_tasks; i++) {
+		th_task_info *task = &task_pool[i];
+		th_task_deque *dq;
+		int sidx = i * chunk_size;
+		int eidx = sidx + chunk_size - 1;
+
+		if (eidx >= num_items)
+			eidx = num_items - 1;
+
+		task->task_id = i;
+		task->task_type = task_type;
+		task->thread_data = alloc_tdata(sidx, eidx);
+		if (task->thread_data == NULL) {
+			ret = false;
+			break;
+		}
+		tdatas.push_back(task->thread_data);
+
+		/* deal the tasks out round robin, the main thread included */
+		dq = &task_deques[i % (num_threads + 1)];
+		tasks_left++;
+		pthread_mutex_lock(&dq->lock);
+		dq->tasks.push_back(task);
+		pthread_mutex_unlock(&dq->lock);
+		tasks_queued++;
+	}
+
 	pthread_mutex_lock(&work_lock);
-	ds_enqueue(work_queue, (void *) task);
-	pthread_cond_signal(&work_cond);
+	pthread_cond_broadcast(&work_cond);
 	pthread_mutex_unlock(&work_lock);
+
+	/* Work on the tasks until there are none left to steal */
+	for (th_task_info *task = get_next_task(0); task != NULL; task = get_next_task(0))
+		run_queued_task(task, 0);
+
+	/* Wait for the worker threads to finish up */
+	pthread_mutex_lock(&result_lock);
+	while (tasks_left > 0)
+		pthread_cond_wait(&result_cond, &result_lock);
+	pthread_mutex_unlock(&result_lock);
+
+	if (ret) {
+		double nsecs_per_item = static_cast<double>(tasks_nsecs) / num_items;
+
+		if (task_nsecs_per_item[task_type] > 0)
+			task_nsecs_per_item[task_type] = (task_nsecs_per_item[task_type] + nsecs_per_item) / 2;
+		else
+			task_nsecs_per_item[task_type] = nsecs_per_item;
+	}
+	in_parallel_for = false;
+
+	return ret;
 }
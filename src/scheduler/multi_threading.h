@@ -40,14 +40,26 @@
 #ifndef SRC_SCHEDULER_MULTI_THREADING_H_
 #define SRC_SCHEDULER_MULTI_THREADING_H_
 
+#include <functional>
+#include <vector>
+
 #include "data_types.h"
 
-#define MT_CHUNK_SIZE_MIN 1024
-#define MT_CHUNK_SIZE_MAX 8192
+/* smallest chunk of items worth handing to another thread */
+#define MT_CHUNK_SIZE_MIN 64
+/* how long it should take a thread to process one chunk (in nanoseconds) */
+#define MT_CHUNK_TARGET_NSECS 500000
+/* number of chunks per thread to make when there's no timing history */
+#define MT_TASKS_PER_THREAD 4
+/* a top job estimate is a whole simulation, so it is worth a thread by itself */
+#define MT_CHUNK_SIZE_MIN_EST_TOPJOB 1
 
 int init_multi_threading(int nthreads);
 void kill_threads(void);
 void *worker(void *);
-void queue_work_for_threads(th_task_info *task);
+int mt_chunk_size(enum thread_task_type task_type, int num_items);
+bool parallel_for(enum thread_task_type task_type, int num_items,
+		  const std::function<void *(int sidx, int eidx)> &alloc_tdata,
+		  std::vector<void *> &tdatas);
 
 #endif /* SRC_SCHEDULER_MULTI_THREADING_H_ */
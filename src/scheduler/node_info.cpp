@@ -105,6 +105,7 @@
  *
  */
 
+#include <list>
 #include <unordered_map>
 
 #include <pbs_config.h>
@@ -132,6 +133,7 @@
 #include "globals.h"
 #include "check.h"
 #include "constant.h"
+#include "cycle_stats.h"
 #include "config.h"
 #include "resource_resv.h"
 #include "simulate.h"
@@ -149,7 +151,7 @@
 #endif
 
 /* name of the last node a job ran on - used in smp_dist = round robin */
-static char last_node_name[PBS_MAXSVRJOBID];
+static thread_local char last_node_name[PBS_MAXSVRJOBID];
 
 void
 query_node_info_chunk(th_data_query_ninfo *data)
@@ -245,6 +247,7 @@ alloc_tdata_nd_query(struct batch_status *nodes, server_info *sinfo, int sidx, i
 node_info **
 query_nodes(int pbs_sd, server_info *sinfo)
 {
+	phase_timer timer(PHASE_QUERY_NODES);
 	struct batch_status *nodes;    /* nodes returned from the server */
 	struct batch_status *cur_node; /* used to cycle through nodes */
 	node_info **ninfo_arr;	       /* array of nodes for scheduler's use */
@@ -252,9 +255,8 @@ query_nodes(int pbs_sd, server_info *sinfo)
 	int nidx = 0;
 	static struct attrl *attrib = NULL;
 	th_data_query_ninfo *tdata = NULL;
-	th_task_info *task = NULL;
-	node_info ***ninfo_arrs_tasks = NULL;
-	int tid;
+	std::vector<void *> tdatas;
+	int th_err;
 
 	if (attrib == NULL) {
 		const char *nodeattrs[] = {
@@ -309,95 +311,45 @@ query_nodes(int pbs_sd, server_info *sinfo)
 		cur_node = cur_node->next;
 	}
 
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_nd_query(nodes, sinfo, 0, num_nodes - 1);
-		if (tdata == NULL) {
-			pbs_statfree(nodes);
-			return NULL;
-		}
-		query_node_info_chunk(tdata);
-		ninfo_arr = tdata->oarr;
-		free(tdata);
-
-		for (nidx = 0; ninfo_arr[nidx] != NULL; nidx++)
-			ninfo_arr[nidx]->rank = get_sched_rank();
-
-		ninfo_arr[nidx] = NULL;
-	} else {
-		int chunk_size = num_nodes / num_threads;
-		int th_err = 0;
-		int j;
-		int num_tasks;
-		if ((ninfo_arr = static_cast<node_info **>(malloc((num_nodes + 1) * sizeof(node_info *)))) == NULL) {
-			log_err(errno, __func__, MEM_ERR_MSG);
-			pbs_statfree(nodes);
-			return NULL;
-		}
-		ninfo_arr[0] = NULL;
-		chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-		for (j = 0, num_tasks = 0; num_nodes > 0;
-		     j += chunk_size, num_tasks++, num_nodes -= chunk_size) {
-			tdata = alloc_tdata_nd_query(nodes, sinfo, j, j + chunk_size - 1);
-			if (tdata == NULL) {
-				th_err = 1;
-				break;
-			}
-			task = static_cast<th_task_info *>(malloc(sizeof(th_task_info)));
-			if (task == NULL) {
-				free(tdata);
-				log_err(errno, __func__, MEM_ERR_MSG);
-				th_err = 1;
-				break;
-			}
-			task->task_id = num_tasks;
-			task->task_type = TS_QUERY_ND_INFO;
-			task->thread_data = (void *) tdata;
+	if ((ninfo_arr = static_cast<node_info **>(malloc((num_nodes + 1) * sizeof(node_info *)))) == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		pbs_statfree(nodes);
+		return NULL;
+	}
 
-			queue_work_for_threads(task);
-		}
-		ninfo_arrs_tasks = static_cast<node_info ***>(malloc(num_tasks * sizeof(node_info **)));
-		if (ninfo_arrs_tasks == NULL) {
-			log_err(errno, __func__, MEM_ERR_MSG);
+	/* Hand each chunk the node it starts at so the chunks don't all have to
+	 * walk the list from the beginning.
+	 */
+	cur_node = nodes;
+	th_err = !parallel_for(TS_QUERY_ND_INFO, num_nodes, [&](int sidx, int eidx) {
+		tdata = alloc_tdata_nd_query(cur_node, sinfo, 0, eidx - sidx);
+		for (int i = sidx; i <= eidx && cur_node != NULL; i++)
+			cur_node = cur_node->next;
+		return tdata;
+	}, tdatas);
+
+	/* Assemble node info objects from the chunks into the ninfo_arr */
+	for (auto td : tdatas) {
+		tdata = static_cast<th_data_query_ninfo *>(td);
+		if (tdata->error)
 			th_err = 1;
-		}
-		/* Get results from worker threads */
-		for (int i = 0; i < num_tasks;) {
-			pthread_mutex_lock(&result_lock);
-			while (ds_queue_is_empty(result_queue))
-				pthread_cond_wait(&result_cond, &result_lock);
-			while (!ds_queue_is_empty(result_queue)) {
-				task = static_cast<th_task_info *>(ds_dequeue(result_queue));
-				tdata = static_cast<th_data_query_ninfo *>(task->thread_data);
-				if (tdata->error)
-					th_err = 1;
-				ninfo_arrs_tasks[task->task_id] = tdata->oarr;
-				free(tdata);
-				free(task);
-				i++;
-			}
-			pthread_mutex_unlock(&result_lock);
-		}
-		if (th_err) {
-			pbs_statfree(nodes);
-			free_nodes(ninfo_arr);
-			return NULL;
-		}
-		/* Assemble node info objects from various threads into the ninfo_arr */
-		for (int i = 0; i < num_tasks; i++) {
-			if (ninfo_arrs_tasks[i] != NULL) {
-				node_info *ninfo;
-
-				for (int j = 0; (ninfo = ninfo_arrs_tasks[i][j]) != NULL; j++) {
-					ninfo->rank = get_sched_rank();
-					ninfo_arr[nidx++] = ninfo;
-				}
-				free(ninfo_arrs_tasks[i]);
+		if (tdata->oarr != NULL) {
+			node_info *ninfo;
+
+			for (int j = 0; (ninfo = tdata->oarr[j]) != NULL; j++) {
+				ninfo->rank = get_sched_rank();
+				ninfo_arr[nidx++] = ninfo;
 			}
+			free(tdata->oarr);
 		}
-		ninfo_arr[nidx] = NULL;
-		free(ninfo_arrs_tasks);
+		free(tdata);
+	}
+	ninfo_arr[nidx] = NULL;
+
+	if (th_err) {
+		pbs_statfree(nodes);
+		free_nodes(ninfo_arr);
+		return NULL;
 	}
 
 	if (nidx == 0) {
@@ -467,7 +419,7 @@ query_node_info(struct batch_status *node, server_info *sinfo)
 				return NULL;
 			}
 		} else if (!strcmp(attrp->name, ATTR_NODE_jobs))
-			ninfo->jobs = break_comma_list(attrp->value);
+			ninfo->jobs.reset(break_comma_list(attrp->value), free_string_array);
 		else if (!strcmp(attrp->name, ATTR_maxrun)) {
 			count = strtol(attrp->value, &endp, 10);
 			if (*endp == '\0')
@@ -577,7 +529,7 @@ query_node_info(struct batch_status *node, server_info *sinfo)
 			if (*endp == '\0')
 				ninfo->last_used_time = count;
 		} else if (!strcmp(attrp->name, ATTR_NODE_resvs)) {
-			ninfo->resvs = break_comma_list(attrp->value);
+			ninfo->resvs.reset(break_comma_list(attrp->value), free_string_array);
 		}
 		attrp = attrp->next;
 	}
@@ -589,6 +541,8 @@ query_node_info(struct batch_status *node, server_info *sinfo)
 	if (ninfo->lic_lock != 1)
 		ninfo->nscr |= NSCR_CYCLE_INELIGIBLE;
 
+	index_node_resources(ninfo);
+
 	return ninfo;
 }
 
@@ -641,6 +595,8 @@ node_info::node_info(const std::string &nname) : name(nname)
 	job_arr = NULL;
 	run_resvs_arr = NULL;
 	res = NULL;
+	res_index_head = NULL;
+	res_index_tail = NULL;
 	server = NULL;
 
 	max_running = SCHD_INFINITY;
@@ -736,65 +692,17 @@ alloc_tdata_free_nodes(node_info **ninfo_arr, int sidx, int eidx)
 void
 free_nodes(node_info **ninfo_arr)
 {
-	int i;
-	int chunk_size;
-	th_data_free_ninfo *tdata = NULL;
-	th_task_info *task = NULL;
-	int num_tasks;
-	int num_nodes;
-	int tid;
+	std::vector<void *> tdatas;
 
 	if (ninfo_arr == NULL)
 		return;
 
-	num_nodes = count_array(ninfo_arr);
-
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_free_nodes(ninfo_arr, 0, num_nodes - 1);
-		if (tdata == NULL)
-			return;
-
-		free_node_info_chunk(tdata);
-		free(tdata);
-		free(ninfo_arr);
-		return;
-	}
-	chunk_size = num_nodes / num_threads;
-	chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-	for (i = 0, num_tasks = 0; num_nodes > 0;
-	     num_tasks++, i += chunk_size, num_nodes -= chunk_size) {
-		tdata = alloc_tdata_free_nodes(ninfo_arr, i, i + chunk_size - 1);
-		if (tdata == NULL)
-			break;
-
-		task = static_cast<th_task_info *>(malloc(sizeof(th_task_info)));
-		if (task == NULL) {
-			free(tdata);
-			log_err(errno, __func__, MEM_ERR_MSG);
-			break;
-		}
-		task->task_type = TS_FREE_ND_INFO;
-		task->thread_data = (void *) tdata;
-
-		queue_work_for_threads(task);
-	}
+	parallel_for(TS_FREE_ND_INFO, count_array(ninfo_arr), [&](int sidx, int eidx) {
+		return alloc_tdata_free_nodes(ninfo_arr, sidx, eidx);
+	}, tdatas);
 
-	/* Get results from worker threads */
-	for (i = 0; i < num_tasks;) {
-		pthread_mutex_lock(&result_lock);
-		while (ds_queue_is_empty(result_queue))
-			pthread_cond_wait(&result_cond, &result_lock);
-		while (!ds_queue_is_empty(result_queue)) {
-			task = static_cast<th_task_info *>(ds_dequeue(result_queue));
-			tdata = static_cast<th_data_free_ninfo *>(task->thread_data);
-			free(tdata);
-			free(task);
-			i++;
-		}
-		pthread_mutex_unlock(&result_lock);
-	}
+	for (auto td : tdatas)
+		free(td);
 	free(ninfo_arr);
 }
 
@@ -805,8 +713,6 @@ free_nodes(node_info **ninfo_arr)
 node_info::~node_info()
 {
 	free(mom);
-	free_string_array(jobs);
-	free_string_array(resvs);
 	free(job_arr);
 	free(run_resvs_arr);
 	free_resource_list(res);
@@ -1099,7 +1005,7 @@ find_node_by_host(node_info **ninfo_arr, char *host)
 		return NULL;
 
 	for (i = 0; ninfo_arr[i] != NULL; i++) {
-		auto res = find_resource(ninfo_arr[i]->res, allres["host"]);
+		auto res = find_node_resource(ninfo_arr[i], allres["host"]);
 		if (res != NULL) {
 			if (compare_res_to_str(res, host, CMP_CASELESS))
 				break;
@@ -1196,80 +1102,34 @@ dup_nodes(node_info **onodes, server_info *nsinfo, unsigned int flags)
 {
 	node_info **nnodes;
 	int num_nodes;
-	int thread_node_ct_left;
 	schd_resource *nres = NULL;
 	schd_resource *ores = NULL;
 	schd_resource *tres = NULL;
 	node_info *ninfo = NULL;
 	th_data_dup_nd_info *tdata = NULL;
-	th_task_info *task = NULL;
+	std::vector<void *> tdatas;
 	int th_err = 0;
-	int tid;
 
 	if (onodes == NULL || nsinfo == NULL)
 		return NULL;
 
-	num_nodes = thread_node_ct_left = count_array(onodes);
+	num_nodes = count_array(onodes);
 
 	if ((nnodes = static_cast<node_info **>(malloc((num_nodes + 1) * sizeof(node_info *)))) == NULL) {
 		log_err(errno, __func__, MEM_ERR_MSG);
 		return NULL;
 	}
 
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_dup_nodes(flags, nsinfo, onodes, nnodes, 0, num_nodes - 1);
-		if (tdata == NULL) {
-			free_nodes(nnodes);
-			log_err(errno, __func__, MEM_ERR_MSG);
-			return NULL;
-		}
+	if (!parallel_for(TS_DUP_ND_INFO, num_nodes, [&](int sidx, int eidx) {
+		    return alloc_tdata_dup_nodes(flags, nsinfo, onodes, nnodes, sidx, eidx);
+	    }, tdatas))
+		th_err = 1;
 
-		dup_node_info_chunk(tdata);
-		th_err = tdata->error;
+	for (auto td : tdatas) {
+		tdata = static_cast<th_data_dup_nd_info *>(td);
+		if (tdata->error)
+			th_err = 1;
 		free(tdata);
-	} else { /* We are multithreading */
-		int j;
-		int num_tasks;
-		int chunk_size = num_nodes / num_threads;
-		chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-		for (j = 0, num_tasks = 0; thread_node_ct_left > 0;
-		     num_tasks++, j += chunk_size, thread_node_ct_left -= chunk_size) {
-			tdata = alloc_tdata_dup_nodes(flags, nsinfo, onodes, nnodes, j, j + chunk_size - 1);
-			if (tdata == NULL) {
-				th_err = 1;
-				break;
-			}
-			task = static_cast<th_task_info *>(malloc(sizeof(th_task_info)));
-			if (task == NULL) {
-				free(tdata);
-				th_err = 1;
-				log_err(errno, __func__, MEM_ERR_MSG);
-				break;
-			}
-			task->task_type = TS_DUP_ND_INFO;
-			task->thread_data = (void *) tdata;
-
-			queue_work_for_threads(task);
-		}
-
-		/* Get results from worker threads */
-		for (int i = 0; i < num_tasks;) {
-			pthread_mutex_lock(&result_lock);
-			while (ds_queue_is_empty(result_queue))
-				pthread_cond_wait(&result_cond, &result_lock);
-			while (!ds_queue_is_empty(result_queue)) {
-				task = static_cast<th_task_info *>(ds_dequeue(result_queue));
-				tdata = static_cast<th_data_dup_nd_info *>(task->thread_data);
-				if (tdata->error)
-					th_err = 1;
-				free(tdata);
-				free(task);
-				i++;
-			}
-			pthread_mutex_unlock(&result_lock);
-		}
 	}
 
 	if (th_err) {
@@ -1294,13 +1154,13 @@ dup_nodes(node_info **onodes, server_info *nsinfo, unsigned int flags)
 					 */
 					if (ninfo == NULL) {
 						ninfo = find_node_info(onodes, nnodes[i]->name);
-						ores = find_resource(ninfo->res, nres->def);
+						ores = find_node_resource(ninfo, nres->def);
 						if (ores->indirect_res != NULL) {
 							char namebuf[1024];
 
 							sprintf(namebuf, "@%s", nnodes[i]->name.c_str());
 							for (int j = i + 1; nnodes[j] != NULL; j++) {
-								tres = find_resource(nnodes[j]->res, nres->def);
+								tres = find_node_resource(nnodes[j], nres->def);
 								if (tres != NULL) {
 									if (tres->indirect_vnode_name != NULL &&
 									    !strcmp(nres->indirect_vnode_name,
@@ -1393,12 +1253,13 @@ dup_node_info(node_info *onode, server_info *nsinfo, unsigned int flags)
 
 	nnode->priority = onode->priority;
 
-	nnode->jobs = dup_string_arr(onode->jobs);
-	nnode->resvs = dup_string_arr(onode->resvs);
+	nnode->jobs = onode->jobs;
+	nnode->resvs = onode->resvs;
 	if (flags & DUP_INDIRECT)
 		nnode->res = dup_ind_resource_list(onode->res);
 	else
 		nnode->res = dup_resource_list(onode->res);
+	index_node_resources(nnode);
 
 	nnode->max_running = onode->max_running;
 	nnode->max_user_run = onode->max_user_run;
@@ -1448,6 +1309,72 @@ dup_node_info(node_info *onode, server_info *nsinfo, unsigned int flags)
 	return nnode;
 }
 
+/**
+ * @brief
+ *		index_node_resources - build an index of a node's resources by
+ *				       resdef id so they can be found without
+ *				       walking the list.  The list is still the
+ *				       owner of the resources.
+ *
+ * @param[in,out]	ninfo	-	the node to index
+ *
+ * @return	void
+ */
+void
+index_node_resources(node_info *ninfo)
+{
+	if (ninfo == NULL)
+		return;
+
+	ninfo->res_by_id.assign(allres.size(), NULL);
+	ninfo->res_index_head = ninfo->res;
+	ninfo->res_index_tail = NULL;
+
+	for (auto res = ninfo->res; res != NULL; res = res->next) {
+		if (res->def != NULL && res->def->id >= 0) {
+			if (static_cast<size_t>(res->def->id) >= ninfo->res_by_id.size())
+				ninfo->res_by_id.resize(res->def->id + 1, NULL);
+			if (ninfo->res_by_id[res->def->id] == NULL)
+				ninfo->res_by_id[res->def->id] = res;
+		}
+		ninfo->res_index_tail = res;
+	}
+}
+
+/**
+ * @brief
+ *		find_node_resource - find a resource of a node by its definition.
+ *				     The resdef id index is used if it is still
+ *				     in step with the node's resource list.  If
+ *				     the list changed since it was indexed, the
+ *				     list is searched instead.
+ *
+ * @param[in]	ninfo	-	the node
+ * @param[in]	def	-	resource definition to search for
+ *
+ * @return	schd_resource *
+ * @retval	the found resource
+ * @retval	NULL	: if not found
+ */
+schd_resource *
+find_node_resource(node_info *ninfo, resdef *def)
+{
+	if (ninfo == NULL || def == NULL)
+		return NULL;
+
+	if (ninfo->res != NULL && ninfo->res == ninfo->res_index_head &&
+	    ninfo->res_index_tail->next == NULL && def->id >= 0) {
+		schd_resource *res = NULL;
+
+		if (static_cast<size_t>(def->id) < ninfo->res_by_id.size())
+			res = ninfo->res_by_id[def->id];
+		if (res == NULL || res->def == def)
+			return res;
+	}
+
+	return find_resource(ninfo->res, def);
+}
+
 /**
  * @brief
  *		copy_node_ptr_array - copy an array of jobs using a different set of
@@ -1559,7 +1486,9 @@ collect_jobs_on_nodes(node_info **ninfo_arr, resource_resv **resresv_arr, int si
 	}
 
 	for (int i = 0; ninfo_arr[i] != NULL; i++) {
-		if (ninfo_arr[i]->jobs != NULL) {
+		char **jobs = ninfo_arr[i]->jobs.get();
+
+		if (jobs != NULL) {
 			/* If there are no running jobs in the list and node reports a running job,
 			 * mark that the node has ghost job
 			 */
@@ -1570,16 +1499,17 @@ collect_jobs_on_nodes(node_info **ninfo_arr, resource_resv **resresv_arr, int si
 			}
 
 			int k = 0;
-			for (int j = 0; ninfo_arr[i]->jobs[j] != NULL && k < size; j++) {
+			for (int j = 0; jobs[j] != NULL && k < size; j++) {
 				/* jobs are in the format of node_name/sub_node.  We don't care about
 				 * the subnode... we just want to populate the jobs on our node
-				 * structure
+				 * structure.  The names are shared with copies of the node, but
+				 * truncating them is harmless since it can be done more than once.
 				 */
-				ptr = strchr(ninfo_arr[i]->jobs[j], '/');
+				ptr = strchr(jobs[j], '/');
 				if (ptr != NULL)
 					*ptr = '\0';
 
-				job = find_resource_resv(resresv_arr, ninfo_arr[i]->jobs[j]);
+				job = find_resource_resv(resresv_arr, jobs[j]);
 				if ((job != NULL) && (!job->nspec_arr.empty())) {
 					/* if a distributed job has more then one instance on this node
 					 * it'll show up more then once.  If this is the case, we only
@@ -1611,7 +1541,7 @@ collect_jobs_on_nodes(node_info **ninfo_arr, resource_resv **resresv_arr, int si
 					ninfo_arr[i]->has_ghost_job = 1;
 					log_eventf(PBSEVENT_DEBUG2, PBS_EVENTCLASS_NODE, LOG_DEBUG, ninfo_arr[i]->name,
 						   "Job %s reported running on node no longer exists or is not in running state",
-						   ninfo_arr[i]->jobs[j]);
+						   jobs[j]);
 				}
 			}
 			ninfo_arr[i]->num_jobs = k;
@@ -1717,7 +1647,7 @@ update_node_on_run(nspec *ns, resource_resv *resresv, const char *job_state)
 		if (resreq->type.is_consumable) {
 			schd_resource *res;
 
-			res = find_resource(ninfo->res, resreq->def);
+			res = find_node_resource(ninfo, resreq->def);
 
 			if (res != NULL) {
 				if (res->indirect_res != NULL)
@@ -1745,7 +1675,7 @@ update_node_on_run(nspec *ns, resource_resv *resresv, const char *job_state)
 
 	/* if we're a cluster node and we have no cpus available, we're job_busy */
 	if (ncpusres == NULL)
-		ncpusres = find_resource(ninfo->res, allres["ncpus"]);
+		ncpusres = find_node_resource(ninfo, allres["ncpus"]);
 
 	if (ncpusres != NULL) {
 		if (dynamic_avail(ncpusres) == 0)
@@ -1769,7 +1699,7 @@ update_node_on_run(nspec *ns, resource_resv *resresv, const char *job_state)
 	if (resresv->is_job && resresv->eoename != NULL)
 		set_current_eoe(ninfo, resresv->eoename);
 
-	if (is_excl(resresv->place_spec, ninfo->sharing)) {
+	if (is_excl(resresv->place_spec.get(), ninfo->sharing)) {
 		if (resresv->is_resv) {
 			add_node_state(ninfo, ND_resv_exclusive);
 		} else {
@@ -1844,7 +1774,7 @@ update_node_on_end(node_info *ninfo, resource_resv *resresv, const char *job_sta
 
 	if (ninfo->is_job_busy)
 		remove_node_state(ninfo, ND_jobbusy);
-	if (is_excl(resresv->place_spec, ninfo->sharing)) {
+	if (is_excl(resresv->place_spec.get(), ninfo->sharing)) {
 		if (resresv->is_resv)
 			remove_node_state(ninfo, ND_resv_exclusive);
 		else {
@@ -1866,7 +1796,7 @@ update_node_on_end(node_info *ninfo, resource_resv *resresv, const char *job_sta
 			}
 			while (resreq != NULL) {
 				if (resreq->type.is_consumable) {
-					res = find_resource(ninfo->res, resreq->def);
+					res = find_node_resource(ninfo, resreq->def);
 					if (res != NULL) {
 						if (res->indirect_res != NULL)
 							res = res->indirect_res;
@@ -2060,7 +1990,7 @@ eval_selspec(status *policy, selspec *spec, place *placespec,
 	int pass_flags = NO_FLAGS;
 	char reason[MAX_LOG_SIZE] = {0};
 	int i = 0;
-	static struct schd_error *failerr = NULL;
+	static thread_local struct schd_error *failerr = NULL;
 
 	if (spec == NULL || ninfo_arr == NULL || resresv == NULL || placespec == NULL)
 		return false;
@@ -2225,7 +2155,7 @@ eval_placement(status *policy, selspec *spec, node_info **ninfo_arr, place *pl,
 	schd_resource *res = NULL;
 	selspec *dselspec = NULL;
 	node_info **nptr = NULL;
-	static schd_error *failerr = NULL;
+	static thread_local schd_error *failerr = NULL;
 
 	if (spec == NULL || ninfo_arr == NULL || pl == NULL || resresv == NULL)
 		return 0;
@@ -2473,7 +2403,7 @@ eval_placement(status *policy, selspec *spec, node_info **ninfo_arr, place *pl,
 										req = ns->resreq;
 										while (req != NULL) {
 											if (req->type.is_consumable) {
-												res = find_resource(ns->ninfo->res, req->def);
+												res = find_node_resource(ns->ninfo, req->def);
 												if (res != NULL) {
 													if (res->indirect_res != NULL)
 														res = res->indirect_res;
@@ -2647,7 +2577,7 @@ eval_complex_selspec(status *policy, selspec *spec, node_info **ninfo_arr, place
 				else {
 					req = ns->resreq;
 					while (req != NULL) {
-						res = find_resource(ns->ninfo->res, req->def);
+						res = find_node_resource(ns->ninfo, req->def);
 						if (res != NULL)
 							res->assigned += req->amount;
 
@@ -2662,7 +2592,7 @@ eval_complex_selspec(status *policy, selspec *spec, node_info **ninfo_arr, place
 				 */
 				if (conf.provision_policy != AVOID_PROVISION &&
 				    !cstat.node_sort->empty() && conf.node_sort_unused)
-					qsort(nodes, tot_nodes, sizeof(node_info *), multi_node_sort);
+					sort_node_array(nodes, tot_nodes);
 			}
 			chunks_needed--;
 			nsa.insert(nsa.end(), ns_chunk.begin(), ns_chunk.end());
@@ -2698,6 +2628,83 @@ eval_complex_selspec(status *policy, selspec *spec, node_info **ninfo_arr, place
 	return eval_complex_selspec(policy, spec, ninfo_arr, pl, resresv, flags, nspec_arr, err);
 }
 
+/**
+ * @brief
+ * 		build a mask of the nodes which could possibly satisfy the
+ *		consumable resources of a chunk on their own.  The amount available
+ *		of each requested resource is gathered for all the nodes into one
+ *		array and compared in a single sweep.  A node whose bit is off will
+ *		certainly fail resources_avail_on_vnode() for the chunk (without
+ *		EVAL_OKBREAK).  A node whose bit is on still needs the full check.
+ *
+ * @param[in]	ninfo_arr	-	the array of nodes
+ * @param[in]	num_nodes	-	number of nodes in ninfo_arr
+ * @param[in]	specreq_cons	-	consumable resources requested by the chunk
+ * @param[out]	num_fit	-	number of nodes whose bit is on
+ *
+ * @return	pbs_bitmap *
+ * @retval	bitmap indexed like ninfo_arr
+ * @retval	NULL	: on error
+ */
+pbs_bitmap *
+node_fit_mask(node_info **ninfo_arr, int num_nodes, resource_req *specreq_cons, int *num_fit)
+{
+	pbs_bitmap *mask;
+	std::vector<unsigned char> fits(num_nodes);
+	std::vector<sch_resource_t> avail(num_nodes);
+	int i;
+
+	if (ninfo_arr == NULL || num_fit == NULL)
+		return NULL;
+
+	*num_fit = 0;
+	if ((mask = pbs_bitmap_alloc(NULL, num_nodes)) == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		return NULL;
+	}
+
+	for (i = 0; i < num_nodes; i++)
+		fits[i] = (ninfo_arr[i]->nscr == 0 && ninfo_arr[i]->lic_lock);
+
+	for (auto req = specreq_cons; req != NULL; req = req->next) {
+		sch_resource_t amount = req->amount;
+
+		if (!req->type.is_consumable || amount == 0)
+			continue;
+
+		/* gather: mirror match_resource() with UNSET_RES_ZERO.  Anything it
+		 * would not compare as a consumable is given enough to pass
+		 */
+		for (i = 0; i < num_nodes; i++) {
+			schd_resource *res;
+
+			avail[i] = amount;
+			if (!fits[i] || ninfo_arr[i]->res == NULL)
+				continue;
+
+			res = find_check_resource(ninfo_arr[i], req, UNSET_RES_ZERO);
+			if (res != NULL && res->type.is_consumable && !res->type.is_non_consumable) {
+				avail[i] = dynamic_avail(res);
+				if (avail[i] == SCHD_INFINITY_RES)
+					avail[i] = 0;
+			}
+		}
+
+		/* sweep */
+		for (i = 0; i < num_nodes; i++)
+			fits[i] &= (avail[i] >= amount);
+	}
+
+	for (i = 0; i < num_nodes; i++) {
+		if (fits[i]) {
+			pbs_bitmap_bit_on(mask, i);
+			(*num_fit)++;
+		}
+	}
+
+	return mask;
+}
+
 /**
  * @brief
  * 		eval a non-plused select spec for satisfiability
@@ -2739,13 +2746,16 @@ eval_simple_selspec(status *policy, chunk *chk, node_info **pninfo_arr,
 
 	node_info **ninfo_arr = NULL;
 
-	static schd_error *failerr = NULL;
+	static thread_local schd_error *failerr = NULL;
 
 	resource_req *aoereq = NULL;
 	nspec *ns = NULL;
 
 	std::vector<nspec *> nsa;
 
+	pbs_bitmap *fit_mask = NULL;
+	std::vector<unsigned int> saved_nscr;
+
 	if (chk == NULL || pninfo_arr == NULL || resresv == NULL || pl == NULL)
 		return false;
 
@@ -2826,11 +2836,52 @@ eval_simple_selspec(status *policy, chunk *chk, node_info **pninfo_arr,
 	else
 		specreq_noncons = NULL; /* no non-consumable resources */
 
+	/* With lots of nodes, first try only the nodes which pass a fit mask on
+	 * the consumable resources.  We don't bother if the per-node log messages
+	 * are wanted since the nodes skipped would not be logged.
+	 */
+	if (!(flags & EVAL_OKBREAK) && specreq_cons != NULL && !will_log_event(PBSEVENT_DEBUG3)) {
+		int num_nodes = count_array(ninfo_arr);
+
+		if (num_nodes >= NODE_FIT_MASK_MIN_NODES) {
+			int num_fit = 0;
+
+			fit_mask = node_fit_mask(ninfo_arr, num_nodes, specreq_cons, &num_fit);
+			/* If nothing fits, the full pass is needed for the error anyway */
+			if (fit_mask != NULL && (num_fit == 0 || num_fit > num_nodes / NODE_FIT_MASK_MAX_RATIO)) {
+				pbs_bitmap_free(fit_mask);
+				fit_mask = NULL;
+			}
+			if (fit_mask != NULL) {
+				saved_nscr.reserve(num_nodes);
+				for (i = 0; i < num_nodes; i++)
+					saved_nscr.push_back(ninfo_arr[i]->nscr);
+			}
+		}
+	}
+
 	ns = new nspec();
 
-	for (i = 0; ninfo_arr[i] != NULL && chunks_found == 0; i++) {
+	for (i = 0; chunks_found == 0; i++) {
+		if (ninfo_arr[i] == NULL) {
+			if (fit_mask == NULL)
+				break;
+			/* None of the nodes which passed the fit mask could satisfy the
+			 * chunk.  Go through all the nodes as if the mask had never been
+			 * used so the error we return is the same.
+			 */
+			pbs_bitmap_free(fit_mask);
+			fit_mask = NULL;
+			for (k = 0; ninfo_arr[k] != NULL; k++)
+				ninfo_arr[k]->nscr = saved_nscr[k];
+			clear_schd_error(failerr);
+			i = -1;
+			continue;
+		}
 		if (ninfo_arr[i]->nscr)
 			continue;
+		if (fit_mask != NULL && !pbs_bitmap_get_bit(fit_mask, i))
+			continue;
 
 		allocated = false;
 		clear_schd_error(err);
@@ -2912,7 +2963,7 @@ eval_simple_selspec(status *policy, chunk *chk, node_info **pninfo_arr,
 			 * because the chunk is pretty much equivalent to ncpus=1 at that point
 			 */
 			if (ninfo_arr[i]->nodesig_ind >= 0 && !(flags & EVAL_OKBREAK)) {
-				if (check_avail_resources(ninfo_arr[i]->res, chk->req,
+				if (check_avail_resources(ninfo_arr[i], chk->req,
 							  COMPARE_TOTAL | UNSET_RES_ZERO | CHECK_ALL_BOOLS,
 							  policy->resdef_to_check_no_hostvnode,
 							  INSUFFICIENT_RESOURCE, err) == 0) {
@@ -2935,6 +2986,7 @@ eval_simple_selspec(status *policy, chunk *chk, node_info **pninfo_arr,
 		}
 	}
 
+	pbs_bitmap_free(fit_mask);
 	if (specreq_cons != NULL)
 		free_resource_req_list(specreq_cons);
 	if (specreq_noncons != NULL)
@@ -3114,7 +3166,7 @@ is_vnode_eligible_chunk(resource_req *specreq, node_info *node,
 	}
 
 	if (specreq != NULL) {
-		if (check_avail_resources(node->res, specreq,
+		if (check_avail_resources(node, specreq,
 					  CHECK_ALL_BOOLS | ONLY_COMP_NONCONS | UNSET_RES_ZERO,
 					  INSUFFICIENT_RESOURCE, err) == 0) {
 			return false;
@@ -3308,7 +3360,7 @@ resources_avail_on_vnode(resource_req *specreq_cons, node_info *node,
 					 */
 					req->amount -= num_chunks;
 
-					auto res = find_resource(node->res, req->def);
+					auto res = find_node_resource(node, req->def);
 					if (res != NULL) {
 						if (res->indirect_res != NULL)
 							res->indirect_res->assigned += num_chunks;
@@ -3428,7 +3480,7 @@ check_resources_for_node(resource_req *resreq, node_info *ninfo,
 
 	auto noderes = ninfo->res;
 
-	min_chunks = check_avail_resources(noderes, resreq,
+	min_chunks = check_avail_resources(ninfo, resreq,
 					   CHECK_ALL_BOOLS | UNSET_RES_ZERO, INSUFFICIENT_RESOURCE, err);
 
 	if (chunks != UNSPECIFIED && (min_chunks == SCHD_INFINITY || chunks < min_chunks))
@@ -3457,7 +3509,7 @@ check_resources_for_node(resource_req *resreq, node_info *ninfo,
 		 * at t2.
 		 */
 		auto nres = dup_ind_resource_list(noderes);
-		auto resresv_excl = is_excl(resresv->place_spec, ninfo->sharing);
+		auto resresv_excl = is_excl(resresv->place_spec.get(), ninfo->sharing);
 
 		if (nres != NULL) {
 			/* Walk the event list by time such that the start of an event always
@@ -3500,7 +3552,7 @@ check_resources_for_node(resource_req *resreq, node_info *ninfo,
 						break;
 					}
 
-					if (is_excl(resc_resv->place_spec, ninfo->sharing) || resresv_excl) {
+					if (is_excl(resc_resv->place_spec.get(), ninfo->sharing) || resresv_excl) {
 						min_chunks = 0;
 					} else {
 						for (auto cur_res = nres; cur_res != NULL; cur_res = cur_res->next) {
@@ -3544,7 +3596,8 @@ check_resources_for_node(resource_req *resreq, node_info *ninfo,
 int
 compare_place(place *pl1, place *pl2)
 {
-	if (pl1 == NULL && pl2 == NULL)
+	/* specs from the spec cache are shared */
+	if (pl1 == pl2)
 		return 1;
 	else if (pl1 == NULL || pl2 == NULL)
 		return 0;
@@ -3802,6 +3855,145 @@ parse_selspec(const std::string &sspec)
 	return spec;
 }
 
+/*
+ * Parsed select and place specs keyed by their string.  The parsed specs
+ * are shared between jobs and kept across cycles.  They must not be
+ * modified.  Once there are more than SPEC_CACHE_SIZE of them, the least
+ * recently used ones are evicted.
+ */
+template <class T>
+class spec_cache
+{
+	typedef std::list<std::pair<std::string, std::shared_ptr<T>>> lru_list;
+	lru_list lru; /* most recently used first */
+	std::unordered_map<std::string, typename lru_list::iterator> index;
+
+	public:
+	/* find a spec and mark it as the most recently used */
+	std::shared_ptr<T> find(const std::string &key)
+	{
+		auto it = index.find(key);
+		if (it == index.end())
+			return nullptr;
+		lru.splice(lru.begin(), lru, it->second);
+		return it->second->second;
+	}
+	/* add a spec or return the one already there */
+	std::shared_ptr<T> add(const std::string &key, const std::shared_ptr<T> &spec)
+	{
+		auto it = index.find(key);
+		if (it != index.end())
+			return it->second->second;
+		lru.emplace_front(key, spec);
+		index[key] = lru.begin();
+		if (index.size() > SPEC_CACHE_SIZE) {
+			index.erase(lru.back().first);
+			lru.pop_back();
+		}
+		return spec;
+	}
+	void clear()
+	{
+		index.clear();
+		lru.clear();
+	}
+};
+
+static spec_cache<selspec> selspec_cache;
+static spec_cache<place> placespec_cache;
+static pthread_mutex_t spec_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief
+ * 		get a parsed select spec from the spec cache.  If it is not
+ *		there, parse it and add it.
+ *
+ * @param[in]	sspec	-	the select spec to parse
+ *
+ * @return	std::shared_ptr<selspec>
+ * @retval	the shared select spec.  It must not be modified.
+ * @retval	nullptr	: on error or invalid spec
+ *
+ * @par MT-safe: Yes
+ */
+std::shared_ptr<selspec>
+parse_cached_selspec(const std::string &sspec)
+{
+	std::shared_ptr<selspec> spec;
+
+	pthread_mutex_lock(&spec_cache_lock);
+	spec = selspec_cache.find(sspec);
+	pthread_mutex_unlock(&spec_cache_lock);
+	if (spec != nullptr)
+		return spec;
+
+	/* parse outside the lock.  If another thread beat us, use its spec */
+	spec.reset(parse_selspec(sspec));
+	if (spec == nullptr)
+		return nullptr;
+
+	pthread_mutex_lock(&spec_cache_lock);
+	spec = selspec_cache.add(sspec, spec);
+	pthread_mutex_unlock(&spec_cache_lock);
+
+	return spec;
+}
+
+/**
+ * @brief
+ * 		get a parsed place spec from the spec cache.  If it is not
+ *		there, parse it and add it.
+ *
+ * @param[in]	place_str	-	placespec as a string
+ *
+ * @return	std::shared_ptr<place>
+ * @retval	the shared place spec.  It must not be modified.
+ * @retval	nullptr	: invalid placement spec
+ *
+ * @par MT-safe: Yes
+ */
+std::shared_ptr<place>
+parse_cached_placespec(char *place_str)
+{
+	std::shared_ptr<place> pl;
+
+	if (place_str == NULL)
+		return nullptr;
+
+	pthread_mutex_lock(&spec_cache_lock);
+	pl = placespec_cache.find(place_str);
+	pthread_mutex_unlock(&spec_cache_lock);
+	if (pl != nullptr)
+		return pl;
+
+	pl.reset(parse_placespec(place_str), free_place);
+	if (pl == nullptr)
+		return nullptr;
+
+	pthread_mutex_lock(&spec_cache_lock);
+	pl = placespec_cache.add(place_str, pl);
+	pthread_mutex_unlock(&spec_cache_lock);
+
+	return pl;
+}
+
+/**
+ * @brief
+ * 		empty the spec cache.  The parsed specs point at resource
+ *		definitions, so this must be called when those are replaced.
+ *		Specs still in use by jobs are freed when the jobs are.
+ *
+ * @return	void
+ */
+void
+clear_spec_cache(void)
+{
+	pthread_mutex_lock(&spec_cache_lock);
+	selspec_cache.clear();
+	placespec_cache.clear();
+	pthread_mutex_unlock(&spec_cache_lock);
+}
+
 /**
  *	@brief compare two chunks for equality
  *	@param[in] c1 - first chunk
@@ -3841,7 +4033,8 @@ compare_selspec(selspec *s1, selspec *s2)
 {
 	int ret = 1;
 
-	if (s1 == NULL && s2 == NULL)
+	/* specs from the spec cache are shared */
+	if (s1 == s2)
 		return 1;
 	else if (s1 == NULL || s2 == NULL)
 		return 0;
@@ -3865,7 +4058,7 @@ compare_selspec(selspec *s1, selspec *s2)
  *
  * @param[in]	ns	-	the nspec struct with the chosen nodes to run the job on
  *
- * @par MT-safe:	no
+ * @par MT-safe:	yes (one buffer per thread)
  *
  * @return	execvnode in static memory
  *
@@ -3873,10 +4066,10 @@ compare_selspec(selspec *s1, selspec *s2)
 char *
 create_execvnode(std::vector<nspec *> &ns_arr)
 {
-	static char *execvnode = NULL;
-	static int execvnode_size = 0;
-	static char *buf = NULL;
-	static int bufsize = 0;
+	static thread_local char *execvnode = NULL;
+	static thread_local int execvnode_size = 0;
+	static thread_local char *buf = NULL;
+	static thread_local int bufsize = 0;
 	char buf2[128];
 	resource_req *req;
 	bool end_of_chunk = true;
@@ -4274,15 +4467,13 @@ create_node_array_from_nspec(std::vector<nspec *> &nspec_arr)
  *      local variable node_array holds onto memory in the heap for reuse.
  *      The caller should not free the return
  *
- * @par MT-safe:	No
- *
- * @par MT-safe: No
+ * @par MT-safe:	Yes (one array per thread)
  */
 node_info **
 reorder_nodes(node_info **nodes, resource_resv *resresv)
 {
-	static node_info **node_array = NULL;
-	static int node_array_size = 0;
+	static thread_local node_info **node_array = NULL;
+	static thread_local int node_array_size = 0;
 	node_info **nptr = NULL;
 	node_info **tmparr = NULL;
 	schd_resource *hostres = NULL;
@@ -4357,10 +4548,10 @@ reorder_nodes(node_info **nodes, resource_resv *resresv)
 				/* find the vnode of the next host or the end of the list since the
 				 * beginning will definitely be a different host because of our sort
 				 */
-				hostres = find_resource(tmparr[i]->res, allres["host"]);
+				hostres = find_node_resource(tmparr[i], allres["host"]);
 				if (hostres != NULL) {
 					for (; i < nsize; i++) {
-						cur_hostres = find_resource(tmparr[i]->res, allres["host"]);
+						cur_hostres = find_node_resource(tmparr[i], allres["host"]);
 						if (cur_hostres != NULL) {
 							if (!compare_res_to_str(cur_hostres, hostres->str_avail[0], CMP_CASELESS))
 								break;
@@ -4412,7 +4603,7 @@ ok_break_chunk(resource_resv *resresv, node_info **nodes)
 		return 0;
 
 	for (i = 0; nodes[i] != NULL; i++) {
-		res = find_resource(nodes[i]->res, allres["host"]);
+		res = find_node_resource(nodes[i], allres["host"]);
 		if (res != NULL) {
 			if (hostres == NULL)
 				hostres = res;
@@ -4546,7 +4737,7 @@ int
 can_fit_on_vnode(resource_req *req, node_info **ninfo_arr)
 {
 	int i;
-	static schd_error *dumperr = NULL;
+	static thread_local schd_error *dumperr = NULL;
 
 	if (req == NULL || ninfo_arr == NULL)
 		return 0;
@@ -4563,7 +4754,7 @@ can_fit_on_vnode(resource_req *req, node_info **ninfo_arr)
 		clear_schd_error(dumperr);
 
 		if (is_vnode_eligible_chunk(req, ninfo_arr[i], NULL, dumperr)) {
-			if (check_avail_resources(ninfo_arr[i]->res, req,
+			if (check_avail_resources(ninfo_arr[i], req,
 						  UNSET_RES_ZERO, INSUFFICIENT_RESOURCE, NULL))
 				return 1;
 		}
@@ -4605,7 +4796,7 @@ is_eoe_avail_on_vnode(node_info *ninfo, resource_resv *resresv)
 	if (resresv->eoename == NULL)
 		return 0;
 
-	if ((resp = find_resource(ninfo->res, allres["eoe"])) != NULL)
+	if ((resp = find_node_resource(ninfo, allres["eoe"])) != NULL)
 		return is_string_in_arr(resp->str_avail, resresv->eoename);
 
 	return 0;
@@ -4993,8 +5184,8 @@ sim_exclhost_func(timed_event *te, void *arg1, void *arg2)
 	if (find_nspec_by_rank(future_resresv->nspec_arr, ninfo->rank) == NULL)
 		return 0; /* event does not affect the node */
 
-	if (is_exclhost(future_resresv->place_spec, ninfo->sharing) ||
-	    is_exclhost(resresv->place_spec, ninfo->sharing)) {
+	if (is_exclhost(future_resresv->place_spec.get(), ninfo->sharing) ||
+	    is_exclhost(resresv->place_spec.get(), ninfo->sharing)) {
 		return -1;
 	}
 
@@ -5208,66 +5399,22 @@ void
 check_node_array_eligibility(node_info **ninfo_arr, resource_resv *resresv, place *pl, schd_error *err)
 {
 	th_data_nd_eligible *tdata = NULL;
-	th_task_info *task = NULL;
-	int tid;
-	int num_nodes;
+	std::vector<void *> tdatas;
 
 	if (ninfo_arr == NULL || resresv == NULL || pl == NULL || err == NULL)
 		return;
 
-	num_nodes = count_array(ninfo_arr);
+	parallel_for(TS_IS_ND_ELIGIBLE, count_array(ninfo_arr), [&](int sidx, int eidx) {
+		return alloc_tdata_nd_eligible(pl, resresv, ninfo_arr, sidx, eidx);
+	}, tdatas);
+
+	for (auto td : tdatas) {
+		tdata = static_cast<th_data_nd_eligible *>(td);
+		if (err->status_code == SCHD_UNKWN && tdata->err->status_code != SCHD_UNKWN)
+			copy_schd_error(err, tdata->err);
 
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_nd_eligible(pl, resresv, ninfo_arr, 0, num_nodes - 1);
-		if (tdata == NULL)
-			return;
-		check_node_eligibility_chunk(tdata);
-		copy_schd_error(err, tdata->err);
 		free_schd_error(tdata->err);
 		free(tdata);
-	} else { /* We are multithreading */
-		int j;
-		int num_tasks;
-		int chunk_size = num_nodes / num_threads;
-		chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-		for (j = 0, num_tasks = 0; num_nodes > 0;
-		     num_tasks++, j += chunk_size, num_nodes -= chunk_size) {
-			tdata = alloc_tdata_nd_eligible(pl, resresv, ninfo_arr, j, j + chunk_size - 1);
-			if (tdata == NULL)
-				break;
-
-			task = static_cast<th_task_info *>(malloc(sizeof(th_task_info)));
-			if (task == NULL) {
-				free(tdata);
-				log_err(errno, __func__, MEM_ERR_MSG);
-				break;
-			}
-			task->task_type = TS_IS_ND_ELIGIBLE;
-			task->thread_data = (void *) tdata;
-
-			queue_work_for_threads(task);
-		}
-
-		/* Get results from worker threads */
-		for (int i = 0; i < num_tasks;) {
-			pthread_mutex_lock(&result_lock);
-			while (ds_queue_is_empty(result_queue))
-				pthread_cond_wait(&result_cond, &result_lock);
-			while (!ds_queue_is_empty(result_queue)) {
-				task = static_cast<th_task_info *>(ds_dequeue(result_queue));
-				tdata = static_cast<th_data_nd_eligible *>(task->thread_data);
-				if (err->status_code == SCHD_UNKWN && tdata->err->status_code != SCHD_UNKWN)
-					copy_schd_error(err, tdata->err);
-
-				free_schd_error(tdata->err);
-				free(tdata);
-				free(task);
-				i++;
-			}
-			pthread_mutex_unlock(&result_lock);
-		}
 	}
 }
 
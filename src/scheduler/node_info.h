@@ -209,6 +209,22 @@ update_nodes_for_resvs(node_info **ninfo_arr, server_info *sinfo,
  */
 node_info *dup_node_info(node_info *onode, server_info *nsinfo, unsigned int flags);
 
+/*
+ *      node_fit_mask - build a mask of the nodes which could fit the consumable
+ *                      resources of a chunk
+ */
+pbs_bitmap *node_fit_mask(node_info **ninfo_arr, int num_nodes, resource_req *specreq_cons, int *num_fit);
+
+/*
+ *      index_node_resources - (re)build the resdef id index of a node's resources
+ */
+void index_node_resources(node_info *ninfo);
+
+/*
+ *      find_node_resource - find a resource of a node by its definition
+ */
+schd_resource *find_node_resource(node_info *ninfo, resdef *def);
+
 /*
  *      find_nspec_by_name - find an nspec in an array by nodename
  */
@@ -260,6 +276,15 @@ int compare_place(place *pl1, place *pl2);
  */
 selspec *parse_selspec(const std::string &sspec);
 
+/* parse a select spec or reuse the shared one from the spec cache */
+std::shared_ptr<selspec> parse_cached_selspec(const std::string &sspec);
+
+/* parse a place spec or reuse the shared one from the spec cache */
+std::shared_ptr<place> parse_cached_placespec(char *place_str);
+
+/* empty the select and place spec cache */
+void clear_spec_cache(void);
+
 /* compare two selspecs to see if they are equal*/
 int compare_selspec(selspec *s1, selspec *s2);
 
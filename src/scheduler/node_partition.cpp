@@ -76,6 +76,7 @@
 
 #include "config.h"
 #include "constant.h"
+#include "cycle_stats.h"
 #include "data_types.h"
 #include "server_info.h"
 #include "queue_info.h"
@@ -88,6 +89,8 @@
 #include "globals.h"
 #include "sort.h"
 #include "buckets.h"
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 /**
@@ -382,7 +385,7 @@ create_node_partitions(status *policy, node_info **nodes, const std::vector<std:
 	node_partition *np;
 	node_partition **tmp_arr;
 	int np_arr_size = 0;
-	static schd_resource *res;
+	static thread_local schd_resource *res;
 
 	int num_nodes;
 
@@ -392,10 +395,18 @@ create_node_partitions(status *policy, node_info **nodes, const std::vector<std:
 	int node_i; /* index into nodes array */
 	int np_i;   /* index into node partition array we are creating */
 
-	static schd_resource *unset_res = NULL;
+	static thread_local schd_resource *unset_res = NULL;
 
 	std::vector<queue_info *> queues;
 
+	/* partitions by name and the nodes in each partition (in node order).
+	 * Membership is gathered while the partitions are found so we don't
+	 * need to search the partitions for each node or the nodes for each
+	 * partition.
+	 */
+	std::unordered_map<std::string, int> np_by_name;
+	std::vector<std::vector<node_info *>> np_nodes;
+
 	if (nodes == NULL || resnames.empty())
 		return NULL;
 
@@ -423,7 +434,7 @@ create_node_partitions(status *policy, node_info **nodes, const std::vector<std:
 			if (nodes[node_i]->is_stale)
 				continue;
 
-			res = find_resource(nodes[node_i]->res, def);
+			res = find_node_resource(nodes[node_i], def);
 
 			if (res == NULL && (flags & NP_CREATE_REST)) {
 				unset_res->name = res_i.c_str();
@@ -442,8 +453,8 @@ create_node_partitions(status *policy, node_info **nodes, const std::vector<std:
 					/* If we find the partition, we've already created it - add the node
 					 * to the existing partition.  If we don't find it, we create it.
 					 */
-					np = find_node_partition(np_arr, str);
-					if (np == NULL) {
+					auto found = np_by_name.find(str);
+					if (found == np_by_name.end()) {
 						if (np_i >= np_arr_size) {
 							tmp_arr = static_cast<node_partition **>(realloc(np_arr,
 													 (np_arr_size * 2 + 1) * sizeof(node_partition *)));
@@ -472,6 +483,8 @@ create_node_partitions(status *policy, node_info **nodes, const std::vector<std:
 								return NULL;
 							}
 
+							np_by_name.emplace(str, np_i);
+							np_nodes.emplace_back(1, nodes[node_i]);
 							np_i++;
 							np_arr[np_i] = NULL;
 						} else {
@@ -479,9 +492,15 @@ create_node_partitions(status *policy, node_info **nodes, const std::vector<std:
 							return NULL;
 						}
 					} else {
+						auto &members = np_nodes[found->second];
+
+						np = np_arr[found->second];
 						np->tot_nodes++;
 						if (nodes[node_i]->is_free)
 							np->free_nodes++;
+						/* a node may have the same value more than once */
+						if (members.back() != nodes[node_i])
+							members.push_back(nodes[node_i]);
 					}
 				}
 			}
@@ -491,69 +510,54 @@ create_node_partitions(status *policy, node_info **nodes, const std::vector<std:
 		}
 	}
 
-	/* now that we have a list of node partitions and number of nodes in each
+	/* now that we have a list of node partitions and the nodes in each
 	 * lets allocate a node array and fill it
 	 */
 
 	for (np_i = 0; np_arr[np_i] != NULL; np_i++) {
+		auto &members = np_nodes[np_i];
 		int i = 0;
 		np_arr[np_i]->ok_break = 1;
 		schd_resource *hostres = NULL;
 
 		np_arr[np_i]->ninfo_arr =
-			static_cast<node_info **>(malloc((np_arr[np_i]->tot_nodes + 1) * sizeof(node_info *)));
+			static_cast<node_info **>(malloc((members.size() + 1) * sizeof(node_info *)));
 
 		if (np_arr[np_i]->ninfo_arr == NULL) {
 			free_node_partition_array(np_arr);
 			return NULL;
 		}
 
-		np_arr[np_i]->ninfo_arr[0] = NULL;
-
-		for (node_i = 0; nodes[node_i] != NULL && i < np_arr[np_i]->tot_nodes; node_i++) {
-			if (nodes[node_i]->is_stale)
-				continue;
-
-			res = find_resource(nodes[node_i]->res, np_arr[np_i]->def);
-			if (res == NULL && (flags & NP_CREATE_REST)) {
-				set_resource(unset_res, "\"\"", RF_AVAIL);
-				res = unset_res;
-			}
-			if (res != NULL) {
-				/* Incase of indirect resource, point it to the right place */
-				if (res->indirect_res != NULL)
-					res = res->indirect_res;
-				if (compare_res_to_str(res, np_arr[np_i]->res_val, CMP_CASE)) {
-					if (np_arr[np_i]->ok_break) {
-						tmpres = find_resource(nodes[node_i]->res, allres["host"]);
-						if (tmpres != NULL) {
-							if (hostres == NULL)
-								hostres = tmpres;
-							else {
-								if (!compare_res_to_str(hostres, tmpres->str_avail[0], CMP_CASELESS))
-									np_arr[np_i]->ok_break = 0;
-							}
-						}
+		for (auto ninfo : members) {
+			if (np_arr[np_i]->ok_break) {
+				tmpres = find_node_resource(ninfo, allres["host"]);
+				if (tmpres != NULL) {
+					if (hostres == NULL)
+						hostres = tmpres;
+					else {
+						if (!compare_res_to_str(hostres, tmpres->str_avail[0], CMP_CASELESS))
+							np_arr[np_i]->ok_break = 0;
 					}
-					if (!(NP_NO_ADD_NP_ARR & flags)) {
-						tmp_arr = static_cast<node_partition **>(add_ptr_to_array(nodes[node_i]->np_arr, np_arr[np_i]));
-						if (tmp_arr == NULL) {
-							free_node_partition_array(np_arr);
-							return NULL;
-						}
-						nodes[node_i]->np_arr = tmp_arr;
-					}
-
-					np_arr[np_i]->ninfo_arr[i] = nodes[node_i];
-					i++;
+				}
+			}
+			if (!(NP_NO_ADD_NP_ARR & flags)) {
+				tmp_arr = static_cast<node_partition **>(add_ptr_to_array(ninfo->np_arr, np_arr[np_i]));
+				if (tmp_arr == NULL) {
 					np_arr[np_i]->ninfo_arr[i] = NULL;
+					free_node_partition_array(np_arr);
+					return NULL;
 				}
+				ninfo->np_arr = tmp_arr;
 			}
+
+			np_arr[np_i]->ninfo_arr[i++] = ninfo;
 		}
+		np_arr[np_i]->ninfo_arr[i] = NULL;
+
 		/* if multiple resource values are present, tot_nodes may be incorrect.
 		 * recalculating tot_nodes for each node partition.
 		 */
-		np_arr[np_i]->tot_nodes = count_array(np_arr[np_i]->ninfo_arr);
+		np_arr[np_i]->tot_nodes = i;
 		np_arr[np_i]->bkts = create_node_buckets(policy, np_arr[np_i]->ninfo_arr, queues, NO_PRINT_BUCKETS);
 		node_partition_update(policy, np_arr[np_i]);
 	}
@@ -722,8 +726,7 @@ node_partition_update(status *policy, node_partition *np)
 
 	if (!policy->node_sort->empty() && conf.node_sort_unused) {
 		/* Resort the nodes in the partition so that selection works correctly. */
-		qsort(np->ninfo_arr, np->tot_nodes, sizeof(node_info *),
-		      multi_node_sort);
+		sort_node_array(np->ninfo_arr, np->tot_nodes);
 	}
 
 	return rc;
@@ -1104,6 +1107,7 @@ create_specific_nodepart(status *policy, const char *name, node_info **nodes, in
 bool
 create_placement_sets(status *policy, server_info *sinfo)
 {
+	phase_timer timer(PHASE_PLACEMENT_SETS);
 	bool is_success = true;
 
 	sinfo->allpart = create_specific_nodepart(policy, "all", sinfo->unassoc_nodes, NO_FLAGS);
@@ -1113,21 +1117,24 @@ create_placement_sets(status *policy, server_info *sinfo)
 		sinfo->hostsets = create_node_partitions(policy, sinfo->nodes,
 							 resstr, sc_attrs.only_explicit_psets ? NP_NONE : NP_CREATE_REST, &num);
 		if (sinfo->hostsets != NULL) {
+			std::unordered_map<std::string, node_partition *> hostsets_by_name;
+
 			sinfo->num_hostsets = num;
+			for (int i = 0; sinfo->hostsets[i] != NULL; i++)
+				hostsets_by_name.emplace(sinfo->hostsets[i]->name, sinfo->hostsets[i]);
+
 			for (int i = 0; sinfo->nodes[i] != NULL; i++) {
 				schd_resource *hostres;
 				char hostbuf[256];
 
-				hostres = find_resource(sinfo->nodes[i]->res, allres["host"]);
-				if (hostres != NULL) {
+				hostres = find_node_resource(sinfo->nodes[i], allres["host"]);
+				if (hostres != NULL)
 					snprintf(hostbuf, sizeof(hostbuf), "host=%s", hostres->str_avail[0]);
-					sinfo->nodes[i]->hostset =
-						find_node_partition(sinfo->hostsets, hostbuf);
-				} else {
+				else
 					snprintf(hostbuf, sizeof(hostbuf), "host=\"\"");
-					sinfo->nodes[i]->hostset =
-						find_node_partition(sinfo->hostsets, hostbuf);
-				}
+
+				auto hs = hostsets_by_name.find(hostbuf);
+				sinfo->nodes[i]->hostset = (hs != hostsets_by_name.end()) ? hs->second : NULL;
 			}
 		} else {
 			log_event(PBSEVENT_DEBUG, PBS_EVENTCLASS_SERVER, LOG_DEBUG, "",
@@ -1211,7 +1218,7 @@ sort_all_nodepart(status *policy, server_info *sinfo)
 	}
 	if (!policy->node_sort->empty() && conf.node_sort_unused && sinfo->hostsets != NULL) {
 		/* Resort the nodes in host sets to correctly reflect unused resources */
-		qsort(sinfo->hostsets, sinfo->num_hostsets, sizeof(node_partition *), multi_nodepart_sort);
+		sort_nodepart_array(sinfo->hostsets, sinfo->num_hostsets);
 	}
 }
 
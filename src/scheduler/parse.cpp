@@ -100,6 +100,10 @@ config::config() : fairshare_res("cput"), fairshare_ent("euser")
 	node_sort_unused = 0;
 	resv_conf_ignore = 0;
 	allow_aoe_calendar = 0;
+	incremental_job_query = 0;
+	parallel_topjob_estimation = 0;
+	cycle_stats = 0;
+	cycle_snapshot = 0;
 #ifdef NAS /* localmod 034 */
 	prime_sto = 0;
 	non_prime_sto = 0;
@@ -117,6 +121,7 @@ config::config() : fairshare_res("cput"), fairshare_ent("euser")
 	unknown_shares = 0;		      /* unknown group shares */
 	max_preempt_attempts = SCHD_INFINITY; /* max num of preempt attempts per cyc*/
 	max_jobs_to_check = SCHD_INFINITY;    /* max number of jobs to check in cyc*/
+	run_job_window = 0;		      /* wait for the reply to each run request */
 	fairshare_decay_factor = .5;	      /* decay factor used when decaying fairshare tree */
 #ifdef NAS
 	/* localmod 034 */
@@ -284,6 +289,14 @@ parse_config(const char *fname)
 					tmpconf.enforce_no_shares = num ? 1 : 0;
 				else if (!strcmp(config_name, PARSE_ALLOW_AOE_CALENDAR))
 					tmpconf.allow_aoe_calendar = 1;
+				else if (!strcmp(config_name, PARSE_INCR_JOB_QUERY))
+					tmpconf.incremental_job_query = num ? 1 : 0;
+				else if (!strcmp(config_name, PARSE_PAR_TOPJOB_EST))
+					tmpconf.parallel_topjob_estimation = num ? 1 : 0;
+				else if (!strcmp(config_name, PARSE_CYCLE_STATS))
+					tmpconf.cycle_stats = num ? 1 : 0;
+				else if (!strcmp(config_name, PARSE_CYCLE_SNAPSHOT))
+					tmpconf.cycle_snapshot = num ? 1 : 0;
 				else if (!strcmp(config_name, PARSE_PRIME_SPILL)) {
 					if (prime == PRIME || prime == PT_ALL)
 						tmpconf.prime_spill = res_to_num(config_value, &type);
@@ -584,7 +597,9 @@ parse_config(const char *fname)
 						tmpconf.max_jobs_to_check = SCHD_INFINITY;
 					else
 						tmpconf.max_jobs_to_check = num;
-				} else if (!strcmp(config_name, PARSE_SELECT_PROVISION)) {
+				} else if (!strcmp(config_name, PARSE_RUN_JOB_WINDOW))
+					tmpconf.run_job_window = num;
+				else if (!strcmp(config_name, PARSE_SELECT_PROVISION)) {
 					if (!strcmp(config_value, PROVPOLICY_AVOID))
 						tmpconf.provision_policy = AVOID_PROVISION;
 				}
@@ -703,9 +718,9 @@ is_speccase_sort(const std::string &sort_res, int sort_type)
 char *
 scan(char *str, char target)
 {
-	static char *isp = NULL; /* internal state pointer used if a NULL is
-					 * passed in to str
-					 */
+	static thread_local char *isp = NULL; /* internal state pointer used if a NULL is
+						      * passed in to str
+						      */
 	char *ptr;		 /* pointer used to search through the str */
 	char *start;
 
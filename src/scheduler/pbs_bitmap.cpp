@@ -43,6 +43,7 @@
 #include "pbs_bitmap.h"
 
 #define BYTES_TO_BITS(x) ((x) *8)
+#define BITS_PER_LONG BYTES_TO_BITS(sizeof(unsigned long))
 
 /**
  * @brief allocate space for a pbs_bitmap (and possibly the bitmap itself)
@@ -72,11 +73,11 @@ pbs_bitmap_alloc(pbs_bitmap *pbm, unsigned long num_bits)
 	/* shrinking bitmap, clear previously used bits */
 	if (num_bits < bm->num_bits) {
 		long i;
-		i = num_bits / BYTES_TO_BITS(sizeof(unsigned long)) + 1;
+		i = num_bits / BITS_PER_LONG;
+		if (num_bits % BITS_PER_LONG > 0)
+			bm->bits[i++] &= (1UL << (num_bits % BITS_PER_LONG)) - 1;
 		for (; static_cast<unsigned long>(i) < bm->num_longs; i++)
 			bm->bits[i] = 0;
-		for (i = pbs_bitmap_next_on_bit(bm, num_bits); i != -1; i = pbs_bitmap_next_on_bit(bm, i))
-			pbs_bitmap_bit_off(bm, i);
 	}
 
 	/* If we have enough unused bits available, we don't need to allocate */
@@ -212,8 +213,8 @@ int
 pbs_bitmap_next_on_bit(pbs_bitmap *pbm, unsigned long start_bit)
 {
 	unsigned long long_ind;
-	long bit;
-	size_t i;
+	unsigned long bit;
+	unsigned long word;
 
 	if (pbm == NULL)
 		return -1;
@@ -221,36 +222,22 @@ pbs_bitmap_next_on_bit(pbs_bitmap *pbm, unsigned long start_bit)
 	if (start_bit >= pbm->num_bits)
 		return -1;
 
-	long_ind = start_bit / BYTES_TO_BITS(sizeof(unsigned long));
-	bit = start_bit % BYTES_TO_BITS(sizeof(unsigned long));
+	long_ind = start_bit / BITS_PER_LONG;
+	bit = start_bit % BITS_PER_LONG;
 
-	/* special case - look at first long that contains start_bit */
-	if (pbm->bits[long_ind] != 0) {
-		for (i = bit + 1; i < BYTES_TO_BITS(sizeof(unsigned long)); i++) {
-			if (pbm->bits[long_ind] & (1UL << i)) {
-				return (long_ind * BYTES_TO_BITS(sizeof(unsigned long)) + i);
-			}
-		}
-
-		/* didn't find an on bit after start_bit_index in the long that contained start_bit */
-		if (long_ind < pbm->num_longs) {
-			long_ind++;
-		}
-	}
+	/* mask off start_bit and everything before it in its long */
+	if (bit == BITS_PER_LONG - 1)
+		word = 0;
+	else
+		word = pbm->bits[long_ind] & (~0UL << (bit + 1));
 
-	for (; long_ind < pbm->num_longs && pbm->bits[long_ind] == 0; long_ind++)
-		;
-
-	if (long_ind == pbm->num_longs)
-		return -1;
-
-	for (i = 0; i < BYTES_TO_BITS(sizeof(unsigned long)); i++) {
-		if (pbm->bits[long_ind] & (1UL << i)) {
-			return (long_ind * BYTES_TO_BITS(sizeof(unsigned long)) + i);
-		}
+	while (word == 0) {
+		if (++long_ind >= pbm->num_longs)
+			return -1;
+		word = pbm->bits[long_ind];
 	}
 
-	return -1;
+	return long_ind * BITS_PER_LONG + __builtin_ctzl(word);
 }
 
 /**
@@ -263,10 +250,16 @@ pbs_bitmap_next_on_bit(pbs_bitmap *pbm, unsigned long start_bit)
 int
 pbs_bitmap_first_on_bit(pbs_bitmap *bm)
 {
-	if (pbs_bitmap_get_bit(bm, 0))
-		return 0;
+	unsigned long i;
+
+	if (bm == NULL)
+		return -1;
+
+	for (i = 0; i < bm->num_longs; i++)
+		if (bm->bits[i] != 0)
+			return i * BITS_PER_LONG + __builtin_ctzl(bm->bits[i]);
 
-	return pbs_bitmap_next_on_bit(bm, 0);
+	return -1;
 }
 
 /**
@@ -330,3 +323,173 @@ pbs_bitmap_is_equal(pbs_bitmap *L, pbs_bitmap *R)
 
 	return 1;
 }
+
+/**
+ * @brief pbs_bitmap version of L &= R
+ * @param L - bitmap lvalue
+ * @param R - bitmap rvalue
+ * @return int
+ * @retval 1 success
+ * @retval 0 failure
+ */
+int
+pbs_bitmap_and(pbs_bitmap *L, pbs_bitmap *R)
+{
+	unsigned long i;
+
+	if (L == NULL || R == NULL)
+		return 0;
+
+	for (i = 0; i < L->num_longs && i < R->num_longs; i++)
+		L->bits[i] &= R->bits[i];
+	for (; i < L->num_longs; i++)
+		L->bits[i] = 0;
+
+	return 1;
+}
+
+/**
+ * @brief pbs_bitmap version of L |= R
+ * @param L - bitmap lvalue
+ * @param R - bitmap rvalue
+ * @return int
+ * @retval 1 success
+ * @retval 0 failure
+ */
+int
+pbs_bitmap_or(pbs_bitmap *L, pbs_bitmap *R)
+{
+	unsigned long i;
+
+	if (L == NULL || R == NULL)
+		return 0;
+
+	if (R->num_bits > L->num_bits)
+		if (pbs_bitmap_alloc(L, R->num_bits) == NULL)
+			return 0;
+
+	for (i = 0; i < L->num_longs && i < R->num_longs; i++)
+		L->bits[i] |= R->bits[i];
+
+	return 1;
+}
+
+/**
+ * @brief pbs_bitmap version of L &= ~R
+ * @param L - bitmap lvalue
+ * @param R - bitmap rvalue
+ * @return int
+ * @retval 1 success
+ * @retval 0 failure
+ */
+int
+pbs_bitmap_andnot(pbs_bitmap *L, pbs_bitmap *R)
+{
+	unsigned long i;
+
+	if (L == NULL || R == NULL)
+		return 0;
+
+	for (i = 0; i < L->num_longs && i < R->num_longs; i++)
+		L->bits[i] &= ~R->bits[i];
+
+	return 1;
+}
+
+/**
+ * @brief count the on bits of a bitmap
+ * @param bm - the bitmap
+ * @return unsigned long
+ * @retval number of on bits
+ */
+unsigned long
+pbs_bitmap_popcount(pbs_bitmap *bm)
+{
+	unsigned long i;
+	unsigned long count = 0;
+
+	if (bm == NULL)
+		return 0;
+
+	for (i = 0; i < bm->num_longs; i++)
+		count += __builtin_popcountl(bm->bits[i]);
+
+	return count;
+}
+
+/**
+ * @brief find the nth on bit of a bitmap
+ * @param bm - the bitmap
+ * @param n - which on bit to find (1 is the first on bit)
+ * @return long
+ * @retval the bit number of the nth on bit
+ * @retval -1 if there are fewer than n on bits
+ */
+long
+pbs_bitmap_nth_on_bit(pbs_bitmap *bm, unsigned long n)
+{
+	unsigned long i;
+
+	if (bm == NULL || n == 0)
+		return -1;
+
+	for (i = 0; i < bm->num_longs; i++) {
+		unsigned long word = bm->bits[i];
+		unsigned long count = __builtin_popcountl(word);
+
+		if (count < n) {
+			n -= count;
+			continue;
+		}
+		/* the bit is in this long: drop the lowest n-1 on bits */
+		for (; n > 1; n--)
+			word &= word - 1;
+		return i * BITS_PER_LONG + __builtin_ctzl(word);
+	}
+
+	return -1;
+}
+
+/**
+ * @brief set L to the first n on bits of R (L = R with all on bits after
+ *	  the nth turned off)
+ * @param L - bitmap lvalue
+ * @param R - bitmap rvalue
+ * @param n - number of on bits to keep
+ * @return unsigned long
+ * @retval number of on bits in L (n, or fewer if R doesn't have n on bits)
+ */
+unsigned long
+pbs_bitmap_first_n_on_bits(pbs_bitmap *L, pbs_bitmap *R, unsigned long n)
+{
+	unsigned long i;
+	unsigned long count = 0;
+
+	if (L == NULL || R == NULL)
+		return 0;
+
+	if (pbs_bitmap_assign(L, R) == 0)
+		return 0;
+
+	for (i = 0; i < L->num_longs; i++) {
+		unsigned long word = L->bits[i];
+		unsigned long wcount = __builtin_popcountl(word);
+
+		if (count + wcount <= n) {
+			count += wcount;
+			continue;
+		}
+		/* keep only the lowest n - count on bits of this long */
+		unsigned long keep = 0;
+		for (; count < n; count++) {
+			keep |= word & -word;
+			word &= word - 1;
+		}
+		L->bits[i] = keep;
+		for (i++; i < L->num_longs; i++)
+			L->bits[i] = 0;
+		break;
+	}
+
+	return count;
+}
@@ -75,4 +75,16 @@ int pbs_bitmap_assign(pbs_bitmap *L, pbs_bitmap *R);
 /* pbs_bitmap's version of L == R */
 int pbs_bitmap_is_equal(pbs_bitmap *L, pbs_bitmap *R);
 
+int pbs_bitmap_and(pbs_bitmap *L, pbs_bitmap *R);
+
+int pbs_bitmap_or(pbs_bitmap *L, pbs_bitmap *R);
+
+int pbs_bitmap_andnot(pbs_bitmap *L, pbs_bitmap *R);
+
+unsigned long pbs_bitmap_popcount(pbs_bitmap *bm);
+
+long pbs_bitmap_nth_on_bit(pbs_bitmap *bm, unsigned long n);
+
+unsigned long pbs_bitmap_first_n_on_bits(pbs_bitmap *L, pbs_bitmap *R, unsigned long n);
+
 #endif /* _PBS_BITMASK_H */
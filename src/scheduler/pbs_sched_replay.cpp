@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+/**
+ * @file    pbs_sched_replay.cpp
+ *
+ * @brief
+ * 		pbs_sched_replay - run scheduling cycles against a snapshot.
+ *
+ *	A snapshot is written by the scheduler each cycle when cycle_snapshot
+ *	is set in the sched_config.  The replay answers every server query
+ *	from it, so no server is needed.  It runs in a copy of the
+ *	scheduler's sched_priv, which supplies the sched_config, fairshare
+ *	tree and so on.  Run, preemption, signal and reservation confirmation
+ *	requests are not sent anywhere: each one is printed on stdout and
+ *	treated as successful.  At the end the time spent in each phase of
+ *	the cycle is printed.
+ */
+#include <pbs_config.h> /* the master config generated by configure */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "constant.h"
+#include "cycle_stats.h"
+#include "data_types.h"
+#include "fifo.h"
+#include "globals.h"
+#include "libpbs.h"
+#include "log.h"
+#include "resource.h"
+#include "snapshot.h"
+
+static const char *usage = "[-d sched_priv] [-L logfile] [-n cycles] [-t threads] snapshot";
+
+int
+main(int argc, char *argv[])
+{
+	const char *dir = ".";
+	char snapfile[PATH_MAX];
+	char logpath[PATH_MAX + sizeof("/sched_replay.log")];
+	char cwd[PATH_MAX];
+	int ncycles = 1;
+	int nthreads = -1;
+	int errflg = 0;
+	int c;
+	sched_cmd cmd = {SCH_SCHEDULE_NEW, NULL};
+
+	if (set_msgdaemonname(const_cast<char *>("pbs_sched_replay"))) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	while ((c = getopt(argc, argv, "d:L:n:t:")) != EOF) {
+		switch (c) {
+			case 'd':
+				dir = optarg;
+				break;
+			case 'L':
+				logfile = optarg;
+				break;
+			case 'n':
+				ncycles = atoi(optarg);
+				if (ncycles < 1)
+					errflg = 1;
+				break;
+			case 't':
+				nthreads = atoi(optarg);
+				break;
+			default:
+				errflg = 1;
+		}
+	}
+	if (errflg || optind != argc - 1) {
+		fprintf(stderr, "usage: %s %s\n", argv[0], usage);
+		return 1;
+	}
+
+	if (pbs_loadconf(0) == 0) {
+		fprintf(stderr, "%s: unable to load pbs.conf\n", argv[0]);
+		return 1;
+	}
+
+	if (pbs_client_thread_init_thread_context() != 0) {
+		fprintf(stderr, "%s: Unable to initialize thread context\n", argv[0]);
+		return 1;
+	}
+
+	if (realpath(argv[optind], snapfile) == NULL) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	if (chdir(dir) == -1 || getcwd(cwd, sizeof(cwd)) == NULL) {
+		perror(dir);
+		return 1;
+	}
+
+	if (logfile == NULL) {
+		snprintf(logpath, sizeof(logpath), "%s/sched_replay.log", cwd);
+		logfile = logpath;
+	}
+	if (log_open(logfile, cwd) == -1) {
+		fprintf(stderr, "%s: logfile could not be opened\n", argv[0]);
+		return 1;
+	}
+
+	if (snapshot_load(snapfile) != 0) {
+		fprintf(stderr, "%s: %s is not a scheduler snapshot\n", argv[0], snapfile);
+		return 1;
+	}
+
+	sc_name = snapshot_sched_name();
+	if (sc_name == NULL)
+		sc_name = PBS_DFLT_SCHED_NAME;
+	dflt_sched = !strcmp(sc_name, PBS_DFLT_SCHED_NAME);
+
+	if (schedinit(nthreads) != 0) {
+		fprintf(stderr, "%s: unable to initialize the scheduler, see %s\n", argv[0], logfile);
+		return 1;
+	}
+
+	/* Peer queues would need connections to other servers.  Jobs are
+	 * always queried in full, and the replay itself is timed.
+	 */
+	conf.peer_queues.clear();
+	conf.incremental_job_query = 0;
+	conf.cycle_snapshot = 0;
+	conf.cycle_stats = 1;
+	snapshot_apply_usage(fstree);
+
+	update_resource_defs(SIMULATE_SD);
+	if (!set_validate_sched_attrs(SIMULATE_SD)) {
+		fprintf(stderr, "%s: no usable scheduler attributes in the snapshot, see %s\n", argv[0], logfile);
+		return 1;
+	}
+
+	for (int i = 0; i < ncycles; i++) {
+		printf("# cycle %d\n", i + 1);
+		scheduling_cycle(SIMULATE_SD, &cmd);
+	}
+
+	cycle_stats_report(stdout);
+
+	return 0;
+}
@@ -76,6 +76,7 @@
 #include "config.h"
 #include "fifo.h"
 #include "globals.h"
+#include "job_info.h"
 #include "libpbs.h"
 #include "libsec.h"
 #include "list_link.h"
@@ -525,6 +526,8 @@ close_server_conns(void)
 
 	clust_primary_sock = -1;
 	clust_secondary_sock = -1;
+
+	invalidate_job_status_cache();
 }
 
 /**
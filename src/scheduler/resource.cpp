@@ -81,6 +81,8 @@
 #include "sort.h"
 #include "parse.h"
 #include "fifo.h"
+#include "formula.h"
+#include "node_info.h"
 
 /**
  * @brief
@@ -97,6 +99,7 @@ query_resources(int pbs_sd)
 	struct batch_status *cur_bs; /* used to iterate over resources */
 	struct attrl *attrp;	     /* iterate over resource fields */
 	std::unordered_map<std::string, resdef *> tmpres;
+	int id = 0;
 
 	if ((bs = send_statrsc(pbs_sd, NULL, NULL, const_cast<char *>("p"))) == NULL) {
 		const char *errmsg = pbs_geterrmsg(pbs_sd);
@@ -122,7 +125,7 @@ query_resources(int pbs_sd)
 				flags = strtol(attrp->value, &endp, 10);
 			}
 		}
-		tmpres[cur_bs->name] = new resdef(cur_bs->name, flags, rtype);
+		tmpres[cur_bs->name] = new resdef(cur_bs->name, flags, rtype, id++);
 	}
 	pbs_statfree(bs);
 
@@ -397,6 +400,10 @@ update_resource_defs(int pbs_sd)
 
 	clear_limres();
 
+	/* cached specs point at the old resdefs */
+	clear_spec_cache();
+	clear_formula_cache();
+
 	return true;
 }
 
@@ -234,63 +234,17 @@ alloc_tdata_free_rr_arr(resource_resv **resresv_arr, int sidx, int eidx)
 void
 free_resource_resv_array(resource_resv **resresv_arr)
 {
-	int i;
-	int chunk_size;
-	th_data_free_resresv *tdata = NULL;
-	th_task_info *task = NULL;
-	int num_tasks;
-	int num_jobs;
-	int tid;
+	std::vector<void *> tdatas;
 
 	if (resresv_arr == NULL)
 		return;
 
-	num_jobs = count_array(resresv_arr);
-
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_free_rr_arr(resresv_arr, 0, num_jobs - 1);
-		if (tdata == NULL)
-			return;
-
-		free_resource_resv_array_chunk(tdata);
-		free(tdata);
-		free(resresv_arr);
-		return;
-	}
-
-	chunk_size = num_jobs / num_threads;
-	chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-	chunk_size = (chunk_size < MT_CHUNK_SIZE_MAX) ? chunk_size : MT_CHUNK_SIZE_MAX;
-	for (i = 0, num_tasks = 0; num_jobs > 0;
-	     num_tasks++, i += chunk_size, num_jobs -= chunk_size) {
-		tdata = alloc_tdata_free_rr_arr(resresv_arr, i, i + chunk_size - 1);
-		if (tdata == NULL)
-			break;
-
-		task = static_cast<th_task_info *>(malloc(sizeof(th_task_info)));
-		task->task_type = TS_FREE_RESRESV;
-		task->thread_data = (void *) tdata;
-
-		queue_work_for_threads(task);
-	}
-
-	/* Get results from worker threads */
-	for (i = 0; i < num_tasks;) {
-		pthread_mutex_lock(&result_lock);
-		while (ds_queue_is_empty(result_queue))
-			pthread_cond_wait(&result_cond, &result_lock);
-		while (!ds_queue_is_empty(result_queue)) {
-			task = static_cast<th_task_info *>(ds_dequeue(result_queue));
-			tdata = static_cast<th_data_free_resresv *>(task->thread_data);
-			free(tdata);
-			free(task);
-			i++;
-		}
-		pthread_mutex_unlock(&result_lock);
-	}
+	parallel_for(TS_FREE_RESRESV, count_array(resresv_arr), [&](int sidx, int eidx) {
+		return alloc_tdata_free_rr_arr(resresv_arr, sidx, eidx);
+	}, tdatas);
 
+	for (auto td : tdatas)
+		free(td);
 	free(resresv_arr);
 }
 
@@ -302,9 +256,6 @@ free_resource_resv_array(resource_resv **resresv_arr)
 resource_resv::~resource_resv()
 {
 	free(nodepart_name);
-	delete select;
-	delete execselect;
-	free_place(place_spec);
 	free_resource_req_list(resreq);
 	free(ninfo_arr);
 	free_nspecs(nspec_arr);
@@ -420,16 +371,14 @@ dup_resource_resv_array(resource_resv **oresresv_arr,
 {
 	resource_resv **nresresv_arr;
 	th_data_dup_resresv *tdata = NULL;
-	th_task_info *task = NULL;
+	std::vector<void *> tdatas;
 	int num_resresv;
-	int thread_job_ct_left;
 	int th_err = 0;
-	int tid;
 
 	if (oresresv_arr == NULL || nsinfo == NULL)
 		return NULL;
 
-	num_resresv = thread_job_ct_left = count_array(oresresv_arr);
+	num_resresv = count_array(oresresv_arr);
 
 	if ((nresresv_arr = static_cast<resource_resv **>(malloc((num_resresv + 1) * sizeof(resource_resv *)))) == NULL) {
 		log_err(errno, __func__, MEM_ERR_MSG);
@@ -437,52 +386,16 @@ dup_resource_resv_array(resource_resv **oresresv_arr,
 	}
 	nresresv_arr[0] = NULL;
 
-	tid = *((int *) pthread_getspecific(th_id_key));
-	if (tid != 0 || num_threads <= 1) {
-		/* don't use multi-threading if I am a worker thread or num_threads is 1 */
-		tdata = alloc_tdata_dup_nodes(oresresv_arr, nresresv_arr, nsinfo, nqinfo, 0, num_resresv - 1);
-		if (tdata == NULL)
-			th_err = 1;
-		else {
-			dup_resource_resv_array_chunk(tdata);
-			th_err = tdata->error;
-			free(tdata);
-		}
-	} else { /* We are multithreading */
-		int num_tasks = 0;
-		int chunk_size = num_resresv / num_threads;
-		chunk_size = (chunk_size > MT_CHUNK_SIZE_MIN) ? chunk_size : MT_CHUNK_SIZE_MIN;
-		chunk_size = (chunk_size < MT_CHUNK_SIZE_MAX) ? chunk_size : MT_CHUNK_SIZE_MAX;
-		for (int j = 0; thread_job_ct_left > 0;
-		     num_tasks++, j += chunk_size, thread_job_ct_left -= chunk_size) {
-			tdata = alloc_tdata_dup_nodes(oresresv_arr, nresresv_arr, nsinfo, nqinfo, j, j + chunk_size - 1);
-			if (tdata == NULL) {
-				th_err = 1;
-				break;
-			}
-			task = static_cast<th_task_info *>(malloc(sizeof(th_task_info)));
-			task->task_type = TS_DUP_RESRESV;
-			task->thread_data = (void *) tdata;
-
-			queue_work_for_threads(task);
-		}
+	if (!parallel_for(TS_DUP_RESRESV, num_resresv, [&](int sidx, int eidx) {
+		    return alloc_tdata_dup_nodes(oresresv_arr, nresresv_arr, nsinfo, nqinfo, sidx, eidx);
+	    }, tdatas))
+		th_err = 1;
 
-		/* Get results from worker threads */
-		for (int i = 0; i < num_tasks;) {
-			pthread_mutex_lock(&result_lock);
-			while (ds_queue_is_empty(result_queue))
-				pthread_cond_wait(&result_cond, &result_lock);
-			while (!ds_queue_is_empty(result_queue)) {
-				task = static_cast<th_task_info *>(ds_dequeue(result_queue));
-				tdata = static_cast<th_data_dup_resresv *>(task->thread_data);
-				if (tdata->error)
-					th_err = 1;
-				free(tdata);
-				free(task);
-				i++;
-			}
-			pthread_mutex_unlock(&result_lock);
-		}
+	for (auto td : tdatas) {
+		tdata = static_cast<th_data_dup_resresv *>(td);
+		if (tdata->error)
+			th_err = 1;
+		free(tdata);
 	}
 
 	if (th_err) {
@@ -541,10 +454,9 @@ dup_resource_resv(resource_resv *oresresv, server_info *nsinfo, queue_info *nqin
 	nresresv->project = oresresv->project;
 
 	nresresv->nodepart_name = string_dup(oresresv->nodepart_name);
-	if (oresresv->select != NULL)
-		nresresv->select = new selspec(*oresresv->select); /* must come before calls to dup_nspecs() below */
-	if (oresresv->execselect != NULL)
-		nresresv->execselect = new selspec(*oresresv->execselect);
+	/* the select specs are shared, not copied.  They must be set before the calls to dup_nspecs() below */
+	nresresv->select = oresresv->select;
+	nresresv->execselect = oresresv->execselect;
 
 	nresresv->is_invalid = oresresv->is_invalid;
 	nresresv->can_not_fit = oresresv->can_not_fit;
@@ -570,7 +482,7 @@ dup_resource_resv(resource_resv *oresresv, server_info *nsinfo, queue_info *nqin
 
 	nresresv->resreq = dup_resource_req_list(oresresv->resreq);
 
-	nresresv->place_spec = dup_place(oresresv->place_spec);
+	nresresv->place_spec = oresresv->place_spec;
 
 	nresresv->aoename = string_dup(oresresv->aoename);
 	nresresv->eoename = string_dup(oresresv->eoename);
@@ -604,7 +516,7 @@ dup_resource_resv(resource_resv *oresresv, server_info *nsinfo, queue_info *nqin
 		if (nresresv->resv->select_orig != NULL)
 			sel = nresresv->resv->select_orig;
 		else
-			sel = nresresv->select;
+			sel = nresresv->select.get();
 		nresresv->resv->orig_nspec_arr = dup_nspecs(oresresv->resv->orig_nspec_arr, nsinfo->nodes, sel);
 		nresresv->ninfo_arr = copy_node_ptr_array(oresresv->ninfo_arr, nsinfo->nodes);
 		nresresv->nspec_arr = dup_nspecs(oresresv->nspec_arr, nsinfo->nodes, NULL);
@@ -1505,7 +1417,7 @@ update_resresv_on_run(resource_resv *resresv, std::vector<nspec *> &nspec_arr)
 		if (resresv->execselect == NULL) {
 			std::string selectspec;
 			selectspec = create_select_from_nspec(nspec_arr);
-			resresv->execselect = parse_selspec(selectspec);
+			resresv->execselect.reset(parse_selspec(selectspec));
 		}
 		if (resresv->job->dependent_jobs != NULL) {
 			for (int i = 0; resresv->job->dependent_jobs[i] != NULL; i++) {
@@ -1596,12 +1508,11 @@ update_resresv_on_end(resource_resv *resresv, const char *job_state)
 				free(resresv->nodepart_name);
 				resresv->nodepart_name = NULL;
 			}
-			delete resresv->execselect;
-			resresv->execselect = NULL;
+			resresv->execselect.reset();
 		}
 		/* We need to correct our calendar */
 		if (resresv->end_event != NULL)
-			set_timed_event_disabled(resresv->end_event, 1);
+			set_timed_event_disabled(resresv->server->calendar, resresv->end_event, 1);
 	} else if (resresv->is_resv && resresv->resv != NULL) {
 		resresv->resv->resv_state = RESV_DELETED;
 		resresv->resv->is_running = 0;
@@ -203,7 +203,7 @@ query_reservations(int pbs_sd, server_info *sinfo, struct batch_status *resvs)
 		}
 #ifdef NAS /* localmod 047 */
 		if (resresv->place_spec == NULL) {
-			resresv->place_spec = parse_placespec("scatter");
+			resresv->place_spec.reset(parse_placespec("scatter"), free_place);
 		}
 #endif /* localmod 047 */
 
@@ -221,7 +221,7 @@ query_reservations(int pbs_sd, server_info *sinfo, struct batch_status *resvs)
 				  resresv->name, "Future reservation is being deleted, ignoring this reservation");
 			ignore_resv = 1;
 		} else if ((resresv->resv->resv_state == RESV_BEING_DELETED) && (resresv->resv->resv_nodes != NULL) &&
-			   (!is_string_in_arr(resresv->resv->resv_nodes[0]->resvs, resresv->name.c_str()))) {
+			   (!is_string_in_arr(resresv->resv->resv_nodes[0]->resvs.get(), resresv->name.c_str()))) {
 			log_event(PBSEVENT_SCHED, PBS_EVENTCLASS_RESV, LOG_DEBUG,
 				  resresv->name, "Reservation is being deleted and not present on node, ignoring this reservation");
 			ignore_resv = 1;
@@ -400,13 +400,12 @@ query_reservations(int pbs_sd, server_info *sinfo, struct batch_status *resvs)
 					release_nodes(resresv_ocr);
 
 					if (resresv_ocr->resv->select_standing != NULL) {
-						delete resresv_ocr->select;
-						resresv_ocr->select = new selspec(*resresv_ocr->resv->select_standing);
+						resresv_ocr->select.reset(new selspec(*resresv_ocr->resv->select_standing));
 					}
 
 					if (degraded_idx >= 1 && degraded_idx <= occr_count)
 						resresv_ocr->resv->orig_nspec_arr = parse_execvnode(
-							execvnode_ptr[degraded_idx - 1], sinfo, resresv_ocr->select);
+							execvnode_ptr[degraded_idx - 1], sinfo, resresv_ocr->select.get());
 					else {
 						resresv_ocr->resv->orig_nspec_arr = {};
 						log_eventf(PBSEVENT_ERROR, PBS_EVENTCLASS_RESV,
@@ -513,7 +512,7 @@ query_resv(struct batch_status *resv, server_info *sinfo)
 		else if (!strcmp(attrp->name, ATTR_queue))
 			advresv->resv->queuename = string_dup(attrp->value);
 		else if (!strcmp(attrp->name, ATTR_SchedSelect)) {
-			advresv->select = parse_selspec(attrp->value);
+			advresv->select.reset(parse_selspec(attrp->value));
 			if (advresv->select != NULL && advresv->select->chunks != NULL) {
 				/* Ignore resv if any of the chunks has no resource req. */
 				int i;
@@ -584,7 +583,7 @@ query_resv(struct batch_status *resv, server_info *sinfo)
 				if (advresv->resreq == NULL)
 					advresv->resreq = resreq;
 				if (!strcmp(attrp->resource, "place")) {
-					advresv->place_spec = parse_placespec(attrp->value);
+					advresv->place_spec.reset(parse_placespec(attrp->value), free_place);
 					if (advresv->place_spec == NULL)
 						advresv->is_invalid = 1;
 				}
@@ -646,7 +645,7 @@ query_resv(struct batch_status *resv, server_info *sinfo)
 		if (advresv->resv->select_orig != NULL)
 			sel = advresv->resv->select_orig;
 		else
-			sel = advresv->select;
+			sel = advresv->select.get();
 		advresv->resv->orig_nspec_arr = parse_execvnode(resv_nodes, sinfo, sel);
 		advresv->nspec_arr = combine_nspec_array(advresv->resv->orig_nspec_arr);
 		advresv->ninfo_arr = create_node_array_from_nspec(advresv->nspec_arr);
@@ -656,7 +655,7 @@ query_resv(struct batch_status *resv, server_info *sinfo)
 		 */
 		advresv->resv->resv_nodes = create_resv_nodes(advresv->nspec_arr, sinfo);
 		selectspec = create_select_from_nspec(advresv->resv->orig_nspec_arr);
-		advresv->execselect = parse_selspec(selectspec);
+		advresv->execselect.reset(parse_selspec(selectspec));
 	}
 
 	/* If reservation is unconfirmed and the number of occurrences is 0 then flag
@@ -691,8 +690,8 @@ query_resv(struct batch_status *resv, server_info *sinfo)
 
 	advresv->rank = get_sched_rank();
 
-	advresv->aoename = getaoename(advresv->select);
-	advresv->eoename = geteoename(advresv->select);
+	advresv->aoename = getaoename(advresv->select.get());
+	advresv->eoename = geteoename(advresv->select.get());
 
 	/* reservations requesting AOE mark nodes as exclusive */
 	if (advresv->aoename) {
@@ -1072,8 +1071,7 @@ check_new_reservations(status *policy, int pbs_sd, resource_resv **resvs, server
 							if (nresv_copy == NULL)
 								break;
 							if (nresv_copy->resv->select_standing != NULL) {
-								delete nresv_copy->select;
-								nresv_copy->select = new selspec(*nresv_copy->resv->select_standing);
+								nresv_copy->select.reset(new selspec(*nresv_copy->resv->select_standing));
 							}
 						}
 					}
@@ -1083,7 +1081,7 @@ check_new_reservations(status *policy, int pbs_sd, resource_resv **resvs, server
 
 					if (j_adjusted >= 0 && j_adjusted < occr_execvnodes_count) {
 						nresv_copy->resv->orig_nspec_arr =
-							parse_execvnode(occr_execvnodes_arr[j_adjusted], sinfo, nresv_copy->select);
+							parse_execvnode(occr_execvnodes_arr[j_adjusted], sinfo, nresv_copy->select.get());
 					} else {
 						nresv_copy->resv->orig_nspec_arr = {};
 						log_eventf(PBSEVENT_ERROR, PBS_EVENTCLASS_RESV,
@@ -1229,9 +1227,9 @@ disable_reservation_occurrence(timed_event *events,
 		return 0;
 
 	if (resv->run_event != NULL)
-		set_timed_event_disabled(resv->run_event, 1);
+		set_timed_event_disabled(resv->server->calendar, resv->run_event, 1);
 	if (resv->end_event != NULL)
-		set_timed_event_disabled(resv->end_event, 1);
+		set_timed_event_disabled(resv->server->calendar, resv->end_event, 1);
 	return 1;
 }
 
@@ -1426,16 +1424,14 @@ confirm_reservation(status *policy, int pbs_sd, resource_resv *unconf_resv, serv
 				   nresv->resv->resv_state == RESV_BEING_ALTERED) {
 				if (nresv->resv->is_running) {
 					std::string sel;
-					delete nresv->execselect;
-
 					sel = create_select_from_nspec(nresv->resv->orig_nspec_arr);
-					nresv->execselect = parse_selspec(sel);
+					nresv->execselect.reset(parse_selspec(sel));
 					for (size_t ind = 0; ind < nresv->resv->orig_nspec_arr.size(); ind++) {
 						nresv->execselect->chunks[ind]->seq_num = nresv->resv->orig_nspec_arr[ind]->seq_num;
 					}
 					if (spec != NULL) {
 						if (nresv->execselect == NULL)
-							nresv->execselect = spec;
+							nresv->execselect.reset(spec);
 						else {
 							/* Everything in that select has a running job on it.  Now add in the rest */
 							int num_exec_chunks = count_array(nresv->execselect->chunks);
@@ -1915,6 +1911,7 @@ create_resv_nodes(std::vector<nspec *> &nspec_arr, server_info *sinfo)
 				}
 				req = req->next;
 			}
+			index_node_resources(nodes[i]);
 		}
 		nodes[i] = NULL;
 	}
@@ -2045,8 +2042,6 @@ modify_jobs_nodes_for_resv(resource_resv *resresv, time_t server_time)
 		free(jobs_in_reservations);
 
 		/* Sort the nodes to ensure correct job placement. */
-		qsort(resresv->resv->resv_nodes,
-		      count_array(resresv->resv->resv_nodes),
-		      sizeof(node_info *), multi_node_sort);
+		sort_node_array(resresv->resv->resv_nodes, count_array(resresv->resv->resv_nodes));
 	}
 }
\ No newline at end of file
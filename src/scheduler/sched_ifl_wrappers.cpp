@@ -39,9 +39,13 @@
 
 #include <pbs_config.h>
 
+#include <errno.h>
 #include <stdlib.h>
+#include <deque>
+#include <string>
 #include <pbs_ifl.h>
 #include <libpbs.h>
+#include "cycle_stats.h"
 #include "data_types.h"
 #include "fifo.h"
 #include "globals.h"
@@ -49,8 +53,19 @@
 #include "misc.h"
 #include "log.h"
 #include "server_info.h"
+#include "snapshot.h"
 #include "libutil.h"
 
+/* run requests sent by send_run_job_pipelined() still waiting for a reply, oldest first */
+struct pending_run {
+	int sd;		   /* connection the request was sent over */
+	resource_resv *rr; /* the job which was run */
+	bool array_queued; /* the job's parent array was queued before the run */
+	time_t time_preempted; /* when the job was preempted, UNSPECIFIED if it wasn't */
+};
+
+static std::deque<pending_run> pending_runs;
+
 /**
  * @brief	Send the relevant runjob request to server
  *
@@ -66,9 +81,17 @@
 int
 send_run_job(int sd, int has_runjob_hook, const std::string &jobid, char *execvnode)
 {
+	phase_timer timer(PHASE_RUN_JOB);
 	if (jobid.empty() || execvnode == NULL)
 		return 1;
 
+	if (snapshot_replaying()) {
+		snapshot_decision("run", jobid, execvnode);
+		return 0;
+	}
+
+	reap_run_job_replies(0);
+
 	if (sc_attrs.runjob_mode == RJ_EXECJOB_HOOK)
 		return pbs_runjob(sd, const_cast<char *>(jobid.c_str()), execvnode, NULL);
 	else if (((sc_attrs.runjob_mode == RJ_RUNJOB_HOOK) && has_runjob_hook))
@@ -77,6 +100,75 @@ send_run_job(int sd, int has_runjob_hook, const std::string &jobid, char *execvn
 		return pbs_asyrunjob(sd, const_cast<char *>(jobid.c_str()), execvnode, NULL);
 }
 
+/**
+ * @brief	Send a runjob request which waits for the runjob hook, but don't
+ *		wait for the reply.  The caller commits the run to its view of
+ *		the universe right away.  The reply is read later by
+ *		reap_run_job_replies() and a rejected run is undone then.  At
+ *		most run_job_window requests are kept outstanding.
+ *
+ * @param[in]	sd	-	communication handle
+ * @param[in]	rr	-	the job to run
+ * @param[in]	execvnode	-	the execvnode to run the job on
+ *
+ * @return	int
+ * @retval	0	request sent
+ * @retval	!0	request could not be sent (pbs_errno is set)
+ */
+int
+send_run_job_pipelined(int sd, resource_resv *rr, char *execvnode)
+{
+	phase_timer timer(PHASE_RUN_JOB);
+	int rc;
+
+	if (rr == NULL || execvnode == NULL)
+		return 1;
+
+	if (snapshot_replaying()) {
+		snapshot_decision("run", rr->name, execvnode);
+		return 0;
+	}
+
+	reap_run_job_replies(conf.run_job_window - 1);
+
+	rc = PBSD_run_put(sd, rr->name.c_str(), execvnode, NULL, PBS_BATCH_AsyrunJob_ack);
+	if (rc == 0)
+		pending_runs.push_back({sd, rr, rr->job->parent_job != NULL && rr->job->parent_job->job->is_queued,
+					rr->job->is_preempted ? rr->job->time_preempted : UNSPECIFIED});
+
+	return rc;
+}
+
+/**
+ * @brief	Read the replies of pipelined run requests, oldest first, until
+ *		no more than max_pending are outstanding.  Runs the server
+ *		rejected are undone with undo_run_job().
+ *
+ * @par	Replies must be read before any other request which waits for a
+ *	reply is sent over the same connection.  Every wrapper here which
+ *	reads a reply calls this first.
+ *
+ * @param[in]	max_pending	-	number of requests which may stay outstanding
+ *
+ * @return	void
+ */
+void
+reap_run_job_replies(size_t max_pending)
+{
+	while (pending_runs.size() > max_pending) {
+		pending_run pr = pending_runs.front();
+		int rc;
+
+		pending_runs.pop_front();
+		rc = PBSD_run_get(pr.sd);
+		if (rc != 0) {
+			const char *errbuf = pbs_geterrmsg(pr.sd);
+
+			undo_run_job(pr.sd, pr.rr, pr.array_queued, pr.time_preempted, rc, errbuf == NULL ? "" : errbuf);
+		}
+	}
+}
+
 /**
  * @brief
  * 		send delayed attributes to the server for a job
@@ -136,6 +228,53 @@ send_attr_updates(int sd, resource_resv *resresv, struct attrl *pattr)
 	return 0;
 }
 
+/**
+ * @brief	answer a preemption request while replaying a snapshot.  Each job
+ *		is preempted by the first method of the first preempt_order
+ *		range, as if it worked.
+ *
+ * @param[in]	preempt_jobs_list - list of jobs to preempt
+ *
+ * @return	preempt_job_info *
+ * @retval	the reply for each job.  Free with free().
+ * @retval	NULL on error
+ */
+static preempt_job_info *
+replay_preempt_jobs(char **preempt_jobs_list)
+{
+	preempt_job_info *reply;
+	char order;
+	int n;
+
+	switch (sc_attrs.preempt_order[0].order[0]) {
+		case PREEMPT_METHOD_SUSPEND:
+			order = 'S';
+			break;
+		case PREEMPT_METHOD_CHECKPOINT:
+			order = 'C';
+			break;
+		case PREEMPT_METHOD_REQUEUE:
+			order = 'Q';
+			break;
+		default:
+			order = 'D';
+	}
+
+	for (n = 0; preempt_jobs_list[n] != NULL; n++)
+		;
+	if ((reply = static_cast<preempt_job_info *>(calloc(n + 1, sizeof(preempt_job_info)))) == NULL) {
+		log_err(errno, __func__, MEM_ERR_MSG);
+		return NULL;
+	}
+	for (int i = 0; i < n; i++) {
+		pbs_strncpy(reply[i].job_id, preempt_jobs_list[i], sizeof(reply[i].job_id));
+		reply[i].order[0] = order;
+		snapshot_decision("preempt", preempt_jobs_list[i], std::string(1, order));
+	}
+
+	return reply;
+}
+
 /**
  * @brief	Wrapper for pbs_preempt_jobs
  *
@@ -148,6 +287,10 @@ send_attr_updates(int sd, resource_resv *resresv, struct attrl *pattr)
 preempt_job_info *
 send_preempt_jobs(int sd, char **preempt_jobs_list)
 {
+	if (snapshot_replaying())
+		return replay_preempt_jobs(preempt_jobs_list);
+
+	reap_run_job_replies(0);
 	return pbs_preempt_jobs(sd, preempt_jobs_list);
 }
 
@@ -165,6 +308,12 @@ send_preempt_jobs(int sd, char **preempt_jobs_list)
 int
 send_sigjob(int sd, resource_resv *resresv, const char *signal, char *extend)
 {
+	if (snapshot_replaying()) {
+		snapshot_decision("signal", resresv->name, signal);
+		return 0;
+	}
+
+	reap_run_job_replies(0);
 	return pbs_sigjob(sd, const_cast<char *>(resresv->name.c_str()), const_cast<char *>(signal), extend);
 }
 
@@ -184,6 +333,12 @@ send_sigjob(int sd, resource_resv *resresv, const char *signal, char *extend)
 int
 send_confirmresv(int sd, resource_resv *resv, const char *location, unsigned long start, const char *extend)
 {
+	if (snapshot_replaying()) {
+		snapshot_decision("confirm", resv->name, std::string(location) + " start=" + std::to_string(start));
+		return 0;
+	}
+
+	reap_run_job_replies(0);
 	return pbs_confirmresv(sd, const_cast<char *>(resv->name.c_str()), const_cast<char *>(location), start, const_cast<char *>(extend));
 }
 
@@ -202,7 +357,16 @@ send_confirmresv(int sd, resource_resv *resv, const char *location, unsigned lon
 struct batch_status *
 send_selstat(int sd, struct attropl *attrib, struct attrl *rattrib, char *extend)
 {
-	return pbs_selstat(sd, attrib, rattrib, extend);
+	struct batch_status *bs;
+
+	if (snapshot_replaying())
+		return snapshot_reply(SNAP_SELSTAT, snapshot_selstat_key(attrib));
+
+	reap_run_job_replies(0);
+	bs = pbs_selstat(sd, attrib, rattrib, extend);
+	snapshot_record(SNAP_SELSTAT, snapshot_selstat_key(attrib), bs);
+
+	return bs;
 }
 
 /**
@@ -220,7 +384,16 @@ send_selstat(int sd, struct attropl *attrib, struct attrl *rattrib, char *extend
 struct batch_status *
 send_statvnode(int sd, char *id, struct attrl *attrib, char *extend)
 {
-	return pbs_statvnode(sd, id, attrib, extend);
+	struct batch_status *bs;
+
+	if (snapshot_replaying())
+		return snapshot_reply(SNAP_STATVNODE, id == NULL ? "" : id);
+
+	reap_run_job_replies(0);
+	bs = pbs_statvnode(sd, id, attrib, extend);
+	snapshot_record(SNAP_STATVNODE, id == NULL ? "" : id, bs);
+
+	return bs;
 }
 
 /**
@@ -237,7 +410,16 @@ send_statvnode(int sd, char *id, struct attrl *attrib, char *extend)
 struct batch_status *
 send_statsched(int sd, struct attrl *attrib, char *extend)
 {
-	return pbs_statsched(sd, attrib, extend);
+	struct batch_status *bs;
+
+	if (snapshot_replaying())
+		return snapshot_reply(SNAP_STATSCHED, "");
+
+	reap_run_job_replies(0);
+	bs = pbs_statsched(sd, attrib, extend);
+	snapshot_record(SNAP_STATSCHED, "", bs);
+
+	return bs;
 }
 
 /**
@@ -255,7 +437,16 @@ send_statsched(int sd, struct attrl *attrib, char *extend)
 struct batch_status *
 send_statqueue(int sd, char *id, struct attrl *attrib, char *extend)
 {
-	return pbs_statque(sd, id, attrib, extend);
+	struct batch_status *bs;
+
+	if (snapshot_replaying())
+		return snapshot_reply(SNAP_STATQUEUE, id == NULL ? "" : id);
+
+	reap_run_job_replies(0);
+	bs = pbs_statque(sd, id, attrib, extend);
+	snapshot_record(SNAP_STATQUEUE, id == NULL ? "" : id, bs);
+
+	return bs;
 }
 
 /**
@@ -272,7 +463,16 @@ send_statqueue(int sd, char *id, struct attrl *attrib, char *extend)
 struct batch_status *
 send_statserver(int sd, struct attrl *attrib, char *extend)
 {
-	return pbs_statserver(sd, attrib, extend);
+	struct batch_status *bs;
+
+	if (snapshot_replaying())
+		return snapshot_reply(SNAP_STATSERVER, "");
+
+	reap_run_job_replies(0);
+	bs = pbs_statserver(sd, attrib, extend);
+	snapshot_record(SNAP_STATSERVER, "", bs);
+
+	return bs;
 }
 
 /**
@@ -290,7 +490,16 @@ send_statserver(int sd, struct attrl *attrib, char *extend)
 struct batch_status *
 send_statrsc(int sd, char *id, struct attrl *attrib, char *extend)
 {
-	return pbs_statrsc(sd, id, attrib, extend);
+	struct batch_status *bs;
+
+	if (snapshot_replaying())
+		return snapshot_reply(SNAP_STATRSC, id == NULL ? "" : id);
+
+	reap_run_job_replies(0);
+	bs = pbs_statrsc(sd, id, attrib, extend);
+	snapshot_record(SNAP_STATRSC, id == NULL ? "" : id, bs);
+
+	return bs;
 }
 
 /**
@@ -308,5 +517,14 @@ send_statrsc(int sd, char *id, struct attrl *attrib, char *extend)
 struct batch_status *
 send_statresv(int sd, char *id, struct attrl *attrib, char *extend)
 {
-	return pbs_statresv(sd, id, attrib, extend);
+	struct batch_status *bs;
+
+	if (snapshot_replaying())
+		return snapshot_reply(SNAP_STATRESV, id == NULL ? "" : id);
+
+	reap_run_job_replies(0);
+	bs = pbs_statresv(sd, id, attrib, extend);
+	snapshot_record(SNAP_STATRESV, id == NULL ? "" : id, bs);
+
+	return bs;
 }
@@ -119,6 +119,7 @@
 #include "libpbs.h"
 #include "constant.h"
 #include "config.h"
+#include "cycle_stats.h"
 #include "server_info.h"
 #include "queue_info.h"
 #include "job_info.h"
@@ -174,6 +175,7 @@ extern char **environ;
 server_info *
 query_server(status *pol, int pbs_sd)
 {
+	phase_timer timer(PHASE_QUERY_SERVER);
 	struct batch_status *server;   /* info about the server */
 	struct batch_status *bs_resvs; /* batch status of the reservations */
 	server_info *sinfo;	       /* scheduler internal form of server info */
@@ -242,11 +244,11 @@ query_server(status *pol, int pbs_sd)
 
 	/* sort the nodes before we filter them down to more useful lists */
 	if (!policy->node_sort->empty())
-		qsort(sinfo->nodes, sinfo->num_nodes, sizeof(node_info *),
-		      multi_node_sort);
+		sort_node_array(sinfo->nodes, sinfo->num_nodes);
 
 	/* get the queues */
 	sinfo->queues = query_queues(policy, pbs_sd, sinfo);
+	prune_job_status_cache();
 	if (sinfo->queues.empty()) {
 		pbs_statfree(server);
 		sinfo->fstree = NULL;
@@ -1585,16 +1587,13 @@ update_server_on_run(status *policy, server_info *sinfo,
 
 				resv_nodes = resresv->job->resv->resv->resv_nodes;
 				num_resv_nodes = count_array(resv_nodes);
-				qsort(resv_nodes, num_resv_nodes, sizeof(node_info *),
-				      multi_node_sort);
+				sort_node_array(resv_nodes, num_resv_nodes);
 			} else {
-				qsort(sinfo->nodes, sinfo->num_nodes, sizeof(node_info *),
-				      multi_node_sort);
+				sort_node_array(sinfo->nodes, sinfo->num_nodes);
 
 				if (sinfo->nodes != sinfo->unassoc_nodes) {
 					auto num_unassoc = count_array(sinfo->unassoc_nodes);
-					qsort(sinfo->unassoc_nodes, num_unassoc, sizeof(node_info *),
-					      multi_node_sort);
+					sort_node_array(sinfo->unassoc_nodes, num_unassoc);
 				}
 			}
 		}
@@ -2164,7 +2163,7 @@ server_info::server_info(const server_info &osinfo)
 		nodes[i]->np_arr =
 			copy_node_partition_ptr_array(osinfo.nodes[i]->np_arr, nodepart);
 		if (calendar != NULL)
-			nodes[i]->node_events = dup_te_lists(osinfo.nodes[i]->node_events, calendar->next_event);
+			nodes[i]->node_events = dup_te_lists(osinfo.nodes[i]->node_events, calendar);
 	}
 	buckets = dup_node_bucket_array(osinfo.buckets, this);
 	/* Now that all job information has been created, time to associate
@@ -3063,7 +3062,7 @@ find_indirect_resource(schd_resource *res, node_info **nodes)
 	for (i = 0; i < max && cur_res != NULL && cur_res->indirect_vnode_name != NULL && !error; i++) {
 		auto ninfo = find_node_info(nodes, cur_res->indirect_vnode_name);
 		if (ninfo != NULL) {
-			cur_res = find_resource(ninfo->res, cur_res->def);
+			cur_res = find_node_resource(ninfo, cur_res->def);
 			if (cur_res == NULL) {
 				error = 1;
 				log_eventf(PBSEVENT_DEBUG, PBS_EVENTCLASS_NODE, LOG_DEBUG, __func__,
@@ -3438,12 +3437,13 @@ update_total_counts_on_end(server_info *si, queue_info *qi,
  *
  * @return	int
  * @retval	unique number for this scheduling cycle
+ *
+ * @par MT-safe: Yes
  */
 int
 get_sched_rank()
 {
-	cstat.order++;
-	return cstat.order;
+	return __atomic_add_fetch(&cstat.order, 1, __ATOMIC_RELAXED);
 }
 
 /**
@@ -3641,7 +3641,7 @@ create_resource_assn_for_node(node_info *ninfo)
 							if (cur_req->type.is_consumable)
 								if (find_resource_req(rns->resreq, cur_req->def) == NULL) {
 									schd_resource *nres;
-									nres = find_resource(ninfo->res, cur_req->def);
+									nres = find_node_resource(ninfo, cur_req->def);
 									if (nres != NULL)
 										nres->assigned += cur_req->amount;
 								}
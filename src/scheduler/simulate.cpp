@@ -68,8 +68,9 @@
  * 	dup_timed_event_list()
  * 	free_timed_event()
  * 	free_timed_event_list()
+ * 	index_event_list()
+ * 	link_timed_events()
  * 	add_event()
- * 	add_timed_event()
  * 	delete_event()
  * 	create_event()
  * 	determine_event_name()
@@ -90,8 +91,12 @@
 #include <string.h>
 #include <errno.h>
 #include <log.h>
+#include <algorithm>
+#include <unordered_set>
+#include <vector>
 
 #include "simulate.h"
+#include "cycle_stats.h"
 #include "data_types.h"
 #include "resource_resv.h"
 #include "resv_info.h"
@@ -470,18 +475,21 @@ find_prev_timed_event(timed_event *event, int ignore_disabled, unsigned int sear
  * @brief
  * 		set the timed_event disabled bit
  *
+ * @param[in,out]	calendar - calendar the event is in (NULL if in none yet)
  * @param[in]	te       - timed event to set
  * @param[in] 	disabled - used to set the disabled bit
  *
  * @return	nothing
  */
 void
-set_timed_event_disabled(timed_event *te, int disabled)
+set_timed_event_disabled(event_list *calendar, timed_event *te, int disabled)
 {
 	if (te == NULL)
 		return;
 
 	te->disabled = disabled ? 1 : 0;
+	if (calendar != NULL)
+		calendar->gen++;
 }
 
 /**
@@ -561,6 +569,75 @@ find_timed_event(timed_event *te_list, time_t event_time)
 	return find_timed_event(te_list, "", 0, TIMED_NOEVENT, event_time);
 }
 
+/**
+ * @brief	is an event before another in the calendar?
+ *
+ * @param[in]	a - an event
+ * @param[in]	b - an event in the same calendar
+ *
+ * @return	bool
+ * @retval	true	a comes before b
+ * @retval	false	a is b or comes after it
+ */
+static bool
+event_before(const timed_event *a, const timed_event *b)
+{
+	if (a->event_time != b->event_time)
+		return a->event_time < b->event_time;
+
+	for (auto e = a->next; e != NULL && e->event_time == a->event_time; e = e->next)
+		if (e == b)
+			return true;
+
+	return false;
+}
+
+/**
+ * @brief
+ * 		find a timed_event in a calendar by name and optionally by event
+ *		type and time.  The calendar's name index is used rather than
+ *		walking the calendar.
+ *
+ * @param[in]	calendar 	- calendar to search in
+ * @param[in]	from		- only consider events from here on, or NULL for all
+ * @param[in] 	name    	- name of timed_event to search for
+ * @param[in] 	ignore_disabled - ignore disabled events
+ * @param[in] 	event_type 	- event_type or TIMED_NOEVENT to ignore
+ * @param[in] 	event_time 	- time or 0 to ignore
+ *
+ * @return	the first matching event in the calendar
+ * @retval	NULL	: no event matches
+ */
+timed_event *
+find_timed_event(event_list *calendar, timed_event *from, const std::string &name, int ignore_disabled,
+		 enum timed_event_types event_type, time_t event_time)
+{
+	timed_event *found = NULL;
+
+	if (calendar == NULL)
+		return NULL;
+	if (name.empty())
+		return find_timed_event(from != NULL ? from : calendar->events, name, ignore_disabled, event_type, event_time);
+
+	auto range = calendar->index->by_name.equal_range(name);
+	for (auto it = range.first; it != range.second; ++it) {
+		timed_event *te = it->second;
+
+		if (ignore_disabled && te->disabled)
+			continue;
+		if (event_type != TIMED_NOEVENT && te->event_type != event_type)
+			continue;
+		if (event_time != 0 && te->event_time != event_time)
+			continue;
+		if (from != NULL && event_before(te, from))
+			continue;
+		if (found == NULL || event_before(te, found))
+			found = te;
+	}
+
+	return found;
+}
+
 /**
  * @brief
  * 		takes a timed_event and performs any actions
@@ -738,6 +815,8 @@ calc_run_time(const std::string &name, server_info *sinfo, int flags)
 	if (!is_resource_resv_valid(resresv, NULL))
 		return (time_t) -1;
 
+	cycle_stats_count(CTR_SIMULATIONS);
+
 	if (flags & USE_BUCKETS)
 		ok_flags |= USE_BUCKETS;
 	if (resresv->is_job) {
@@ -843,6 +922,7 @@ create_event_list(server_info *sinfo)
 		return NULL;
 
 	elist->events = create_events(sinfo);
+	index_event_list(elist);
 
 	elist->next_event = elist->events;
 	elist->first_run_event = find_timed_event(elist->events, TIMED_RUN_EVENT);
@@ -865,7 +945,7 @@ create_event_list(server_info *sinfo)
 timed_event *
 create_events(server_info *sinfo)
 {
-	timed_event *events = NULL;
+	std::vector<timed_event *> events;
 	timed_event *te = NULL;
 	resource_resv **all = NULL;
 	int errflag = 0;
@@ -900,7 +980,7 @@ create_events(server_info *sinfo)
 				errflag++;
 				break;
 			}
-			events = add_timed_event(events, te);
+			events.push_back(te);
 		}
 
 		if (sinfo->use_hard_duration)
@@ -912,7 +992,7 @@ create_events(server_info *sinfo)
 			errflag++;
 			break;
 		}
-		events = add_timed_event(events, te);
+		events.push_back(te);
 	}
 
 	/* for nodes that are in state=sleep add a timed event */
@@ -925,19 +1005,20 @@ create_events(server_info *sinfo)
 				errflag++;
 				break;
 			}
-			events = add_timed_event(events, te);
+			events.push_back(te);
 		}
 	}
 
 	/* A malloc error was encountered, free all allocated memory and return */
 	if (errflag > 0) {
-		free_timed_event_list(events);
+		for (auto e : events)
+			free_timed_event(e);
 		free(all_resresv_copy);
 		return 0;
 	}
 
 	free(all_resresv_copy);
-	return events;
+	return link_timed_events(events);
 }
 
 /**
@@ -962,6 +1043,9 @@ new_event_list()
 	elist->next_event = NULL;
 	elist->first_run_event = NULL;
 	elist->current_time = NULL;
+	elist->resmin_profiles = NULL;
+	elist->gen = 0;
+	elist->index = new event_index();
 
 	return elist;
 }
@@ -998,10 +1082,11 @@ dup_event_list(event_list *oelist, server_info *nsinfo)
 			free_event_list(nelist);
 			return NULL;
 		}
+		index_event_list(nelist);
 	}
 
 	if (oelist->next_event != NULL) {
-		nelist->next_event = find_timed_event(nelist->events, oelist->next_event->name,
+		nelist->next_event = find_timed_event(nelist, NULL, oelist->next_event->name, 0,
 						      oelist->next_event->event_type,
 						      oelist->next_event->event_time);
 		if (nelist->next_event == NULL) {
@@ -1014,7 +1099,7 @@ dup_event_list(event_list *oelist, server_info *nsinfo)
 
 	if (oelist->first_run_event != NULL) {
 		nelist->first_run_event =
-			find_timed_event(nelist->events, oelist->first_run_event->name, TIMED_RUN_EVENT,
+			find_timed_event(nelist, NULL, oelist->first_run_event->name, 0, TIMED_RUN_EVENT,
 					 oelist->first_run_event->event_time);
 		if (nelist->first_run_event == NULL) {
 			log_event(PBSEVENT_SCHED, PBS_EVENTCLASS_SCHED, LOG_WARNING, oelist->first_run_event->name,
@@ -1040,6 +1125,8 @@ free_event_list(event_list *elist)
 		return;
 
 	free_timed_event_list(elist->events);
+	delete elist->resmin_profiles;
+	delete elist->index;
 	free(elist);
 }
 
@@ -1102,7 +1189,7 @@ dup_timed_event(timed_event *ote, server_info *nsinfo)
 		return NULL;
 
 	nte = create_event(ote->event_type, ote->event_time, event_ptr, ote->event_func, ote->event_func_arg);
-	set_timed_event_disabled(nte, ote->disabled);
+	set_timed_event_disabled(NULL, nte, ote->disabled);
 
 	return nte;
 }
@@ -1146,23 +1233,24 @@ free_te_list(te_list *tel)
 /*
  * @brief te_list copy constructor
  * @param[in] ote - te_list to copy
- * @param[in] new_timed_even_list - new timed events
+ * @param[in] ncalendar - new calendar, whose events from next_event on are searched
  *
  * @return copied te_list
  */
 te_list *
-dup_te_list(te_list *ote, timed_event *new_timed_event_list)
+dup_te_list(te_list *ote, event_list *ncalendar)
 {
 	te_list *nte;
 
-	if (ote == NULL || new_timed_event_list == NULL)
+	if (ote == NULL || ncalendar == NULL || ncalendar->next_event == NULL)
 		return NULL;
 
 	nte = new_te_list();
 	if (nte == NULL)
 		return NULL;
 
-	nte->event = find_timed_event(new_timed_event_list, ote->event->name, ote->event->event_type, ote->event->event_time);
+	nte->event = find_timed_event(ncalendar, ncalendar->next_event, ote->event->name, 0,
+				      ote->event->event_type, ote->event->event_time);
 
 	return nte;
 }
@@ -1170,24 +1258,24 @@ dup_te_list(te_list *ote, timed_event *new_timed_event_list)
 /*
  * @brief copy constructor for a list of te_list structures
  * @param[in] ote - te_list to copy
- * @param[in] new_timed_even_list - new timed events
+ * @param[in] ncalendar - new calendar, whose events from next_event on are searched
  *
  * @return copied te_list list
  */
 
 te_list *
-dup_te_lists(te_list *ote, timed_event *new_timed_event_list)
+dup_te_lists(te_list *ote, event_list *ncalendar)
 {
 	te_list *nte;
 	te_list *end_te = NULL;
 	te_list *cur;
 	te_list *nte_head = NULL;
 
-	if (ote == NULL || new_timed_event_list == NULL)
+	if (ote == NULL || ncalendar == NULL || ncalendar->next_event == NULL)
 		return NULL;
 
 	for (cur = ote; cur != NULL; cur = cur->next) {
-		nte = dup_te_list(cur, new_timed_event_list);
+		nte = dup_te_list(cur, ncalendar);
 		if (nte == NULL) {
 			free_te_list(nte_head);
 			return NULL;
@@ -1415,6 +1503,186 @@ free_timed_event_list(timed_event *te_list)
 	}
 }
 
+/**
+ * @brief
+ * 		rebuild the indexes of an event_list from its list of events
+ *
+ * @param[in,out]	calendar - event list
+ *
+ * @return void
+ */
+void
+index_event_list(event_list *calendar)
+{
+	event_index *idx;
+
+	if (calendar == NULL)
+		return;
+
+	calendar->gen++;
+	idx = calendar->index;
+	idx->first_at.clear();
+	idx->by_name.clear();
+	idx->last = NULL;
+
+	for (timed_event *te = calendar->events; te != NULL; te = te->next) {
+		idx->first_at.emplace(te->event_time, te);
+		idx->by_name.emplace(te->name, te);
+		idx->last = te;
+	}
+}
+
+/**
+ * @brief
+ * 		sort new events into calendar order and link them into a list
+ *
+ * @par	The order is the one add_event() keeps: by time, and at the same
+ *	time end events come first.  End events at the same time end up in the
+ *	reverse of the order they were created in and the rest in the order
+ *	they were created in, as if each were added to the calendar in turn.
+ *
+ * @param[in]	events - the events in the order they were created
+ *
+ * @return	head of the timed_event list
+ * @retval	NULL	: there are no events
+ */
+timed_event *
+link_timed_events(const std::vector<timed_event *> &events)
+{
+	struct sort_key {
+		time_t time;
+		int not_end;
+		long seq;
+		timed_event *te;
+	};
+	std::vector<sort_key> keys;
+
+	if (events.empty())
+		return NULL;
+
+	keys.reserve(events.size());
+	for (size_t i = 0; i < events.size(); i++) {
+		timed_event *te = events[i];
+		int not_end = te->event_type == TIMED_END_EVENT ? 0 : 1;
+
+		keys.push_back({te->event_time, not_end, not_end ? static_cast<long>(i) : -static_cast<long>(i), te});
+	}
+	std::sort(keys.begin(), keys.end(), [](const sort_key &a, const sort_key &b) {
+		if (a.time != b.time)
+			return a.time < b.time;
+		if (a.not_end != b.not_end)
+			return a.not_end < b.not_end;
+		return a.seq < b.seq;
+	});
+
+	for (size_t i = 0; i < keys.size(); i++) {
+		keys[i].te->prev = i > 0 ? keys[i - 1].te : NULL;
+		keys[i].te->next = i + 1 < keys.size() ? keys[i + 1].te : NULL;
+	}
+
+	return keys[0].te;
+}
+
+/**
+ * @brief
+ * 		link a timed_event into its place in a calendar and index it
+ *
+ * @note
+ *		if multiple events are at the same time, all end events come first
+ *
+ * @param[in,out]	calendar - event list
+ * @param[in]	te       - timed event
+ *
+ * @return void
+ */
+static void
+insert_timed_event(event_list *calendar, timed_event *te)
+{
+	event_index *idx = calendar->index;
+	timed_event *before = NULL;
+
+	calendar->gen++;
+
+	/* an end event goes in front of the others at its time, anything else
+	 * goes behind them (i.e., in front of the first event at a later time)
+	 */
+	auto at = idx->first_at.find(te->event_time);
+	if (at != idx->first_at.end() && te->event_type == TIMED_END_EVENT)
+		before = at->second;
+	else {
+		auto later = idx->first_at.upper_bound(te->event_time);
+		if (later != idx->first_at.end())
+			before = later->second;
+	}
+
+	if (before != NULL) {
+		te->next = before;
+		te->prev = before->prev;
+		before->prev = te;
+	} else {
+		te->next = NULL;
+		te->prev = idx->last;
+		idx->last = te;
+	}
+	if (te->prev != NULL)
+		te->prev->next = te;
+	else
+		calendar->events = te;
+
+	if (at == idx->first_at.end())
+		idx->first_at.emplace(te->event_time, te);
+	else if (before == at->second)
+		at->second = te;
+	idx->by_name.emplace(te->name, te);
+}
+
+/**
+ * @brief
+ * 		unlink a timed_event from a calendar and drop it from the indexes
+ *
+ * @param[in,out]	calendar - event list
+ * @param[in]	te       - timed event
+ *
+ * @return void
+ */
+static void
+unlink_timed_event(event_list *calendar, timed_event *te)
+{
+	event_index *idx = calendar->index;
+
+	calendar->gen++;
+
+	auto at = idx->first_at.find(te->event_time);
+	if (at != idx->first_at.end() && at->second == te) {
+		if (te->next != NULL && te->next->event_time == te->event_time)
+			at->second = te->next;
+		else
+			idx->first_at.erase(at);
+	}
+
+	auto range = idx->by_name.equal_range(te->name);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second == te) {
+			idx->by_name.erase(it);
+			break;
+		}
+	}
+
+	if (idx->last == te)
+		idx->last = te->prev;
+
+	if (te->prev == NULL)
+		calendar->events = te->next;
+	else
+		te->prev->next = te->next;
+
+	if (te->next != NULL)
+		te->next->prev = te->prev;
+
+	te->next = NULL;
+	te->prev = NULL;
+}
+
 /**
  * @brief
  * 		add a timed_event to an event list
@@ -1440,7 +1708,7 @@ add_event(event_list *calendar, timed_event *te)
 	if (calendar->events == NULL)
 		events_is_null = 1;
 
-	calendar->events = add_timed_event(calendar->events, te);
+	insert_timed_event(calendar, te);
 
 	/* empty event list - the new event is the only event */
 	if (events_is_null)
@@ -1452,10 +1720,8 @@ add_event(event_list *calendar, timed_event *te)
 		if (te->event_time > current_time) {
 			if (te->event_time < calendar->next_event->event_time)
 				calendar->next_event = te;
-			else if (te->event_time == calendar->next_event->event_time) {
-				calendar->next_event =
-					find_timed_event(calendar->events, te->event_time);
-			}
+			else if (te->event_time == calendar->next_event->event_time)
+				calendar->next_event = calendar->index->first_at[te->event_time];
 		}
 	}
 	/* if next_event == NULL, then we've simulated to the end. */
@@ -1475,58 +1741,6 @@ add_event(event_list *calendar, timed_event *te)
 	return 1;
 }
 
-/**
- * @brief
- * 		add_timed_event - add an event to a sorted list of events
- *
- * @note
- *		ASSUMPTION: if multiple events are at the same time, all
- *		    end events will come first
- *
- * @param	events - event list to add event to
- * @param 	te     - timed_event to add to list
- *
- * @return	head of timed_event list
- */
-timed_event *
-add_timed_event(timed_event *events, timed_event *te)
-{
-	timed_event *eloop;
-	timed_event *eloop_prev = NULL;
-
-	if (te == NULL)
-		return events;
-
-	if (events == NULL)
-		return te;
-
-	for (eloop = events; eloop != NULL; eloop = eloop->next) {
-		if (eloop->event_time > te->event_time)
-			break;
-		if (eloop->event_time == te->event_time &&
-		    te->event_type == TIMED_END_EVENT) {
-			break;
-		}
-
-		eloop_prev = eloop;
-	}
-
-	if (eloop_prev == NULL) {
-		te->next = events;
-		events->prev = te;
-		te->prev = NULL;
-		return te;
-	}
-
-	te->next = eloop;
-	eloop_prev->next = te;
-	te->prev = eloop_prev;
-	if (eloop != NULL)
-		eloop->prev = te;
-
-	return events;
-}
-
 /**
  * @brief
  * 		delete a timed event from an event_list
@@ -1550,16 +1764,11 @@ delete_event(server_info *sinfo, timed_event *e)
 	if (calendar->next_event == e)
 		calendar->next_event = e->next;
 
+	/* e was the first run event, so the next one is after it */
 	if (calendar->first_run_event == e)
-		calendar->first_run_event = find_timed_event(calendar->events, TIMED_RUN_EVENT);
-
-	if (e->prev == NULL)
-		calendar->events = e->next;
-	else
-		e->prev->next = e->next;
+		calendar->first_run_event = find_init_timed_event(e->next, 0, TIMED_RUN_EVENT);
 
-	if (e->next != NULL)
-		e->next->prev = e->prev;
+	unlink_timed_event(calendar, e);
 
 	free_timed_event(e);
 }
@@ -1732,6 +1941,96 @@ add_dedtime_events(event_list *elist, status *policy)
 	return 1;
 }
 
+/**
+ * @brief
+ * 		get the resmin_profile of a calendar for a set of resresvs,
+ *		(re)building it if the calendar or the set has changed since it
+ *		was built.  Profiles are kept by the owner of the set rather than
+ *		by the set itself: an array freed mid-cycle may have its address
+ *		reused by another owner's array.
+ *		The profile holds, for each run/end event from the calendar's
+ *		next event on, the peak change in the amount of each consumable
+ *		resource assigned up to and including that event.
+ *
+ * @param[in] calendar	- calendar to profile
+ * @param[in] incl_arr	- only use events for resresvs in this array (can be NULL)
+ * @param[in] owner	- queue or server incl_arr belongs to
+ *
+ * @return	resmin_profile *
+ * @retval	the profile (owned by the calendar)
+ *
+ * @par MT-safe: No
+ */
+static resmin_profile *
+get_resmin_profile(event_list *calendar, resource_resv **incl_arr, const void *owner)
+{
+	std::unordered_set<int> incl_ranks;
+	std::unordered_map<resdef *, size_t> def_ind;
+	std::vector<sch_resource_t> assigned;
+	unsigned int event_mask = (TIMED_RUN_EVENT | TIMED_END_EVENT);
+	timed_event *te;
+
+	if (calendar->resmin_profiles == NULL)
+		calendar->resmin_profiles = new std::unordered_map<const void *, resmin_profile>;
+
+	auto &prof = (*calendar->resmin_profiles)[owner];
+	if (!prof.times.empty() && prof.gen == calendar->gen && prof.start == calendar->next_event &&
+	    prof.incl_arr == incl_arr)
+		return &prof;
+
+	prof.gen = calendar->gen;
+	prof.start = calendar->next_event;
+	prof.incl_arr = incl_arr;
+	prof.times.clear();
+	prof.defs.clear();
+	prof.first.clear();
+	prof.peak.clear();
+
+	if (incl_arr != NULL)
+		for (int i = 0; incl_arr[i] != NULL; i++)
+			incl_ranks.insert(incl_arr[i]->rank);
+
+	for (te = find_init_timed_event(get_next_event(calendar), IGNORE_DISABLED_EVENTS, event_mask);
+	     te != NULL; te = find_next_timed_event(te, IGNORE_DISABLED_EVENTS, event_mask)) {
+		auto resresv = static_cast<resource_resv *>(te->event_ptr);
+		size_t j = prof.times.size();
+
+		prof.times.push_back(te->event_time);
+		for (auto &p : prof.peak)
+			p.push_back(p.back());
+
+		if (incl_arr != NULL && incl_ranks.find(resresv->rank) == incl_ranks.end())
+			continue;
+
+		for (auto req = resresv->resreq; req != NULL; req = req->next) {
+			if (!req->type.is_consumable)
+				continue;
+
+			auto d = def_ind.find(req->def);
+			size_t k;
+			if (d == def_ind.end()) {
+				k = prof.defs.size();
+				def_ind[req->def] = k;
+				prof.defs.push_back(req->def);
+				prof.first.push_back(j);
+				prof.peak.emplace_back(j + 1, 0);
+				assigned.push_back(0);
+			} else
+				k = d->second;
+
+			if (te->event_type == TIMED_RUN_EVENT)
+				assigned[k] += req->amount;
+			else
+				assigned[k] -= req->amount;
+
+			if (assigned[k] > prof.peak[k][j])
+				prof.peak[k][j] = assigned[k];
+		}
+	}
+
+	return &prof;
+}
+
 /**
  * @brief
  * 		simulate the minimum amount of a resource list
@@ -1747,23 +2046,30 @@ add_dedtime_events(event_list *elist, status *policy)
  *		qmgr -c 's s resources_available.ncpus + =5' this function will
  *		will have to be revisited.
  *
+ * @note
+ * 		Unless exclude has events in the calendar, the answer comes from
+ *		the calendar's resmin_profile for incl_arr.  It is built once per
+ *		change to the calendar and then each call is a binary search on
+ *		the end time.
+ *
  * @param[in] reslist	- resource list to simulate
  * @param[in] end	- end time
  * @param[in] calendar	- calendar to simulate
  * @param[in] incl_arr	- only use events for resresvs in this array (can be NULL)
+ * @param[in] owner	- queue or server incl_arr belongs to
  * @param[in] exclude	- job/resv to ignore (possibly NULL)
  *
  * @return static pointer to amount of resources available during
  * @retval the entire length from now to end
  * @retval	NULL	: on error
  *
- * @par MT-safe: No
+ * @par MT-safe: Yes (one return buffer per thread)
  */
 schd_resource *
 simulate_resmin(schd_resource *reslist, time_t end, event_list *calendar,
-		resource_resv **incl_arr, resource_resv *exclude)
+		resource_resv **incl_arr, const void *owner, resource_resv *exclude)
 {
-	static schd_resource *retres = NULL; /* return pointer */
+	static thread_local schd_resource *retres = NULL; /* return pointer */
 
 	schd_resource *cur_res;
 	schd_resource *cur_resmin;
@@ -1790,6 +2096,35 @@ simulate_resmin(schd_resource *reslist, time_t end, event_list *calendar,
 		retres = NULL;
 	}
 
+	/* The events of the resresv to exclude are in the profile, so we
+	 * have to simulate the calendar the long way.
+	 */
+	if (exclude == NULL || (exclude->run_event == NULL && exclude->end_event == NULL)) {
+		auto prof = get_resmin_profile(calendar, incl_arr, owner);
+		size_t num_events;
+
+		if (end == 0)
+			num_events = prof->times.size();
+		else
+			num_events = std::lower_bound(prof->times.begin(), prof->times.end(), end) - prof->times.begin();
+
+		if ((resmin = dup_resource_list(reslist)) == NULL)
+			return NULL;
+
+		for (size_t k = 0; k < prof->defs.size(); k++) {
+			if (prof->first[k] >= num_events)
+				continue;
+			cur_resmin = find_alloc_resource(resmin, prof->defs[k]);
+			if (cur_resmin == NULL) {
+				free_resource_list(resmin);
+				return NULL;
+			}
+			cur_resmin->assigned += prof->peak[k][num_events - 1];
+		}
+		retres = resmin;
+		return retres;
+	}
+
 	if ((res = dup_resource_list(reslist)) == NULL)
 		return NULL;
 	if ((resmin = dup_resource_list(reslist)) == NULL) {
@@ -108,12 +108,13 @@ timed_event *find_prev_timed_event(timed_event *event, int ignore_disabled, unsi
 /*
  *      set_timed_event_disabled - set the timed_event disabled bit
  *
+ *        calendar - calendar the event is in (NULL if in none yet)
  *        te       - timed event to set
  *        disabled - used to set the disabled bit
  *
  *      return nothing
  */
-void set_timed_event_disabled(timed_event *te, int disabled);
+void set_timed_event_disabled(event_list *calendar, timed_event *te, int disabled);
 
 /*
  *
@@ -139,6 +140,15 @@ timed_event *find_timed_event(timed_event *te_list, enum timed_event_types event
 timed_event *find_timed_event(timed_event *te_list, const std::string &name, enum timed_event_types event_type, time_t event_time);
 timed_event *find_timed_event(timed_event *te_list, time_t event_time);
 
+/*
+ *	find_timed_event - find a timed_event in a calendar by name using the
+ *			   calendar's index.  Only events from 'from' on are
+ *			   considered (NULL for all).  The first match is returned.
+ */
+timed_event *
+find_timed_event(event_list *calendar, timed_event *from, const std::string &name, int ignore_disabled,
+		 enum timed_event_types event_type, time_t event_time);
+
 /*
  *      next_event - move an event_list to the next event and return it
  *
@@ -292,17 +302,21 @@ void free_event_list(event_list *el);
 timed_event *find_event_by_name(timed_event *events, char *name);
 
 /*
- *      add_timed_event - add an event to a sorted list of events
+ *      index_event_list - rebuild the indexes of an event_list from its events
+ */
+void index_event_list(event_list *calendar);
+
+/*
+ *      link_timed_events - sort new events into calendar order and link them
  *
  *      ASSUMPTION: if multiple events are at the same time, all
  *                  end events will come first
  *
- *        \param events - event list to add event to
- *        \param te     - timed_event to add to list
+ *        \param events - the events in the order they were created
  *
  *      \return head of timed_event list
  */
-timed_event *add_timed_event(timed_event *events, timed_event *te);
+timed_event *link_timed_events(const std::vector<timed_event *> &events);
 /*
  *
  *	add_event - add a timed_event to an event list
@@ -395,6 +409,7 @@ int add_dedtime_events(event_list *elist, struct status *policy);
  *	  end	  - end time
  *	  calendar - calendar to simulate
  *	  incl_arr - only use events for resresvs in this array (can be NULL)
+ *	  owner	  - queue or server incl_arr belongs to
  *	  exclude	  - job/resv to ignore (possibly NULL)
  *
  *	return static pointer to amount of resources available during
@@ -402,7 +417,7 @@ int add_dedtime_events(event_list *elist, struct status *policy);
  */
 schd_resource *
 simulate_resmin(schd_resource *reslist, time_t end, event_list *calendar,
-		resource_resv **incl_arr, resource_resv *exclude);
+		resource_resv **incl_arr, const void *owner, resource_resv *exclude);
 
 /*
  *
@@ -442,8 +457,8 @@ generic_sim(event_list *calendar, unsigned int event_mask, time_t end, int defau
 
 te_list *new_te_list();
 
-te_list *dup_te_list(te_list *ote, timed_event *new_timed_event_list);
-te_list *dup_te_lists(te_list *ote, timed_event *new_timed_event_list);
+te_list *dup_te_list(te_list *ote, event_list *ncalendar);
+te_list *dup_te_lists(te_list *ote, event_list *ncalendar);
 
 void free_te_list(te_list *tel);
 
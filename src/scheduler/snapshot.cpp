@@ -0,0 +1,613 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+/**
+ * @file    snapshot.cpp
+ *
+ * @brief
+ * 		snapshot.cpp - record the server's replies of a scheduling cycle and
+ *		answer server queries from such a recording.
+ *
+ *	When cycle_snapshot is set in the sched_config, the reply of every
+ *	server query made in a cycle is kept and at the end of the cycle it is
+ *	written to CYCLE_SNAPSHOT_FILE in sched_priv along with the fairshare
+ *	usage.  The scheduler and resource queries are mostly made outside of
+ *	a cycle, so their last replies are always kept and added to each
+ *	cycle's snapshot.
+ *
+ *	pbs_sched_replay loads a snapshot and the server query wrappers answer
+ *	from it instead of a server.  The file is text with one record per
+ *	line and tab separated fields.  Tabs, newlines and backslashes in a
+ *	field are escaped with a backslash.
+ *
+ *		#PBS_SCHED_SNAPSHOT 1	file header
+ *		N <sched>		name of the scheduler
+ *		T <time>		time of the cycle
+ *		@ <query> <key>		start of a query's reply
+ *		O <name>		object in the reply
+ *		A <name> <resc> <value>	attribute of the object
+ *		.			end of the reply
+ *		F <entity> <usage>	fairshare usage of an entity
+ *		D <time>		last time the fairshare tree was decayed
+ *
+ * Functions included are:
+ * 	snapshot_cycle_begin()
+ * 	snapshot_cycle_end()
+ * 	snapshot_recording()
+ * 	snapshot_missing_defs()
+ * 	snapshot_record()
+ * 	snapshot_selstat_key()
+ * 	snapshot_load()
+ * 	snapshot_replaying()
+ * 	snapshot_reply()
+ * 	snapshot_time()
+ * 	snapshot_sched_name()
+ * 	snapshot_apply_usage()
+ * 	snapshot_decision()
+ *
+ */
+#include <pbs_config.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <libpbs.h>
+#include <log.h>
+
+#include "config.h"
+#include "constant.h"
+#include "data_types.h"
+#include "fairshare.h"
+#include "globals.h"
+#include "snapshot.h"
+
+#define SNAPSHOT_MAGIC "#PBS_SCHED_SNAPSHOT 1"
+
+static const char *snap_call_names[SNAP_NUM_CALLS] = {
+	"statserver",
+	"statsched",
+	"statque",
+	"statvnode",
+	"statresv",
+	"statrsc",
+	"selstat"};
+
+/* an object of a recorded reply */
+struct snap_obj {
+	std::string name;
+	std::vector<std::array<std::string, 3>> attrs; /* name, resource, value */
+};
+
+static bool recording;		/* the current cycle is being recorded */
+static std::string cycle_replies;	/* replies recorded in the current cycle */
+static std::string last_sched;	/* last reply to the scheduler query */
+static std::string last_rsc;	/* last reply to the resource query */
+
+static bool replaying;		/* answer queries from the loaded snapshot */
+static time_t snap_time;
+static std::string snap_sched;
+static std::unordered_map<std::string, std::vector<snap_obj>> snap_replies;
+static std::vector<std::pair<std::string, usage_t>> snap_usage;
+static time_t snap_last_decay;
+
+/**
+ * @brief	append a field to a record, escaping the characters which
+ *		separate fields and records
+ *
+ * @param[in,out]	buf - record being built
+ * @param[in]	field - the field (NULL is written as an empty field)
+ *
+ * @return	void
+ */
+static void
+append_field(std::string &buf, const char *field)
+{
+	buf += '\t';
+	if (field == NULL)
+		return;
+
+	for (const char *p = field; *p != '\0'; p++) {
+		switch (*p) {
+			case '\\':
+				buf += "\\\\";
+				break;
+			case '\t':
+				buf += "\\t";
+				break;
+			case '\n':
+				buf += "\\n";
+				break;
+			default:
+				buf += *p;
+		}
+	}
+}
+
+/**
+ * @brief	split a record into its fields and unescape them
+ *
+ * @param[in]	line - the record without its newline
+ *
+ * @return	std::vector<std::string>
+ */
+static std::vector<std::string>
+split_fields(const char *line)
+{
+	std::vector<std::string> fields(1);
+
+	for (const char *p = line; *p != '\0'; p++) {
+		if (*p == '\t')
+			fields.emplace_back();
+		else if (*p == '\\' && p[1] != '\0') {
+			p++;
+			fields.back() += (*p == 't') ? '\t' : (*p == 'n') ? '\n' : *p;
+		} else
+			fields.back() += *p;
+	}
+
+	return fields;
+}
+
+/**
+ * @brief	the key a reply is kept under
+ */
+static std::string
+reply_key(enum snap_call call, const std::string &key)
+{
+	return std::string(snap_call_names[call]) + '\t' + key;
+}
+
+/**
+ * @brief	serialize a query's reply and append it to a buffer
+ *
+ * @param[in,out]	buf - buffer to append to
+ * @param[in]	call - the query
+ * @param[in]	key - what the query asked for
+ * @param[in]	bs - the reply
+ *
+ * @return	void
+ */
+static void
+append_reply(std::string &buf, enum snap_call call, const std::string &key, struct batch_status *bs)
+{
+	buf += '@';
+	append_field(buf, snap_call_names[call]);
+	append_field(buf, key.c_str());
+	buf += '\n';
+
+	for (; bs != NULL; bs = bs->next) {
+		buf += 'O';
+		append_field(buf, bs->name);
+		buf += '\n';
+		for (struct attrl *attrp = bs->attribs; attrp != NULL; attrp = attrp->next) {
+			buf += 'A';
+			append_field(buf, attrp->name);
+			append_field(buf, attrp->resource);
+			append_field(buf, attrp->value);
+			buf += '\n';
+		}
+	}
+	buf += ".\n";
+}
+
+/**
+ * @brief	start recording the server's replies of a new cycle.  Nothing
+ *		is recorded unless cycle_snapshot is set in the sched_config.
+ *
+ * @return	void
+ */
+void
+snapshot_cycle_begin(void)
+{
+	recording = conf.cycle_snapshot;
+	cycle_replies.clear();
+}
+
+/**
+ * @brief	is the current cycle being recorded?
+ *
+ * @return	bool
+ */
+bool
+snapshot_recording(void)
+{
+	return recording;
+}
+
+/**
+ * @brief	are the scheduler or resource definitions missing from the
+ *		recording of the current cycle?  They are only queried when the
+ *		scheduler starts or is reconfigured, which may have happened
+ *		before cycle_snapshot was set.
+ *
+ * @return	bool
+ */
+bool
+snapshot_missing_defs(void)
+{
+	return recording && (last_sched.empty() || last_rsc.empty());
+}
+
+/**
+ * @brief	record the reply of a server query.  Failed queries are not
+ *		recorded.
+ *
+ * @param[in]	call - the query
+ * @param[in]	key - what the query asked for (e.g., the object id)
+ * @param[in]	bs - the reply
+ *
+ * @return	void
+ */
+void
+snapshot_record(enum snap_call call, const std::string &key, struct batch_status *bs)
+{
+	if (!conf.cycle_snapshot)
+		return;
+	if (bs == NULL && pbs_errno != PBSE_NONE)
+		return;
+
+	switch (call) {
+		case SNAP_STATSCHED:
+			last_sched.clear();
+			append_reply(last_sched, call, key, bs);
+			break;
+		case SNAP_STATRSC:
+			last_rsc.clear();
+			append_reply(last_rsc, call, key, bs);
+			break;
+		default:
+			if (recording)
+				append_reply(cycle_replies, call, key, bs);
+	}
+}
+
+/**
+ * @brief	write the replies recorded in the cycle and the fairshare usage
+ *		to the snapshot file.  The file is written under a temporary
+ *		name and renamed so a reader never sees a partial file.
+ *
+ * @return	void
+ */
+void
+snapshot_cycle_end(void)
+{
+	const char *tmpname = CYCLE_SNAPSHOT_FILE ".new";
+	std::string buf;
+	FILE *fp;
+
+	if (!recording)
+		return;
+	recording = false;
+
+	buf = SNAPSHOT_MAGIC "\nN";
+	append_field(buf, sc_name);
+	buf += "\nT\t" + std::to_string(cstat.current_time) + '\n';
+	buf += last_sched;
+	buf += last_rsc;
+	buf += cycle_replies;
+	cycle_replies.clear();
+
+	if (fstree != NULL) {
+		char usage_buf[64];
+
+		for (const auto &gi : fstree->nodes) {
+			buf += 'F';
+			append_field(buf, gi.name.c_str());
+			snprintf(usage_buf, sizeof(usage_buf), "\t%.17g\n", gi.usage);
+			buf += usage_buf;
+		}
+		buf += "D\t" + std::to_string(fstree->last_decay) + '\n';
+	}
+
+	if ((fp = fopen(tmpname, "w")) == NULL) {
+		log_errf(errno, __func__, "Error opening file %s", tmpname);
+		return;
+	}
+
+	if (fwrite(buf.data(), 1, buf.size(), fp) != buf.size() ||
+	    fclose(fp) != 0 || rename(tmpname, CYCLE_SNAPSHOT_FILE) != 0) {
+		log_errf(errno, __func__, "Error writing file %s", CYCLE_SNAPSHOT_FILE);
+		remove(tmpname);
+	}
+}
+
+/**
+ * @brief	build the key of a pbs_selstat() query from its selection
+ *		criteria (e.g., "queue=workq")
+ *
+ * @param[in]	opl - the selection criteria
+ *
+ * @return	std::string
+ */
+std::string
+snapshot_selstat_key(struct attropl *opl)
+{
+	std::string key;
+
+	for (; opl != NULL; opl = opl->next) {
+		const char *op;
+
+		switch (opl->op) {
+			case EQ:
+				op = "=";
+				break;
+			case NE:
+				op = "!=";
+				break;
+			case GE:
+				op = ">=";
+				break;
+			case GT:
+				op = ">";
+				break;
+			case LE:
+				op = "<=";
+				break;
+			case LT:
+				op = "<";
+				break;
+			default:
+				op = "?";
+		}
+		if (!key.empty())
+			key += ',';
+		key += std::string(opl->name) + op + (opl->value == NULL ? "" : opl->value);
+	}
+
+	return key;
+}
+
+/**
+ * @brief	load a snapshot file.  From then on server queries are answered
+ *		from it.
+ *
+ * @param[in]	file - the snapshot file
+ *
+ * @return	int
+ * @retval	0	success
+ * @retval	-1	the file could not be read or is not a snapshot
+ */
+int
+snapshot_load(const char *file)
+{
+	std::vector<snap_obj> *reply = NULL;
+	char *line = NULL;
+	size_t len = 0;
+	ssize_t n;
+	int lineno = 0;
+	int ret = 0;
+	FILE *fp;
+
+	if ((fp = fopen(file, "r")) == NULL) {
+		log_errf(errno, __func__, "Error opening file %s", file);
+		return -1;
+	}
+
+	while (ret == 0 && (n = getline(&line, &len, fp)) != -1) {
+		lineno++;
+		if (n > 0 && line[n - 1] == '\n')
+			line[n - 1] = '\0';
+
+		if (lineno == 1) {
+			if (strcmp(line, SNAPSHOT_MAGIC) != 0)
+				ret = -1;
+			continue;
+		}
+
+		auto f = split_fields(line);
+		const std::string &type = f[0];
+
+		if (type == "N" && f.size() == 2)
+			snap_sched = f[1];
+		else if (type == "T" && f.size() == 2)
+			snap_time = strtol(f[1].c_str(), NULL, 10);
+		else if (type == "@" && f.size() == 3) {
+			/* the last reply to the same query wins */
+			reply = &snap_replies[f[1] + '\t' + f[2]];
+			reply->clear();
+		} else if (type == "O" && f.size() == 2 && reply != NULL) {
+			reply->emplace_back();
+			reply->back().name = f[1];
+		} else if (type == "A" && f.size() == 4 && reply != NULL && !reply->empty())
+			reply->back().attrs.push_back({f[1], f[2], f[3]});
+		else if (type == "." && f.size() == 1)
+			reply = NULL;
+		else if (type == "F" && f.size() == 3)
+			snap_usage.emplace_back(f[1], strtod(f[2].c_str(), NULL));
+		else if (type == "D" && f.size() == 2)
+			snap_last_decay = strtol(f[1].c_str(), NULL, 10);
+		else
+			ret = -1;
+	}
+
+	if (ret != 0)
+		log_eventf(PBSEVENT_ERROR, PBS_EVENTCLASS_FILE, LOG_ERR, file,
+			   "Not a scheduler snapshot or bad record at line %d", lineno);
+	else
+		replaying = true;
+
+	free(line);
+	fclose(fp);
+	return ret;
+}
+
+/**
+ * @brief	are server queries answered from a snapshot?
+ *
+ * @return	bool
+ */
+bool
+snapshot_replaying(void)
+{
+	return replaying;
+}
+
+/**
+ * @brief	answer a server query from the loaded snapshot
+ *
+ * @param[in]	call - the query
+ * @param[in]	key - what the query asked for
+ *
+ * @return	struct batch_status *
+ * @retval	the recorded reply.  Free with pbs_statfree().
+ * @retval	NULL if the reply was empty or is not in the snapshot (pbs_errno
+ *		is PBSE_NONE) or on error (pbs_errno is set)
+ */
+struct batch_status *
+snapshot_reply(enum snap_call call, const std::string &key)
+{
+	struct batch_status *head = NULL;
+	struct batch_status **tail = &head;
+
+	pbs_errno = PBSE_NONE;
+
+	auto it = snap_replies.find(reply_key(call, key));
+	if (it == snap_replies.end()) {
+		log_eventf(PBSEVENT_DEBUG, PBS_EVENTCLASS_SERVER, LOG_DEBUG, __func__,
+			   "No %s reply for \"%s\" in the snapshot", snap_call_names[call], key.c_str());
+		return NULL;
+	}
+
+	for (const auto &obj : it->second) {
+		struct batch_status *bs;
+		struct attrl **atail;
+
+		if ((bs = static_cast<batch_status *>(calloc(1, sizeof(struct batch_status)))) == NULL)
+			goto err;
+		*tail = bs;
+		tail = &bs->next;
+		if ((bs->name = strdup(obj.name.c_str())) == NULL)
+			goto err;
+
+		atail = &bs->attribs;
+		for (const auto &a : obj.attrs) {
+			struct attrl *attrp;
+
+			if ((attrp = static_cast<attrl *>(calloc(1, sizeof(struct attrl)))) == NULL)
+				goto err;
+			*atail = attrp;
+			atail = &attrp->next;
+			attrp->name = strdup(a[0].c_str());
+			attrp->resource = a[1].empty() ? NULL : strdup(a[1].c_str());
+			attrp->value = strdup(a[2].c_str());
+			if (attrp->name == NULL || attrp->value == NULL || (!a[1].empty() && attrp->resource == NULL))
+				goto err;
+		}
+	}
+
+	return head;
+
+err:
+	log_err(errno, __func__, MEM_ERR_MSG);
+	pbs_statfree(head);
+	pbs_errno = PBSE_SYSTEM;
+	return NULL;
+}
+
+/**
+ * @brief	time the snapshot was taken at
+ *
+ * @return	time_t
+ * @retval	the time of the recorded cycle
+ * @retval	0	if no snapshot is loaded
+ */
+time_t
+snapshot_time(void)
+{
+	return snap_time;
+}
+
+/**
+ * @brief	name of the scheduler which took the snapshot
+ *
+ * @return	const char *
+ * @retval	the scheduler's name
+ * @retval	NULL if no snapshot is loaded
+ */
+const char *
+snapshot_sched_name(void)
+{
+	return snap_sched.empty() ? NULL : snap_sched.c_str();
+}
+
+/**
+ * @brief	set the fairshare usage of the tree to the recorded usage.
+ *		Entities which are not in the tree are added to the unknown group.
+ *
+ * @param[in,out]	fhead - the fairshare tree
+ *
+ * @return	void
+ */
+void
+snapshot_apply_usage(fairshare_head *fhead)
+{
+	if (fhead == NULL)
+		return;
+
+	for (const auto &u : snap_usage) {
+		group_info *gi = find_alloc_ginfo(u.first, fhead);
+
+		if (gi != NULL)
+			gi->usage = u.second;
+	}
+	if (snap_last_decay != 0)
+		fhead->last_decay = snap_last_decay;
+}
+
+/**
+ * @brief	report a decision the scheduler made while replaying a snapshot
+ *
+ * @param[in]	action - what was done (e.g., "run")
+ * @param[in]	name - the job or reservation it was done to
+ * @param[in]	detail - the rest (e.g., the execvnode)
+ *
+ * @return	void
+ */
+void
+snapshot_decision(const char *action, const std::string &name, const std::string &detail)
+{
+	printf("%s\t%s\t%s\n", action, name.c_str(), detail.c_str());
+}
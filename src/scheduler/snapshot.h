@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include <time.h>
+
+#include <string>
+
+#include <pbs_ifl.h>
+
+#include "constant.h"
+#include "data_types.h"
+
+/* start recording the server's replies of a new cycle (if cycle_snapshot is set) */
+void snapshot_cycle_begin(void);
+
+/* write the replies recorded this cycle and the fairshare usage to the snapshot file */
+void snapshot_cycle_end(void);
+
+/* is the current cycle being recorded? */
+bool snapshot_recording(void);
+
+/* are the scheduler or resource definitions missing from the recording? */
+bool snapshot_missing_defs(void);
+
+/* record the reply of a server query */
+void snapshot_record(enum snap_call call, const std::string &key, struct batch_status *bs);
+
+/* build the key of a pbs_selstat() query from its selection criteria */
+std::string snapshot_selstat_key(struct attropl *opl);
+
+/* load a snapshot file and answer server queries from it from now on */
+int snapshot_load(const char *file);
+
+/* are server queries answered from a snapshot? */
+bool snapshot_replaying(void);
+
+/* answer a server query from the loaded snapshot */
+struct batch_status *snapshot_reply(enum snap_call call, const std::string &key);
+
+/* time the snapshot was taken at */
+time_t snapshot_time(void);
+
+/* name of the scheduler the snapshot was taken by */
+const char *snapshot_sched_name(void);
+
+/* set the fairshare usage from the snapshot */
+void snapshot_apply_usage(fairshare_head *fhead);
+
+/* report a decision the scheduler made while replaying */
+void snapshot_decision(const char *action, const std::string &name, const std::string &detail);
+
+#endif /* _SNAPSHOT_H */
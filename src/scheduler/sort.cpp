@@ -67,6 +67,10 @@
  * 	cmp_node_host()
  * 	cmp_aoe()
  * 	cmp_job_preemption_time_asc()
+ * 	fill_sort_keys_chunk()
+ * 	sort_job_array()
+ * 	sort_node_array()
+ * 	sort_nodepart_array()
  * 	sort_jobs()
  * 	swapfunc()
  * 	med3()
@@ -77,6 +81,7 @@
 
 #include "check.h"
 #include "constant.h"
+#include "cycle_stats.h"
 #include "data_types.h"
 #include "fairshare.h"
 #include "fifo.h"
@@ -87,12 +92,19 @@
 #include "resource_resv.h"
 #include "server_info.h"
 #include "sort.h"
+#include "multi_threading.h"
 #include <errno.h>
 #include <log.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
 #ifdef NAS
 #include "site_code.h"
 #endif
@@ -1116,6 +1128,376 @@ cmp_resv_state(const void *r1, const void *r2)
 		return 0;
 }
 
+/* Key based sorting
+ * Sorting with the comparators above finds every sort key of both objects on
+ * each comparison.  Instead, the keys of each object are found once and
+ * packed into a row of doubles which are compared in ascending order.  A
+ * descending key is negated.  The last columns are a unique tiebreak
+ * (e.g., rank) so the order is total and the same as the comparator's.
+ */
+
+/**
+ * @brief	fill the sort keys of a chunk of objects
+ *
+ * @param[in,out]	data - the thread data of the chunk
+ *
+ * @return	void
+ */
+void
+fill_sort_keys_chunk(th_data_sort_keys *data)
+{
+	for (int i = data->sidx; i <= data->eidx; i++)
+		(*data->fill_key)(i, &data->keys[static_cast<size_t>(i) * data->num_keys]);
+}
+
+/**
+ * @brief	fill the sort keys of an array of objects in parallel
+ *
+ * @param[in]	num - number of objects
+ * @param[in]	num_keys - number of keys per object
+ * @param[in]	fill_key - fills the keys of object idx into key[0 .. num_keys-1]
+ * @param[out]	keys - the keys of the objects, num_keys per object
+ *
+ * @return	bool
+ * @retval	true	: success
+ * @retval	false	: error
+ */
+static bool
+fill_sort_keys(int num, int num_keys, const std::function<void(int idx, double *key)> &fill_key, std::vector<double> &keys)
+{
+	std::vector<void *> tdatas;
+	bool ret;
+
+	keys.resize(static_cast<size_t>(num) * num_keys);
+
+	ret = parallel_for(TS_FILL_SORT_KEYS, num, [&](int sidx, int eidx) {
+		th_data_sort_keys *tdata;
+
+		tdata = static_cast<th_data_sort_keys *>(malloc(sizeof(th_data_sort_keys)));
+		if (tdata == NULL) {
+			log_err(errno, __func__, MEM_ERR_MSG);
+			return static_cast<void *>(NULL);
+		}
+		tdata->fill_key = &fill_key;
+		tdata->keys = keys.data();
+		tdata->num_keys = num_keys;
+		tdata->sidx = sidx;
+		tdata->eidx = eidx;
+		return static_cast<void *>(tdata);
+	}, tdatas);
+
+	for (auto td : tdatas)
+		free(td);
+
+	return ret;
+}
+
+/**
+ * @brief	map a double onto an unsigned integer with the same order
+ *
+ * @param[in]	d - the double
+ *
+ * @return	uint64_t
+ */
+static inline uint64_t
+sort_key_bits(double d)
+{
+	uint64_t bits;
+
+	d += 0.0; /* -0 sorts with 0 */
+	memcpy(&bits, &d, sizeof(bits));
+	if (bits >> 63)
+		return ~bits;
+	return bits | (static_cast<uint64_t>(1) << 63);
+}
+
+/**
+ * @brief	stable LSD radix sort of a permutation on some key columns
+ *
+ * @par	Each column is sorted a byte at a time, least significant column
+ *	first.  Bytes which are the same for every object are skipped, so
+ *	small integer keys (e.g., rank) only take a couple of passes.
+ *
+ * @param[in,out]	perm - the permutation to sort
+ * @param[in]	keys - the sort keys
+ * @param[in]	num_keys - number of keys per object
+ * @param[in]	cols - the columns to sort on, most significant first
+ *
+ * @return	void
+ */
+static void
+radix_sort_keys(std::vector<int> &perm, const std::vector<double> &keys, int num_keys, const std::vector<int> &cols)
+{
+	size_t num = perm.size();
+	std::vector<int> tmp(num);
+	std::vector<uint64_t> bits(num);
+	std::vector<uint64_t> sorted_bits(num);
+
+	for (auto c = cols.rbegin(); c != cols.rend(); ++c) {
+		size_t hist[8][256] = {{0}};
+
+		for (size_t i = 0; i < num; i++) {
+			bits[i] = sort_key_bits(keys[static_cast<size_t>(perm[i]) * num_keys + *c]);
+			for (int b = 0; b < 8; b++)
+				hist[b][(bits[i] >> (b * 8)) & 0xff]++;
+		}
+
+		for (int b = 0; b < 8; b++) {
+			size_t offset = 0;
+			int byte = (bits[0] >> (b * 8)) & 0xff;
+
+			if (hist[b][byte] == num)
+				continue;
+
+			for (int v = 0; v < 256; v++) {
+				size_t cnt = hist[b][v];
+				hist[b][v] = offset;
+				offset += cnt;
+			}
+			for (size_t i = 0; i < num; i++) {
+				size_t pos = hist[b][(bits[i] >> (b * 8)) & 0xff]++;
+				tmp[pos] = perm[i];
+				sorted_bits[pos] = bits[i];
+			}
+			perm.swap(tmp);
+			bits.swap(sorted_bits);
+		}
+	}
+}
+
+/**
+ * @brief	sort an array of objects on their sort keys
+ *
+ * @par	If at most one column other than the tiebreak ones differs between
+ *	the objects, a radix sort is used.  Otherwise the rows are compared.
+ *
+ * @param[in,out]	arr - the array to sort
+ * @param[in]	num - number of objects in arr
+ * @param[in]	num_keys - number of keys per object
+ * @param[in]	num_tiebreak - number of tiebreak columns at the end of the keys
+ * @param[in]	keys - the sort keys, num_keys per object
+ *
+ * @return	void
+ */
+template <typename T>
+static void
+sort_by_keys(T **arr, int num, int num_keys, int num_tiebreak, const std::vector<double> &keys)
+{
+	std::vector<int> cols;
+	std::vector<int> perm(num);
+	std::vector<T *> sorted(arr, arr + num);
+	int num_primary = 0;
+
+	/* columns which are the same for every object do not matter */
+	for (int c = 0; c < num_keys; c++) {
+		for (int i = 1; i < num; i++) {
+			if (keys[static_cast<size_t>(i) * num_keys + c] != keys[c]) {
+				cols.push_back(c);
+				if (c < num_keys - num_tiebreak)
+					num_primary++;
+				break;
+			}
+		}
+	}
+
+	for (int i = 0; i < num; i++)
+		perm[i] = i;
+
+	if (num >= RADIX_SORT_MIN && num_primary <= 1)
+		radix_sort_keys(perm, keys, num_keys, cols);
+	else {
+		std::sort(perm.begin(), perm.end(), [&](int i1, int i2) {
+			const double *k1 = &keys[static_cast<size_t>(i1) * num_keys];
+			const double *k2 = &keys[static_cast<size_t>(i2) * num_keys];
+			for (auto c : cols) {
+				if (k1[c] < k2[c])
+					return true;
+				if (k1[c] > k2[c])
+					return false;
+			}
+			return false;
+		});
+	}
+
+	for (int i = 0; i < num; i++)
+		arr[i] = sorted[perm[i]];
+}
+
+/**
+ * @brief	rank the fairshare groups of jobs by how deserving they are to
+ *		run according to compare_path().  Groups which compare equal
+ *		have the same rank.
+ *
+ * @param[in]	jobs - the jobs
+ * @param[in]	num_jobs - number of jobs
+ *
+ * @return	std::unordered_map<group_info *, int>
+ */
+static std::unordered_map<group_info *, int>
+rank_fairshare_groups(resource_resv **jobs, int num_jobs)
+{
+	std::unordered_map<group_info *, int> ranks;
+	std::vector<group_info *> groups;
+	int rank = 0;
+
+	for (int i = 0; i < num_jobs; i++) {
+		group_info *ginfo = jobs[i]->job->ginfo;
+		if (ginfo != NULL && ranks.insert(std::make_pair(ginfo, 0)).second)
+			groups.push_back(ginfo);
+	}
+
+	std::stable_sort(groups.begin(), groups.end(), [](group_info *g1, group_info *g2) {
+		return compare_path(g1->gpath, g2->gpath) < 0;
+	});
+
+	for (size_t i = 0; i < groups.size(); i++) {
+		if (i > 0 && compare_path(groups[i - 1]->gpath, groups[i]->gpath) != 0)
+			rank++;
+		ranks[groups[i]] = rank;
+	}
+
+	return ranks;
+}
+
+/**
+ * @brief
+ * 		sort an array of jobs into the same order as qsort() with cmp_sort()
+ *		using precomputed sort keys
+ *
+ * @param[in,out]	jobs - the jobs to sort
+ * @param[in]	num_jobs - number of jobs in the array
+ *
+ * @return	void
+ */
+void
+sort_job_array(resource_resv **jobs, int num_jobs)
+{
+	std::unordered_map<group_info *, int> fs_ranks;
+	std::vector<double> keys;
+	int num_keys;
+	bool fair_share = false;
+
+	if (jobs == NULL || num_jobs < 2)
+		return;
+
+	for (int i = 0; i < num_jobs; i++) {
+		if (jobs[i]->job == NULL) {
+			qsort(jobs, num_jobs, sizeof(resource_resv *), cmp_sort);
+			return;
+		}
+	}
+
+#ifndef NAS /* localmod 041 */
+	if (jobs[0]->server->policy->fair_share) {
+		fair_share = true;
+		fs_ranks = rank_fairshare_groups(jobs, num_jobs);
+	}
+#endif /* localmod 041 */
+
+	/* runnable, preempt, preempted, time preempted, formula, fairshare,
+	 * job_sort_key..., qrank, rank
+	 */
+	num_keys = 6 + cstat.sort_by->size() + 2;
+	if (!fill_sort_keys(num_jobs, num_keys, [&](int idx, double *key) {
+		    resource_resv *resresv = jobs[idx];
+		    job_info *job = resresv->job;
+		    int k = 0;
+
+		    key[k++] = in_runnable_state(resresv) ? 0 : 1;
+		    key[k++] = -static_cast<double>(job->preempt);
+		    key[k++] = job->time_preempted == UNSPECIFIED ? 1 : 0;
+		    key[k++] = job->time_preempted == UNSPECIFIED ? 0 : job->time_preempted;
+		    key[k++] = -job->formula_value;
+		    if (fair_share && job->ginfo != NULL)
+			    key[k++] = fs_ranks.find(job->ginfo)->second;
+		    else
+			    key[k++] = 0;
+		    for (const auto &si : *cstat.sort_by) {
+			    sch_resource_t v = find_resresv_amount(resresv, si.res_name, si.def);
+			    key[k++] = si.order == ASC ? v : -v;
+		    }
+		    key[k++] = resresv->qrank;
+		    key[k++] = resresv->rank;
+	    }, keys)) {
+		qsort(jobs, num_jobs, sizeof(resource_resv *), cmp_sort);
+		return;
+	}
+
+	sort_by_keys(jobs, num_jobs, num_keys, 2, keys);
+}
+
+/**
+ * @brief
+ * 		sort an array of nodes into the same order as qsort() with
+ *		multi_node_sort() using precomputed sort keys
+ *
+ * @param[in,out]	nodes - the nodes to sort
+ * @param[in]	num_nodes - number of nodes in the array
+ *
+ * @return	void
+ */
+void
+sort_node_array(node_info **nodes, int num_nodes)
+{
+	std::vector<double> keys;
+	int num_keys;
+
+	if (nodes == NULL || num_nodes < 2)
+		return;
+
+	num_keys = cstat.node_sort->size() + 1;
+	if (!fill_sort_keys(num_nodes, num_keys, [&](int idx, double *key) {
+		    int k = 0;
+
+		    for (const auto &si : *cstat.node_sort) {
+			    sch_resource_t v = find_node_amount(nodes[idx], si.res_name, si.def, si.res_type);
+			    key[k++] = si.order == ASC ? v : -v;
+		    }
+		    key[k++] = nodes[idx]->rank;
+	    }, keys)) {
+		qsort(nodes, num_nodes, sizeof(node_info *), multi_node_sort);
+		return;
+	}
+
+	sort_by_keys(nodes, num_nodes, num_keys, 1, keys);
+}
+
+/**
+ * @brief
+ * 		sort an array of node partitions into the same order as qsort()
+ *		with multi_nodepart_sort() using precomputed sort keys
+ *
+ * @param[in,out]	nodeparts - the node partitions to sort
+ * @param[in]	num_parts - number of node partitions in the array
+ *
+ * @return	void
+ */
+void
+sort_nodepart_array(node_partition **nodeparts, int num_parts)
+{
+	std::vector<double> keys;
+	int num_keys;
+
+	if (nodeparts == NULL || num_parts < 2)
+		return;
+
+	num_keys = cstat.node_sort->size() + 1;
+	if (!fill_sort_keys(num_parts, num_keys, [&](int idx, double *key) {
+		    int k = 0;
+
+		    for (const auto &si : *cstat.node_sort) {
+			    sch_resource_t v = find_nodepart_amount(nodeparts[idx], si.res_name, si.def, si.res_type);
+			    key[k++] = si.order == ASC ? v : -v;
+		    }
+		    key[k++] = nodeparts[idx]->rank;
+	    }, keys)) {
+		qsort(nodeparts, num_parts, sizeof(node_partition *), multi_nodepart_sort);
+		return;
+	}
+
+	sort_by_keys(nodeparts, num_parts, num_keys, 1, keys);
+}
+
 /**
  * @brief
  * 		sort_jobs - This function sorts all jobs according to their preemption
@@ -1132,6 +1514,7 @@ cmp_resv_state(const void *r1, const void *r2)
 void
 sort_jobs(status *policy, server_info *sinfo)
 {
+	phase_timer timer(PHASE_SORT_JOBS);
 	/** sort jobs in such a way that Higher Priority jobs come on top
 	 * followed by preempted jobs and then normal jobs
 	 */
@@ -1146,8 +1529,7 @@ sort_jobs(status *policy, server_info *sinfo)
 			 */
 			for (auto qinfo : sinfo->queues) {
 				if (qinfo->sc.total > 0) {
-					qsort(qinfo->jobs, qinfo->sc.total,
-					      sizeof(resource_resv *), cmp_sort);
+					sort_job_array(qinfo->jobs, qinfo->sc.total);
 				}
 			}
 			for (auto qinfo : sinfo->queues) {
@@ -1160,24 +1542,23 @@ sort_jobs(status *policy, server_info *sinfo)
 		}
 		/** Sort on entire complex **/
 		else if (!policy->by_queue && !policy->round_robin) {
-			qsort(sinfo->jobs, count_array(sinfo->jobs), sizeof(resource_resv *), cmp_sort);
+			sort_job_array(sinfo->jobs, count_array(sinfo->jobs));
 		}
 	} else if (policy->by_queue) {
 		for (auto qinfo : sinfo->queues) {
-			qsort(qinfo->jobs, count_array(qinfo->jobs), sizeof(resource_resv *), cmp_sort);
+			sort_job_array(qinfo->jobs, count_array(qinfo->jobs));
 		}
-		qsort(sinfo->jobs, count_array(sinfo->jobs), sizeof(resource_resv *), cmp_sort);
+		sort_job_array(sinfo->jobs, count_array(sinfo->jobs));
 	} else if (policy->round_robin) {
 		if (sinfo->queue_list != NULL) {
 			int queue_list_size = count_array(sinfo->queue_list);
 			for (int i = 0; i < queue_list_size; i++) {
 				int queue_index_size = count_array(sinfo->queue_list[i]);
 				for (int j = 0; j < queue_index_size; j++) {
-					qsort(sinfo->queue_list[i][j]->jobs, count_array(sinfo->queue_list[i][j]->jobs),
-					      sizeof(resource_resv *), cmp_sort);
+					sort_job_array(sinfo->queue_list[i][j]->jobs, count_array(sinfo->queue_list[i][j]->jobs));
 				}
 			}
 		}
 	} else
-		qsort(sinfo->jobs, count_array(sinfo->jobs), sizeof(resource_resv *), cmp_sort);
+		sort_job_array(sinfo->jobs, count_array(sinfo->jobs));
 }
@@ -183,6 +183,18 @@ int cmp_preemption(resource_resv *r1, resource_resv *r2);
  */
 int cmp_resv_state(const void *r1, const void *r2);
 
+/* fill the sort keys of a chunk of objects (multi-threaded) */
+void fill_sort_keys_chunk(th_data_sort_keys *data);
+
+/* sort jobs like cmp_sort() does using precomputed sort keys */
+void sort_job_array(resource_resv **jobs, int num_jobs);
+
+/* sort nodes like multi_node_sort() does using precomputed sort keys */
+void sort_node_array(node_info **nodes, int num_nodes);
+
+/* sort node partitions like multi_nodepart_sort() does using precomputed sort keys */
+void sort_nodepart_array(node_partition **nodeparts, int num_parts);
+
 /*
  * sort_jobs - This function sorts all jobs according to their preemption
  *             priority, preempted time and fairshare.
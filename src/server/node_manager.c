@@ -4314,6 +4314,7 @@ is_request(int stream, int version)
 	job *pjob;
 	unsigned long ipaddr;
 	unsigned long port;
+	unsigned int caps;
 	struct sockaddr_in *addr;
 	struct pbsnode *np = NULL;
 	attribute *pala;
@@ -4367,6 +4368,13 @@ is_request(int stream, int version)
 			goto badcon;
 		}
 
+		/* an older Mom sends no capabilities */
+		caps = disrui(stream, &ret);
+		if (ret != DIS_SUCCESS) {
+			caps = 0;
+			ret = DIS_SUCCESS;
+		}
+
 		DBPRT(("%s: IS_HELLOSVR addr: %s, port %lu\n", __func__, netaddr(addr), port))
 
 		if ((pmom = tfind2(ipaddr, port, &ipaddrs)) == NULL) {
@@ -4416,6 +4424,8 @@ is_request(int stream, int version)
 
 		/* we save this stream for future communications */
 		pdmninfo->dmn_stream = stream;
+		if ((caps & IS_CAP_DIS_COMPACT) && pbs_conf.pbs_dis_compact)
+			dis_set_compact(stream, 1);
 		pdmninfo->dmn_state |= INUSE_INIT;
 		pdmninfo->dmn_state &= ~INUSE_NEEDS_HELLOSVR;
 		tinsert2((u_long) stream, 0ul, pmom, &streams);
@@ -522,6 +522,9 @@ main(int argc, char **argv)
 	if (already_forked == 0)
 		lock_out(lockfds, F_WRLCK);
 
+	/* the log writer thread must be started in the backgrounded process */
+	log_set_async(pbs_conf.pbs_log_async);
+
 	/* go_to_backgroud call creates a forked process,
 	 * thus print/log pid only after go_to_background()
 	 * has been called
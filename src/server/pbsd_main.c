@@ -86,6 +86,7 @@
 #include "credential.h"
 #include "batch_request.h"
 #include "pbs_idx.h"
+#include "avltree.h"
 #include "pbs_nodes.h"
 #include "svrfunc.h"
 #include <libutil.h>
@@ -666,6 +667,10 @@ main(int argc, char **argv)
 	if (pbs_loadconf(0) == 0)
 		return (1);
 
+	/* the main and tpp threads, and the status workers, use the indexes */
+	if (pbs_conf.pbs_server_stat_threads > 0)
+		avl_set_maxthreads(2 + pbs_conf.pbs_server_stat_threads);
+
 	set_log_conf(pbs_conf.pbs_leaf_name, pbs_conf.pbs_mom_node_name,
 		     pbs_conf.locallog, pbs_conf.syslogfac,
 		     pbs_conf.syslogsvr, pbs_conf.pbs_log_highres_timestamp);
@@ -856,7 +861,6 @@ main(int argc, char **argv)
 	CLEAR_HEAD(svr_requests);
 	CLEAR_HEAD(task_list_immed);
 	CLEAR_HEAD(task_list_interleave);
-	CLEAR_HEAD(task_list_timed);
 	CLEAR_HEAD(task_list_event);
 	CLEAR_HEAD(svr_queues);
 	CLEAR_HEAD(svr_alljobs);
@@ -1103,6 +1107,9 @@ main(int argc, char **argv)
 	/* Protect from being killed by kernel */
 	daemon_protect(0, PBS_DAEMON_PROTECT_ON);
 
+	/* the log writer thread must be started in the backgrounded process */
+	log_set_async(pbs_conf.pbs_log_async);
+
 #ifdef _POSIX_MEMLOCK
 	if (do_mlockall == 1) {
 		if (mlockall(MCL_CURRENT | MCL_FUTURE) == -1) {
@@ -1201,6 +1208,10 @@ main(int argc, char **argv)
 		return (3);
 	}
 
+	/* serve status requests in worker threads if configured */
+	if (stat_pool_init(pbs_conf.pbs_server_stat_threads) != 0)
+		log_err(-1, msg_daemonname, "status worker threads not started, status requests served serially");
+
 	/* record the fact that the Secondary is up and active (running) */
 
 	if (pbs_failover_active) {
@@ -1577,7 +1588,7 @@ get_port(char *arg, unsigned int *port, pbs_net_t *addr)
  *		1. If svr_delay_entry is set, then a delayed task is ready so
  *	   		find and process it.
  *		2. All items on the immediate list, then
- *		3. All items on the timed task list which have expired times
+ *		3. All items on the timed task heap which have expired times
  *
  * @return	amount of time till next task
  */
@@ -783,7 +783,7 @@ process_request(int sfds)
  * @retval 	0	- success
  */
 
-static int
+int
 set_to_non_blocking(conn_t *conn)
 {
 
@@ -812,7 +812,7 @@ set_to_non_blocking(conn_t *conn)
  @param[in] conn - the connection structure.
  */
 
-static void
+void
 clear_non_blocking(conn_t *conn)
 {
 	if (!conn)
@@ -859,6 +859,12 @@ dispatch_request(int sfds, struct batch_request *request)
 		}
 	}
 
+#ifndef PBS_MOM
+	/* status requests may go to the status worker threads, see stat_pool.c */
+	if (stat_pool_submit(conn, request) == 0)
+		return;
+#endif
+
 	switch (request->rq_type) {
 
 		case PBS_BATCH_QueueJob:
@@ -197,6 +197,12 @@ dis_reply_write(int sfds, struct batch_request *preq)
 	time_t old_tcp_timeout = pbs_tcp_timeout;
 #endif
 
+#ifndef PBS_MOM
+	/* a status worker thread only encodes, it sends after dropping the lock */
+	if (preq->prot == PROT_TCP && stat_pool_worker())
+		return (stat_pool_reply(sfds, preq));
+#endif
+
 	if (preq->prot == PROT_TPP) {
 		rc = encode_DIS_replyTPP(sfds, preq->tppcmd_msgid, preply);
 	} else {
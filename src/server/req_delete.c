@@ -1339,7 +1339,7 @@ req_deleteReservation(struct batch_request *preq)
 	/*Know resc_resv struct exists and requester allowed to remove it*/
 	futuredr = presv->ri_futuredr;
 	presv->ri_futuredr = 0; /*would be non-zero if getting*/
-	/*here from task_list_timed*/
+	/*here from a timed work task*/
 	strcpy(user, preq->rq_user); /*need after request is gone*/
 	strcpy(host, preq->rq_host);
 	perm = preq->rq_perm;
@@ -81,5 +81,9 @@ req_connect(struct batch_request *preq)
 			conn->cn_authen |= PBS_NET_CONN_FROM_QSUB_DAEMON;
 	}
 
-	reply_ack(preq);
+	/* an ack, which also offers the compact encoding to the client */
+	preq->rq_reply.brp_code = PBSE_NONE;
+	preq->rq_reply.brp_auxcode = pbs_conf.pbs_dis_compact ? DIS_COMPACT_OFFER : 0;
+	preq->rq_reply.brp_choice = BATCH_REPLY_CHOICE_NULL;
+	(void) reply_send(preq);
 }
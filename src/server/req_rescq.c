@@ -688,7 +688,7 @@ req_confirmresv(struct batch_request *preq)
 		/* When confirming for the first time, set the index and count */
 		if (!is_degraded) {
 
-			/* Add first occurrence's end date on timed task list */
+			/* Add first occurrence's end date on the timed task heap */
 			if (get_rattr_long(presv, RESV_ATR_start) != PBS_RESV_FUTURE_SCH) {
 				if (gen_task_EndResvWindow(presv)) {
 					free(next_execvnode);
@@ -795,7 +795,7 @@ req_confirmresv(struct batch_request *preq)
 		return;
 	}
 
-	/* place "Time4resv" task on "task_list_timed" only if this is a
+	/* place "Time4resv" task on the timed task heap only if this is a
 	 * confirmation but not the reconfirmation of a degraded reservation as
 	 * in this case, the reservation had already been confirmed and added to
 	 * the task list before
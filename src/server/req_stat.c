@@ -47,6 +47,8 @@
  * Functions included are:
  * 	do_stat_of_a_job()
  * 	stat_a_jobidname()
+ * 	stat_job_yield()
+ * 	stat_node_yield()
  * 	req_stat_job()
  * 	req_stat_que()
  * 	status_que()
@@ -267,6 +269,58 @@ stat_a_jobidname(struct batch_request *preq, char *name, int dohistjobs, int dos
 	}
 }
 
+/**
+ * @brief
+ * 	Support function for req_stat_job() when it runs in a status worker
+ * 	thread, see stat_pool.c.
+ *
+ * 	Lets the main thread run between two batches of a walk over the jobs,
+ * 	then finds where the walk goes on: with the same job if it is still
+ * 	there, else with the first job after its (queue rank, job id) as the
+ * 	job lists are kept in that order, see cmp_job_qrank().
+ *
+ * @param[in] pjob - next job of the walk
+ * @param[in] qname - queue being walked, NULL for all jobs in the Server
+ * @param[out] rc - PBSE_NONE, or error if the batch could not be sent
+ *
+ * @return job *
+ * @retval next job of the walk
+ * @retval NULL - the walk is over
+ *
+ */
+static job *
+stat_job_yield(job *pjob, char *qname, int *rc)
+{
+	char jobid[PBS_MAXSVRJOBID + 1];
+	long long qrank;
+	pbs_queue *pque = NULL;
+
+	snprintf(jobid, sizeof(jobid), "%s", pjob->ji_qs.ji_jobid);
+	qrank = get_jattr_ll(pjob, JOB_ATR_qrank);
+
+	if ((*rc = stat_pool_yield()) != PBSE_NONE)
+		return NULL;
+
+	if (qname != NULL) {
+		pque = find_queuebyname(qname);
+#ifdef NAS /* localmod 075 */
+		if (pque == NULL)
+			pque = find_resvqueuebyname(qname);
+#endif /* localmod 075 */
+		if (pque == NULL)
+			return NULL;
+	}
+
+	pjob = find_job(jobid);
+	if (pjob != NULL && (pque == NULL || pjob->ji_qhdr == pque))
+		return pjob;
+
+	pjob = (job *) GET_NEXT(pque ? pque->qu_jobs : svr_alljobs);
+	while (pjob && cmp_job_qrank(pjob, qrank, jobid) < 0)
+		pjob = (job *) GET_NEXT(pque ? pjob->ji_jobque : pjob->ji_alljobs);
+	return pjob;
+}
+
 /**
  * @brief
  * 	Service the Status Job Request
@@ -369,9 +423,19 @@ req_stat_job(struct batch_request *preq)
 		 * one job is returned, then no error is given.
 		 * If a single job id is requested and there is an error
 		 * the error is returned.
+		 * A long list is sent in batches as for all jobs below, each
+		 * id is looked up again so the worker may yield in between.
 		 */
 		pnxtjid = name;
 		while ((name = parse_comma_string_r(&pnxtjid)) != NULL) {
+			if (at_least_one_success && preply->brp_count >= MAX_JOBS_PER_REPLY) {
+				if (reply_send_status_part(preq) != PBSE_NONE)
+					return;
+				if (stat_pool_yield() != PBSE_NONE) {
+					free_br(preq);
+					return;
+				}
+			}
 			if ((rc = stat_a_jobidname(preq, name, dohistjobs, dosubjobs)) == PBSE_NONE)
 				at_least_one_success = 1;
 		}
@@ -394,6 +458,13 @@ req_stat_job(struct batch_request *preq)
 				rc = reply_send_status_part(preq);
 				if (rc != PBSE_NONE)
 					return;
+				if (stat_pool_worker()) {
+					pjob = stat_job_yield(pjob, type == 2 ? name : NULL, &rc);
+					if (rc != PBSE_NONE) {
+						free_br(preq);
+						return;
+					}
+				}
 			}
 		}
 	}
@@ -536,6 +607,44 @@ status_que(pbs_queue *pque, struct batch_request *preq, pbs_list_head *pstathd)
 	return rc;
 }
 
+/**
+ * @brief
+ * 	Support function for req_stat_node() when it runs in a status worker
+ * 	thread, see stat_pool.c.
+ *
+ * 	Lets the main thread run between two batches of a walk over the nodes,
+ * 	then finds where the walk goes on: with the same node if it is still
+ * 	there, else after the last node sent if it is still there, else at
+ * 	the same place in the node array.  Nodes are only ever added at the
+ * 	end of the array.
+ *
+ * @param[in] i - index of the next node of the walk in pbsndlist
+ * @param[out] rc - PBSE_NONE, or error if the batch could not be sent
+ *
+ * @return int
+ * @retval index of the next node of the walk
+ *
+ */
+static int
+stat_node_yield(int i, int *rc)
+{
+	char next[PBS_MAXHOSTNAME + 1];
+	char last[PBS_MAXHOSTNAME + 1];
+	struct pbsnode *pnode;
+
+	snprintf(next, sizeof(next), "%s", pbsndlist[i]->nd_name);
+	snprintf(last, sizeof(last), "%s", pbsndlist[i - 1]->nd_name);
+
+	if ((*rc = stat_pool_yield()) != PBSE_NONE)
+		return i;
+
+	if ((pnode = find_nodebyname(next)) != NULL)
+		return pnode->nd_arr_index;
+	if ((pnode = find_nodebyname(last)) != NULL)
+		return pnode->nd_arr_index + 1;
+	return (i - 1 < svr_totnodes ? i - 1 : svr_totnodes);
+}
+
 /**
  * @brief
  * 		req_stat_node - service the Status Node Request
@@ -593,13 +702,23 @@ req_stat_node(struct batch_request *preq)
 
 	} else { /* get status of all nodes */
 
-		for (i = 0; i < svr_totnodes; i++) {
+		for (i = 0; i < svr_totnodes;) {
 			pnode = pbsndlist[i];
 
 			rc = status_node(pnode, preq,
 					 &preply->brp_un.brp_status);
 			if (rc)
 				break;
+			i++;
+			if (preply->brp_count >= MAX_JOBS_PER_REPLY && i < svr_totnodes && stat_pool_worker()) {
+				if (reply_send_status_part(preq) != PBSE_NONE)
+					return;
+				i = stat_node_yield(i, &rc);
+				if (rc != PBSE_NONE) {
+					free_br(preq);
+					return;
+				}
+			}
 		}
 	}
 
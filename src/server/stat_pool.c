@@ -0,0 +1,563 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+/**
+ * @file	stat_pool.c
+ *
+ * @brief
+ * 		stat_pool.c - Worker threads which serve the read-only status
+ * 		requests (job, queue, node, reservation and server status) that
+ * 		arrive on client connections.
+ *
+ * @par
+ *		The server's data is not thread safe, so it is guarded by a single
+ *		lock.  The main thread holds the lock all the time except while it
+ *		waits in poll (see net_set_poll_hooks()), and it gets the lock back
+ *		ahead of any waiting worker.  A worker takes the lock to build a
+ *		reply and encodes it into memory, then drops the lock while it
+ *		writes the reply to the client.  A job or node status walk drops
+ *		the lock between batches of MAX_JOBS_PER_REPLY objects, see
+ *		stat_pool_yield().
+ *		So a slow client, or a large status, no longer holds up the
+ *		requests that change the server's data.
+ *
+ * @par
+ *		While a worker owns a connection, the connection is paused: the
+ *		main thread neither reads from it nor times it out.  When the
+ *		worker is done, it queues the connection back to the main thread
+ *		through a pipe, and the main thread resumes or closes it.
+ *
+ * Functions included are:
+ *	stat_pool_init()
+ *	stat_pool_submit()
+ *	stat_pool_worker()
+ *	stat_pool_reply()
+ *	stat_pool_yield()
+ *
+ */
+#include <pbs_config.h> /* the master config generated by configure */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <pthread.h>
+#include "libpbs.h"
+#include "dis.h"
+#include "log.h"
+#include "pbs_error.h"
+#include "server_limits.h"
+#include "list_link.h"
+#include "attribute.h"
+#include "server.h"
+#include "credential.h"
+#include "batch_request.h"
+#include "job.h"
+#include "reservation.h"
+#include "queue.h"
+#include "net_connect.h"
+#include "svrfunc.h"
+
+/* a status request handed to the pool */
+struct stat_work {
+	pbs_list_link sw_link;
+	struct batch_request *sw_preq; /* the request, freed by the handler */
+	int sw_sock;		       /* client connection */
+	int sw_failed;		       /* encoding or writing the reply failed */
+	char *sw_out;		       /* encoded reply not yet written */
+	size_t sw_outlen;
+	size_t sw_outsize;
+};
+
+/* lock on the server's data */
+static pthread_mutex_t stat_lock_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stat_lock_cond = PTHREAD_COND_INITIALIZER;
+static int stat_lock_owned;	 /* some thread has the server's data */
+static int stat_lock_main_waits; /* the main thread wants it back */
+
+/* requests waiting for a worker, and connections going back to main */
+static pthread_mutex_t stat_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stat_queue_cond = PTHREAD_COND_INITIALIZER;
+static pbs_list_head stat_todo;
+static pbs_list_head stat_done;
+static int stat_pipe[2] = {-1, -1};
+
+static int stat_nthreads = 0;
+static __thread struct stat_work *stat_current; /* set in a worker thread */
+
+/**
+ * @brief
+ *		stat_lock_main - take the server's data for the main thread.
+ *		Waits for the worker that has it, if any, to finish its batch.
+ */
+static void
+stat_lock_main(void)
+{
+	pthread_mutex_lock(&stat_lock_mutex);
+	stat_lock_main_waits = 1;
+	while (stat_lock_owned)
+		pthread_cond_wait(&stat_lock_cond, &stat_lock_mutex);
+	stat_lock_owned = 1;
+	stat_lock_main_waits = 0;
+	pthread_mutex_unlock(&stat_lock_mutex);
+}
+
+/**
+ * @brief
+ *		stat_lock_worker - take the server's data for a worker thread.
+ *		The main thread goes first.
+ */
+static void
+stat_lock_worker(void)
+{
+	pthread_mutex_lock(&stat_lock_mutex);
+	while (stat_lock_owned || stat_lock_main_waits)
+		pthread_cond_wait(&stat_lock_cond, &stat_lock_mutex);
+	stat_lock_owned = 1;
+	pthread_mutex_unlock(&stat_lock_mutex);
+}
+
+/**
+ * @brief
+ *		stat_unlock - give up the server's data.
+ */
+static void
+stat_unlock(void)
+{
+	pthread_mutex_lock(&stat_lock_mutex);
+	stat_lock_owned = 0;
+	pthread_cond_broadcast(&stat_lock_cond);
+	pthread_mutex_unlock(&stat_lock_mutex);
+}
+
+/**
+ * @brief
+ *		stat_flush - write out the reply a worker has encoded so far.
+ *		Called without the lock, so only the socket and the work item
+ *		may be touched.
+ *
+ * @param[in,out]	psw	-	the work item
+ *
+ * @return	int
+ * @retval	0	: success
+ * @retval	-1	: the client went away or did not read in time
+ */
+static int
+stat_flush(struct stat_work *psw)
+{
+	char *pb = psw->sw_out;
+	size_t ct = psw->sw_outlen;
+	struct pollfd pfd;
+	ssize_t i;
+
+	if (psw->sw_failed)
+		return -1;
+
+	while (ct > 0) {
+		i = write(psw->sw_sock, pb, ct);
+		if (i > 0) {
+			ct -= i;
+			pb += i;
+			continue;
+		}
+		if (i == -1 && errno == EINTR)
+			continue;
+		if (i == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			/* socket is non-blocking, wait till it can take more */
+			pfd.fd = psw->sw_sock;
+			pfd.events = POLLOUT;
+			pfd.revents = 0;
+			i = poll(&pfd, 1, PBS_DIS_TCP_TIMEOUT_REPLY * 1000);
+			if (i > 0 || (i == -1 && errno == EINTR))
+				continue;
+			if (i == 0)
+				errno = EAGAIN;
+		}
+		log_eventf(PBSEVENT_SYSTEM, PBS_EVENTCLASS_REQUEST, LOG_WARNING, __func__,
+			   "status reply failure on socket %d, errno=%d%s", psw->sw_sock, errno,
+			   (errno == EAGAIN) ? " write timed out" : "");
+		psw->sw_failed = 1;
+		return -1;
+	}
+	psw->sw_outlen = 0;
+	return 0;
+}
+
+/**
+ * @brief
+ *		stat_dispatch - run the handler of a status request.
+ *
+ * @param[in]	preq	-	the request, freed by the handler
+ */
+static void
+stat_dispatch(struct batch_request *preq)
+{
+	switch (preq->rq_type) {
+		case PBS_BATCH_StatusJob:
+			req_stat_job(preq);
+			break;
+		case PBS_BATCH_StatusQue:
+			req_stat_que(preq);
+			break;
+		case PBS_BATCH_StatusNode:
+			req_stat_node(preq);
+			break;
+		case PBS_BATCH_StatusResv:
+			req_stat_resv(preq);
+			break;
+		case PBS_BATCH_StatusSvr:
+			req_stat_svr(preq);
+			break;
+		default:
+			req_reject(PBSE_UNKREQ, 0, preq);
+			break;
+	}
+}
+
+/**
+ * @brief
+ *		stat_worker - body of a worker thread.
+ *
+ * @param[in]	arg	-	unused
+ */
+static void *
+stat_worker(void *arg)
+{
+	struct stat_work *psw;
+
+	for (;;) {
+		pthread_mutex_lock(&stat_queue_mutex);
+		while ((psw = (struct stat_work *) GET_NEXT(stat_todo)) == NULL)
+			pthread_cond_wait(&stat_queue_cond, &stat_queue_mutex);
+		delete_link(&psw->sw_link);
+		pthread_mutex_unlock(&stat_queue_mutex);
+
+		stat_current = psw;
+		stat_lock_worker();
+		stat_dispatch(psw->sw_preq);
+		stat_unlock();
+		(void) stat_flush(psw);
+		stat_current = NULL;
+
+		pthread_mutex_lock(&stat_queue_mutex);
+		append_link(&stat_done, &psw->sw_link, psw);
+		pthread_mutex_unlock(&stat_queue_mutex);
+		if (write(stat_pipe[1], "", 1) == -1) {
+			/* pipe is full, so the main thread will reap this one too */
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief
+ *		stat_pool_reap - main thread side of a finished status request,
+ *		called when the pool's pipe is readable.  Resumes polling the
+ *		connection, or closes it if the reply could not be sent.
+ *
+ * @param[in]	fd	-	read end of the pool's pipe
+ */
+static void
+stat_pool_reap(int fd)
+{
+	char buf[64];
+	struct stat_work *psw;
+
+	while (read(fd, buf, sizeof(buf)) > 0)
+		;
+
+	for (;;) {
+		pthread_mutex_lock(&stat_queue_mutex);
+		psw = (struct stat_work *) GET_NEXT(stat_done);
+		if (psw != NULL)
+			delete_link(&psw->sw_link);
+		pthread_mutex_unlock(&stat_queue_mutex);
+		if (psw == NULL)
+			break;
+
+		(void) net_resume_conn(psw->sw_sock);
+		if (psw->sw_failed)
+			close_client(psw->sw_sock);
+		else
+			clear_non_blocking(get_conn(psw->sw_sock));
+		free(psw->sw_out);
+		free(psw);
+	}
+}
+
+/**
+ * @brief
+ *		stat_pool_init - start the status worker threads.
+ *
+ * @par
+ *		Must be called by the main thread once the server is initialized.
+ *		From here on the main thread owns the server's data except while
+ *		it waits in poll.
+ *
+ * @param[in]	nthreads	-	number of worker threads
+ *
+ * @return	int
+ * @retval	0	: success, or nthreads is 0
+ * @retval	-1	: failure, status requests are served by the main thread
+ */
+int
+stat_pool_init(int nthreads)
+{
+	pthread_attr_t attr;
+	pthread_t tid;
+	sigset_t allsigs;
+	sigset_t oldsigs;
+	int i;
+
+	if (nthreads <= 0 || stat_nthreads > 0)
+		return 0;
+
+	CLEAR_HEAD(stat_todo);
+	CLEAR_HEAD(stat_done);
+
+	if (pipe(stat_pipe) == -1) {
+		log_err(errno, __func__, "pipe");
+		return -1;
+	}
+	if ((fcntl(stat_pipe[0], F_SETFL, O_NONBLOCK) == -1) ||
+	    (fcntl(stat_pipe[1], F_SETFL, O_NONBLOCK) == -1) ||
+	    (fcntl(stat_pipe[0], F_SETFD, FD_CLOEXEC) == -1) ||
+	    (fcntl(stat_pipe[1], F_SETFD, FD_CLOEXEC) == -1)) {
+		log_err(errno, __func__, "fcntl");
+		goto err;
+	}
+	if (add_conn(stat_pipe[0], ChildPipe, (pbs_net_t) 0, 0, NULL, stat_pool_reap) == NULL) {
+		log_err(-1, __func__, "could not add status pool pipe to connection table");
+		goto err;
+	}
+
+	stat_lock_owned = 1; /* the main thread has the server's data */
+
+	/* workers leave all signals to the main thread */
+	sigfillset(&allsigs);
+	pthread_sigmask(SIG_BLOCK, &allsigs, &oldsigs);
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	for (i = 0; i < nthreads; i++) {
+		if (pthread_create(&tid, &attr, stat_worker, NULL) != 0) {
+			log_err(errno, __func__, "could not create status worker thread");
+			break;
+		}
+	}
+	pthread_attr_destroy(&attr);
+	pthread_sigmask(SIG_SETMASK, &oldsigs, NULL);
+
+	if (i == 0) {
+		close_conn(stat_pipe[0]);
+		close(stat_pipe[1]);
+		stat_pipe[0] = stat_pipe[1] = -1;
+		stat_lock_owned = 0;
+		return -1;
+	}
+	stat_nthreads = i;
+	net_set_poll_hooks(stat_unlock, stat_lock_main);
+
+	log_eventf(PBSEVENT_SYSTEM | PBSEVENT_FORCE, PBS_EVENTCLASS_SERVER, LOG_INFO, __func__,
+		   "%d status worker threads started", stat_nthreads);
+	return 0;
+
+err:
+	close(stat_pipe[0]);
+	close(stat_pipe[1]);
+	stat_pipe[0] = stat_pipe[1] = -1;
+	return -1;
+}
+
+/**
+ * @brief
+ *		stat_pool_submit - hand a status request to the worker pool.
+ *
+ * @par
+ *		Only status requests from clients over TCP are taken.  On success
+ *		the pool owns the request and the connection until the reply is
+ *		sent; the socket is non-blocking meanwhile.
+ *
+ * @param[in]	conn	-	client connection the request came on
+ * @param[in]	preq	-	the request
+ *
+ * @return	int
+ * @retval	0	: handed off
+ * @retval	-1	: not handed off, the caller must process the request
+ */
+int
+stat_pool_submit(conn_t *conn, struct batch_request *preq)
+{
+	struct stat_work *psw;
+
+	if (stat_nthreads == 0 || conn == NULL || preq->prot != PROT_TCP)
+		return -1;
+
+	switch (preq->rq_type) {
+		case PBS_BATCH_StatusJob:
+		case PBS_BATCH_StatusQue:
+		case PBS_BATCH_StatusNode:
+		case PBS_BATCH_StatusResv:
+		case PBS_BATCH_StatusSvr:
+			break;
+		default:
+			return -1;
+	}
+
+	if ((psw = calloc(1, sizeof(struct stat_work))) == NULL)
+		return -1;
+	CLEAR_LINK(psw->sw_link);
+	psw->sw_preq = preq;
+	psw->sw_sock = conn->cn_sock;
+
+	if (set_to_non_blocking(conn) == -1) {
+		free(psw);
+		return -1;
+	}
+	if (net_pause_conn(conn->cn_sock) != 0) {
+		clear_non_blocking(conn);
+		free(psw);
+		return -1;
+	}
+
+	pthread_mutex_lock(&stat_queue_mutex);
+	append_link(&stat_todo, &psw->sw_link, psw);
+	pthread_cond_signal(&stat_queue_cond);
+	pthread_mutex_unlock(&stat_queue_mutex);
+	return 0;
+}
+
+/**
+ * @brief
+ *		stat_pool_worker - is this a status worker thread?
+ *
+ * @return	int
+ * @retval	1	: yes
+ * @retval	0	: no
+ */
+int
+stat_pool_worker(void)
+{
+	return (stat_current != NULL);
+}
+
+/**
+ * @brief
+ *		stat_pool_reply - encode a reply in a worker thread.
+ *
+ * @par
+ *		Called by dis_reply_write() in place of sending the reply.  The
+ *		reply is encoded and kept in memory, the worker writes it to the
+ *		client once it has dropped the lock.
+ *
+ * @param[in]	sfds	-	client connection
+ * @param[in]	preq	-	the request holding the reply
+ *
+ * @return	int
+ * @retval	0	: success
+ * @retval	!0	: failure, the connection will be closed
+ */
+int
+stat_pool_reply(int sfds, struct batch_request *preq)
+{
+	struct stat_work *psw = stat_current;
+	void *pkt;
+	size_t pktlen;
+	int rc;
+
+	if (psw->sw_failed)
+		return PBSE_SYSTEM;
+
+	DIS_tcp_funcs();
+	rc = encode_DIS_reply(sfds, &preq->rq_reply);
+	if (rc == 0 && (rc = dis_take_pkt(sfds, &pkt, &pktlen)) == 0 && pkt != NULL) {
+		if (psw->sw_outlen + pktlen > psw->sw_outsize) {
+			char *tmp = realloc(psw->sw_out, psw->sw_outlen + pktlen);
+			if (tmp == NULL) {
+				free(pkt);
+				rc = PBSE_SYSTEM;
+			} else {
+				psw->sw_out = tmp;
+				psw->sw_outsize = psw->sw_outlen + pktlen;
+			}
+		}
+		if (rc == 0) {
+			memcpy(psw->sw_out + psw->sw_outlen, pkt, pktlen);
+			psw->sw_outlen += pktlen;
+			free(pkt);
+		}
+	}
+	if (rc) {
+		log_eventf(PBSEVENT_SYSTEM, PBS_EVENTCLASS_REQUEST, LOG_WARNING, __func__,
+			   "DIS reply failure, %d, on socket %d", rc, sfds);
+		psw->sw_failed = 1;
+	}
+	return rc;
+}
+
+/**
+ * @brief
+ *		stat_pool_yield - in a worker thread, drop the lock, write out the
+ *		reply encoded so far and take the lock again.  Does nothing on the
+ *		main thread.
+ *
+ * @par
+ *		The main thread may have changed anything while the lock was
+ *		dropped; the caller must look up again any object it holds.
+ *
+ * @return	int
+ * @retval	PBSE_NONE	: success
+ * @retval	PBSE_SYSTEM	: the reply could not be written
+ */
+int
+stat_pool_yield(void)
+{
+	int rc;
+
+	if (stat_current == NULL)
+		return PBSE_NONE;
+
+	stat_unlock();
+	rc = stat_flush(stat_current);
+	stat_lock_worker();
+	return (rc == 0 ? PBSE_NONE : PBSE_SYSTEM);
+}
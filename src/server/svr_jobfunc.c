@@ -175,7 +175,7 @@ clear_default_resc(job *pjob)
  * 		processing of the reply from the particular server subsystem
  * 		to happen as "soon" as the server get back to its main loop -
  * 		see server's main loop and "next_task()" and variable, "waittime".
- * 		By placing a do nothing task on the "timed_task_list" whose time
+ * 		By placing a do nothing task on the timed task heap whose time
  * 		is now (or already passed), we can get next_task() to look at the
  * 		"task_list_immed" tasks now rather than wait for a while
  */
@@ -185,6 +185,38 @@ tickle_for_reply(void)
 	(void) set_task(WORK_Timed, time_now + 10, 0, NULL);
 }
 
+/**
+ * @brief
+ * 		cmp_job_qrank	-	Compare the place of a job in the job lists
+ *		with a (queue rank, job id) key.  The lists are kept in queue rank
+ *		order, and jobs of the same queue rank in job id order.
+ *
+ * @param[in]	pjob	-	the job
+ * @param[in]	qrank	-	queue rank of the key
+ * @param[in]	jobid	-	job id of the key
+ *
+ * @return	int
+ * @retval	<0	: the job goes before the key
+ * @retval	0	: the job is the key
+ * @retval	>0	: the job goes after the key
+ */
+int
+cmp_job_qrank(job *pjob, long long qrank, char *jobid)
+{
+	long long r = get_jattr_ll(pjob, JOB_ATR_qrank);
+	unsigned long long seq1;
+	unsigned long long seq2;
+
+	if (r != qrank)
+		return (r < qrank ? -1 : 1);
+
+	seq1 = strtoull(pjob->ji_qs.ji_jobid, NULL, 10);
+	seq2 = strtoull(jobid, NULL, 10);
+	if (seq1 != seq2)
+		return (seq1 < seq2 ? -1 : 1);
+	return (strcmp(pjob->ji_qs.ji_jobid, jobid));
+}
+
 /**
  * @brief
  * 		svr_enquejob	-	Enqueue the job into specified queue.
@@ -261,7 +293,7 @@ svr_enquejob(job *pjob, char *selectspec)
 
 	pjcur = (job *) GET_PRIOR(svr_alljobs);
 	while (pjcur) {
-		if (get_jattr_ll(pjob, JOB_ATR_qrank) >= get_jattr_ll(pjcur, JOB_ATR_qrank))
+		if (cmp_job_qrank(pjcur, get_jattr_ll(pjob, JOB_ATR_qrank), pjob->ji_qs.ji_jobid) <= 0)
 			break;
 		pjcur = (job *) GET_PRIOR(pjcur->ji_alljobs);
 	}
@@ -285,7 +317,7 @@ svr_enquejob(job *pjob, char *selectspec)
 
 	pjcur = (job *) GET_PRIOR(pque->qu_jobs);
 	while (pjcur) {
-		if (get_jattr_ll(pjob, JOB_ATR_qrank) >= get_jattr_ll(pjcur, JOB_ATR_qrank))
+		if (cmp_job_qrank(pjcur, get_jattr_ll(pjob, JOB_ATR_qrank), pjob->ji_qs.ji_jobid) <= 0)
 			break;
 		pjcur = (job *) GET_PRIOR(pjcur->ji_jobque);
 	}
@@ -1551,15 +1583,16 @@ job_set_wait(attribute *pattr, void *pjob, int mode)
 	when = pattr->at_val.at_long;
 	ptask = (struct work_task *) GET_NEXT(((job *) pjob)->ji_svrtask);
 
-	/* Is there already an entry for this job?  Then reuse it */
+	/* Is there already an entry for this job?  Then replace it */
 
 	if (((job *) pjob)->ji_qs.ji_svrflags & JOB_SVFLG_HASWAIT) {
 		while (ptask) {
-			if ((ptask->wt_event == WORK_Timed) &&
+			if ((ptask->wt_type == WORK_Timed) &&
 			    (ptask->wt_func == job_wait_over) &&
 			    (ptask->wt_parm1 == pjob)) {
-				ptask->wt_event = when;
-				return (0);
+				/* the time of a timed task cannot be changed in place */
+				delete_task(ptask);
+				break;
 			}
 			ptask = (struct work_task *) GET_NEXT(ptask->wt_linkobj);
 		}
@@ -3025,7 +3058,7 @@ Time4occurrenceFinish(resc_resv *presv)
 		return;
 	}
 
-	/* place "Time4resv" task on "task_list_timed" */
+	/* place "Time4resv" task on the timed task heap */
 	if ((rc = gen_task_Time4resv(presv)) != 0) {
 		sprintf(log_buffer, "problem generating task Time for occurrence (%d)", rc);
 		log_event(PBSEVENT_ERROR, PBS_EVENTCLASS_RESV, LOG_NOTICE, presv->ri_qs.ri_resvID, log_buffer);
@@ -3535,7 +3568,7 @@ chk_resvReq_viable(resc_resv *presv)
  * @param[in]	presv	-	pointer to reservation.
  *
  * @return	int
- * @retval	0	: work_task created and put on timed task list
+ * @retval	0	: work_task created and put on timed task heap
  * @retval	error code	: if problem was detected
  */
 int
@@ -3581,7 +3614,7 @@ gen_task_Time4resv(resc_resv *presv)
  * @param[in]	presv	-	pointer to reservation.
  *
  * @return	int
- * @retval	0	: task was created and put on timed task list
+ * @retval	0	: task was created and put on timed task heap
  * @retval	error code	: if a problem was detected
  */
 int
@@ -3611,7 +3644,7 @@ gen_task_EndResvWindow(resc_resv *presv)
  * @param[in]	fromNow	-	It's the number of seconds into the future that this task is to be activated.
  *
  * @return	int
- * @retval	0	: task was created and put on timed task list
+ * @retval	0	: task was created and put on timed task heap
  * @retval	error code	: if a problem was detected
  */
 int
@@ -3650,7 +3683,7 @@ gen_deleteResv(resc_resv *presv, long fromNow)
  * @param[in]	fromNow	-	It's the number of seconds into the future that this task is to be activated.
  *
  * @return	int
- * @retval	0	: task was created and put on timed task list
+ * @retval	0	: task was created and put on timed task heap
  * @retval	error code	: if a problem was detected
  */
 int
@@ -3689,7 +3722,7 @@ gen_negI_deleteResv(resc_resv *presv, long fromNow)
  * @param[in]	fromNow	-	It's the number of seconds into the future that this task is to be activated.
  *
  * @return	int
- * @retval	0	: task was created and put on timed task list
+ * @retval	0	: task was created and put on timed task heap
  * @retval	error code	: if a problem was detected
  */
 int
@@ -3732,7 +3765,7 @@ gen_future_deleteResv(resc_resv *presv, long fromNow)
  * @param[in]	fromNow	-	It's the number of seconds into the future that this task is to be activated.
  *
  * @return	int
- * @retval	0	: task was created and put on timed task list
+ * @retval	0	: task was created and put on timed task heap
  * @retval	error code	: if a problem was detected
  */
 int
@@ -3918,7 +3951,7 @@ remove_deleted_resvs(void)
 		nxresv = (resc_resv *) GET_NEXT(presv->ri_allresvs);
 
 		if (presv->ri_qs.ri_state == RESV_FINISHED) {
-			/*put a task on the server's "task_list_timed" that causes
+			/*put a task on the server's timed task heap that causes
 			 *an internal BATCH_REQUEST_DeleteResv to be generated
 			 *and issued against this reservation
 			 */
@@ -4000,7 +4033,7 @@ degrade_corrupted_confirmed_resvs(void)
 /**
  * @brief
  *  	add_resv_beginEnd_tasks - for each reservation not in state
- *  	RESV_FINISHED add to "task_list_timed" the "begin" and
+ *  	RESV_FINISHED add to the timed task heap the "begin" and
  *  	"end" reservation tasks as appropriate.  Function used
  *  	in "pbsd_init" code
  *
@@ -4019,7 +4052,7 @@ add_resv_beginEnd_tasks(void)
 		if (presv->ri_qs.ri_state == RESV_CONFIRMED ||
 		    presv->ri_qs.ri_state == RESV_RUNNING) {
 
-			/* add "begin" and "end" tasks onto "task_list_timed" */
+			/* add "begin" and "end" tasks onto the timed task heap */
 
 			if ((rc = gen_task_EndResvWindow(presv)) != 0) {
 				sprintf(txt, "%s : EndResvWindow task creation failed",
@@ -4033,7 +4066,7 @@ add_resv_beginEnd_tasks(void)
 			}
 		} else if (presv->ri_qs.ri_state == RESV_UNCONFIRMED) {
 
-			/* add "end" task onto "task_list_timed" */
+			/* add "end" task onto the timed task heap */
 
 			if ((rc = gen_task_EndResvWindow(presv)) != 0) {
 				sprintf(txt, "%s : EndResvWindow task creation failed",
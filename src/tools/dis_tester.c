@@ -0,0 +1,607 @@
+/*
+ * Copyright (C) 1994-2021 Altair Engineering, Inc.
+ * For more information, contact Altair at www.altair.com.
+ *
+ * This file is part of both the OpenPBS software ("OpenPBS")
+ * and the PBS Professional ("PBS Pro") software.
+ *
+ * Open Source License Information:
+ *
+ * OpenPBS is free software. You can redistribute it and/or modify it under
+ * the terms of the GNU Affero General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Commercial License Information:
+ *
+ * PBS Pro is commercially licensed software that shares a common core with
+ * the OpenPBS software.  For a copy of the commercial license terms and
+ * conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+ * Altair Legal Department.
+ *
+ * Altair's dual-license business model allows companies, individuals, and
+ * organizations to create proprietary derivative works of OpenPBS and
+ * distribute them - whether embedded or bundled with other software -
+ * under a commercial license agreement.
+ *
+ * Use of Altair's trademarks, including but not limited to "PBS™",
+ * "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+ * subject to Altair's trademark licensing policies.
+ */
+
+/**
+ * @file dis_tester.c
+ *
+ * @brief
+ *		dis_tester.c - Checks that values written with the DIS writers are
+ *		read back the same, both in DIS text and in the compact encoding
+ *		(see disv_.c).
+ *
+ * @par
+ *		Every value is sent over a socketpair twice, once in each
+ *		encoding.  The values written, and the values and return codes
+ *		read back, must be the same for both encodings.  Values which fit
+ *		the reader must come back unchanged.
+ *
+ * Functions included are:
+ * 	main()
+ * 	test_get_chan()
+ * 	test_set_chan()
+ * 	test_recv()
+ * 	test_send()
+ * 	check()
+ * 	set_encoding()
+ * 	test_ints()
+ * 	test_overflow()
+ * 	test_floats()
+ * 	test_strings()
+ */
+#include <pbs_config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include "dis.h"
+
+#define MAX_TEST_FD 1024
+
+extern void dis_init_tables(void);
+
+static pbs_tcp_chan_t *test_chans[MAX_TEST_FD];
+static int wr_fd; /* end the values are written to */
+static int rd_fd; /* end the values are read from */
+static int failures;
+static int cases;
+
+/**
+ * @brief
+ *		get the DIS channel of a socketpair end
+ *
+ * @param[in]	fd	-	socketpair end
+ *
+ * @return	pbs_tcp_chan_t *
+ */
+static pbs_tcp_chan_t *
+test_get_chan(int fd)
+{
+	if (fd < 0 || fd >= MAX_TEST_FD) {
+		errno = ENOTCONN;
+		return NULL;
+	}
+	errno = 0;
+	return test_chans[fd];
+}
+
+/**
+ * @brief
+ *		set the DIS channel of a socketpair end
+ *
+ * @param[in]	fd	-	socketpair end
+ * @param[in]	chan	-	the channel
+ *
+ * @return	int
+ * @retval	0	: success
+ * @retval	-1	: bad fd
+ */
+static int
+test_set_chan(int fd, pbs_tcp_chan_t *chan)
+{
+	if (fd < 0 || fd >= MAX_TEST_FD)
+		return -1;
+	test_chans[fd] = chan;
+	return 0;
+}
+
+/**
+ * @brief
+ *		read exactly len bytes from a socketpair end
+ *
+ * @return	int
+ * @retval	len	: success
+ * @retval	-1	: error
+ * @retval	-2	: EOF
+ */
+static int
+test_recv(int fd, void *data, int len)
+{
+	int got = 0;
+
+	while (got < len) {
+		ssize_t i = read(fd, (char *) data + got, len - got);
+		if (i == 0)
+			return -2;
+		if (i < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		got += i;
+	}
+	return len;
+}
+
+/**
+ * @brief
+ *		write len bytes to a socketpair end
+ *
+ * @return	int
+ * @retval	len	: success
+ * @retval	-1	: error
+ */
+static int
+test_send(int fd, void *data, int len)
+{
+	int put = 0;
+
+	while (put < len) {
+		ssize_t i = write(fd, (char *) data + put, len - put);
+		if (i < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		put += i;
+	}
+	return len;
+}
+
+/**
+ * @brief
+ *		record the outcome of one case
+ *
+ * @param[in]	ok	-	did the case pass?
+ * @param[in]	what	-	description of the case
+ *
+ * @return	void
+ */
+static void
+check(int ok, const char *what)
+{
+	cases++;
+	if (!ok) {
+		failures++;
+		fprintf(stderr, "FAILED: %s\n", what);
+	}
+}
+
+/**
+ * @brief
+ *		start sending in one encoding
+ *
+ * @param[in]	compact	-	true for the compact encoding
+ *
+ * @return	void
+ */
+static void
+set_encoding(int compact)
+{
+	dis_set_compact(wr_fd, compact);
+}
+
+/* Each of the helpers below writes one value, flushes it and reads it
+ * back in the encoding set by set_encoding().
+ */
+
+static unsigned long
+rt_ul(unsigned long v, int *rc)
+{
+	diswul(wr_fd, v);
+	dis_flush(wr_fd);
+	return disrul(rd_fd, rc);
+}
+
+static long
+rt_sl(long v, int *rc)
+{
+	diswsl(wr_fd, v);
+	dis_flush(wr_fd);
+	return disrsl(rd_fd, rc);
+}
+
+static u_Long
+rt_ull(u_Long v, int *rc)
+{
+	diswull(wr_fd, v);
+	dis_flush(wr_fd);
+	return disrull(rd_fd, rc);
+}
+
+static unsigned
+rt_ul_as_ui(unsigned long v, int *rc)
+{
+	diswul(wr_fd, v);
+	dis_flush(wr_fd);
+	return disrui(rd_fd, rc);
+}
+
+static int
+rt_sl_as_si(long v, int *rc)
+{
+	diswsl(wr_fd, v);
+	dis_flush(wr_fd);
+	return disrsi(rd_fd, rc);
+}
+
+static long
+rt_ull_as_sl(u_Long v, int *rc)
+{
+	diswull(wr_fd, v);
+	dis_flush(wr_fd);
+	return disrsl(rd_fd, rc);
+}
+
+static double
+rt_d(double v, int *rc)
+{
+	diswd(wr_fd, v);
+	dis_flush(wr_fd);
+	return disrd(rd_fd, rc);
+}
+
+static float
+rt_f(float v, int *rc)
+{
+	diswf(wr_fd, v);
+	dis_flush(wr_fd);
+	return disrf(rd_fd, rc);
+}
+
+/**
+ * @brief
+ *		integers at 0, +-1, the 6 bit and 7 bit boundaries of the compact
+ *		encoding and the limits of each type
+ *
+ * @return	void
+ */
+static void
+test_ints(void)
+{
+	static const unsigned long uvals[] = {0, 1, 62, 63, 64, 65, 127, 128,
+					      8191, 8192, 8193, 1048575, 1048576,
+					      UINT_MAX, ULONG_MAX - 1, ULONG_MAX};
+	static const long svals[] = {0, 1, -1, 63, -63, 64, -64, 8191, -8191,
+				     8192, -8192, INT_MAX, INT_MIN,
+				     LONG_MAX, LONG_MIN + 1, LONG_MIN};
+	static const u_Long ullvals[] = {0, 1, 63, 64, 8192, ULONG_MAX, ULLONG_MAX};
+	char what[256];
+	size_t i;
+
+	for (i = 0; i < sizeof(uvals) / sizeof(uvals[0]); i++) {
+		int rc[2];
+		unsigned long got[2];
+		int enc;
+
+		for (enc = 0; enc < 2; enc++) {
+			set_encoding(enc);
+			got[enc] = rt_ul(uvals[i], &rc[enc]);
+		}
+		snprintf(what, sizeof(what), "unsigned long %lu", uvals[i]);
+		check(rc[0] == DIS_SUCCESS && rc[1] == DIS_SUCCESS &&
+			      got[0] == uvals[i] && got[1] == uvals[i],
+		      what);
+	}
+
+	for (i = 0; i < sizeof(svals) / sizeof(svals[0]); i++) {
+		int rc[2];
+		long got[2];
+		int enc;
+
+		for (enc = 0; enc < 2; enc++) {
+			set_encoding(enc);
+			got[enc] = rt_sl(svals[i], &rc[enc]);
+		}
+		snprintf(what, sizeof(what), "long %ld", svals[i]);
+		check(rc[0] == DIS_SUCCESS && rc[1] == DIS_SUCCESS &&
+			      got[0] == svals[i] && got[1] == svals[i],
+		      what);
+	}
+
+	for (i = 0; i < sizeof(ullvals) / sizeof(ullvals[0]); i++) {
+		int rc[2];
+		u_Long got[2];
+		int enc;
+
+		for (enc = 0; enc < 2; enc++) {
+			set_encoding(enc);
+			got[enc] = rt_ull(ullvals[i], &rc[enc]);
+		}
+		snprintf(what, sizeof(what), "u_Long %llu", (unsigned long long) ullvals[i]);
+		check(rc[0] == DIS_SUCCESS && rc[1] == DIS_SUCCESS &&
+			      got[0] == ullvals[i] && got[1] == ullvals[i],
+		      what);
+	}
+
+	/* signed writers and unsigned readers can be mixed */
+	for (i = 0; i < sizeof(svals) / sizeof(svals[0]); i++) {
+		int rc[2];
+		unsigned long got[2];
+		int enc;
+
+		for (enc = 0; enc < 2; enc++) {
+			set_encoding(enc);
+			diswsl(wr_fd, svals[i]);
+			dis_flush(wr_fd);
+			got[enc] = disrul(rd_fd, &rc[enc]);
+		}
+		snprintf(what, sizeof(what), "long %ld read as unsigned long", svals[i]);
+		if (svals[i] >= 0)
+			check(rc[0] == DIS_SUCCESS && rc[1] == DIS_SUCCESS &&
+				      got[0] == (unsigned long) svals[i] && got[1] == got[0],
+			      what);
+		else
+			check(rc[0] == DIS_BADSIGN && rc[1] == DIS_BADSIGN, what);
+	}
+}
+
+/**
+ * @brief
+ *		values too large for the reader.  Both encodings must give the same
+ *		error and value.  A reader does not always consume a value it could
+ *		not convert, so the rest of the pkt is dropped after each case.
+ *
+ * @return	void
+ */
+static void
+test_overflow(void)
+{
+	static const unsigned long uvals[] = {(unsigned long) UINT_MAX + 1, ULONG_MAX};
+	static const long svals[] = {(long) INT_MAX + 1, (long) INT_MIN - 1, LONG_MAX, LONG_MIN};
+	char what[256];
+	size_t i;
+
+	for (i = 0; i < sizeof(uvals) / sizeof(uvals[0]); i++) {
+		int rc[2];
+		unsigned got[2];
+		int enc;
+
+		if (uvals[i] <= UINT_MAX)
+			continue;
+		for (enc = 0; enc < 2; enc++) {
+			set_encoding(enc);
+			got[enc] = rt_ul_as_ui(uvals[i], &rc[enc]);
+			dis_setup_chan(rd_fd, test_get_chan);
+		}
+		snprintf(what, sizeof(what), "unsigned long %lu read as unsigned", uvals[i]);
+		check(rc[0] == DIS_OVERFLOW && rc[1] == rc[0] && got[1] == got[0], what);
+	}
+
+	for (i = 0; i < sizeof(svals) / sizeof(svals[0]); i++) {
+		int rc[2];
+		int got[2];
+		int enc;
+
+		if (svals[i] <= INT_MAX && svals[i] >= INT_MIN)
+			continue;
+		for (enc = 0; enc < 2; enc++) {
+			set_encoding(enc);
+			got[enc] = rt_sl_as_si(svals[i], &rc[enc]);
+			dis_setup_chan(rd_fd, test_get_chan);
+		}
+		snprintf(what, sizeof(what), "long %ld read as int", svals[i]);
+		check(rc[0] == DIS_OVERFLOW && rc[1] == rc[0] && got[1] == got[0], what);
+	}
+
+	{
+		int rc[2];
+		long got[2];
+		int enc;
+
+		for (enc = 0; enc < 2; enc++) {
+			set_encoding(enc);
+			got[enc] = rt_ull_as_sl(ULLONG_MAX, &rc[enc]);
+			dis_setup_chan(rd_fd, test_get_chan);
+		}
+		check(rc[0] == DIS_OVERFLOW && rc[1] == rc[0] && got[1] == got[0],
+		      "ULLONG_MAX read as long");
+	}
+}
+
+/**
+ * @brief
+ *		floating point numbers, whose coefficient stays in DIS text and
+ *		whose exponent is an integer
+ *
+ * @return	void
+ */
+static void
+test_floats(void)
+{
+	static const double dvals[] = {0.0, 1.0, -1.0, 0.5, -2.5, 3.14159265358979,
+				       1e-300, 1e300, -1e300, 123456789.0, DBL_MAX, DBL_MIN};
+	static const float fvals[] = {0.0f, 1.0f, -1.0f, 0.1f, 1e30f, -1e-30f, FLT_MAX};
+	char what[256];
+	size_t i;
+
+	for (i = 0; i < sizeof(dvals) / sizeof(dvals[0]); i++) {
+		int rc[2];
+		double got[2];
+		int enc;
+
+		for (enc = 0; enc < 2; enc++) {
+			set_encoding(enc);
+			got[enc] = rt_d(dvals[i], &rc[enc]);
+		}
+		snprintf(what, sizeof(what), "double %g", dvals[i]);
+		/* DBL_MAX rounded to DBL_DIG digits is past DBL_MAX in either encoding */
+		if (dvals[i] == DBL_MAX)
+			check(rc[0] == DIS_OVERFLOW && rc[1] == rc[0], what);
+		else
+			check(rc[0] == DIS_SUCCESS && rc[1] == DIS_SUCCESS && got[0] == got[1], what);
+	}
+
+	for (i = 0; i < sizeof(fvals) / sizeof(fvals[0]); i++) {
+		int rc[2];
+		float got[2];
+		int enc;
+
+		for (enc = 0; enc < 2; enc++) {
+			set_encoding(enc);
+			got[enc] = rt_f(fvals[i], &rc[enc]);
+		}
+		snprintf(what, sizeof(what), "float %g", (double) fvals[i]);
+		check(rc[0] == DIS_SUCCESS && rc[1] == DIS_SUCCESS && got[0] == got[1], what);
+	}
+}
+
+/**
+ * @brief
+ *		counted strings with lengths at the boundaries of the compact
+ *		encoding, read back with each of the string readers
+ *
+ * @return	void
+ */
+static void
+test_strings(void)
+{
+	static const size_t lens[] = {0, 1, 63, 64, 127, 128, 8191, 8192, 100000};
+	char what[256];
+	char *str;
+	char *buf;
+	size_t i;
+	size_t j;
+
+	if ((str = malloc(100001)) == NULL || (buf = malloc(100001)) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	for (j = 0; j < 100000; j++)
+		str[j] = 'a' + j % 26;
+
+	for (i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+		int enc;
+
+		for (enc = 0; enc < 2; enc++) {
+			size_t nchars = 0;
+			char *got;
+			int rc;
+
+			set_encoding(enc);
+
+			/* counted string */
+			diswcs(wr_fd, str, lens[i]);
+			dis_flush(wr_fd);
+			got = disrcs(rd_fd, &nchars, &rc);
+			snprintf(what, sizeof(what), "counted string of %zu (encoding %d)", lens[i], enc);
+			check(rc == DIS_SUCCESS && got != NULL && nchars == lens[i] &&
+				      memcmp(got, str, lens[i]) == 0,
+			      what);
+			free(got);
+
+			/* into a fixed buffer that is large enough */
+			diswcs(wr_fd, str, lens[i]);
+			dis_flush(wr_fd);
+			rc = disrfcs(rd_fd, &nchars, 100001, buf);
+			snprintf(what, sizeof(what), "fixed counted string of %zu (encoding %d)", lens[i], enc);
+			check(rc == DIS_SUCCESS && nchars == lens[i] && memcmp(buf, str, lens[i]) == 0, what);
+
+			/* NUL terminated string */
+			str[lens[i]] = '\0';
+			diswst(wr_fd, str);
+			dis_flush(wr_fd);
+			got = disrst(rd_fd, &rc);
+			snprintf(what, sizeof(what), "string of %zu (encoding %d)", lens[i], enc);
+			check(rc == DIS_SUCCESS && got != NULL && strcmp(got, str) == 0, what);
+			free(got);
+
+			diswst(wr_fd, str);
+			dis_flush(wr_fd);
+			rc = disrfst(rd_fd, 100001, buf);
+			snprintf(what, sizeof(what), "fixed string of %zu (encoding %d)", lens[i], enc);
+			check(rc == DIS_SUCCESS && strcmp(buf, str) == 0, what);
+			str[lens[i]] = 'a' + lens[i] % 26;
+
+			/* the next value after a string is read in step */
+			diswsl(wr_fd, -64);
+			dis_flush(wr_fd);
+			snprintf(what, sizeof(what), "value after string of %zu (encoding %d)", lens[i], enc);
+			check(disrsl(rd_fd, &rc) == -64 && rc == DIS_SUCCESS, what);
+		}
+	}
+
+	/* a string too long for the buffer is an error in both encodings */
+	for (j = 0; j < 2; j++) {
+		size_t nchars = 0;
+		int rc;
+
+		set_encoding(j);
+		diswcs(wr_fd, str, 64);
+		dis_flush(wr_fd);
+		rc = disrfcs(rd_fd, &nchars, 63, buf);
+		snprintf(what, sizeof(what), "counted string too long for buffer (encoding %zu)", j);
+		check(rc == DIS_OVERFLOW, what);
+		dis_setup_chan(rd_fd, test_get_chan);
+	}
+
+	free(str);
+	free(buf);
+}
+
+/**
+ * @brief
+ *      This is main function of dis_tester.
+ *
+ * @return	int
+ * @retval	0	: all cases passed
+ * @retval	1	: failure
+ *
+ */
+int
+main(void)
+{
+	int sv[2];
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+		perror("socketpair");
+		return 1;
+	}
+	wr_fd = sv[0];
+	rd_fd = sv[1];
+
+	dis_init_tables();
+
+	pfn_transport_get_chan = test_get_chan;
+	pfn_transport_set_chan = test_set_chan;
+	pfn_transport_recv = test_recv;
+	pfn_transport_send = test_send;
+	dis_setup_chan(wr_fd, test_get_chan);
+	dis_setup_chan(rd_fd, test_get_chan);
+
+	test_ints();
+	test_overflow();
+	test_floats();
+	test_strings();
+
+	printf("%d of %d cases passed\n", cases - failures, cases);
+	return (failures != 0);
+}
@@ -0,0 +1,134 @@
+# coding: utf-8
+
+# Copyright (C) 1994-2021 Altair Engineering, Inc.
+# For more information, contact Altair at www.altair.com.
+#
+# This file is part of both the OpenPBS software ("OpenPBS")
+# and the PBS Professional ("PBS Pro") software.
+#
+# Open Source License Information:
+#
+# OpenPBS is free software. You can redistribute it and/or modify it under
+# the terms of the GNU Affero General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Commercial License Information:
+#
+# PBS Pro is commercially licensed software that shares a common core with
+# the OpenPBS software.  For a copy of the commercial license terms and
+# conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+# Altair Legal Department.
+#
+# Altair's dual-license business model allows companies, individuals, and
+# organizations to create proprietary derivative works of OpenPBS and
+# distribute them - whether embedded or bundled with other software -
+# under a commercial license agreement.
+#
+# Use of Altair's trademarks, including but not limited to "PBS™",
+# "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+# subject to Altair's trademark licensing policies.
+
+
+from tests.functional import *
+
+
+class TestDisCompact(TestFunctional):
+    """
+    Test client, server and Mom traffic with the compact encoding of
+    the DIS protocol turned on and off (PBS_DIS_COMPACT)
+    """
+
+    # attribute value lengths at the 6 and 13 bit boundaries of the
+    # compact encoding
+    lens = [0, 1, 63, 64, 127, 128, 8191, 8192]
+
+    def tearDown(self):
+        for host in set([self.server.hostname, self.mom.hostname]):
+            self.du.unset_pbs_config(host, confs='PBS_DIS_COMPACT')
+        self.server.restart()
+        self.mom.restart()
+        TestFunctional.tearDown(self)
+
+    def set_compact(self, val):
+        """
+        Set PBS_DIS_COMPACT on the server and Mom hosts and restart them
+        """
+        for host in set([self.server.hostname, self.mom.hostname]):
+            self.du.set_pbs_config(host, confs={'PBS_DIS_COMPACT': val})
+        self.server.restart()
+        self.mom.restart()
+        self.server.expect(NODE, {'state': 'free'}, id=self.mom.shortname)
+
+    def check_traffic(self):
+        """
+        Submit jobs with values of many lengths, check qstat shows them
+        as they were sent, and run a job through Mom
+        """
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        vals = {}
+        for n in self.lens:
+            val = ''.join(chr(ord('a') + i % 26) for i in range(n))
+            a = {ATTR_v: 'DISVAL=x' + val, ATTR_N: 'dis%d' % n}
+            jid = self.server.submit(Job(TEST_USER, attrs=a))
+            vals[jid] = 'x' + val
+
+        for jid, val in vals.items():
+            st = self.server.status(JOB, ATTR_v, id=jid)
+            self.assertIn('DISVAL=' + val, st[0][ATTR_v])
+
+        # qstat -f of all the jobs at once
+        st = self.server.status(JOB)
+        self.assertEqual(len(st), len(vals))
+
+        # A job run by Mom and its usage reported back to the server
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'True'})
+        jid = list(vals)[0]
+        self.server.expect(JOB, {'job_state': 'R'}, id=jid)
+        self.server.expect(JOB, 'resources_used.walltime', op=SET, id=jid)
+        self.server.delete(list(vals), wait=True)
+        self.server.expect(NODE, {'state': 'free'}, id=self.mom.shortname)
+
+    def test_compact_off(self):
+        """
+        Test qstat and Mom traffic with PBS_DIS_COMPACT=0
+        """
+        self.set_compact('0')
+        self.check_traffic()
+
+    def test_compact_on(self):
+        """
+        Test qstat and Mom traffic with PBS_DIS_COMPACT=1
+        """
+        self.set_compact('1')
+        self.check_traffic()
+
+    def test_compact_mixed(self):
+        """
+        Test that a client with PBS_DIS_COMPACT=0 talks to a server which
+        offers the compact encoding, and the other way round
+        """
+        self.set_compact('1')
+        jid = self.server.submit(Job(TEST_USER))
+        qstat = os.path.join(self.server.pbs_conf['PBS_EXEC'],
+                             'bin', 'qstat')
+        for val in ['0', '1']:
+            ret = self.du.run_cmd(self.server.hostname, [qstat, '-f', jid],
+                                  env={'PBS_DIS_COMPACT': val})
+            self.assertEqual(ret['rc'], 0)
+            self.assertIn('Job Id: ' + jid, '\n'.join(ret['out']))
+
+        self.set_compact('0')
+        for val in ['0', '1']:
+            ret = self.du.run_cmd(self.server.hostname, [qstat, '-f', jid],
+                                  env={'PBS_DIS_COMPACT': val})
+            self.assertEqual(ret['rc'], 0)
+            self.assertIn('Job Id: ' + jid, '\n'.join(ret['out']))
@@ -72,3 +72,99 @@ class TestJobSortFormula(TestFunctional):
             self.assertEqual(job.split('.')[0], c.political_order[i])
 
         self.server.expect(JOB, {'job_state=R': 2})
+
+    def submit_formula_jobs(self):
+        """
+        Submit held jobs with a mix of int and float resources for the
+        formula tests.  Held jobs are evaluated every cycle, but never run.
+        """
+        self.server.manager(MGR_CMD_CREATE, RSC, {'type': 'float'}, id='foo')
+        self.server.manager(MGR_CMD_SET, SCHED, {'log_events': 2047})
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        jids = []
+        for ncpus, foo in [(1, 0.1), (2, -2.5), (3, 7), (5, 1e6)]:
+            a = {'Resource_List.ncpus': ncpus, 'Resource_List.foo': foo,
+                 ATTR_h: None}
+            jids.append(self.server.submit(Job(TEST_USER, attrs=a)))
+        return jids
+
+    def formula_values(self, formula, jids):
+        """
+        Set the job_sort_formula, run a cycle, and return the formula
+        value the scheduler logged for each job
+        """
+        self.server.manager(MGR_CMD_SET, SERVER,
+                            {'job_sort_formula': formula}, runas=ROOT_USER)
+        t = time.time()
+        self.scheduler.run_scheduling_cycle()
+        vals = {}
+        for jid in jids:
+            m = self.scheduler.log_match(jid + ';Formula Evaluation = ',
+                                         starttime=t)
+            vals[jid] = m[1].split('Formula Evaluation = ')[1].strip()
+        return vals
+
+    def check_formulas(self, formulas, jids):
+        """
+        Check that formulas the scheduler evaluates natively give the same
+        values the Python interpreter does.  A conditional expression is
+        not compiled, so wrapping a formula in one makes the scheduler use
+        the Python interpreter.
+        """
+        for f in formulas:
+            native = self.formula_values(f, jids)
+            python = self.formula_values('(%s) if True else 0' % f, jids)
+            self.assertEqual(native, python, 'formula: ' + f)
+
+    def test_formula_precedence(self):
+        """
+        Test operator precedence and unary minus of natively evaluated
+        formulas against the Python interpreter
+        """
+        jids = self.submit_formula_jobs()
+        self.check_formulas(['ncpus + 2 * 3 - foo / 8',
+                             '(ncpus + 2) * 3 ** 2 ** ncpus',
+                             '-ncpus ** 2 + - - 3',
+                             '-foo * -2 + +ncpus',
+                             '2 ** -ncpus * foo',
+                             '3 * -ncpus ** -2'], jids)
+
+    def test_formula_division(self):
+        """
+        Test division, floor division and modulo of natively evaluated
+        formulas against the Python interpreter, including division by zero
+        """
+        jids = self.submit_formula_jobs()
+        self.check_formulas(['ncpus / 3',
+                             'ncpus // 3 + ncpus % 3',
+                             '-ncpus // 2 + -ncpus % 3',
+                             'ncpus // -2 + ncpus % -3',
+                             '1 // 0.1 + foo // 0.3 + foo % -0.7',
+                             'ncpus / (ncpus - ncpus)',
+                             'foo // (ncpus - ncpus)'], jids)
+
+    def test_formula_unknown_name(self):
+        """
+        Test that a formula with a name the scheduler does not know is
+        evaluated by the Python interpreter
+        """
+        jids = self.submit_formula_jobs()
+        t = time.time()
+        self.check_formulas(['abs(ncpus - 3) + 1'], jids)
+        self.scheduler.log_match(
+            'Formula will be evaluated by Python (unknown name abs)',
+            starttime=t)
+
+    def test_formula_large_integers(self):
+        """
+        Test that int arithmetic in natively evaluated formulas is exact
+        like Python's, and ints which outgrow 64 bits still give Python's
+        answer
+        """
+        jids = self.submit_formula_jobs()
+        self.check_formulas(['(2 ** 53 + ncpus) - 2 ** 53',
+                             '10 ** 18 // (7 * ncpus) % 1000',
+                             '(10 ** 17 + ncpus) / 3',
+                             '2 ** 70 // 2 ** 68 + ncpus',
+                             '-(-9223372036854775807 - ncpus)',
+                             '9223372036854775808 - ncpus'], jids)
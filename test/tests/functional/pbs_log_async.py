@@ -0,0 +1,115 @@
+# coding: utf-8
+# Copyright (C) 1994-2021 Altair Engineering, Inc.
+# For more information, contact Altair at www.altair.com.
+#
+# This file is part of both the OpenPBS software ("OpenPBS")
+# and the PBS Professional ("PBS Pro") software.
+#
+# Open Source License Information:
+#
+# OpenPBS is free software. You can redistribute it and/or modify it under
+# the terms of the GNU Affero General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Commercial License Information:
+#
+# PBS Pro is commercially licensed software that shares a common core with
+# the OpenPBS software.  For a copy of the commercial license terms and
+# conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+# Altair Legal Department.
+#
+# Altair's dual-license business model allows companies, individuals, and
+# organizations to create proprietary derivative works of OpenPBS and
+# distribute them - whether embedded or bundled with other software -
+# under a commercial license agreement.
+#
+# Use of Altair's trademarks, including but not limited to "PBS™",
+# "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+# subject to Altair's trademark licensing policies.
+
+
+from tests.functional import *
+
+
+class TestLogAsync(TestFunctional):
+    """
+    Test logging through the asynchronous log writer (PBS_LOG_ASYNC)
+    """
+    line_re = re.compile(r'^\d{2}/\d{2}/\d{4} \d{2}:\d{2}:\d{2}(\.\d{6})?;'
+                         r'[0-9a-f]{4};[^;]+;[^;]+;[^;]*;.*$')
+
+    def set_log_async(self, mode):
+        """
+        Set PBS_LOG_ASYNC in pbs.conf and restart the daemons
+        """
+        self.du.set_pbs_config(self.server.hostname,
+                               confs={'PBS_LOG_ASYNC': mode})
+        PBSInitServices().restart()
+        self.assertTrue(self.server.isUp(), 'Failed to restart PBS Daemons')
+
+    def tearDown(self):
+        self.du.unset_pbs_config(self.server.hostname, confs='PBS_LOG_ASYNC')
+        PBSInitServices().restart()
+        TestFunctional.tearDown(self)
+
+    def check_lines(self, starttime, jids):
+        """
+        Check that every server log line since starttime is complete and
+        that the jobs were logged as queued in the order they were
+        submitted
+        """
+        lines = self.server.log_lines(logtype=self.server, n='ALL',
+                                      starttime=starttime)
+        queued = []
+        for line in lines:
+            self.assertTrue(self.line_re.match(line),
+                            'Incomplete log line: %s' % line)
+            f = line.split(';')
+            if f[4] in jids and 'Job Queued at request of' in f[5]:
+                queued.append(f[4])
+        self.assertEqual(queued, jids)
+
+    def test_lines_complete_and_ordered(self):
+        """
+        Submit and delete jobs with PBS_LOG_ASYNC=1 and check that the
+        log lines are complete and in order
+        """
+        self.set_log_async(1)
+        self.server.manager(MGR_CMD_SET, SERVER,
+                            {'log_events': 2047})
+        t = time.time()
+        jids = []
+        for _ in range(200):
+            j = Job(TEST_USER, attrs={ATTR_h: None})
+            jids.append(self.server.submit(j))
+        self.server.delete(jids, wait=True)
+        self.server.log_match('%s;dequeuing from' % jids[-1],
+                              starttime=t)
+        self.check_lines(t, jids)
+
+    def test_drop_debug_keeps_other_records(self):
+        """
+        With PBS_LOG_ASYNC=2 only debug records may be dropped: every job
+        is still logged as queued, in order, on complete lines
+        """
+        self.set_log_async(2)
+        self.server.manager(MGR_CMD_SET, SERVER,
+                            {'log_events': 2047})
+        t = time.time()
+        jids = []
+        for _ in range(200):
+            j = Job(TEST_USER, attrs={ATTR_h: None})
+            jids.append(self.server.submit(j))
+        self.server.delete(jids, wait=True)
+        self.server.log_match('%s;dequeuing from' % jids[-1],
+                              starttime=t)
+        self.check_lines(t, jids)
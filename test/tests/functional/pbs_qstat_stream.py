@@ -0,0 +1,137 @@
+# coding: utf-8
+# Copyright (C) 1994-2021 Altair Engineering, Inc.
+# For more information, contact Altair at www.altair.com.
+#
+# This file is part of both the OpenPBS software ("OpenPBS")
+# and the PBS Professional ("PBS Pro") software.
+#
+# Open Source License Information:
+#
+# OpenPBS is free software. You can redistribute it and/or modify it under
+# the terms of the GNU Affero General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Commercial License Information:
+#
+# PBS Pro is commercially licensed software that shares a common core with
+# the OpenPBS software.  For a copy of the commercial license terms and
+# conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+# Altair Legal Department.
+#
+# Altair's dual-license business model allows companies, individuals, and
+# organizations to create proprietary derivative works of OpenPBS and
+# distribute them - whether embedded or bundled with other software -
+# under a commercial license agreement.
+#
+# Use of Altair's trademarks, including but not limited to "PBS™",
+# "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+# subject to Altair's trademark licensing policies.
+
+
+import subprocess
+
+from tests.functional import *
+
+
+class TestQstatStream(TestFunctional):
+    """
+    Test qstat output of more jobs than the server sends in one part of a
+    status reply (MAX_JOBS_PER_REPLY, 500)
+    """
+
+    def setUp(self):
+        TestFunctional.setUp(self)
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        self.qstat = os.path.join(self.server.pbs_conf['PBS_EXEC'],
+                                  'bin', 'qstat')
+        # 499 jobs, then array jobs as the last job of the first part and
+        # the first jobs of the second part, then more jobs
+        self.jids = []
+        j = Job(TEST_USER)
+        for _ in range(499):
+            self.jids.append(self.server.submit(j))
+        for _ in range(3):
+            ja = Job(TEST_USER, attrs={ATTR_J: '1-3'})
+            self.jids.append(self.server.submit(ja))
+        for _ in range(100):
+            self.jids.append(self.server.submit(j))
+
+    def run_qstat(self, args):
+        """
+        Run qstat with args and return its output.  A cycle in the job
+        status list would make qstat print forever, so it is timed out.
+        """
+        p = subprocess.run([self.qstat] + args, stdout=subprocess.PIPE,
+                           stderr=subprocess.PIPE, timeout=300)
+        self.assertEqual(p.returncode, 0, p.stderr.decode())
+        return p.stdout.decode().splitlines()
+
+    def check_full(self, out, ordered=True):
+        """
+        Check that qstat -f output lists every job once, and in order if
+        ordered is True
+        """
+        ids = [l[len('Job Id: '):] for l in out if l.startswith('Job Id: ')]
+        if ordered:
+            self.assertEqual(ids, self.jids)
+        else:
+            self.assertEqual(sorted(ids), sorted(self.jids))
+
+    def check_default(self, out, ordered=True):
+        """
+        Check that the default qstat output lists every job once, and in
+        order if ordered is True
+        """
+        i = [n for n, l in enumerate(out) if l.startswith('---')][0]
+        ids = [l.split()[0] for l in out[i + 1:]]
+        self.assertEqual(len(ids), len(self.jids))
+        self.assertEqual(len(ids), len(set(ids)))
+        if ordered:
+            for sid, jid in zip(ids, self.jids):
+                self.assertTrue(jid.startswith(sid.split('.')[0] + '.'))
+
+    def test_default_all_jobs(self):
+        """
+        Test the default display of all jobs at the server
+        """
+        self.check_default(self.run_qstat([]))
+
+    def test_full_all_jobs(self):
+        """
+        Test qstat -f of all jobs at the server, and of a queue
+        """
+        self.check_full(self.run_qstat(['-f']))
+        self.check_full(self.run_qstat(['-f', 'workq']))
+
+    def test_full_job_list(self):
+        """
+        Test qstat -f and the default display of a list of job ids, which
+        the server replies to in parts of a comma separated list.  qstat -E
+        sorts the list.
+        """
+        self.check_full(self.run_qstat(['-E', '-f'] + self.jids), False)
+        self.check_default(self.run_qstat(['-E'] + self.jids), False)
+
+    def test_subjobs_on_boundary(self):
+        """
+        Test qstat -t, where the subjobs of the array jobs on the part
+        boundary are listed after their parents
+        """
+        out = self.run_qstat(['-t', '-f'])
+        ids = [l[len('Job Id: '):] for l in out if l.startswith('Job Id: ')]
+        self.assertEqual(len(ids), len(set(ids)))
+        for jid in self.jids[499:502]:
+            seq, svr = jid.split('[]')
+            subs = ['%s[%d]%s' % (seq, i, svr) for i in range(1, 4)]
+            k = ids.index(jid)
+            self.assertEqual(ids[k + 1:k + 4], subs)
+        self.assertEqual(len(ids), len(self.jids) + 9)
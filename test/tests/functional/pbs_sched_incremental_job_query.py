@@ -0,0 +1,138 @@
+# coding: utf-8
+
+# Copyright (C) 1994-2021 Altair Engineering, Inc.
+# For more information, contact Altair at www.altair.com.
+#
+# This file is part of both the OpenPBS software ("OpenPBS")
+# and the PBS Professional ("PBS Pro") software.
+#
+# Open Source License Information:
+#
+# OpenPBS is free software. You can redistribute it and/or modify it under
+# the terms of the GNU Affero General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Commercial License Information:
+#
+# PBS Pro is commercially licensed software that shares a common core with
+# the OpenPBS software.  For a copy of the commercial license terms and
+# conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+# Altair Legal Department.
+#
+# Altair's dual-license business model allows companies, individuals, and
+# organizations to create proprietary derivative works of OpenPBS and
+# distribute them - whether embedded or bundled with other software -
+# under a commercial license agreement.
+#
+# Use of Altair's trademarks, including but not limited to "PBS™",
+# "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+# subject to Altair's trademark licensing policies.
+
+
+
+from tests.functional import *
+
+
+class TestSchedIncrementalJobQuery(TestFunctional):
+    """
+    Test suite for the scheduler's incremental_job_query option
+    """
+
+    def setUp(self):
+        TestFunctional.setUp(self)
+        self.scheduler.set_sched_config({'incremental_job_query':
+                                         'True ALL'})
+        self.server.manager(MGR_CMD_SET, SCHED, {'log_events': 2047})
+        self.server.manager(MGR_CMD_SET, NODE,
+                            {'resources_available.ncpus': 1},
+                            self.mom.shortname)
+
+    def test_changed_job_is_requeried(self):
+        """
+        Test that a change to a job made in between cycles is seen by the
+        scheduler when only changed jobs are queried
+        """
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        j = Job(TEST_USER, attrs={ATTR_h: None})
+        jid1 = self.server.submit(j)
+        j = Job(TEST_USER, attrs={ATTR_l + '.ncpus': 2})
+        jid2 = self.server.submit(j)
+
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, {ATTR_state: 'H'}, id=jid1)
+        self.server.expect(JOB, {ATTR_state: 'Q'}, id=jid2)
+
+        # The first query of a queue is a full one, the next is incremental
+        self.scheduler.run_scheduling_cycle()
+        self.scheduler.log_match('workq;Incremental job query: 2 jobs, ')
+
+        self.server.alterjob(jid2, {ATTR_l + '.ncpus': 1})
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, {ATTR_state: 'R'}, id=jid2)
+
+        self.server.deljob(jid2, wait=True)
+        self.server.rlsjob(jid1, USER_HOLD)
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, {ATTR_state: 'R'}, id=jid1)
+
+    def test_new_and_deleted_jobs(self):
+        """
+        Test that jobs submitted and deleted in between cycles are
+        picked up when only changed jobs are queried
+        """
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        j = Job(TEST_USER, attrs={ATTR_h: None})
+        jid1 = self.server.submit(j)
+        self.scheduler.run_scheduling_cycle()
+        self.scheduler.run_scheduling_cycle()
+
+        self.server.deljob(jid1, wait=True)
+        j = Job(TEST_USER)
+        jid2 = self.server.submit(j)
+        self.scheduler.run_scheduling_cycle()
+        self.scheduler.log_match('workq;Incremental job query: 1 jobs, ')
+        self.server.expect(JOB, {ATTR_state: 'R'}, id=jid2)
+
+    def test_running_job_resources_used(self):
+        """
+        Test that the resources_used of a running job, which the server
+        updates from Mom's status without changing the job's mtime, is not
+        reused from the cache when only changed jobs are queried
+        """
+        self.scheduler.set_sched_config({'fair_share': 'True',
+                                         'fairshare_usage_res': 'walltime'})
+        self.scheduler.add_to_resource_group(TEST_USER, 10, 'root', 50)
+        self.scheduler.fairshare.set_fairshare_usage(TEST_USER, 1)
+        self.mom.add_config({'$min_check_poll': 2, '$max_check_poll': 4})
+
+        j = Job(TEST_USER)
+        j.set_sleep_time(1000)
+        jid = self.server.submit(j)
+        self.server.expect(JOB, {ATTR_state: 'R'}, id=jid)
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+
+        # Cache the job while its resources_used is still low
+        self.scheduler.run_scheduling_cycle()
+        self.scheduler.run_scheduling_cycle()
+
+        self.server.expect(JOB, {'resources_used.walltime': 10}, op=GE,
+                           id=jid, offset=10)
+        t = time.time()
+        self.scheduler.run_scheduling_cycle()
+        self.scheduler.log_match(
+            'workq;Incremental job query: 1 jobs, 0 changed, 1 running',
+            starttime=t)
+
+        # The usage only grows if the scheduler saw the new resources_used
+        fs = self.scheduler.fairshare.query_fairshare(name=str(TEST_USER))
+        self.assertGreaterEqual(int(fs.usage), 10,
+                                "Fairshare usage did not see resources_used")
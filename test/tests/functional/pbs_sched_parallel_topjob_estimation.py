@@ -0,0 +1,164 @@
+# coding: utf-8
+
+# Copyright (C) 1994-2021 Altair Engineering, Inc.
+# For more information, contact Altair at www.altair.com.
+#
+# This file is part of both the OpenPBS software ("OpenPBS")
+# and the PBS Professional ("PBS Pro") software.
+#
+# Open Source License Information:
+#
+# OpenPBS is free software. You can redistribute it and/or modify it under
+# the terms of the GNU Affero General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Commercial License Information:
+#
+# PBS Pro is commercially licensed software that shares a common core with
+# the OpenPBS software.  For a copy of the commercial license terms and
+# conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+# Altair Legal Department.
+#
+# Altair's dual-license business model allows companies, individuals, and
+# organizations to create proprietary derivative works of OpenPBS and
+# distribute them - whether embedded or bundled with other software -
+# under a commercial license agreement.
+#
+# Use of Altair's trademarks, including but not limited to "PBS™",
+# "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+# subject to Altair's trademark licensing policies.
+
+
+from tests.functional import *
+
+
+class TestSchedParallelTopjobEstimation(TestFunctional):
+    """
+    Test suite for the scheduler's parallel_topjob_estimation option
+    """
+
+    def setUp(self):
+        TestFunctional.setUp(self)
+        self.du.set_pbs_config(self.server.hostname,
+                               confs={'PBS_SCHED_THREADS': '4'})
+        self.scheduler.restart()
+        self.scheduler.set_sched_config({'strict_ordering': 'True ALL'})
+        self.server.manager(MGR_CMD_SET, SERVER, {'backfill_depth': 10})
+        self.server.manager(MGR_CMD_SET, SCHED,
+                            {'opt_backfill_fuzzy': 'off',
+                             'log_events': 2047})
+
+    def tearDown(self):
+        self.du.unset_pbs_config(self.server.hostname,
+                                 confs='PBS_SCHED_THREADS')
+        self.scheduler.restart()
+        TestFunctional.tearDown(self)
+
+    def get_estimates(self, jids):
+        """
+        Return the estimated start time and execvnode of each job
+        """
+        ests = {}
+        for jid in jids:
+            self.server.expect(JOB, 'estimated.start_time', op=SET, id=jid)
+            st = self.server.status(JOB, ['estimated.start_time',
+                                          'estimated.exec_vnode'], id=jid)
+            ests[jid] = (st[0]['estimated.start_time'],
+                         st[0]['estimated.exec_vnode'])
+        return ests
+
+    def compare_with_serial(self, jids):
+        """
+        Run a cycle with the estimates done one at a time, then one with
+        them done in parallel, and check both give the same estimates
+        """
+        self.scheduler.set_sched_config(
+            {'parallel_topjob_estimation': 'False'})
+        self.scheduler.run_scheduling_cycle()
+        serial = self.get_estimates(jids)
+
+        self.scheduler.set_sched_config(
+            {'parallel_topjob_estimation': 'True'})
+        t = time.time()
+        self.scheduler.run_scheduling_cycle()
+        self.scheduler.log_match(
+            'Estimating the start time for a top job in parallel',
+            starttime=t)
+        parallel = self.get_estimates(jids)
+        self.assertEqual(serial, parallel)
+        return parallel
+
+    def test_estimates_match_serial(self):
+        """
+        Test that top job start times estimated on the scheduler threads
+        are the same as the ones estimated one at a time
+        """
+        a = {'resources_available.ncpus': 1}
+        self.mom.create_vnodes(a, num=4, sharednode=False)
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+
+        a = {'Resource_List.select': '4:ncpus=1',
+             'Resource_List.walltime': 100}
+        j = Job(TEST_USER, attrs=a)
+        jid1 = self.server.submit(j)
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, {ATTR_state: 'R'}, id=jid1)
+
+        jids = []
+        for sel, wt in [('2:ncpus=1', 100), ('1:ncpus=1', 200),
+                        ('4:ncpus=1', 50), ('1:ncpus=1', 100)]:
+            a = {'Resource_List.select': sel, 'Resource_List.walltime': wt}
+            jids.append(self.server.submit(Job(TEST_USER, attrs=a)))
+
+        self.compare_with_serial(jids)
+
+    def test_exclhost_same_host(self):
+        """
+        Test that an estimate on another vnode of a host used by an earlier
+        top job is redone when the job needs the host exclusively
+        """
+        a = {'resources_available.ncpus': 1}
+        self.mom.create_vnodes(a, num=4, sharednode=False,
+                               vnodes_per_host=2)
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+
+        # Find two vnodes on the same host
+        hosts = {}
+        for n in self.server.status(NODE):
+            if n['resources_available.ncpus'] != '1':
+                continue
+            hosts.setdefault(n['resources_available.host'], []).append(
+                n['id'])
+        vns = [v for v in hosts.values() if len(v) == 2][0]
+
+        a = {'Resource_List.select': '4:ncpus=1',
+             'Resource_List.walltime': 100}
+        j = Job(TEST_USER, attrs=a)
+        jid1 = self.server.submit(j)
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, {ATTR_state: 'R'}, id=jid1)
+
+        a = {'Resource_List.select': '1:ncpus=1:vnode=' + vns[0],
+             'Resource_List.walltime': 100}
+        jid2 = self.server.submit(Job(TEST_USER, attrs=a))
+        a = {'Resource_List.select': '1:ncpus=1:vnode=' + vns[1],
+             'Resource_List.place': 'exclhost',
+             'Resource_List.walltime': 100}
+        jid3 = self.server.submit(Job(TEST_USER, attrs=a))
+
+        ests = self.compare_with_serial([jid2, jid3])
+
+        # The exclhost job can't start until the first one is done
+        fmt = '%a %b %d %H:%M:%S %Y'
+        st2 = time.mktime(time.strptime(ests[jid2][0], fmt))
+        st3 = time.mktime(time.strptime(ests[jid3][0], fmt))
+        self.assertGreaterEqual(st3, st2 + 100)
@@ -0,0 +1,179 @@
+# coding: utf-8
+
+# Copyright (C) 1994-2021 Altair Engineering, Inc.
+# For more information, contact Altair at www.altair.com.
+#
+# This file is part of both the OpenPBS software ("OpenPBS")
+# and the PBS Professional ("PBS Pro") software.
+#
+# Open Source License Information:
+#
+# OpenPBS is free software. You can redistribute it and/or modify it under
+# the terms of the GNU Affero General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Commercial License Information:
+#
+# PBS Pro is commercially licensed software that shares a common core with
+# the OpenPBS software.  For a copy of the commercial license terms and
+# conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+# Altair Legal Department.
+#
+# Altair's dual-license business model allows companies, individuals, and
+# organizations to create proprietary derivative works of OpenPBS and
+# distribute them - whether embedded or bundled with other software -
+# under a commercial license agreement.
+#
+# Use of Altair's trademarks, including but not limited to "PBS™",
+# "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+# subject to Altair's trademark licensing policies.
+
+
+from tests.functional import *
+
+
+class TestSchedRunJobWindow(TestFunctional):
+    """
+    Tests for run requests pipelined with the run_job_window option
+    """
+
+    hook_txt = """
+import pbs
+
+if pbs.event().job.id == '%s':
+    pbs.event().reject("rejecting job")
+pbs.event().accept()
+"""
+
+    def setUp(self):
+        TestFunctional.setUp(self)
+        self.server.manager(MGR_CMD_SET, SCHED,
+                            {'job_run_wait': 'runjob_hook',
+                             'log_events': 2047})
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        self.scheduler.set_sched_config({'run_job_window': '4',
+                                         'strict_ordering': 'True ALL'})
+
+    def reject_in_hook(self, jid):
+        """
+        Create a runjob hook which rejects job jid
+        """
+        hk_attrs = {'event': 'runjob', 'enabled': 'True'}
+        self.server.create_import_hook('rj', hk_attrs, self.hook_txt % jid)
+
+    def test_reject_pipelined_run(self):
+        """
+        Test that a pipelined run rejected by the runjob hook puts the job
+        back as queued and its end is taken out of the calendar before the
+        top job is estimated in the same cycle
+        """
+        a = {'resources_available.ncpus': 2}
+        self.server.manager(MGR_CMD_SET, NODE, a, id=self.mom.shortname)
+
+        a = {'Resource_List.select': '1:ncpus=1',
+             'Resource_List.walltime': 1000}
+        jid1 = self.server.submit(Job(TEST_USER, attrs=a))
+        a = {'Resource_List.select': '1:ncpus=1',
+             'Resource_List.walltime': 100}
+        jid2 = self.server.submit(Job(TEST_USER, attrs=a))
+        a = {'Resource_List.select': '1:ncpus=2',
+             'Resource_List.walltime': 100}
+        jid3 = self.server.submit(Job(TEST_USER, attrs=a))
+        self.reject_in_hook(jid1)
+
+        t = time.time()
+        self.scheduler.run_scheduling_cycle()
+        self.scheduler.log_match(jid1 + ';Run request rejected',
+                                 starttime=t)
+        self.server.expect(JOB, {'job_state': 'Q'}, id=jid1)
+        self.server.expect(JOB, {'comment': (MATCH_RE, 'Not Running')},
+                           id=jid1)
+        self.server.expect(JOB, {'job_state': 'R'}, id=jid2)
+
+        # The rejected job's end is gone from the calendar, so the top job
+        # is estimated to start when the job which did run ends, not when
+        # the rejected job would have ended
+        self.server.expect(JOB, 'estimated.start_time', op=SET, id=jid3)
+        st = self.server.status(JOB, ['stime'], id=jid2)
+        stime2 = int(time.mktime(time.strptime(st[0]['stime'],
+                                               '%a %b %d %H:%M:%S %Y')))
+        st = self.server.status(JOB, ['estimated.start_time'], id=jid3)
+        est3 = int(time.mktime(time.strptime(st[0]['estimated.start_time'],
+                                             '%a %b %d %H:%M:%S %Y')))
+        self.assertGreaterEqual(est3, stime2 + 100)
+        self.assertLess(est3, stime2 + 1000)
+
+    def test_preemptor_run_not_pipelined(self):
+        """
+        Test that the run of a job which preempted work waits for the
+        reply, and the preempted work is restored when it is rejected
+        """
+        a = {'resources_available.ncpus': 1}
+        self.server.manager(MGR_CMD_SET, NODE, a, id=self.mom.shortname)
+        a = {'queue_type': 'execution', 'started': 'True',
+             'enabled': 'True', 'Priority': 150}
+        self.server.manager(MGR_CMD_CREATE, QUEUE, a, id='expressq')
+
+        a = {'Resource_List.select': '1:ncpus=1'}
+        jid1 = self.server.submit(Job(TEST_USER, attrs=a))
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, {'job_state': 'R'}, id=jid1)
+
+        a = {'Resource_List.select': '1:ncpus=1', 'queue': 'expressq'}
+        jid2 = self.server.submit(Job(TEST_USER, attrs=a))
+        self.reject_in_hook(jid2)
+
+        t = time.time()
+        self.scheduler.run_scheduling_cycle()
+        self.scheduler.log_match(
+            jid2 + ";Preempted work didn't run job - rerun it", starttime=t)
+        self.scheduler.log_match(jid2 + ';Run request rejected',
+                                 starttime=t, existence=False,
+                                 max_attempts=2)
+        self.server.expect(JOB, {'job_state': 'Q'}, id=jid2)
+        self.server.expect(JOB, {'job_state': 'R'}, id=jid1)
+
+    def test_reject_keeps_preempted_state(self):
+        """
+        Test that a rejected pipelined run of a requeued preempted job
+        leaves the job's preempted time set
+        """
+        a = {'resources_available.ncpus': 1}
+        self.server.manager(MGR_CMD_SET, NODE, a, id=self.mom.shortname)
+        self.server.manager(MGR_CMD_SET, SCHED, {'preempt_order': 'R'},
+                            runas=ROOT_USER)
+        a = {'queue_type': 'execution', 'started': 'True',
+             'enabled': 'True', 'Priority': 150}
+        self.server.manager(MGR_CMD_CREATE, QUEUE, a, id='expressq')
+
+        a = {'Resource_List.select': '1:ncpus=1'}
+        jid1 = self.server.submit(Job(TEST_USER, attrs=a))
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, {'job_state': 'R'}, id=jid1)
+
+        a = {'Resource_List.select': '1:ncpus=1', 'queue': 'expressq'}
+        j = Job(TEST_USER, attrs=a)
+        j.set_sleep_time(5)
+        jid2 = self.server.submit(j)
+        self.scheduler.run_scheduling_cycle()
+        self.server.expect(JOB, {'job_state': 'R'}, id=jid2)
+        self.server.expect(JOB, {'job_state': 'Q'}, id=jid1)
+        self.server.expect(JOB, 'ptime', op=SET, id=jid1)
+        self.server.expect(JOB, 'queue', op=UNSET, id=jid2, offset=5)
+
+        self.reject_in_hook(jid1)
+        t = time.time()
+        self.scheduler.run_scheduling_cycle()
+        self.scheduler.log_match(jid1 + ';Run request rejected',
+                                 starttime=t)
+        self.server.expect(JOB, {'job_state': 'Q'}, id=jid1)
+        self.server.expect(JOB, 'ptime', op=SET, id=jid1)
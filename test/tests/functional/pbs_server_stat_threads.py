@@ -0,0 +1,154 @@
+# coding: utf-8
+
+# Copyright (C) 1994-2021 Altair Engineering, Inc.
+# For more information, contact Altair at www.altair.com.
+#
+# This file is part of both the OpenPBS software ("OpenPBS")
+# and the PBS Professional ("PBS Pro") software.
+#
+# Open Source License Information:
+#
+# OpenPBS is free software. You can redistribute it and/or modify it under
+# the terms of the GNU Affero General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# OpenPBS is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Affero General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Commercial License Information:
+#
+# PBS Pro is commercially licensed software that shares a common core with
+# the OpenPBS software.  For a copy of the commercial license terms and
+# conditions, go to: (http://www.pbspro.com/agreement.html) or contact the
+# Altair Legal Department.
+#
+# Altair's dual-license business model allows companies, individuals, and
+# organizations to create proprietary derivative works of OpenPBS and
+# distribute them - whether embedded or bundled with other software -
+# under a commercial license agreement.
+#
+# Use of Altair's trademarks, including but not limited to "PBS™",
+# "OpenPBS®", "PBS Professional®", and "PBS Pro™" and Altair's logos is
+# subject to Altair's trademark licensing policies.
+
+
+import subprocess
+
+from tests.functional import *
+
+
+class TestServerStatThreads(TestFunctional):
+    """
+    Test status requests served by the server's status worker threads
+    (PBS_SERVER_STAT_THREADS)
+    """
+
+    def setUp(self):
+        TestFunctional.setUp(self)
+        self.du.set_pbs_config(self.server.hostname,
+                               confs={'PBS_SERVER_STAT_THREADS': '4'})
+        self.server.restart()
+        self.server.manager(MGR_CMD_SET, SERVER, {'scheduling': 'False'})
+        self.qstat = os.path.join(self.server.pbs_conf['PBS_EXEC'],
+                                  'bin', 'qstat')
+
+    def tearDown(self):
+        self.du.unset_pbs_config(self.server.hostname,
+                                 confs='PBS_SERVER_STAT_THREADS')
+        self.server.restart()
+        TestFunctional.tearDown(self)
+
+    def submit_jobs(self, num):
+        """
+        Submit num jobs and return their ids
+        """
+        j = Job(TEST_USER)
+        return [self.server.submit(j) for _ in range(num)]
+
+    def test_large_qstat_f(self):
+        """
+        Test that a qstat -f of more jobs than fit in one batch of the
+        reply lists every job once
+        """
+        jids = self.submit_jobs(1100)
+        st = self.server.status(JOB)
+        self.assertEqual(sorted([j['id'] for j in st]), sorted(jids))
+
+        # A queue's jobs are walked the same way
+        st = self.server.status(JOB, id='workq')
+        self.assertEqual(len(st), len(jids))
+
+    def test_client_disconnects_mid_reply(self):
+        """
+        Test that the server keeps serving status requests after clients
+        go away while their reply is being sent
+        """
+        jids = self.submit_jobs(1100)
+        for _ in range(10):
+            p = subprocess.Popen([self.qstat, '-f'],
+                                 stdout=subprocess.PIPE,
+                                 stderr=subprocess.DEVNULL)
+            time.sleep(0.1)
+            p.kill()
+            p.wait()
+        self.assertTrue(self.server.isUp())
+        st = self.server.status(JOB)
+        self.assertEqual(len(st), len(jids))
+
+    def test_jobs_deleted_during_yield(self):
+        """
+        Test that a qstat -f walk which lets go of the server between
+        batches carries on when jobs are deleted in between
+        """
+        jids = self.submit_jobs(1500)
+        procs = [subprocess.Popen([self.qstat, '-f'],
+                                  stdout=subprocess.PIPE,
+                                  stderr=subprocess.PIPE)
+                 for _ in range(4)]
+        self.server.delete(jids[400:1200], wait=False)
+        for p in procs:
+            out, _ = p.communicate()
+            self.assertEqual(p.returncode, 0)
+            # no job is listed twice
+            ids = [l for l in out.decode().splitlines()
+                   if l.startswith('Job Id: ')]
+            self.assertEqual(len(ids), len(set(ids)))
+        self.assertTrue(self.server.isUp())
+        left = jids[:400] + jids[1200:]
+        st = self.server.status(JOB)
+        self.assertEqual(sorted([j['id'] for j in st]), sorted(left))
+
+    def test_large_pbsnodes(self):
+        """
+        Test that a pbsnodes -av of more vnodes than fit in one batch of
+        the reply lists every vnode once, also while vnodes are deleted
+        """
+        a = {'resources_available.ncpus': 1}
+        self.mom.create_vnodes(a, 1100)
+        st = self.server.status(NODE)
+        names = [n['id'] for n in st]
+        self.assertEqual(len(names), len(set(names)))
+        self.assertGreaterEqual(len(names), 1100)
+
+        pbsnodes = os.path.join(self.server.pbs_conf['PBS_EXEC'],
+                                'bin', 'pbsnodes')
+        procs = [subprocess.Popen([pbsnodes, '-av'],
+                                  stdout=subprocess.PIPE,
+                                  stderr=subprocess.PIPE)
+                 for _ in range(4)]
+        for name in sorted(names)[100:150]:
+            self.server.manager(MGR_CMD_DELETE, NODE, id=name)
+        for p in procs:
+            out, _ = p.communicate()
+            self.assertEqual(p.returncode, 0)
+            # no vnode is listed twice
+            ids = [l for l in out.decode().splitlines()
+                   if l and not l[0].isspace()]
+            self.assertEqual(len(ids), len(set(ids)))
+        self.assertTrue(self.server.isUp())